@@ -18,6 +18,142 @@ public:
   static Status create(Ref &ref, IVirtualDatabase &virtual_database,
                        const std::string &configuration_file_path);
 
+  /// \brief Per-process rate limiting settings for the event tables
+  struct EventRateLimit final {
+    /// \brief How many events per second each (exe, uid) pair can generate.
+    ///        Zero disables rate limiting
+    std::uint32_t events_per_second{0U};
+
+    /// \brief How many events can be generated in a single burst
+    std::uint32_t burst_size{0U};
+
+    /// \brief When greater than one, one in sampling_ratio processes keeps
+    ///        reporting events after its (exe, uid) pair has been limited
+    std::uint32_t sampling_ratio{0U};
+  };
+
+  /// \brief Settings for the batched wire mode, where a single Zeek event
+  ///        carries many result rows
+  struct ZeekEventBatching final {
+    /// \brief The maximum amount of rows in each event. Zero sends one
+    ///        event per row
+    std::uint32_t max_row_count{0U};
+
+    /// \brief The (approximate) maximum size of the rows in each event
+    std::uint32_t max_byte_count{65536U};
+  };
+
+  /// \brief Settings for the queue of the query outputs waiting to be
+  ///        published
+  struct OutputQueue final {
+    /// \brief What happens when the queue is full
+    enum class OverflowPolicy {
+      /// \brief The query scheduler is paused until there is room again
+      Block,
+
+      /// \brief The queued snapshots are dropped first, then the query
+      ///        scheduler is paused
+      DropSnapshots
+    };
+
+    /// \brief The (approximate) maximum size of the queued outputs, for
+    ///        each server endpoint
+    std::uint32_t max_queued_byte_count{64U * 1024U * 1024U};
+
+    /// \brief What happens when the queue is full
+    OverflowPolicy overflow_policy{OverflowPolicy::Block};
+
+    /// \brief How many rows can be published each second on a single
+    ///        response topic; 0 means unlimited
+    std::uint32_t max_topic_rows_per_second{0U};
+
+    /// \brief How many rows can be published each second for a single
+    ///        query; 0 means unlimited
+    std::uint32_t max_query_rows_per_second{0U};
+
+    /// \brief How many rows each query can publish in its turn, when
+    ///        several queries have pending output
+    std::uint32_t fair_queuing_quantum{1000U};
+  };
+
+  /// \brief A Zeek server endpoint
+  struct ServerEndpoint final {
+    /// \brief The server address
+    std::string address;
+
+    /// \brief The server port
+    std::uint16_t port{0U};
+  };
+
+  /// \brief Settings for the connections to the Zeek servers
+  struct ServerEndpoints final {
+    /// \brief How the output is distributed across the endpoints
+    enum class Policy {
+      /// \brief All the output goes to the first connected endpoint
+      Failover,
+
+      /// \brief Each query is assigned to an endpoint, based on its ID
+      ShardByQuery,
+
+      /// \brief Each response topic is assigned to an endpoint
+      ShardByTopic
+    };
+
+    /// \brief The endpoints to connect to; the first one is always
+    ///        server_address:server_port
+    std::vector<ServerEndpoint> endpoint_list;
+
+    /// \brief How the output is distributed across the endpoints. When an
+    ///        endpoint is not connected, its output goes to the next
+    ///        connected one
+    Policy policy{Policy::Failover};
+  };
+
+  /// \brief Settings for the reconnection to the Zeek server. The delay
+  ///        before each attempt is picked at random, under a ceiling that
+  ///        doubles after every failed attempt
+  struct Reconnect final {
+    /// \brief The ceiling used for the first attempt, in milliseconds
+    std::uint32_t initial_backoff_ms{250U};
+
+    /// \brief The maximum ceiling, in milliseconds
+    std::uint32_t max_backoff_ms{30000U};
+  };
+
+  /// \brief Settings for the disk spool that keeps the query outputs while
+  ///        no Zeek server is connected
+  struct OutputSpool final {
+    /// \brief Where the spool segments are stored. The spool is disabled
+    ///        when empty
+    std::string folder_path;
+
+    /// \brief The maximum size of the spool on disk. The oldest segments
+    ///        are dropped to make room
+    std::uint32_t max_byte_count{256U * 1024U * 1024U};
+
+    /// \brief The size of each spool segment
+    std::uint32_t segment_byte_count{4U * 1024U * 1024U};
+
+    /// \brief How many spooled rows are replayed each second once a Zeek
+    ///        server is connected. Zero disables the limit
+    std::uint32_t replay_rows_per_second{10000U};
+  };
+
+  /// \brief Settings for the rotation of the agent log files
+  struct LogRotation final {
+    /// \brief The size after which a new log file is started. Zero disables
+    ///        the limit
+    std::uint32_t max_log_file_byte_count{64U * 1024U * 1024U};
+
+    /// \brief How many seconds a log file is written to before a new one is
+    ///        started. Zero disables the limit
+    std::uint32_t max_log_file_age{86400U};
+
+    /// \brief How many log files are kept, including the current one. Zero
+    ///        keeps all of them
+    std::uint32_t max_log_file_count{10U};
+  };
+
   /// \brief Constructor
   IZeekConfiguration() = default;
 
@@ -49,10 +185,52 @@ public:
   /// \return Returns the path for the configured osquery extensions socket
   virtual const std::string &osqueryExtensionsSocket() const = 0;
 
+  /// \return Returns the path of the query state snapshot. When empty, the
+  ///         scheduled queries are only kept across reconnects
+  virtual const std::string &stateSnapshotPath() const = 0;
+
   /// \return Returns the maximum number of rows that can be queued in a table
   ///         that is waiting to be queried
   virtual std::size_t maxQueuedRowCount() const = 0;
 
+  /// \return Returns the path rules that select which file events are
+  ///         always reported
+  virtual const std::vector<std::string> &fileEventsIncludeList() const = 0;
+
+  /// \return Returns the path rules that select which file events are
+  ///         discarded before they are stored in the file_events table
+  virtual const std::vector<std::string> &fileEventsExcludeList() const = 0;
+
+  /// \return Returns how many seconds identical events are merged for before
+  ///         they are stored in the event tables. Zero disables coalescing
+  virtual std::uint32_t eventCoalescingWindow() const = 0;
+
+  /// \return Returns the rate limiting settings for the event tables
+  virtual const EventRateLimit &eventRateLimit() const = 0;
+
+  /// \return Returns the maximum amount of rows published at once for a
+  ///         single query. Zero disables chunking
+  virtual std::uint32_t queryOutputChunkSize() const = 0;
+
+  /// \return Returns the settings for the batched wire mode
+  virtual const ZeekEventBatching &zeekEventBatching() const = 0;
+
+  /// \return Returns the settings for the output queue
+  virtual const OutputQueue &outputQueue() const = 0;
+
+  /// \return Returns the settings for the reconnection to the Zeek server
+  virtual const Reconnect &reconnect() const = 0;
+
+  /// \return Returns the Zeek server endpoints, starting with the one
+  ///         configured with serverAddress and serverPort
+  virtual const ServerEndpoints &serverEndpoints() const = 0;
+
+  /// \return Returns the settings for the output spool
+  virtual const OutputSpool &outputSpool() const = 0;
+
+  /// \return Returns the settings for the rotation of the log files
+  virtual const LogRotation &logRotation() const = 0;
+
   IZeekConfiguration(const IZeekConfiguration &) = delete;
   IZeekConfiguration &operator=(const IZeekConfiguration &) = delete;
 };
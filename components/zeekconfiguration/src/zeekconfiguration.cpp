@@ -17,6 +17,9 @@ namespace {
 #define REQUIRE_OSQUERY_EXTENSIONS_SOCKET false
 #endif
 
+/// \brief The smallest accepted output spool segment
+const std::uint32_t kMinSpoolSegmentByteCount{64U * 1024U};
+
 // clang-format off
 const ConfigurationChecker::Constraints kConfigurationConstraints = {
   {
@@ -107,6 +110,281 @@ const ConfigurationChecker::Constraints kConfigurationConstraints = {
     }
   },
 
+  {
+    "event_coalescing_window",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "",
+      false
+    }
+  },
+
+  {
+    "query_output_chunk_size",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "",
+      false
+    }
+  },
+
+  {
+    "events_per_second",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "event_rate_limit",
+      false
+    }
+  },
+
+  {
+    "burst_size",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "event_rate_limit",
+      false
+    }
+  },
+
+  {
+    "sampling_ratio",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "event_rate_limit",
+      false
+    }
+  },
+
+  {
+    "max_row_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "zeek_event_batching",
+      false
+    }
+  },
+
+  {
+    "max_byte_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "zeek_event_batching",
+      false
+    }
+  },
+
+  {
+    "max_queued_byte_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_queue",
+      false
+    }
+  },
+
+  {
+    "overflow_policy",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      false,
+      "output_queue",
+      false
+    }
+  },
+
+  {
+    "max_topic_rows_per_second",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_queue",
+      false
+    }
+  },
+
+  {
+    "max_query_rows_per_second",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_queue",
+      false
+    }
+  },
+
+  {
+    "fair_queuing_quantum",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_queue",
+      false
+    }
+  },
+
+  {
+    "initial_backoff_ms",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "reconnect",
+      false
+    }
+  },
+
+  {
+    "max_backoff_ms",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "reconnect",
+      false
+    }
+  },
+
+  {
+    "spool_folder_path",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      false,
+      "output_spool",
+      false
+    }
+  },
+
+  {
+    "max_spool_byte_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_spool",
+      false
+    }
+  },
+
+  {
+    "spool_segment_byte_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_spool",
+      false
+    }
+  },
+
+  {
+    "replay_rows_per_second",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "output_spool",
+      false
+    }
+  },
+
+  {
+    "max_log_file_byte_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "log_rotation",
+      false
+    }
+  },
+
+  {
+    "max_log_file_age",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "log_rotation",
+      false
+    }
+  },
+
+  {
+    "max_log_file_count",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::UInt32,
+      false,
+      "log_rotation",
+      false
+    }
+  },
+
+  {
+    "endpoint_list",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      true,
+      "server_endpoints",
+      false
+    }
+  },
+
+  {
+    "endpoint_policy",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      false,
+      "server_endpoints",
+      false
+    }
+  },
+
+  {
+    "include_path_list",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      true,
+      "file_events",
+      false
+    }
+  },
+
+  {
+    "exclude_path_list",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      true,
+      "file_events",
+      false
+    }
+  },
+
   {
     "osquery_extensions_socket",
 
@@ -116,6 +394,17 @@ const ConfigurationChecker::Constraints kConfigurationConstraints = {
       "",
       REQUIRE_OSQUERY_EXTENSIONS_SOCKET
     }
+  },
+
+  {
+    "state_snapshot_path",
+
+    {
+      ConfigurationChecker::MemberConstraint::Type::String,
+      false,
+      "",
+      false
+    }
   }
 };
 // clang-format on
@@ -171,10 +460,63 @@ const std::string &ZeekConfiguration::osqueryExtensionsSocket() const {
   return d->context.osquery_extensions_socket;
 }
 
+const std::string &ZeekConfiguration::stateSnapshotPath() const {
+  return d->context.state_snapshot_path;
+}
+
 std::size_t ZeekConfiguration::maxQueuedRowCount() const {
   return d->context.max_queued_row_count;
 }
 
+const std::vector<std::string> &
+ZeekConfiguration::fileEventsIncludeList() const {
+  return d->context.file_events_include_list;
+}
+
+const std::vector<std::string> &
+ZeekConfiguration::fileEventsExcludeList() const {
+  return d->context.file_events_exclude_list;
+}
+
+std::uint32_t ZeekConfiguration::eventCoalescingWindow() const {
+  return d->context.event_coalescing_window;
+}
+
+const IZeekConfiguration::EventRateLimit &
+ZeekConfiguration::eventRateLimit() const {
+  return d->context.event_rate_limit;
+}
+
+std::uint32_t ZeekConfiguration::queryOutputChunkSize() const {
+  return d->context.query_output_chunk_size;
+}
+
+const IZeekConfiguration::ZeekEventBatching &
+ZeekConfiguration::zeekEventBatching() const {
+  return d->context.zeek_event_batching;
+}
+
+const IZeekConfiguration::OutputQueue &ZeekConfiguration::outputQueue() const {
+  return d->context.output_queue;
+}
+
+const IZeekConfiguration::Reconnect &ZeekConfiguration::reconnect() const {
+  return d->context.reconnect;
+}
+
+const IZeekConfiguration::ServerEndpoints &
+ZeekConfiguration::serverEndpoints() const {
+  return d->context.server_endpoints;
+}
+
+const IZeekConfiguration::OutputSpool &ZeekConfiguration::outputSpool() const {
+  return d->context.output_spool;
+}
+
+const IZeekConfiguration::LogRotation &ZeekConfiguration::logRotation() const {
+  return d->context.log_rotation;
+}
+
 ZeekConfiguration::ZeekConfiguration(IVirtualDatabase &virtual_database,
                                      const std::string &configuration_file_path)
     : d(new PrivateData(virtual_database)) {
@@ -267,11 +609,58 @@ Status ZeekConfiguration::parseConfigurationData(Context &context,
     context.osquery_extensions_socket = "";
   }
 
+  if (document.HasMember("state_snapshot_path")) {
+    context.state_snapshot_path = document["state_snapshot_path"].GetString();
+
+  } else {
+    context.state_snapshot_path = "";
+  }
+
   context.server_port =
       static_cast<std::uint16_t>(document["server_port"].GetInt());
 
   context.log_folder = document["log_folder"].GetString();
 
+  auto &server_endpoints = context.server_endpoints;
+  server_endpoints.endpoint_list.push_back(
+      {context.server_address, context.server_port});
+
+  if (document.HasMember("server_endpoints")) {
+    const auto &server_endpoints_object = document["server_endpoints"];
+
+    if (server_endpoints_object.HasMember("endpoint_list")) {
+      const auto &endpoint_list = server_endpoints_object["endpoint_list"];
+
+      for (auto i = 0U; i < endpoint_list.Size(); ++i) {
+        ServerEndpoint endpoint;
+        status = parseServerEndpoint(endpoint, endpoint_list[i].GetString());
+        if (!status.succeeded()) {
+          return status;
+        }
+
+        server_endpoints.endpoint_list.push_back(std::move(endpoint));
+      }
+    }
+
+    if (server_endpoints_object.HasMember("endpoint_policy")) {
+      std::string policy =
+          server_endpoints_object["endpoint_policy"].GetString();
+
+      if (policy == "failover") {
+        server_endpoints.policy = ServerEndpoints::Policy::Failover;
+
+      } else if (policy == "shard_by_query") {
+        server_endpoints.policy = ServerEndpoints::Policy::ShardByQuery;
+
+      } else if (policy == "shard_by_topic") {
+        server_endpoints.policy = ServerEndpoints::Policy::ShardByTopic;
+
+      } else {
+        return Status::failure("Invalid server endpoint policy: " + policy);
+      }
+    }
+  }
+
   const auto &group_list = document["group_list"];
 
   for (auto i = 0U; i < group_list.Size(); ++i) {
@@ -287,6 +676,200 @@ Status ZeekConfiguration::parseConfigurationData(Context &context,
     context.max_queued_row_count = 50000U;
   }
 
+  if (document.HasMember("event_coalescing_window")) {
+    context.event_coalescing_window = static_cast<std::uint32_t>(
+        document["event_coalescing_window"].GetInt());
+
+  } else {
+    context.event_coalescing_window = 0U;
+  }
+
+  if (document.HasMember("event_rate_limit")) {
+    const auto &event_rate_limit_object = document["event_rate_limit"];
+    auto &event_rate_limit = context.event_rate_limit;
+
+    if (event_rate_limit_object.HasMember("events_per_second")) {
+      event_rate_limit.events_per_second = static_cast<std::uint32_t>(
+          event_rate_limit_object["events_per_second"].GetInt());
+    }
+
+    if (event_rate_limit_object.HasMember("burst_size")) {
+      event_rate_limit.burst_size = static_cast<std::uint32_t>(
+          event_rate_limit_object["burst_size"].GetInt());
+
+    } else {
+      event_rate_limit.burst_size = event_rate_limit.events_per_second;
+    }
+
+    if (event_rate_limit_object.HasMember("sampling_ratio")) {
+      event_rate_limit.sampling_ratio = static_cast<std::uint32_t>(
+          event_rate_limit_object["sampling_ratio"].GetInt());
+    }
+  }
+
+  if (document.HasMember("query_output_chunk_size")) {
+    context.query_output_chunk_size = static_cast<std::uint32_t>(
+        document["query_output_chunk_size"].GetInt());
+
+  } else {
+    context.query_output_chunk_size = 1024U;
+  }
+
+  if (document.HasMember("zeek_event_batching")) {
+    const auto &zeek_event_batching_object = document["zeek_event_batching"];
+    auto &zeek_event_batching = context.zeek_event_batching;
+
+    if (zeek_event_batching_object.HasMember("max_row_count")) {
+      zeek_event_batching.max_row_count = static_cast<std::uint32_t>(
+          zeek_event_batching_object["max_row_count"].GetInt());
+    }
+
+    if (zeek_event_batching_object.HasMember("max_byte_count")) {
+      zeek_event_batching.max_byte_count = static_cast<std::uint32_t>(
+          zeek_event_batching_object["max_byte_count"].GetInt());
+    }
+  }
+
+  if (document.HasMember("output_queue")) {
+    const auto &output_queue_object = document["output_queue"];
+    auto &output_queue = context.output_queue;
+
+    if (output_queue_object.HasMember("max_queued_byte_count")) {
+      output_queue.max_queued_byte_count = static_cast<std::uint32_t>(
+          output_queue_object["max_queued_byte_count"].GetInt());
+    }
+
+    if (output_queue_object.HasMember("overflow_policy")) {
+      std::string overflow_policy =
+          output_queue_object["overflow_policy"].GetString();
+
+      if (overflow_policy == "block") {
+        output_queue.overflow_policy = OutputQueue::OverflowPolicy::Block;
+
+      } else if (overflow_policy == "drop_snapshots") {
+        output_queue.overflow_policy =
+            OutputQueue::OverflowPolicy::DropSnapshots;
+
+      } else {
+        return Status::failure("Invalid output queue overflow policy: " +
+                               overflow_policy);
+      }
+    }
+
+    if (output_queue_object.HasMember("max_topic_rows_per_second")) {
+      output_queue.max_topic_rows_per_second = static_cast<std::uint32_t>(
+          output_queue_object["max_topic_rows_per_second"].GetInt());
+    }
+
+    if (output_queue_object.HasMember("max_query_rows_per_second")) {
+      output_queue.max_query_rows_per_second = static_cast<std::uint32_t>(
+          output_queue_object["max_query_rows_per_second"].GetInt());
+    }
+
+    if (output_queue_object.HasMember("fair_queuing_quantum")) {
+      output_queue.fair_queuing_quantum = static_cast<std::uint32_t>(
+          output_queue_object["fair_queuing_quantum"].GetInt());
+    }
+
+    if (output_queue.fair_queuing_quantum == 0U) {
+      return Status::failure("Invalid output queue fair queuing quantum");
+    }
+  }
+
+  if (document.HasMember("reconnect")) {
+    const auto &reconnect_object = document["reconnect"];
+    auto &reconnect = context.reconnect;
+
+    if (reconnect_object.HasMember("initial_backoff_ms")) {
+      reconnect.initial_backoff_ms = static_cast<std::uint32_t>(
+          reconnect_object["initial_backoff_ms"].GetInt());
+    }
+
+    if (reconnect_object.HasMember("max_backoff_ms")) {
+      reconnect.max_backoff_ms = static_cast<std::uint32_t>(
+          reconnect_object["max_backoff_ms"].GetInt());
+    }
+
+    if (reconnect.initial_backoff_ms == 0U ||
+        reconnect.max_backoff_ms < reconnect.initial_backoff_ms) {
+      return Status::failure("Invalid reconnect backoff settings");
+    }
+  }
+
+  if (document.HasMember("output_spool")) {
+    const auto &output_spool_object = document["output_spool"];
+    auto &output_spool = context.output_spool;
+
+    if (output_spool_object.HasMember("spool_folder_path")) {
+      output_spool.folder_path =
+          output_spool_object["spool_folder_path"].GetString();
+    }
+
+    if (output_spool_object.HasMember("max_spool_byte_count")) {
+      output_spool.max_byte_count = static_cast<std::uint32_t>(
+          output_spool_object["max_spool_byte_count"].GetInt());
+    }
+
+    if (output_spool_object.HasMember("spool_segment_byte_count")) {
+      output_spool.segment_byte_count = static_cast<std::uint32_t>(
+          output_spool_object["spool_segment_byte_count"].GetInt());
+    }
+
+    if (output_spool_object.HasMember("replay_rows_per_second")) {
+      output_spool.replay_rows_per_second = static_cast<std::uint32_t>(
+          output_spool_object["replay_rows_per_second"].GetInt());
+    }
+
+    // The spool needs room for at least two segments: the one being
+    // replayed and the one being written
+    if (output_spool.segment_byte_count < kMinSpoolSegmentByteCount ||
+        output_spool.max_byte_count / 2U < output_spool.segment_byte_count) {
+      return Status::failure("Invalid output spool settings");
+    }
+  }
+
+  if (document.HasMember("log_rotation")) {
+    const auto &log_rotation_object = document["log_rotation"];
+    auto &log_rotation = context.log_rotation;
+
+    if (log_rotation_object.HasMember("max_log_file_byte_count")) {
+      log_rotation.max_log_file_byte_count = static_cast<std::uint32_t>(
+          log_rotation_object["max_log_file_byte_count"].GetInt());
+    }
+
+    if (log_rotation_object.HasMember("max_log_file_age")) {
+      log_rotation.max_log_file_age = static_cast<std::uint32_t>(
+          log_rotation_object["max_log_file_age"].GetInt());
+    }
+
+    if (log_rotation_object.HasMember("max_log_file_count")) {
+      log_rotation.max_log_file_count = static_cast<std::uint32_t>(
+          log_rotation_object["max_log_file_count"].GetInt());
+    }
+  }
+
+  if (document.HasMember("file_events")) {
+    const auto &file_events_object = document["file_events"];
+
+    if (file_events_object.HasMember("include_path_list")) {
+      const auto &include_path_list = file_events_object["include_path_list"];
+
+      for (auto i = 0U; i < include_path_list.Size(); ++i) {
+        context.file_events_include_list.push_back(
+            include_path_list[i].GetString());
+      }
+    }
+
+    if (file_events_object.HasMember("exclude_path_list")) {
+      const auto &exclude_path_list = file_events_object["exclude_path_list"];
+
+      for (auto i = 0U; i < exclude_path_list.Size(); ++i) {
+        context.file_events_exclude_list.push_back(
+            exclude_path_list[i].GetString());
+      }
+    }
+  }
+
   if (document.HasMember("authentication")) {
     const auto &auth_object = document["authentication"];
     std::vector<std::string> auth_file_list;
@@ -330,6 +913,39 @@ Status ZeekConfiguration::parseConfigurationData(Context &context,
   return Status::success();
 }
 
+Status ZeekConfiguration::parseServerEndpoint(ServerEndpoint &endpoint,
+                                              const std::string &value) {
+  endpoint = {};
+
+  auto separator_index = value.rfind(':');
+  if (separator_index == std::string::npos || separator_index == 0U ||
+      separator_index + 1U == value.size()) {
+    return Status::failure("Invalid server endpoint: " + value);
+  }
+
+  auto address = value.substr(0U, separator_index);
+  if (address.front() == '[' && address.back() == ']') {
+    address = address.substr(1U, address.size() - 2U);
+  }
+
+  auto port_string = value.substr(separator_index + 1U);
+  if (address.empty() ||
+      port_string.find_first_not_of("0123456789") != std::string::npos ||
+      port_string.size() > 5U) {
+    return Status::failure("Invalid server endpoint: " + value);
+  }
+
+  auto port = std::stoul(port_string);
+  if (port == 0U || port > 65535U) {
+    return Status::failure("Invalid server endpoint: " + value);
+  }
+
+  endpoint.address = std::move(address);
+  endpoint.port = static_cast<std::uint16_t>(port);
+
+  return Status::success();
+}
+
 Status IZeekConfiguration::create(Ref &ref, IVirtualDatabase &virtual_database,
                                   const std::string &configuration_file_path) {
   try {
@@ -34,10 +34,54 @@ public:
   /// \return Returns the path for the configured osquery extensions socket
   virtual const std::string &osqueryExtensionsSocket() const override;
 
+  /// \return Returns the path of the query state snapshot. When empty, the
+  ///         scheduled queries are only kept across reconnects
+  virtual const std::string &stateSnapshotPath() const override;
+
   /// \return Returns the maximum number of rows that can be queued in a table
   ///         that is waiting to be queried
   virtual std::size_t maxQueuedRowCount() const override;
 
+  /// \return Returns the path rules that select which file events are
+  ///         always reported
+  virtual const std::vector<std::string> &
+  fileEventsIncludeList() const override;
+
+  /// \return Returns the path rules that select which file events are
+  ///         discarded before they are stored in the file_events table
+  virtual const std::vector<std::string> &
+  fileEventsExcludeList() const override;
+
+  /// \return Returns how many seconds identical events are merged for before
+  ///         they are stored in the event tables. Zero disables coalescing
+  virtual std::uint32_t eventCoalescingWindow() const override;
+
+  /// \return Returns the rate limiting settings for the event tables
+  virtual const EventRateLimit &eventRateLimit() const override;
+
+  /// \return Returns the maximum amount of rows published at once for a
+  ///         single query. Zero disables chunking
+  virtual std::uint32_t queryOutputChunkSize() const override;
+
+  /// \return Returns the settings for the batched wire mode
+  virtual const ZeekEventBatching &zeekEventBatching() const override;
+
+  /// \return Returns the settings for the output queue
+  virtual const OutputQueue &outputQueue() const override;
+
+  /// \return Returns the settings for the reconnection to the Zeek server
+  virtual const Reconnect &reconnect() const override;
+
+  /// \return Returns the Zeek server endpoints, starting with the one
+  ///         configured with serverAddress and serverPort
+  virtual const ServerEndpoints &serverEndpoints() const override;
+
+  /// \return Returns the settings for the output spool
+  virtual const OutputSpool &outputSpool() const override;
+
+  /// \return Returns the settings for the rotation of the log files
+  virtual const LogRotation &logRotation() const override;
+
 protected:
   /// \brief Constructor
   /// \param virtual_database A reference to a virtual database instance. Used
@@ -91,9 +135,45 @@ public:
     /// \brief Path to the osquery extensions socket
     std::string osquery_extensions_socket;
 
+    /// \brief Path to the query state snapshot
+    std::string state_snapshot_path;
+
     /// \brief Maximum amount of rows that can be queued in a table that is
     /// waiting to be queried
     std::size_t max_queued_row_count;
+
+    /// \brief Path rules for file events that must always be reported
+    std::vector<std::string> file_events_include_list;
+
+    /// \brief Path rules for file events that must be discarded
+    std::vector<std::string> file_events_exclude_list;
+
+    /// \brief How many seconds identical events are merged for
+    std::uint32_t event_coalescing_window{0U};
+
+    /// \brief Rate limiting settings for the event tables
+    EventRateLimit event_rate_limit;
+
+    /// \brief Maximum amount of rows published at once for a single query
+    std::uint32_t query_output_chunk_size{1024U};
+
+    /// \brief Settings for the batched wire mode
+    ZeekEventBatching zeek_event_batching;
+
+    /// \brief Settings for the output queue
+    OutputQueue output_queue;
+
+    /// \brief Settings for the reconnection to the Zeek server
+    Reconnect reconnect;
+
+    /// \brief The Zeek server endpoints
+    ServerEndpoints server_endpoints;
+
+    /// \brief Settings for the output spool
+    OutputSpool output_spool;
+
+    /// \brief Settings for the rotation of the log files
+    LogRotation log_rotation;
   };
 
   /// \brief Parses the given configuration data in JSON format
@@ -102,5 +182,13 @@ public:
   /// \param A Status object
   static Status parseConfigurationData(Context &context,
                                        const std::string &json);
+
+  /// \brief Parses an endpoint in the address:port format. IPv6 addresses
+  ///        are enclosed in square brackets
+  /// \param endpoint Where the parsed endpoint is stored
+  /// \param value The endpoint string
+  /// \return A Status object
+  static Status parseServerEndpoint(ServerEndpoint &endpoint,
+                                    const std::string &value);
 };
 } // namespace zeek
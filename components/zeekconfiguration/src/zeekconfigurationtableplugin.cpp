@@ -107,9 +107,122 @@ Status ZeekConfigurationTablePlugin::generateRowList(RowList &row_list) {
   generateRow(row_list, "osquery_extensions_socket",
               d->configuration.osqueryExtensionsSocket());
 
+  generateRow(row_list, "state_snapshot_path",
+              d->configuration.stateSnapshotPath());
+
   generateRow(row_list, "max_queued_row_count",
               d->configuration.maxQueuedRowCount());
 
+  generateRow(row_list, "file_events.include_path_list",
+              d->configuration.fileEventsIncludeList());
+
+  generateRow(row_list, "file_events.exclude_path_list",
+              d->configuration.fileEventsExcludeList());
+
+  generateRow(row_list, "event_coalescing_window",
+              d->configuration.eventCoalescingWindow());
+
+  const auto &event_rate_limit = d->configuration.eventRateLimit();
+
+  generateRow(row_list, "event_rate_limit.events_per_second",
+              event_rate_limit.events_per_second);
+
+  generateRow(row_list, "event_rate_limit.burst_size",
+              event_rate_limit.burst_size);
+
+  generateRow(row_list, "event_rate_limit.sampling_ratio",
+              event_rate_limit.sampling_ratio);
+
+  generateRow(row_list, "query_output_chunk_size",
+              d->configuration.queryOutputChunkSize());
+
+  const auto &zeek_event_batching = d->configuration.zeekEventBatching();
+
+  generateRow(row_list, "zeek_event_batching.max_row_count",
+              zeek_event_batching.max_row_count);
+
+  generateRow(row_list, "zeek_event_batching.max_byte_count",
+              zeek_event_batching.max_byte_count);
+
+  const auto &output_queue = d->configuration.outputQueue();
+
+  generateRow(row_list, "output_queue.max_queued_byte_count",
+              output_queue.max_queued_byte_count);
+
+  generateRow(row_list, "output_queue.overflow_policy",
+              output_queue.overflow_policy ==
+                      IZeekConfiguration::OutputQueue::OverflowPolicy::Block
+                  ? "block"
+                  : "drop_snapshots");
+
+  generateRow(row_list, "output_queue.max_topic_rows_per_second",
+              output_queue.max_topic_rows_per_second);
+
+  generateRow(row_list, "output_queue.max_query_rows_per_second",
+              output_queue.max_query_rows_per_second);
+
+  generateRow(row_list, "output_queue.fair_queuing_quantum",
+              output_queue.fair_queuing_quantum);
+
+  const auto &server_endpoints = d->configuration.serverEndpoints();
+
+  std::vector<std::string> endpoint_list;
+  for (const auto &endpoint : server_endpoints.endpoint_list) {
+    endpoint_list.push_back(endpoint.address + ":" +
+                            std::to_string(endpoint.port));
+  }
+
+  generateRow(row_list, "server_endpoints.endpoint_list", endpoint_list);
+
+  std::string endpoint_policy;
+  switch (server_endpoints.policy) {
+  case IZeekConfiguration::ServerEndpoints::Policy::Failover:
+    endpoint_policy = "failover";
+    break;
+
+  case IZeekConfiguration::ServerEndpoints::Policy::ShardByQuery:
+    endpoint_policy = "shard_by_query";
+    break;
+
+  case IZeekConfiguration::ServerEndpoints::Policy::ShardByTopic:
+    endpoint_policy = "shard_by_topic";
+    break;
+  }
+
+  generateRow(row_list, "server_endpoints.endpoint_policy", endpoint_policy);
+
+  const auto &reconnect = d->configuration.reconnect();
+
+  generateRow(row_list, "reconnect.initial_backoff_ms",
+              reconnect.initial_backoff_ms);
+
+  generateRow(row_list, "reconnect.max_backoff_ms", reconnect.max_backoff_ms);
+
+  const auto &output_spool = d->configuration.outputSpool();
+
+  generateRow(row_list, "output_spool.spool_folder_path",
+              output_spool.folder_path);
+
+  generateRow(row_list, "output_spool.max_spool_byte_count",
+              output_spool.max_byte_count);
+
+  generateRow(row_list, "output_spool.spool_segment_byte_count",
+              output_spool.segment_byte_count);
+
+  generateRow(row_list, "output_spool.replay_rows_per_second",
+              output_spool.replay_rows_per_second);
+
+  const auto &log_rotation = d->configuration.logRotation();
+
+  generateRow(row_list, "log_rotation.max_log_file_byte_count",
+              log_rotation.max_log_file_byte_count);
+
+  generateRow(row_list, "log_rotation.max_log_file_age",
+              log_rotation.max_log_file_age);
+
+  generateRow(row_list, "log_rotation.max_log_file_count",
+              log_rotation.max_log_file_count);
+
   return Status::success();
 }
 
@@ -9,6 +9,8 @@ TEST_CASE("Reading configuration files", "[ZeekConfiguration]") {
   const std::string kExpectedCertFile{"nul"};
   const std::string kExceptedOsqueryExtensionsSocket{
       "C:\\osquery_extensions_socket"};
+  const std::string kExpectedStateSnapshotPath{"C:\\zeek-agent\\state.bin"};
+  const std::string kExpectedSpoolFolderPath{"C:\\zeek-agent\\spool"};
 
   const std::string kTestConfiguration = R""(
   {
@@ -28,8 +30,61 @@ TEST_CASE("Reading configuration files", "[ZeekConfiguration]") {
       "client_key": "nul"
     },
 
+    "file_events": {
+      "include_path_list": [
+        "C:\\Users\\"
+      ],
+
+      "exclude_path_list": [
+        "C:\\Windows\\",
+        "node_modules\\"
+      ]
+    },
+
+    "event_rate_limit": {
+      "events_per_second": 100,
+      "sampling_ratio": 16
+    },
+
+    "query_output_chunk_size": 4096,
+
+    "zeek_event_batching": {
+      "max_row_count": 256
+    },
+
+    "output_queue": {
+      "overflow_policy": "drop_snapshots",
+      "max_query_rows_per_second": 2000,
+      "fair_queuing_quantum": 250
+    },
+
+    "reconnect": {
+      "initial_backoff_ms": 500
+    },
+
+    "server_endpoints": {
+      "endpoint_list": [
+        "zeek-proxy-1:9999",
+        "[::1]:10000"
+      ],
+
+      "endpoint_policy": "shard_by_query"
+    },
+
+    "output_spool": {
+      "spool_folder_path": "C:\\zeek-agent\\spool",
+      "replay_rows_per_second": 500
+    },
+
+    "log_rotation": {
+      "max_log_file_byte_count": 1048576,
+      "max_log_file_count": 0
+    },
+
     "osquery_extensions_socket": "C:\\osquery_extensions_socket",
-    "max_queued_row_count": 1337
+    "state_snapshot_path": "C:\\zeek-agent\\state.bin",
+    "max_queued_row_count": 1337,
+    "event_coalescing_window": 5
   }
   )"";
 
@@ -37,6 +92,9 @@ TEST_CASE("Reading configuration files", "[ZeekConfiguration]") {
   const std::string kExpectedLogFolder{"/var/log/zeek"};
   const std::string kExpectedCertFile{"/dev/null"};
   const std::string kExceptedOsqueryExtensionsSocket{"/test/path"};
+  const std::string kExpectedStateSnapshotPath{
+      "/var/lib/zeek-agent/state.bin"};
+  const std::string kExpectedSpoolFolderPath{"/var/spool/zeek-agent"};
 
   const std::string kTestConfiguration = R""(
   {
@@ -56,8 +114,61 @@ TEST_CASE("Reading configuration files", "[ZeekConfiguration]") {
       "client_key": "/dev/null"
     },
 
+    "file_events": {
+      "include_path_list": [
+        "/proc/self/"
+      ],
+
+      "exclude_path_list": [
+        "/proc/",
+        "node_modules/"
+      ]
+    },
+
+    "event_rate_limit": {
+      "events_per_second": 100,
+      "sampling_ratio": 16
+    },
+
+    "query_output_chunk_size": 4096,
+
+    "zeek_event_batching": {
+      "max_row_count": 256
+    },
+
+    "output_queue": {
+      "overflow_policy": "drop_snapshots",
+      "max_query_rows_per_second": 2000,
+      "fair_queuing_quantum": 250
+    },
+
+    "reconnect": {
+      "initial_backoff_ms": 500
+    },
+
+    "server_endpoints": {
+      "endpoint_list": [
+        "zeek-proxy-1:9999",
+        "[::1]:10000"
+      ],
+
+      "endpoint_policy": "shard_by_query"
+    },
+
+    "output_spool": {
+      "spool_folder_path": "/var/spool/zeek-agent",
+      "replay_rows_per_second": 500
+    },
+
+    "log_rotation": {
+      "max_log_file_byte_count": 1048576,
+      "max_log_file_count": 0
+    },
+
     "osquery_extensions_socket": "/test/path",
-    "max_queued_row_count": 1337
+    "state_snapshot_path": "/var/lib/zeek-agent/state.bin",
+    "max_queued_row_count": 1337,
+    "event_coalescing_window": 5
   }
   )"";
 #endif
@@ -83,7 +194,171 @@ TEST_CASE("Reading configuration files", "[ZeekConfiguration]") {
   REQUIRE(context.client_key == kExpectedCertFile);
   REQUIRE(context.osquery_extensions_socket ==
           kExceptedOsqueryExtensionsSocket);
+  REQUIRE(context.state_snapshot_path == kExpectedStateSnapshotPath);
 
   REQUIRE(context.max_queued_row_count == 1337U);
+
+  REQUIRE(context.file_events_include_list.size() == 1U);
+  REQUIRE(context.file_events_exclude_list.size() == 2U);
+
+  REQUIRE(context.event_coalescing_window == 5U);
+
+  REQUIRE(context.event_rate_limit.events_per_second == 100U);
+  REQUIRE(context.event_rate_limit.burst_size == 100U);
+  REQUIRE(context.event_rate_limit.sampling_ratio == 16U);
+
+  REQUIRE(context.query_output_chunk_size == 4096U);
+
+  REQUIRE(context.zeek_event_batching.max_row_count == 256U);
+  REQUIRE(context.zeek_event_batching.max_byte_count == 65536U);
+
+  REQUIRE(context.output_queue.max_queued_byte_count == 64U * 1024U * 1024U);
+  REQUIRE(context.output_queue.overflow_policy ==
+          IZeekConfiguration::OutputQueue::OverflowPolicy::DropSnapshots);
+  REQUIRE(context.output_queue.max_topic_rows_per_second == 0U);
+  REQUIRE(context.output_queue.max_query_rows_per_second == 2000U);
+  REQUIRE(context.output_queue.fair_queuing_quantum == 250U);
+
+  REQUIRE(context.reconnect.initial_backoff_ms == 500U);
+  REQUIRE(context.reconnect.max_backoff_ms == 30000U);
+
+  const auto &endpoint_list = context.server_endpoints.endpoint_list;
+  REQUIRE(endpoint_list.size() == 3U);
+
+  REQUIRE(endpoint_list.at(0U).address == "127.0.0.1");
+  REQUIRE(endpoint_list.at(0U).port == 9999U);
+
+  REQUIRE(endpoint_list.at(1U).address == "zeek-proxy-1");
+  REQUIRE(endpoint_list.at(1U).port == 9999U);
+
+  REQUIRE(endpoint_list.at(2U).address == "::1");
+  REQUIRE(endpoint_list.at(2U).port == 10000U);
+
+  REQUIRE(context.server_endpoints.policy ==
+          IZeekConfiguration::ServerEndpoints::Policy::ShardByQuery);
+
+  REQUIRE(context.output_spool.folder_path == kExpectedSpoolFolderPath);
+  REQUIRE(context.output_spool.max_byte_count == 256U * 1024U * 1024U);
+  REQUIRE(context.output_spool.segment_byte_count == 4U * 1024U * 1024U);
+  REQUIRE(context.output_spool.replay_rows_per_second == 500U);
+
+  REQUIRE(context.log_rotation.max_log_file_byte_count == 1048576U);
+  REQUIRE(context.log_rotation.max_log_file_age == 86400U);
+  REQUIRE(context.log_rotation.max_log_file_count == 0U);
+}
+
+TEST_CASE("Invalid output queue overflow policy", "[ZeekConfiguration]") {
+  const std::string kTestConfiguration = R""(
+  {
+    "server_address": "127.0.0.1",
+    "server_port": 9999,
+    "log_folder": "/var/log/zeek",
+    "group_list": [],
+
+    "output_queue": {
+      "overflow_policy": "spill"
+    }
+  }
+  )"";
+
+  ZeekConfiguration::Context context;
+  auto status =
+      ZeekConfiguration::parseConfigurationData(context, kTestConfiguration);
+
+  REQUIRE(!status.succeeded());
+  REQUIRE(status.message() == "Invalid output queue overflow policy: spill");
+}
+
+TEST_CASE("Invalid output queue fair queuing quantum", "[ZeekConfiguration]") {
+  const std::string kTestConfiguration = R""(
+  {
+    "server_address": "127.0.0.1",
+    "server_port": 9999,
+    "log_folder": "/var/log/zeek",
+    "group_list": [],
+
+    "output_queue": {
+      "fair_queuing_quantum": 0
+    }
+  }
+  )"";
+
+  ZeekConfiguration::Context context;
+  auto status =
+      ZeekConfiguration::parseConfigurationData(context, kTestConfiguration);
+
+  REQUIRE(!status.succeeded());
+  REQUIRE(status.message() == "Invalid output queue fair queuing quantum");
+}
+
+TEST_CASE("Invalid reconnect backoff settings", "[ZeekConfiguration]") {
+  const std::string kTestConfiguration = R""(
+  {
+    "server_address": "127.0.0.1",
+    "server_port": 9999,
+    "log_folder": "/var/log/zeek",
+    "group_list": [],
+
+    "reconnect": {
+      "initial_backoff_ms": 1000,
+      "max_backoff_ms": 100
+    }
+  }
+  )"";
+
+  ZeekConfiguration::Context context;
+  auto status =
+      ZeekConfiguration::parseConfigurationData(context, kTestConfiguration);
+
+  REQUIRE(!status.succeeded());
+  REQUIRE(status.message() == "Invalid reconnect backoff settings");
+}
+
+TEST_CASE("Invalid output spool settings", "[ZeekConfiguration]") {
+  const std::string kTestConfiguration = R""(
+  {
+    "server_address": "127.0.0.1",
+    "server_port": 9999,
+    "log_folder": "/var/log/zeek",
+    "group_list": [],
+
+    "output_spool": {
+      "spool_folder_path": "/var/spool/zeek-agent",
+      "max_spool_byte_count": 1048576,
+      "spool_segment_byte_count": 1048576
+    }
+  }
+  )"";
+
+  ZeekConfiguration::Context context;
+  auto status =
+      ZeekConfiguration::parseConfigurationData(context, kTestConfiguration);
+
+  REQUIRE(!status.succeeded());
+  REQUIRE(status.message() == "Invalid output spool settings");
+}
+
+TEST_CASE("Parsing server endpoints", "[ZeekConfiguration]") {
+  IZeekConfiguration::ServerEndpoint endpoint;
+
+  auto status =
+      ZeekConfiguration::parseServerEndpoint(endpoint, "192.168.1.10:47760");
+
+  REQUIRE(status.succeeded());
+  REQUIRE(endpoint.address == "192.168.1.10");
+  REQUIRE(endpoint.port == 47760U);
+
+  status = ZeekConfiguration::parseServerEndpoint(endpoint, "[fe80::1]:1");
+  REQUIRE(status.succeeded());
+  REQUIRE(endpoint.address == "fe80::1");
+  REQUIRE(endpoint.port == 1U);
+
+  const std::vector<std::string> kInvalidEndpointList = {
+      "zeek", "zeek:", ":9999", "zeek:0", "zeek:65536", "zeek:99a", "[]:9999"};
+
+  for (const auto &invalid_endpoint : kInvalidEndpointList) {
+    status = ZeekConfiguration::parseServerEndpoint(endpoint, invalid_endpoint);
+    REQUIRE(!status.succeeded());
+  }
 }
 } // namespace zeek
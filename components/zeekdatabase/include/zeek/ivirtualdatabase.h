@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -29,6 +30,14 @@ public:
   /// \brief A reference to a virtual database object
   using Ref = std::unique_ptr<IVirtualDatabase>;
 
+  /// \brief A callback that receives the query output one chunk at a time;
+  ///        returning a failure interrupts the query
+  using QueryOutputCallback = std::function<Status(QueryOutput chunk)>;
+
+  /// \brief A callback invoked when an event table receives new rows
+  using TableUpdateCallback = std::function<void(
+      const std::string &table_name, std::size_t row_count)>;
+
   /// \brief Factory method
   /// \param obj Where the created object is stored
   /// \return A Status object
@@ -53,12 +62,34 @@ public:
   /// \return A Status object
   virtual Status unregisterTable(const std::string &name) = 0;
 
+  /// \brief Returns true if the specified table discards its rows once they
+  ///        have been read
+  /// \param name The name of the table
+  /// \return True if the table is registered and is an event table
+  virtual bool isEventTable(const std::string &name) const = 0;
+
+  /// \brief Sets the callback invoked (from any thread) when one of the
+  ///        registered event tables receives new rows
+  /// \param callback The callback to invoke
+  virtual void setTableUpdateCallback(TableUpdateCallback callback) = 0;
+
   /// \brief Queries the virtual database
   /// \param output Where the query output is stored
   /// \param query The SQL statement to execute
   /// \return A Status object
   virtual Status query(QueryOutput &output, const std::string &query) const = 0;
 
+  /// \brief Queries the virtual database, passing the output to the given
+  ///        callback in chunks, as the rows are generated
+  /// \param query The SQL statement to execute
+  /// \param chunk_size The maximum amount of rows in each chunk; zero means
+  ///                   that the whole output is passed as a single chunk
+  /// \param callback The callback invoked for each chunk. It is not invoked
+  ///                 when there are no rows
+  /// \return A Status object
+  virtual Status query(const std::string &query, std::size_t chunk_size,
+                       const QueryOutputCallback &callback) const = 0;
+
   IVirtualDatabase(const IVirtualDatabase &other) = delete;
   IVirtualDatabase &operator=(const IVirtualDatabase &other) = delete;
 };
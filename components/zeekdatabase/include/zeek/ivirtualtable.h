@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -23,12 +24,16 @@ public:
   enum class ColumnType { Integer, String, Double };
   using Schema = std::map<std::string, ColumnType>;
 
+  using UpdateCallback = std::function<void(std::size_t row_count)>;
+
   virtual ~IVirtualTable() = default;
   IVirtualTable() = default;
 
   virtual const std::string &name() const = 0;
   virtual const Schema &schema() const = 0;
   virtual Status generateRowList(RowList &row_list) = 0;
+  virtual bool isEventTable() const { return false; }
+  virtual void setUpdateCallback(UpdateCallback) {}
 
   IVirtualTable(const IVirtualTable &other) = delete;
   IVirtualTable &operator=(const IVirtualTable &other) = delete;
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mutex>
+
+#include <zeek/ivirtualtable.h>
+
+namespace zeek {
+/// \brief Keeps the update callback of an event table, and tells it about
+///        the new rows
+///
+/// The callback reaches the virtual database and the query scheduler, so it
+/// is never called with a lock held: it is copied under the internal mutex,
+/// then called after releasing it. Callers must not hold their own table
+/// locks either
+class TableUpdateNotifier final {
+public:
+  /// \brief Constructor
+  TableUpdateNotifier() = default;
+
+  /// \brief Destructor
+  ~TableUpdateNotifier() = default;
+
+  /// \brief Replaces the update callback
+  /// \param callback The new callback; can be empty
+  void setCallback(IVirtualTable::UpdateCallback callback);
+
+  /// \brief Calls the update callback, if any
+  /// \param row_count How many rows have been added; nothing is called
+  ///                  when zero
+  void notify(std::size_t row_count);
+
+  TableUpdateNotifier(const TableUpdateNotifier &) = delete;
+  TableUpdateNotifier &operator=(const TableUpdateNotifier &) = delete;
+
+private:
+  /// \brief Protects the callback
+  std::mutex callback_mutex;
+
+  /// \brief The update callback
+  IVirtualTable::UpdateCallback callback;
+};
+} // namespace zeek
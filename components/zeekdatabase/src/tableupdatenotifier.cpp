@@ -0,0 +1,25 @@
+#include <zeek/tableupdatenotifier.h>
+
+namespace zeek {
+void TableUpdateNotifier::setCallback(IVirtualTable::UpdateCallback callback) {
+  std::lock_guard<std::mutex> lock(callback_mutex);
+  this->callback = std::move(callback);
+}
+
+void TableUpdateNotifier::notify(std::size_t row_count) {
+  if (row_count == 0U) {
+    return;
+  }
+
+  IVirtualTable::UpdateCallback current_callback;
+
+  {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    current_callback = callback;
+  }
+
+  if (current_callback) {
+    current_callback(row_count);
+  }
+}
+} // namespace zeek
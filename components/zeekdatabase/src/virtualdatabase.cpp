@@ -3,12 +3,22 @@
 #include "virtualtablemodule.h"
 #include "zeektablelisttableplugin.h"
 
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
 #include <sqlite3.h>
 
 namespace zeek {
+namespace {
+/// \brief Forwards the event table updates to the database callback. It is
+///        shared with the tables, since they can outlive the database
+struct TableUpdateDispatcher final {
+  std::mutex callback_mutex;
+  IVirtualDatabase::TableUpdateCallback callback;
+};
+} // namespace
+
 struct VirtualDatabase::PrivateData final {
   sqlite3 *sqlite_database{nullptr};
 
@@ -16,6 +26,9 @@ struct VirtualDatabase::PrivateData final {
       registered_module_list;
 
   IVirtualTable::Ref zeek_table_list_table_plugin;
+
+  std::shared_ptr<TableUpdateDispatcher> table_update_dispatcher{
+      std::make_shared<TableUpdateDispatcher>()};
 };
 
 VirtualDatabase::~VirtualDatabase() {
@@ -57,6 +70,21 @@ Status VirtualDatabase::registerTable(IVirtualTable::Ref table) {
     return status;
   }
 
+  if (table->isEventTable()) {
+    auto table_update_dispatcher = d->table_update_dispatcher;
+    auto table_name = table->name();
+
+    table->setUpdateCallback(
+        [table_update_dispatcher, table_name](std::size_t row_count) {
+          std::lock_guard<std::mutex> lock(
+              table_update_dispatcher->callback_mutex);
+
+          if (table_update_dispatcher->callback) {
+            table_update_dispatcher->callback(table_name, row_count);
+          }
+        });
+  }
+
   table = {};
 
   auto err = sqlite3_create_module_v2(d->sqlite_database,
@@ -122,22 +150,55 @@ Status VirtualDatabase::unregisterTable(const std::string &name) {
   return Status::success();
 }
 
+bool VirtualDatabase::isEventTable(const std::string &name) const {
+  auto table_it = d->registered_module_list.find(name);
+  if (table_it == d->registered_module_list.end()) {
+    return false;
+  }
+
+  const auto &virtual_table_module = table_it->second;
+  return virtual_table_module->isEventTable();
+}
+
+void VirtualDatabase::setTableUpdateCallback(TableUpdateCallback callback) {
+  std::lock_guard<std::mutex> lock(d->table_update_dispatcher->callback_mutex);
+  d->table_update_dispatcher->callback = std::move(callback);
+}
+
 Status VirtualDatabase::query(QueryOutput &output,
                               const std::string &query) const {
 
   output = {};
 
-  SqliteStatement sql_stmt;
-  auto status = prepareSqliteStatement(sql_stmt, d->sqlite_database, query);
+  QueryOutput temp_output;
+
+  auto status = this->query(query, 0U, [&temp_output](QueryOutput chunk) {
+    temp_output = std::move(chunk);
+    return Status::success();
+  });
+
   if (!status.succeeded()) {
     return status;
   }
 
+  output = std::move(temp_output);
+  return Status::success();
+}
+
+Status VirtualDatabase::query(const std::string &query, std::size_t chunk_size,
+                              const QueryOutputCallback &callback) const {
+
+  SqliteStatement sql_stmt;
+  auto status = prepareSqliteStatement(sql_stmt, d->sqlite_database, query);
   if (!status.succeeded()) {
     return status;
   }
 
-  QueryOutput temp_output;
+  QueryOutput chunk;
+  if (chunk_size != 0U) {
+    chunk.reserve(chunk_size);
+  }
+
   auto column_count = sqlite3_column_count(sql_stmt.get());
 
   while (sqlite3_step(sql_stmt.get()) == SQLITE_ROW) {
@@ -154,8 +215,12 @@ Status VirtualDatabase::query(QueryOutput &output,
 
       case SQLITE_INTEGER:
         column.data = static_cast<std::int64_t>(
-            sqlite3_column_int(sql_stmt.get(), column_index));
+            sqlite3_column_int64(sql_stmt.get(), column_index));
+
+        break;
 
+      case SQLITE_FLOAT:
+        column.data = sqlite3_column_double(sql_stmt.get(), column_index);
         break;
 
       case SQLITE_TEXT: {
@@ -175,10 +240,26 @@ Status VirtualDatabase::query(QueryOutput &output,
       current_row.push_back(std::move(column));
     }
 
-    temp_output.push_back(std::move(current_row));
+    chunk.push_back(std::move(current_row));
+
+    if (chunk.size() == chunk_size) {
+      status = callback(std::move(chunk));
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      chunk = {};
+      chunk.reserve(chunk_size);
+    }
+  }
+
+  if (!chunk.empty()) {
+    status = callback(std::move(chunk));
+    if (!status.succeeded()) {
+      return status;
+    }
   }
 
-  output = std::move(temp_output);
   return Status::success();
 }
 
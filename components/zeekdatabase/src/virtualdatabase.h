@@ -25,6 +25,17 @@ public:
   /// \return A Status object
   virtual Status unregisterTable(const std::string &name) override;
 
+  /// \brief Returns true if the specified table discards its rows once they
+  ///        have been read
+  /// \param name The name of the table
+  /// \return True if the table is registered and is an event table
+  virtual bool isEventTable(const std::string &name) const override;
+
+  /// \brief Sets the callback invoked (from any thread) when one of the
+  ///        registered event tables receives new rows
+  /// \param callback The callback to invoke
+  virtual void setTableUpdateCallback(TableUpdateCallback callback) override;
+
   /// \brief Queries the virtual database
   /// \param output Where the query output is stored
   /// \param query The SQL statement to execute
@@ -32,6 +43,17 @@ public:
   virtual Status query(QueryOutput &output,
                        const std::string &query) const override;
 
+  /// \brief Queries the virtual database, passing the output to the given
+  ///        callback in chunks, as the rows are generated
+  /// \param query The SQL statement to execute
+  /// \param chunk_size The maximum amount of rows in each chunk; zero means
+  ///                   that the whole output is passed as a single chunk
+  /// \param callback The callback invoked for each chunk. It is not invoked
+  ///                 when there are no rows
+  /// \return A Status object
+  virtual Status query(const std::string &query, std::size_t chunk_size,
+                       const QueryOutputCallback &callback) const override;
+
 protected:
   /// \brief Constructor
   VirtualDatabase();
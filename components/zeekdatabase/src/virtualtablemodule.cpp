@@ -108,6 +108,10 @@ VirtualTableModule::~VirtualTableModule() {}
 
 const std::string &VirtualTableModule::name() const { return d->table->name(); }
 
+bool VirtualTableModule::isEventTable() const {
+  return d->table->isEventTable();
+}
+
 const struct sqlite3_module *VirtualTableModule::sqliteModule() {
   return &kSqliteModule;
 }
@@ -342,6 +346,10 @@ VirtualTableModule::generateSQLTableDefinition(std::string &sql_statement,
       column_type_as_string = "TEXT";
       break;
 
+    case IVirtualTable::ColumnType::Double:
+      column_type_as_string = "REAL";
+      break;
+
     default:
       break;
     }
@@ -26,6 +26,9 @@ public:
   /// \return The module name
   const std::string &name() const;
 
+  /// \return True if the serviced table is an event table
+  bool isEventTable() const;
+
   VirtualTableModule(const VirtualTableModule &other) = delete;
   VirtualTableModule &operator=(const VirtualTableModule &other) = delete;
 
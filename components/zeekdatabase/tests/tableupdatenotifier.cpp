@@ -0,0 +1,50 @@
+#include <catch2/catch.hpp>
+
+#include <zeek/tableupdatenotifier.h>
+
+namespace zeek {
+SCENARIO("Notifying table updates", "[TableUpdateNotifier]") {
+  GIVEN("a table update notifier") {
+    TableUpdateNotifier update_notifier;
+
+    WHEN("no callback has been set") {
+      THEN("notifying does nothing") { update_notifier.notify(10U); }
+    }
+
+    WHEN("a callback has been set") {
+      std::size_t notified_row_count{0U};
+
+      update_notifier.setCallback(
+          [&notified_row_count](std::size_t row_count) {
+            notified_row_count += row_count;
+          });
+
+      update_notifier.notify(10U);
+      update_notifier.notify(0U);
+
+      THEN("it receives the new row counts") {
+        REQUIRE(notified_row_count == 10U);
+      }
+    }
+
+    WHEN("the callback replaces itself") {
+      std::size_t call_count{0U};
+
+      update_notifier.setCallback(
+          [&update_notifier, &call_count](std::size_t) {
+            ++call_count;
+
+            // Would deadlock if the callback was called with the lock held
+            update_notifier.setCallback({});
+          });
+
+      update_notifier.notify(1U);
+      update_notifier.notify(1U);
+
+      THEN("it is called without holding the notifier lock") {
+        REQUIRE(call_count == 1U);
+      }
+    }
+  }
+}
+} // namespace zeek
@@ -4,6 +4,39 @@
 #include <catch2/catch.hpp>
 
 namespace zeek {
+namespace {
+class EventTestTable final : public IVirtualTable {
+public:
+  EventTestTable() = default;
+  virtual ~EventTestTable() override = default;
+
+  virtual const std::string &name() const override {
+    static const std::string kTableName{"EventTestTable"};
+    return kTableName;
+  }
+
+  virtual const Schema &schema() const override {
+    static const Schema kTableSchema = {
+        {"integer", IVirtualTable::ColumnType::Integer}};
+
+    return kTableSchema;
+  }
+
+  virtual Status generateRowList(RowList &row_list) override {
+    row_list = {};
+    return Status::success();
+  }
+
+  virtual bool isEventTable() const override { return true; }
+
+  virtual void setUpdateCallback(UpdateCallback callback) override {
+    update_callback = std::move(callback);
+  }
+
+  UpdateCallback update_callback;
+};
+} // namespace
+
 SCENARIO("Basic VirtualDatabase operations", "[VirtualDatabase]") {
   GIVEN("a virtual database") {
     IVirtualDatabase::Ref virtual_database;
@@ -27,6 +60,38 @@ SCENARIO("Basic VirtualDatabase operations", "[VirtualDatabase]") {
       }
     }
 
+    WHEN("registering an event table") {
+      auto event_table = std::make_shared<EventTestTable>();
+
+      status = virtual_database->registerTable(event_table);
+      REQUIRE(status.succeeded());
+
+      std::string updated_table_name;
+      std::size_t updated_row_count{0U};
+
+      virtual_database->setTableUpdateCallback(
+          [&](const std::string &table_name, std::size_t row_count) {
+            updated_table_name = table_name;
+            updated_row_count += row_count;
+          });
+
+      THEN("table updates are forwarded to the database callback") {
+        REQUIRE(virtual_database->isEventTable("EventTestTable"));
+        REQUIRE(!virtual_database->isEventTable("zeek_table_list"));
+
+        REQUIRE(event_table->update_callback);
+        event_table->update_callback(10U);
+
+        REQUIRE(updated_table_name == "EventTestTable");
+        REQUIRE(updated_row_count == 10U);
+
+        virtual_database->setTableUpdateCallback({});
+        event_table->update_callback(10U);
+
+        REQUIRE(updated_row_count == 10U);
+      }
+    }
+
     WHEN("registering the same table twice") {
       IVirtualTable::Ref test_table(
           new TestTable(TestTable::SchemaType::Valid));
@@ -119,6 +184,58 @@ SCENARIO("Basic VirtualDatabase operations", "[VirtualDatabase]") {
       }
     }
 
+    WHEN("querying a table in chunks") {
+      static const std::size_t kRowCount{100U};
+      static const std::size_t kChunkSize{30U};
+
+      IVirtualTable::Ref test_table(
+          new TestTable(TestTable::SchemaType::Valid, kRowCount));
+
+      status = virtual_database->registerTable(test_table);
+      REQUIRE(status.succeeded());
+
+      std::vector<std::size_t> chunk_size_list;
+      std::int64_t expected_integer_value{0};
+
+      status = virtual_database->query(
+          "SELECT integer FROM TestTable;", kChunkSize,
+          [&](IVirtualDatabase::QueryOutput chunk) -> Status {
+            chunk_size_list.push_back(chunk.size());
+
+            for (const auto &row : chunk) {
+              const auto &integer_column = row.at(0U);
+
+              auto integer_value =
+                  std::get<std::int64_t>(integer_column.data.value());
+              CHECK(integer_value == expected_integer_value);
+
+              ++expected_integer_value;
+            }
+
+            return Status::success();
+          });
+
+      THEN("the rows are returned in order, in bounded chunks") {
+        REQUIRE(status.succeeded());
+        REQUIRE(chunk_size_list ==
+                std::vector<std::size_t>{30U, 30U, 30U, 10U});
+      }
+
+      std::size_t chunk_count{0U};
+
+      status = virtual_database->query(
+          "SELECT integer FROM TestTable;", kChunkSize,
+          [&chunk_count](IVirtualDatabase::QueryOutput) -> Status {
+            ++chunk_count;
+            return Status::failure("Interrupted");
+          });
+
+      THEN("a failing callback interrupts the query") {
+        REQUIRE(!status.succeeded());
+        REQUIRE(chunk_count == 1U);
+      }
+    }
+
     WHEN("querying an empty table") {
       static const std::size_t kRowCount{0U};
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include <zeek/ivirtualdatabase.h>
@@ -11,6 +12,16 @@ public:
   /// \brief Supported severity types
   enum class Severity { Debug, Information, Warning, Error };
 
+  /// \brief What happens when the message queue is full
+  enum class OverflowPolicy {
+    /// \brief The caller waits until the writer thread catches up
+    Block,
+
+    /// \brief The message is dropped; the writer thread reports how many
+    ///        messages have been lost
+    Drop
+  };
+
   /// \brief The logger configuration
   struct Configuration final {
     /// \brief Severity filter
@@ -18,6 +29,36 @@ public:
 
     /// \brief The path to the log folder
     std::string log_folder;
+
+    /// \brief How many messages can wait for the writer thread
+    std::size_t max_queued_message_count{8192U};
+
+    /// \brief What happens when the message queue is full
+    OverflowPolicy overflow_policy{OverflowPolicy::Drop};
+
+    /// \brief How often the log file is flushed. Errors are always
+    ///        flushed right away
+    std::chrono::milliseconds flush_interval{1000};
+
+    /// \brief How many messages the zeek_logger table keeps until it is
+    ///        queried. The oldest messages are dropped first
+    std::size_t max_table_row_count{50000U};
+
+    /// \brief The maximum (estimated) size of the messages kept by the
+    ///        zeek_logger table
+    std::size_t max_table_byte_count{16U * 1024U * 1024U};
+
+    /// \brief A new log file is started once the current one reaches this
+    ///        size; 0 disables the size based rotation
+    std::size_t max_log_file_byte_count{64U * 1024U * 1024U};
+
+    /// \brief A new log file is started once the current one is this old;
+    ///        0 disables the time based rotation
+    std::chrono::seconds max_log_file_age{86400};
+
+    /// \brief How many log files are kept in the log folder, including the
+    ///        current one. The oldest are deleted first; 0 keeps them all
+    std::size_t max_log_file_count{10U};
   };
 
   /// \brief A reference to a Zeek logger object
@@ -38,7 +79,8 @@ public:
   /// \brief Destructor
   virtual ~IZeekLogger() = default;
 
-  /// \brief Logs a message both to file and to the log table
+  /// \brief Logs a message both to file and to the log table. The message
+  ///        is written in the background
   /// \param severity The log severity
   /// \param message The message to log
   virtual void logMessage(Severity severity, const std::string &message) = 0;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <zeek/izeeklogger.h>
+
+/// \brief Logs a message at most once per interval, as decided by the given
+///        LogRateLimiter. The message expression is only evaluated when it
+///        is actually logged; the calls that have been suppressed in the
+///        meantime are reported along with it
+/// \param rate_limiter The LogRateLimiter object that owns the messages,
+///                     for example one for each table or query
+/// \param logger The IZeekLogger object
+/// \param severity The log severity
+/// \param message An expression that generates the message
+#define ZEEK_LOG_RATE_LIMITED_BY(rate_limiter, logger, severity, message)      \
+  do {                                                                         \
+    std::size_t zeek_log_suppressed_count{0U};                                 \
+    if ((rate_limiter).shouldLog(zeek_log_suppressed_count)) {                 \
+      (logger).logMessage((severity),                                          \
+                          zeek::LogRateLimiter::appendSuppressedCount(         \
+                              (message), zeek_log_suppressed_count));          \
+    }                                                                          \
+  } while (false)
+
+/// \brief Same as ZEEK_LOG_RATE_LIMITED_BY, with a LogRateLimiter shared by
+///        every call of this call site. Only meant for call sites that
+///        always log about the same object
+/// \param logger The IZeekLogger object
+/// \param severity The log severity
+/// \param message An expression that generates the message
+#define ZEEK_LOG_RATE_LIMITED(logger, severity, message)                       \
+  do {                                                                         \
+    static zeek::LogRateLimiter zeek_log_rate_limiter;                         \
+    ZEEK_LOG_RATE_LIMITED_BY(zeek_log_rate_limiter, logger, severity,          \
+                             message);                                         \
+  } while (false)
+
+namespace zeek {
+/// \brief Deduplicates the messages of a log call site, or of the object
+///        it logs about. Can be used from any thread
+class LogRateLimiter final {
+public:
+  /// \brief The default time between two logged messages
+  static constexpr std::chrono::milliseconds kDefaultInterval{10000};
+
+  /// \brief Constructor
+  /// \param interval The minimum time between two logged messages
+  LogRateLimiter(std::chrono::milliseconds interval = kDefaultInterval);
+
+  /// \brief Decides whether the next message can be logged
+  /// \param suppressed_count Set to how many messages have been suppressed
+  ///                         since the last logged one
+  /// \return False if the message must be suppressed
+  bool shouldLog(std::size_t &suppressed_count);
+
+  /// \param message The message to log
+  /// \param suppressed_count How many messages have been suppressed
+  /// \return The message, followed by the suppressed message count if not
+  ///         zero
+  static std::string appendSuppressedCount(std::string message,
+                                           std::size_t suppressed_count);
+
+  LogRateLimiter(const LogRateLimiter &) = delete;
+  LogRateLimiter &operator=(const LogRateLimiter &) = delete;
+
+private:
+  /// \brief The minimum time between two logged messages
+  std::chrono::steady_clock::duration interval;
+
+  /// \brief When the next message can be logged, in steady clock ticks
+  std::atomic<std::int64_t> next_log_time{0};
+
+  /// \brief How many messages have been suppressed so far
+  std::atomic<std::size_t> suppressed_message_count{0U};
+};
+} // namespace zeek
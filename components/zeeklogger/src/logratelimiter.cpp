@@ -0,0 +1,43 @@
+#include <zeek/logratelimiter.h>
+
+namespace zeek {
+constexpr std::chrono::milliseconds LogRateLimiter::kDefaultInterval;
+
+LogRateLimiter::LogRateLimiter(std::chrono::milliseconds interval)
+    : interval(interval) {}
+
+bool LogRateLimiter::shouldLog(std::size_t &suppressed_count) {
+  suppressed_count = 0U;
+
+  auto current_time =
+      std::chrono::steady_clock::now().time_since_epoch().count();
+
+  auto next_time = next_log_time.load(std::memory_order_relaxed);
+
+  // Only the thread that moves the deadline forward gets to log
+  if (current_time < next_time ||
+      !next_log_time.compare_exchange_strong(
+          next_time, current_time + interval.count(),
+          std::memory_order_relaxed)) {
+
+    suppressed_message_count.fetch_add(1U, std::memory_order_relaxed);
+    return false;
+  }
+
+  suppressed_count =
+      suppressed_message_count.exchange(0U, std::memory_order_relaxed);
+
+  return true;
+}
+
+std::string
+LogRateLimiter::appendSuppressedCount(std::string message,
+                                      std::size_t suppressed_count) {
+  if (suppressed_count != 0U) {
+    message += " (" + std::to_string(suppressed_count) +
+               " similar messages have been suppressed)";
+  }
+
+  return message;
+}
+} // namespace zeek
@@ -0,0 +1,125 @@
+#include "logrecordqueue.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace zeek {
+namespace {
+/// \brief Keeps the positions on separate cache lines, so that the
+///        producers do not slow down the consumer
+const std::size_t kCacheLineSize{64U};
+
+/// \brief A queue slot
+struct Slot final {
+  /// \brief Equal to the write position when the slot can be written, and
+  ///        to the write position + 1 when it can be read
+  std::atomic<std::size_t> sequence{0U};
+
+  LogRecordQueue::Record record;
+};
+} // namespace
+
+struct LogRecordQueue::PrivateData final {
+  std::unique_ptr<Slot[]> slot_list;
+  std::size_t mask{0U};
+
+  alignas(kCacheLineSize) std::atomic<std::size_t> write_position{0U};
+  alignas(kCacheLineSize) std::atomic<std::size_t> read_position{0U};
+};
+
+Status LogRecordQueue::create(Ref &obj, std::size_t capacity) {
+  try {
+    obj.reset();
+
+    auto ptr = new LogRecordQueue(capacity);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+LogRecordQueue::~LogRecordQueue() {}
+
+std::size_t LogRecordQueue::capacity() const { return d->mask + 1U; }
+
+bool LogRecordQueue::tryPush(Record &record) {
+  auto position = d->write_position.load(std::memory_order_relaxed);
+  Slot *slot{nullptr};
+
+  for (;;) {
+    slot = &d->slot_list[position & d->mask];
+    auto sequence = slot->sequence.load(std::memory_order_acquire);
+
+    auto difference = static_cast<std::intptr_t>(sequence) -
+                      static_cast<std::intptr_t>(position);
+
+    if (difference == 0) {
+      if (d->write_position.compare_exchange_weak(
+              position, position + 1U, std::memory_order_relaxed)) {
+        break;
+      }
+
+    } else if (difference < 0) {
+      // The consumer has not read this slot yet
+      return false;
+
+    } else {
+      position = d->write_position.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->record = std::move(record);
+  slot->sequence.store(position + 1U, std::memory_order_release);
+
+  return true;
+}
+
+bool LogRecordQueue::tryPop(Record &record) {
+  auto position = d->read_position.load(std::memory_order_relaxed);
+
+  auto &slot = d->slot_list[position & d->mask];
+  if (slot.sequence.load(std::memory_order_acquire) != position + 1U) {
+    return false;
+  }
+
+  record = std::move(slot.record);
+  slot.record.message = {};
+
+  d->read_position.store(position + 1U, std::memory_order_relaxed);
+  slot.sequence.store(position + d->mask + 1U, std::memory_order_release);
+
+  return true;
+}
+
+bool LogRecordQueue::empty() const {
+  auto position = d->read_position.load(std::memory_order_relaxed);
+
+  const auto &slot = d->slot_list[position & d->mask];
+  return slot.sequence.load(std::memory_order_acquire) != position + 1U;
+}
+
+LogRecordQueue::LogRecordQueue(std::size_t capacity) : d(new PrivateData) {
+  if (capacity == 0U) {
+    throw Status::failure("Invalid log record queue capacity");
+  }
+
+  // A single slot can not tell a written record from a free slot
+  std::size_t slot_count{2U};
+  while (slot_count < capacity) {
+    slot_count <<= 1U;
+  }
+
+  d->slot_list.reset(new Slot[slot_count]);
+  d->mask = slot_count - 1U;
+
+  for (std::size_t i = 0U; i < slot_count; ++i) {
+    d->slot_list[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+} // namespace zeek
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <zeek/izeeklogger.h>
+
+namespace zeek {
+/// \brief A bounded, lock-free queue of log records, written by any thread
+///        and read by the log writer thread
+///
+/// Each slot carries a sequence number that tells the producers and the
+/// consumer whose turn it is, so that pushing a record only costs a
+/// compare-and-swap on the write position
+class LogRecordQueue final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to a log record queue object
+  using Ref = std::unique_ptr<LogRecordQueue>;
+
+  /// \brief A single log message
+  struct Record final {
+    /// \brief The log severity
+    IZeekLogger::Severity severity{IZeekLogger::Severity::Information};
+
+    /// \brief When the message has been logged
+    std::chrono::system_clock::time_point time;
+
+    /// \brief The message to log
+    std::string message;
+  };
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param capacity How many records can be queued; rounded up to the
+  ///                 next power of two, and to at least 2
+  /// \return A Status object
+  static Status create(Ref &obj, std::size_t capacity);
+
+  /// \brief Destructor
+  ~LogRecordQueue();
+
+  /// \return How many records can be queued
+  std::size_t capacity() const;
+
+  /// \brief Queues a new record. Can be called from any thread
+  /// \param record The record to queue; moved into the queue on success
+  /// \return False if the queue is full
+  bool tryPush(Record &record);
+
+  /// \brief Takes the oldest record. Only one thread can call this method
+  /// \param record Where the record is stored
+  /// \return False if the queue is empty
+  bool tryPop(Record &record);
+
+  /// \return True if there is nothing to pop
+  bool empty() const;
+
+  LogRecordQueue(const LogRecordQueue &) = delete;
+  LogRecordQueue &operator=(const LogRecordQueue &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param capacity How many records can be queued
+  LogRecordQueue(std::size_t capacity);
+};
+} // namespace zeek
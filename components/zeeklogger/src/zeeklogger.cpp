@@ -1,19 +1,44 @@
 #include "zeeklogger.h"
 #include "zeekloggertableplugin.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <condition_variable>
 #include <ctime>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <zeek/time.h>
 
 namespace zeek {
 namespace {
+/// \brief How many messages the writer thread handles before writing them
+///        to file
+const std::size_t kMaxBatchSize{1024U};
+
+/// \brief The log file names: a timestamp, optionally followed by a
+///        suffix when the file is rotated more than once per second
+const std::size_t kLogFileTimestampSize{15U};
+const std::size_t kLogFileNameSuffixSize{3U};
+const std::size_t kMaxLogFileNameSuffix{999U};
+const std::string kLogFileExtension{".log"};
+
+/// \brief The last formatted timestamp; the messages logged within the
+///        same second share it
+struct TimestampCache final {
+  std::time_t time{-1};
+  std::string timestamp;
+};
+
 std::string getCurrentTimestamp(const std::string &format) {
   auto current_time = std::time(nullptr);
 
@@ -26,8 +51,133 @@ std::string getCurrentTimestamp(const std::string &format) {
   return buffer.str();
 }
 
-std::string generateLogFileName(const std::string &base_path) {
-  return base_path + "/" + getCurrentTimestamp("%Y%m%d_%H%M%S") + ".log";
+const std::string &formatTimestamp(TimestampCache &timestamp_cache,
+                                   std::time_t time) {
+  if (time == timestamp_cache.time) {
+    return timestamp_cache.timestamp;
+  }
+
+  struct tm time_tm {};
+  getLocalTime(&time, &time_tm);
+
+  char buffer[32]{};
+  auto size = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S",
+                            &time_tm);
+
+  timestamp_cache.time = time;
+  timestamp_cache.timestamp.assign(buffer, size);
+
+  return timestamp_cache.timestamp;
+}
+
+/// \brief Remembers the last log file name, so that the files created
+///        within the same second are still sorted by age
+struct LogFileNameState final {
+  std::string timestamp;
+  std::size_t suffix{0U};
+};
+
+/// \return A log file path that is not in use yet
+std::string generateLogFileName(LogFileNameState &state,
+                                const std::string &base_path) {
+  auto timestamp = getCurrentTimestamp("%Y%m%d_%H%M%S");
+
+  if (timestamp == state.timestamp) {
+    ++state.suffix;
+
+  } else {
+    state.timestamp = timestamp;
+    state.suffix = 0U;
+  }
+
+  std::string log_file_path;
+  std::error_code error;
+
+  do {
+    log_file_path = base_path + "/" + timestamp;
+
+    if (state.suffix != 0U) {
+      auto suffix = std::to_string(state.suffix);
+      suffix.insert(0U, kLogFileNameSuffixSize - suffix.size(), '0');
+
+      log_file_path += "_" + suffix;
+    }
+
+    log_file_path += kLogFileExtension;
+
+  } while (std::filesystem::exists(log_file_path, error) &&
+           state.suffix++ < kMaxLogFileNameSuffix);
+
+  return log_file_path;
+}
+
+/// \return True if the given file name has been generated by
+///         generateLogFileName
+bool isLogFileName(const std::string &file_name) {
+  auto name_size = file_name.size();
+  if (name_size < kLogFileExtension.size() ||
+      file_name.compare(name_size - kLogFileExtension.size(),
+                        kLogFileExtension.size(), kLogFileExtension) != 0) {
+    return false;
+  }
+
+  name_size -= kLogFileExtension.size();
+  if (name_size != kLogFileTimestampSize &&
+      name_size != kLogFileTimestampSize + 1U + kLogFileNameSuffixSize) {
+    return false;
+  }
+
+  // YYYYmmdd_HHMMSS, optionally followed by _NNN
+  for (std::size_t i = 0U; i < name_size; ++i) {
+    auto separator = i == 8U || i == kLogFileTimestampSize;
+
+    if (separator ? file_name[i] != '_'
+                  : !std::isdigit(static_cast<unsigned char>(file_name[i]))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/// \brief Deletes the oldest log files, keeping at most max_log_file_count
+///        of them. The file currently in use is never deleted
+void removeOldLogFiles(const std::string &log_folder,
+                       std::size_t max_log_file_count,
+                       const std::string &current_log_file_path) {
+  if (max_log_file_count == 0U) {
+    return;
+  }
+
+  std::error_code error;
+  std::filesystem::directory_iterator folder_it(log_folder, error);
+  if (error) {
+    return;
+  }
+
+  std::vector<std::filesystem::path> log_file_path_list;
+
+  for (const auto &entry : folder_it) {
+    const auto &path = entry.path();
+
+    if (isLogFileName(path.filename().string()) &&
+        !std::filesystem::equivalent(path, current_log_file_path, error)) {
+      log_file_path_list.push_back(path);
+    }
+  }
+
+  // The names start with the timestamp, so the oldest files come first
+  std::sort(log_file_path_list.begin(), log_file_path_list.end());
+
+  // Make room for the current file
+  auto removed_file_count =
+      static_cast<std::ptrdiff_t>(log_file_path_list.size() + 1U) -
+      static_cast<std::ptrdiff_t>(max_log_file_count);
+
+  for (std::ptrdiff_t i = 0; i < removed_file_count; ++i) {
+    std::filesystem::remove(log_file_path_list.at(static_cast<std::size_t>(i)),
+                            error);
+  }
 }
 } // namespace
 
@@ -40,11 +190,35 @@ struct ZeekLogger::PrivateData final {
 
   ZeekLoggerTablePlugin::Ref logger_table;
 
-  std::mutex log_file_mutex;
+  LogRecordQueue::Ref record_queue;
+  std::atomic<std::uint64_t> dropped_message_count{0U};
+
+  std::thread writer_thread;
+  std::mutex writer_mutex;
+  std::condition_variable writer_cv;
+  std::atomic_bool writer_sleeping{false};
+  bool terminate{false};
+
+  // Only used by the writer thread
   std::fstream log_file;
+  std::string log_file_path;
+  LogFileNameState log_file_name_state;
+  std::size_t log_file_byte_count{0U};
+  std::chrono::steady_clock::time_point log_file_open_time;
+  bool flush_pending{false};
+  TimestampCache timestamp_cache;
+  std::string write_buffer;
 };
 
 ZeekLogger::~ZeekLogger() {
+  {
+    std::lock_guard<std::mutex> lock(d->writer_mutex);
+    d->terminate = true;
+  }
+
+  d->writer_cv.notify_one();
+  d->writer_thread.join();
+
   auto status = unregisterTables();
 
   assert(status.succeeded() &&
@@ -52,43 +226,26 @@ ZeekLogger::~ZeekLogger() {
 }
 
 void ZeekLogger::logMessage(Severity severity, const std::string &message) {
-  auto &logger_table_impl =
-      *static_cast<ZeekLoggerTablePlugin *>(d->logger_table.get());
-
   if (severity < d->configuration.severity_filter) {
     return;
   }
 
-  std::lock_guard<std::mutex> lock(d->log_file_mutex);
-
-  if (!d->log_file.is_open() || d->log_file.fail()) {
-    d->log_file = {};
+  LogRecordQueue::Record record;
+  record.severity = severity;
+  record.time = std::chrono::system_clock::now();
+  record.message = message;
 
-    auto log_file_path = generateLogFileName(d->configuration.log_folder);
-
-    d->log_file.open(log_file_path, std::ios::out);
-    if (!d->log_file.good()) {
-      auto error_message = "Failed to open the log file: " + log_file_path;
-
-      auto status =
-          logger_table_impl.appendMessage(Severity::Error, error_message);
-
-      std::cerr << error_message << "\n";
-
-      d->log_file = {};
+  while (!d->record_queue->tryPush(record)) {
+    if (d->configuration.overflow_policy == OverflowPolicy::Drop) {
+      d->dropped_message_count.fetch_add(1U, std::memory_order_relaxed);
+      return;
     }
-  }
 
-  auto status = logger_table_impl.appendMessage(severity, message);
-  if (!status.succeeded()) {
-    std::cerr << "Failed to log the following message to the logger table: "
-              << message << "\n";
+    wakeUpWriter();
+    std::this_thread::yield();
   }
 
-  std::ostream &output_stream = d->log_file.is_open() ? d->log_file : std::cerr;
-  output_stream << getCurrentTimestamp("%Y-%m-%d %H:%M:%S") << " "
-                << loggerSeverityToString(severity) << ": " << message
-                << std::endl;
+  wakeUpWriter();
 }
 
 ZeekLogger::ZeekLogger(const Configuration &configuration,
@@ -97,14 +254,26 @@ ZeekLogger::ZeekLogger(const Configuration &configuration,
 
   d->configuration = configuration;
 
-  auto status = registerTables();
+  auto status = LogRecordQueue::create(
+      d->record_queue, d->configuration.max_queued_message_count);
+
   if (!status.succeeded()) {
     throw status;
   }
+
+  status = registerTables();
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  d->writer_thread = std::thread(&ZeekLogger::writerThread, this);
 }
 
 Status ZeekLogger::registerTables() {
-  auto status = ZeekLoggerTablePlugin::create(d->logger_table);
+  auto status = ZeekLoggerTablePlugin::create(
+      d->logger_table, d->configuration.max_table_row_count,
+      d->configuration.max_table_byte_count);
+
   if (!status.succeeded()) {
     return status;
   }
@@ -128,6 +297,195 @@ Status ZeekLogger::unregisterTables() {
   return Status::success();
 }
 
+void ZeekLogger::wakeUpWriter() {
+  // Pairs with the fence in the writer thread: either the writer sees the
+  // new message, or this thread sees that the writer is about to sleep
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (!d->writer_sleeping.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(d->writer_mutex);
+    d->writer_sleeping = false;
+  }
+
+  d->writer_cv.notify_one();
+}
+
+void ZeekLogger::writerThread() {
+  auto last_flush_time = std::chrono::steady_clock::now();
+
+  for (;;) {
+    bool terminate{false};
+
+    {
+      std::lock_guard<std::mutex> lock(d->writer_mutex);
+      terminate = d->terminate;
+    }
+
+    LogRecordQueue::Record record;
+    std::size_t record_count{0U};
+    bool flush_now{false};
+
+    while (record_count < kMaxBatchSize && d->record_queue->tryPop(record)) {
+      writeRecord(record);
+
+      flush_now = flush_now || record.severity == Severity::Error;
+      ++record_count;
+    }
+
+    auto dropped_message_count = d->dropped_message_count.exchange(0U);
+    if (dropped_message_count != 0U) {
+      record.severity = Severity::Warning;
+      record.time = std::chrono::system_clock::now();
+      record.message = std::to_string(dropped_message_count) +
+                       " log messages have been dropped because the log "
+                       "queue was full";
+
+      writeRecord(record);
+    }
+
+    if (!d->write_buffer.empty()) {
+      writeBuffer();
+    }
+
+    auto current_time = std::chrono::steady_clock::now();
+
+    if (d->flush_pending &&
+        (flush_now || terminate ||
+         current_time - last_flush_time >= d->configuration.flush_interval)) {
+
+      std::ostream &output_stream =
+          d->log_file.is_open() ? d->log_file : std::cerr;
+
+      output_stream.flush();
+
+      d->flush_pending = false;
+      last_flush_time = current_time;
+    }
+
+    if (record_count == kMaxBatchSize) {
+      continue;
+    }
+
+    if (terminate) {
+      if (d->record_queue->empty()) {
+        break;
+      }
+
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(d->writer_mutex);
+
+    d->writer_sleeping = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (d->record_queue->empty()) {
+      d->writer_cv.wait_for(lock, d->configuration.flush_interval, [this]() {
+        return d->terminate || !d->writer_sleeping;
+      });
+    }
+
+    d->writer_sleeping = false;
+  }
+}
+
+void ZeekLogger::writeRecord(const LogRecordQueue::Record &record) {
+  auto &logger_table_impl =
+      *static_cast<ZeekLoggerTablePlugin *>(d->logger_table.get());
+
+  auto status = logger_table_impl.appendMessage(record.severity,
+                                                record.message, record.time);
+
+  if (!status.succeeded()) {
+    std::cerr << "Failed to log the following message to the logger table: "
+              << record.message << "\n";
+  }
+
+  auto &write_buffer = d->write_buffer;
+
+  write_buffer += formatTimestamp(
+      d->timestamp_cache, std::chrono::system_clock::to_time_t(record.time));
+
+  write_buffer += " ";
+  write_buffer += loggerSeverityToString(record.severity);
+  write_buffer += ": ";
+  write_buffer += record.message;
+  write_buffer += "\n";
+
+  // Rotate as soon as the size limit is reached, rather than at the end of
+  // the batch
+  auto max_log_file_byte_count = d->configuration.max_log_file_byte_count;
+
+  if (max_log_file_byte_count != 0U &&
+      d->log_file_byte_count + write_buffer.size() >= max_log_file_byte_count) {
+    writeBuffer();
+  }
+}
+
+void ZeekLogger::writeBuffer() {
+  const auto &configuration = d->configuration;
+
+  if (d->log_file.is_open()) {
+    auto size_exceeded = configuration.max_log_file_byte_count != 0U &&
+                         d->log_file_byte_count >=
+                             configuration.max_log_file_byte_count;
+
+    auto age_exceeded = configuration.max_log_file_age.count() != 0 &&
+                        std::chrono::steady_clock::now() -
+                                d->log_file_open_time >=
+                            configuration.max_log_file_age;
+
+    if (size_exceeded || age_exceeded) {
+      d->log_file = {};
+    }
+  }
+
+  if (!d->log_file.is_open() || d->log_file.fail()) {
+    openLogFile();
+  }
+
+  std::ostream &output_stream = d->log_file.is_open() ? d->log_file : std::cerr;
+  output_stream.write(d->write_buffer.data(),
+                      static_cast<std::streamsize>(d->write_buffer.size()));
+
+  d->log_file_byte_count += d->write_buffer.size();
+  d->write_buffer.clear();
+
+  d->flush_pending = true;
+}
+
+void ZeekLogger::openLogFile() {
+  d->log_file = {};
+  d->log_file_byte_count = 0U;
+  d->log_file_open_time = std::chrono::steady_clock::now();
+
+  d->log_file_path = generateLogFileName(d->log_file_name_state,
+                                         d->configuration.log_folder);
+
+  d->log_file.open(d->log_file_path, std::ios::out | std::ios::app);
+  if (!d->log_file.good()) {
+    auto &logger_table_impl =
+        *static_cast<ZeekLoggerTablePlugin *>(d->logger_table.get());
+
+    auto error_message = "Failed to open the log file: " + d->log_file_path;
+
+    auto status = logger_table_impl.appendMessage(
+        Severity::Error, error_message, std::chrono::system_clock::now());
+
+    std::cerr << error_message << "\n";
+
+    d->log_file = {};
+    return;
+  }
+
+  removeOldLogFiles(d->configuration.log_folder,
+                    d->configuration.max_log_file_count, d->log_file_path);
+}
+
 Status IZeekLogger::create(Ref &ref, const Configuration &configuration,
                            IVirtualDatabase &virtual_database) {
   try {
@@ -1,15 +1,21 @@
 #pragma once
 
+#include "logrecordqueue.h"
+
 #include <zeek/izeeklogger.h>
 
 namespace zeek {
 /// \brief The Zeek logger (implementation)
+///
+/// The callers only queue the messages; a writer thread formats them,
+/// appends them to the log table and writes them to file in batches
 class ZeekLogger final : public IZeekLogger {
 public:
-  /// \brief Destructor
+  /// \brief Destructor; the queued messages are written first
   virtual ~ZeekLogger() override;
 
-  /// \brief Logs a message both to file and to the log table
+  /// \brief Logs a message both to file and to the log table. The message
+  ///        is written in the background
   /// \param severity The log severity
   /// \param message The message to log
   virtual void logMessage(Severity severity,
@@ -36,6 +42,25 @@ private:
   /// \return A Status object
   Status unregisterTables();
 
+  /// \brief Wakes up the writer thread if it is waiting for new messages
+  void wakeUpWriter();
+
+  /// \brief Writes the queued messages until the object is destroyed
+  void writerThread();
+
+  /// \brief Appends a message to the log table and to the write buffer.
+  ///        Only called by the writer thread
+  /// \param record The message to write
+  void writeRecord(const LogRecordQueue::Record &record);
+
+  /// \brief Writes the buffered messages to the log file, opening or
+  ///        rotating it if needed. Only called by the writer thread
+  void writeBuffer();
+
+  /// \brief Starts a new log file, then deletes the oldest ones past the
+  ///        retention limit. Only called by the writer thread
+  void openLogFile();
+
   friend class IZeekLogger;
 };
 } // namespace zeek
@@ -1,19 +1,58 @@
 #include "zeekloggertableplugin.h"
 
-#include <chrono>
+#include <deque>
 #include <mutex>
 
 namespace zeek {
+namespace {
+/// \brief A message waiting to be queried
+struct QueuedRow final {
+  IVirtualTable::Row row;
+  std::size_t byte_count{0U};
+};
+
+/// \return The estimated memory used by the given row
+std::size_t estimateRowByteCount(const IVirtualTable::Row &row) {
+  // Accounts for the map nodes, not just for the strings
+  const std::size_t kColumnOverhead{64U};
+
+  auto byte_count = sizeof(QueuedRow);
+
+  for (const auto &column : row) {
+    byte_count += kColumnOverhead + column.first.size();
+
+    if (!column.second.has_value()) {
+      continue;
+    }
+
+    if (auto string_value = std::get_if<std::string>(&column.second.value())) {
+      byte_count += string_value->size();
+    }
+  }
+
+  return byte_count;
+}
+} // namespace
+
 struct ZeekLoggerTablePlugin::PrivateData final {
-  RowList row_list;
-  std::mutex row_list_mutex;
+  std::size_t max_row_count{0U};
+  std::size_t max_byte_count{0U};
+
+  std::deque<QueuedRow> row_queue;
+  mutable std::mutex row_queue_mutex;
+
+  Stats stats;
+
+  /// \brief How many messages have been dropped since the last query
+  std::uint64_t unreported_drop_count{0U};
 };
 
-Status ZeekLoggerTablePlugin::create(Ref &obj) {
+Status ZeekLoggerTablePlugin::create(Ref &obj, std::size_t max_row_count,
+                                     std::size_t max_byte_count) {
   obj.reset();
 
   try {
-    auto ptr = new ZeekLoggerTablePlugin();
+    auto ptr = new ZeekLoggerTablePlugin(max_row_count, max_byte_count);
     obj.reset(ptr);
 
     return Status::success();
@@ -47,37 +86,104 @@ const ZeekLoggerTablePlugin::Schema &ZeekLoggerTablePlugin::schema() const {
 }
 
 Status ZeekLoggerTablePlugin::generateRowList(RowList &row_list) {
-  std::lock_guard<std::mutex> lock(d->row_list_mutex);
+  row_list = {};
+
+  std::lock_guard<std::mutex> lock(d->row_queue_mutex);
+
+  // Let the reader know that there is a gap before the first row
+  if (d->unreported_drop_count != 0U) {
+    Row row;
+    auto status = generateRow(
+        row, IZeekLogger::Severity::Warning,
+        std::to_string(d->unreported_drop_count) +
+            " older messages have been dropped because the table was full "
+            "(max row count is set to " +
+            std::to_string(d->max_row_count) + ", max byte count is set to " +
+            std::to_string(d->max_byte_count) + ")",
+        std::chrono::system_clock::now());
+
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    row_list.push_back(std::move(row));
+    d->unreported_drop_count = 0U;
+  }
+
+  row_list.reserve(row_list.size() + d->row_queue.size());
 
-  row_list = std::move(d->row_list);
-  d->row_list = {};
+  for (auto &queued_row : d->row_queue) {
+    row_list.push_back(std::move(queued_row.row));
+  }
+
+  d->row_queue.clear();
+  d->stats.queued_row_count = 0U;
+  d->stats.queued_byte_count = 0U;
 
   return Status::success();
 }
 
-Status ZeekLoggerTablePlugin::appendMessage(IZeekLogger::Severity severity,
-                                            const std::string &message) {
+Status ZeekLoggerTablePlugin::appendMessage(
+    IZeekLogger::Severity severity, const std::string &message,
+    std::chrono::system_clock::time_point time) {
 
-  Row row;
-  auto status = generateRow(row, severity, message);
+  QueuedRow queued_row;
+  auto status = generateRow(queued_row.row, severity, message, time);
   if (!status.succeeded()) {
     return status;
   }
 
+  queued_row.byte_count = estimateRowByteCount(queued_row.row);
+
   {
-    std::lock_guard<std::mutex> lock(d->row_list_mutex);
+    std::lock_guard<std::mutex> lock(d->row_queue_mutex);
+
+    auto &stats = d->stats;
+
+    d->row_queue.push_back(std::move(queued_row));
+    ++stats.queued_row_count;
+    stats.queued_byte_count += d->row_queue.back().byte_count;
+
+    while (!d->row_queue.empty() &&
+           (stats.queued_row_count > d->max_row_count ||
+            stats.queued_byte_count > d->max_byte_count)) {
+
+      auto byte_count = d->row_queue.front().byte_count;
+      d->row_queue.pop_front();
+
+      --stats.queued_row_count;
+      stats.queued_byte_count -= byte_count;
 
-    d->row_list.push_back(std::move(row));
+      ++stats.dropped_row_count;
+      stats.dropped_byte_count += byte_count;
+
+      ++d->unreported_drop_count;
+    }
   }
 
   return Status::success();
 }
 
-ZeekLoggerTablePlugin::ZeekLoggerTablePlugin() : d(new PrivateData) {}
+ZeekLoggerTablePlugin::Stats ZeekLoggerTablePlugin::stats() const {
+  std::lock_guard<std::mutex> lock(d->row_queue_mutex);
+  return d->stats;
+}
+
+ZeekLoggerTablePlugin::ZeekLoggerTablePlugin(std::size_t max_row_count,
+                                             std::size_t max_byte_count)
+    : d(new PrivateData) {
+
+  if (max_row_count == 0U || max_byte_count == 0U) {
+    throw Status::failure("Invalid zeek_logger table limits");
+  }
+
+  d->max_row_count = max_row_count;
+  d->max_byte_count = max_byte_count;
+}
 
-Status ZeekLoggerTablePlugin::generateRow(Row &row,
-                                          IZeekLogger::Severity severity,
-                                          const std::string &message) {
+Status ZeekLoggerTablePlugin::generateRow(
+    Row &row, IZeekLogger::Severity severity, const std::string &message,
+    std::chrono::system_clock::time_point time) {
 
   row = {};
 
@@ -104,10 +210,10 @@ Status ZeekLoggerTablePlugin::generateRow(Row &row,
     return Status::failure("Invalid severity specified");
   }
 
-  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-      std::chrono::system_clock::now().time_since_epoch());
+  auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      time.time_since_epoch());
 
-  auto time_value = static_cast<std::int64_t>(current_timestamp.count());
+  auto time_value = static_cast<std::int64_t>(timestamp.count());
 
   row["time"] = time_value;
   row["severity"] = severity_name;
@@ -1,19 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+
 #include <zeek/ivirtualtable.h>
 #include <zeek/izeeklogger.h>
 
 namespace zeek {
 /// \brief A virtual table plugin that exposes the logged messages
+///
+/// The messages are kept until the table is queried, within a row and an
+/// (estimated) byte limit; the oldest messages are dropped first, and the
+/// next query reports how many have been lost
 class ZeekLoggerTablePlugin final : public IVirtualTable {
   struct PrivateData;
   std::unique_ptr<PrivateData> d;
 
 public:
+  /// \brief Table metrics
+  struct Stats final {
+    /// \brief How many messages are waiting to be queried
+    std::size_t queued_row_count{0U};
+
+    /// \brief The estimated size of the messages waiting to be queried
+    std::size_t queued_byte_count{0U};
+
+    /// \brief How many messages have been dropped because the table was
+    ///        full
+    std::uint64_t dropped_row_count{0U};
+
+    /// \brief The estimated size of the dropped messages
+    std::uint64_t dropped_byte_count{0U};
+  };
+
   /// \brief Factory method
   /// \param obj Where the created object is stored
+  /// \param max_row_count How many messages can wait to be queried
+  /// \param max_byte_count The maximum (estimated) size of the messages
+  ///                       waiting to be queried
   /// \return A Status object
-  static Status create(Ref &obj);
+  static Status create(Ref &obj, std::size_t max_row_count,
+                       std::size_t max_byte_count);
 
   /// \brief Destructor
   virtual ~ZeekLoggerTablePlugin() override;
@@ -32,21 +59,31 @@ public:
   /// \brief Used by the logger to store new messages in the table
   /// \param severity The severity for the log message
   /// \param message The message to log
+  /// \param time When the message has been logged
   /// \return A Status object
   Status appendMessage(IZeekLogger::Severity severity,
-                       const std::string &message);
+                       const std::string &message,
+                       std::chrono::system_clock::time_point time);
+
+  /// \return The table metrics
+  Stats stats() const;
 
 protected:
   /// \brief Constructor
-  ZeekLoggerTablePlugin();
+  /// \param max_row_count How many messages can wait to be queried
+  /// \param max_byte_count The maximum (estimated) size of the messages
+  ///                       waiting to be queried
+  ZeekLoggerTablePlugin(std::size_t max_row_count, std::size_t max_byte_count);
 
 public:
   /// \brief Generates a single row from the given log message
   /// \param row Where to store the generated row
   /// \param severity The severity for the log message
   /// \param message The message to log
+  /// \param time When the message has been logged
   /// \return A Status object
   static Status generateRow(Row &row, IZeekLogger::Severity severity,
-                            const std::string &message);
+                            const std::string &message,
+                            std::chrono::system_clock::time_point time);
 };
 } // namespace zeek
@@ -0,0 +1,116 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <zeek/logratelimiter.h>
+
+namespace zeek {
+namespace {
+/// \brief A logger that only keeps the messages in memory
+class MessageRecorder final : public IZeekLogger {
+public:
+  MessageRecorder() = default;
+  virtual ~MessageRecorder() override = default;
+
+  virtual void logMessage(Severity, const std::string &message) override {
+    message_list.push_back(message);
+  }
+
+  std::vector<std::string> message_list;
+};
+
+/// \brief Logs from a single call site
+/// \param logger Where the messages are logged
+/// \param format_count Incremented each time the message is generated
+void logFromHotPath(IZeekLogger &logger, std::size_t &format_count) {
+  ZEEK_LOG_RATE_LIMITED(logger, IZeekLogger::Severity::Warning,
+                        "message " + std::to_string(++format_count));
+}
+} // namespace
+
+TEST_CASE("Log rate limiter", "[LogRateLimiter]") {
+  LogRateLimiter rate_limiter(std::chrono::milliseconds(200));
+
+  std::size_t suppressed_count{1U};
+  REQUIRE(rate_limiter.shouldLog(suppressed_count));
+  REQUIRE(suppressed_count == 0U);
+
+  for (std::size_t i = 0U; i < 10U; ++i) {
+    REQUIRE(!rate_limiter.shouldLog(suppressed_count));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+  REQUIRE(rate_limiter.shouldLog(suppressed_count));
+  REQUIRE(suppressed_count == 10U);
+
+  REQUIRE(LogRateLimiter::appendSuppressedCount("message", 0U) == "message");
+
+  REQUIRE(LogRateLimiter::appendSuppressedCount("message", 10U) ==
+          "message (10 similar messages have been suppressed)");
+}
+
+TEST_CASE("Rate limited logging", "[LogRateLimiter]") {
+  MessageRecorder logger;
+  std::size_t format_count{0U};
+
+  for (std::size_t i = 0U; i < 1000U; ++i) {
+    logFromHotPath(logger, format_count);
+  }
+
+  // The suppressed messages are never generated
+  REQUIRE(logger.message_list.size() == 1U);
+  REQUIRE(logger.message_list.at(0U) == "message 1");
+  REQUIRE(format_count == 1U);
+}
+
+TEST_CASE("Rate limited logging by object", "[LogRateLimiter]") {
+  MessageRecorder logger;
+
+  // Each table has its own limiter, so that one table can not hide the
+  // messages of another one
+  LogRateLimiter first_table_rate_limiter;
+  LogRateLimiter second_table_rate_limiter;
+
+  for (std::size_t i = 0U; i < 100U; ++i) {
+    ZEEK_LOG_RATE_LIMITED_BY(first_table_rate_limiter, logger,
+                             IZeekLogger::Severity::Error, "first_table");
+
+    ZEEK_LOG_RATE_LIMITED_BY(second_table_rate_limiter, logger,
+                             IZeekLogger::Severity::Error, "second_table");
+  }
+
+  REQUIRE(logger.message_list.size() == 2U);
+  REQUIRE(logger.message_list.at(0U) == "first_table");
+  REQUIRE(logger.message_list.at(1U) == "second_table");
+}
+
+TEST_CASE("Log rate limiter with several threads", "[LogRateLimiter]") {
+  const std::size_t kThreadCount{4U};
+  const std::size_t kCallCount{10000U};
+
+  LogRateLimiter rate_limiter;
+
+  std::atomic<std::size_t> logged_count{0U};
+  std::vector<std::thread> thread_list;
+
+  for (std::size_t i = 0U; i < kThreadCount; ++i) {
+    thread_list.push_back(std::thread([&rate_limiter, &logged_count]() {
+      for (std::size_t j = 0U; j < kCallCount; ++j) {
+        std::size_t suppressed_count{0U};
+        if (rate_limiter.shouldLog(suppressed_count)) {
+          ++logged_count;
+        }
+      }
+    }));
+  }
+
+  for (auto &thread : thread_list) {
+    thread.join();
+  }
+
+  REQUIRE(logged_count == 1U);
+}
+} // namespace zeek
@@ -0,0 +1,105 @@
+#include "logrecordqueue.h"
+
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+LogRecordQueue::Record generateRecord(const std::string &message) {
+  LogRecordQueue::Record record;
+  record.severity = IZeekLogger::Severity::Information;
+  record.time = std::chrono::system_clock::now();
+  record.message = message;
+
+  return record;
+}
+} // namespace
+
+TEST_CASE("Log record queue", "[LogRecordQueue]") {
+  LogRecordQueue::Ref record_queue;
+  auto status = LogRecordQueue::create(record_queue, 3U);
+  REQUIRE(status.succeeded());
+
+  // The capacity is rounded up to the next power of two
+  REQUIRE(record_queue->capacity() == 4U);
+  REQUIRE(record_queue->empty());
+
+  for (std::size_t i = 0U; i < 4U; ++i) {
+    auto record = generateRecord(std::to_string(i));
+    REQUIRE(record_queue->tryPush(record));
+  }
+
+  // A record that does not fit is left untouched
+  auto record = generateRecord("4");
+  REQUIRE(!record_queue->tryPush(record));
+  REQUIRE(record.message == "4");
+
+  for (std::size_t i = 0U; i < 4U; ++i) {
+    REQUIRE(record_queue->tryPop(record));
+    REQUIRE(record.message == std::to_string(i));
+  }
+
+  REQUIRE(record_queue->empty());
+  REQUIRE(!record_queue->tryPop(record));
+
+  status = LogRecordQueue::create(record_queue, 0U);
+  REQUIRE(!status.succeeded());
+}
+
+TEST_CASE("Log record queue with several producers", "[LogRecordQueue]") {
+  const std::size_t kProducerCount{4U};
+  const std::size_t kRecordCount{20000U};
+
+  LogRecordQueue::Ref record_queue;
+  auto status = LogRecordQueue::create(record_queue, 64U);
+  REQUIRE(status.succeeded());
+
+  std::vector<std::thread> producer_list;
+
+  for (std::size_t i = 0U; i < kProducerCount; ++i) {
+    producer_list.push_back(std::thread([i, &record_queue]() {
+      for (std::size_t j = 0U; j < kRecordCount; ++j) {
+        auto record =
+            generateRecord(std::to_string(i) + ":" + std::to_string(j));
+
+        while (!record_queue->tryPush(record)) {
+          std::this_thread::yield();
+        }
+      }
+    }));
+  }
+
+  // Each producer's records must come out in order
+  std::vector<std::size_t> next_record_list(kProducerCount, 0U);
+  std::size_t record_count{0U};
+  bool ordered{true};
+
+  while (record_count < kProducerCount * kRecordCount) {
+    LogRecordQueue::Record record;
+    if (!record_queue->tryPop(record)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    auto separator = record.message.find(':');
+    auto producer = std::stoul(record.message.substr(0U, separator));
+    auto index = std::stoul(record.message.substr(separator + 1U));
+
+    if (index != next_record_list.at(producer)) {
+      ordered = false;
+    }
+
+    next_record_list.at(producer) = index + 1U;
+    ++record_count;
+  }
+
+  for (auto &producer : producer_list) {
+    producer.join();
+  }
+
+  REQUIRE(ordered);
+  REQUIRE(record_queue->empty());
+}
+} // namespace zeek
@@ -0,0 +1,330 @@
+#include "zeeklogger.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+const std::string kLogFolderPath{"zeek_logger_test"};
+const std::string kDroppedMessageSuffix{
+    " log messages have been dropped because the log queue was full"};
+
+/// \brief A virtual database that only keeps the registered tables
+class TableRegistry final : public IVirtualDatabase {
+public:
+  TableRegistry() = default;
+  virtual ~TableRegistry() override = default;
+
+  virtual std::vector<std::string> virtualTableList() const override {
+    std::vector<std::string> table_name_list;
+    for (const auto &p : table_map) {
+      table_name_list.push_back(p.first);
+    }
+
+    return table_name_list;
+  }
+
+  virtual Status registerTable(IVirtualTable::Ref table) override {
+    table_map[table->name()] = table;
+    return Status::success();
+  }
+
+  virtual Status unregisterTable(const std::string &name) override {
+    table_map.erase(name);
+    return Status::success();
+  }
+
+  virtual bool isEventTable(const std::string &) const override {
+    return true;
+  }
+
+  virtual void setTableUpdateCallback(TableUpdateCallback) override {}
+
+  virtual Status query(QueryOutput &, const std::string &) const override {
+    return Status::failure("Not implemented");
+  }
+
+  virtual Status query(const std::string &, std::size_t,
+                       const QueryOutputCallback &) const override {
+    return Status::failure("Not implemented");
+  }
+
+  std::unordered_map<std::string, IVirtualTable::Ref> table_map;
+};
+
+/// \return The lines of every log file in the test folder
+std::vector<std::string> readLogFiles() {
+  std::vector<std::string> line_list;
+
+  for (const auto &entry :
+       std::filesystem::directory_iterator(kLogFolderPath)) {
+    std::ifstream log_file(entry.path());
+
+    std::string line;
+    while (std::getline(log_file, line)) {
+      line_list.push_back(line);
+    }
+  }
+
+  return line_list;
+}
+
+/// \return The message part of a log line
+std::string logLineMessage(const std::string &line) {
+  auto separator = line.find(": ");
+  if (separator == std::string::npos) {
+    return {};
+  }
+
+  return line.substr(separator + 2U);
+}
+
+/// \return How many dropped messages the given line reports
+std::size_t droppedMessageCount(const std::string &message) {
+  if (message.size() <= kDroppedMessageSuffix.size() ||
+      message.compare(message.size() - kDroppedMessageSuffix.size(),
+                      kDroppedMessageSuffix.size(),
+                      kDroppedMessageSuffix) != 0) {
+    return 0U;
+  }
+
+  return std::stoul(message);
+}
+} // namespace
+
+TEST_CASE("Logging messages", "[ZeekLogger]") {
+  const std::size_t kMessageCount{1000U};
+
+  std::filesystem::remove_all(kLogFolderPath);
+  std::filesystem::create_directories(kLogFolderPath);
+
+  TableRegistry table_registry;
+
+  IZeekLogger::Configuration configuration;
+  configuration.log_folder = kLogFolderPath;
+  configuration.overflow_policy = IZeekLogger::OverflowPolicy::Block;
+  configuration.max_queued_message_count = 16U;
+
+  IVirtualTable::RowList row_list;
+
+  {
+    IZeekLogger::Ref logger;
+    auto status = IZeekLogger::create(logger, configuration, table_registry);
+    REQUIRE(status.succeeded());
+    REQUIRE(table_registry.table_map.count("zeek_logger") == 1U);
+
+    logger->logMessage(IZeekLogger::Severity::Debug, "filtered");
+
+    for (std::size_t i = 0U; i < kMessageCount; ++i) {
+      logger->logMessage(IZeekLogger::Severity::Information,
+                         "message " + std::to_string(i));
+    }
+
+    // The queued messages are written before the logger goes away
+    auto logger_table = table_registry.table_map.at("zeek_logger");
+    logger.reset();
+
+    status = logger_table->generateRowList(row_list);
+    REQUIRE(status.succeeded());
+  }
+
+  REQUIRE(table_registry.table_map.empty());
+
+  auto line_list = readLogFiles();
+  REQUIRE(line_list.size() == kMessageCount);
+  REQUIRE(row_list.size() == kMessageCount);
+
+  for (std::size_t i = 0U; i < kMessageCount; ++i) {
+    const auto &line = line_list.at(i);
+    auto expected_message = "message " + std::to_string(i);
+
+    REQUIRE(line.find(" Information: ") != std::string::npos);
+    REQUIRE(logLineMessage(line) == expected_message);
+
+    REQUIRE(std::get<std::string>(row_list.at(i).at("message").value()) ==
+            expected_message);
+  }
+
+  std::filesystem::remove_all(kLogFolderPath);
+}
+
+TEST_CASE("Dropping log messages", "[ZeekLogger]") {
+  const std::size_t kMessageCount{20000U};
+
+  std::filesystem::remove_all(kLogFolderPath);
+  std::filesystem::create_directories(kLogFolderPath);
+
+  TableRegistry table_registry;
+
+  IZeekLogger::Configuration configuration;
+  configuration.log_folder = kLogFolderPath;
+  configuration.overflow_policy = IZeekLogger::OverflowPolicy::Drop;
+  configuration.max_queued_message_count = 2U;
+
+  {
+    IZeekLogger::Ref logger;
+    auto status = IZeekLogger::create(logger, configuration, table_registry);
+    REQUIRE(status.succeeded());
+
+    for (std::size_t i = 0U; i < kMessageCount; ++i) {
+      logger->logMessage(IZeekLogger::Severity::Information,
+                         "message " + std::to_string(i));
+    }
+  }
+
+  // Every message is either written or accounted for
+  std::size_t written_message_count{0U};
+  std::size_t dropped_message_count{0U};
+  std::size_t next_message_index{0U};
+  bool ordered{true};
+
+  for (const auto &line : readLogFiles()) {
+    auto message = logLineMessage(line);
+
+    auto dropped_count = droppedMessageCount(message);
+    if (dropped_count != 0U) {
+      REQUIRE(line.find(" Warning: ") != std::string::npos);
+      dropped_message_count += dropped_count;
+      continue;
+    }
+
+    auto index = std::stoul(message.substr(message.find(' ') + 1U));
+    if (index < next_message_index) {
+      ordered = false;
+    }
+
+    next_message_index = index + 1U;
+    ++written_message_count;
+  }
+
+  REQUIRE(ordered);
+  REQUIRE(written_message_count + dropped_message_count == kMessageCount);
+
+  std::filesystem::remove_all(kLogFolderPath);
+}
+
+TEST_CASE("Log file rotation", "[ZeekLogger]") {
+  const std::size_t kMessageCount{1000U};
+
+  std::filesystem::remove_all(kLogFolderPath);
+  std::filesystem::create_directories(kLogFolderPath);
+
+  // Not generated by the logger, so it must be left alone
+  { std::ofstream other_file(kLogFolderPath + "/other.log"); }
+
+  TableRegistry table_registry;
+
+  IZeekLogger::Configuration configuration;
+  configuration.log_folder = kLogFolderPath;
+  configuration.overflow_policy = IZeekLogger::OverflowPolicy::Block;
+  configuration.max_log_file_byte_count = 4096U;
+  configuration.max_log_file_count = 3U;
+
+  {
+    IZeekLogger::Ref logger;
+    auto status = IZeekLogger::create(logger, configuration, table_registry);
+    REQUIRE(status.succeeded());
+
+    for (std::size_t i = 0U; i < kMessageCount; ++i) {
+      logger->logMessage(IZeekLogger::Severity::Information,
+                         "message " + std::to_string(i));
+    }
+  }
+
+  std::vector<std::filesystem::path> log_file_path_list;
+
+  for (const auto &entry :
+       std::filesystem::directory_iterator(kLogFolderPath)) {
+    if (entry.path().filename() != "other.log") {
+      log_file_path_list.push_back(entry.path());
+    }
+  }
+
+  REQUIRE(std::filesystem::exists(kLogFolderPath + "/other.log"));
+
+  // Only the newest files are kept, and none of them is much larger than
+  // the limit
+  REQUIRE(log_file_path_list.size() == 3U);
+
+  std::sort(log_file_path_list.begin(), log_file_path_list.end());
+  std::string last_line;
+
+  for (const auto &log_file_path : log_file_path_list) {
+    REQUIRE(std::filesystem::file_size(log_file_path) < 4096U + 64U);
+
+    std::ifstream log_file(log_file_path);
+
+    std::string line;
+    while (std::getline(log_file, line)) {
+      last_line = line;
+    }
+  }
+
+  REQUIRE(logLineMessage(last_line) ==
+          "message " + std::to_string(kMessageCount - 1U));
+
+  std::filesystem::remove_all(kLogFolderPath);
+}
+
+TEST_CASE("Logging cost per call", "[.benchmark][ZeekLogger]") {
+  const std::size_t kMessageCount{1000000U};
+  const std::string kMessage{
+      "Running scheduled query: SELECT * FROM processes"};
+
+  auto measure = [&kMessageCount,
+                  &kMessage](IZeekLogger::OverflowPolicy overflow_policy,
+                             const std::string &mode_name) {
+    std::filesystem::remove_all(kLogFolderPath);
+    std::filesystem::create_directories(kLogFolderPath);
+
+    TableRegistry table_registry;
+
+    IZeekLogger::Configuration configuration;
+    configuration.log_folder = kLogFolderPath;
+    configuration.overflow_policy = overflow_policy;
+
+    IZeekLogger::Ref logger;
+    auto status = IZeekLogger::create(logger, configuration, table_registry);
+    REQUIRE(status.succeeded());
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0U; i < kMessageCount; ++i) {
+      logger->logMessage(IZeekLogger::Severity::Information, kMessage);
+    }
+
+    auto call_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time);
+
+    logger.reset();
+
+    auto wall_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
+
+    std::size_t dropped_message_count{0U};
+    auto line_list = readLogFiles();
+
+    for (const auto &line : line_list) {
+      dropped_message_count += droppedMessageCount(logLineMessage(line));
+    }
+
+    WARN(mode_name << ": "
+                   << (call_time.count() /
+                       static_cast<long long>(kMessageCount))
+                   << "ns per call, " << dropped_message_count
+                   << " dropped messages, wall time including the final "
+                      "write: "
+                   << wall_time.count() << "ms");
+
+    std::filesystem::remove_all(kLogFolderPath);
+  };
+
+  measure(IZeekLogger::OverflowPolicy::Block, "Block");
+  measure(IZeekLogger::OverflowPolicy::Drop, "Drop");
+}
+} // namespace zeek
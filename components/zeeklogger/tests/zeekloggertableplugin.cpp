@@ -0,0 +1,99 @@
+#include "zeekloggertableplugin.h"
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+std::string rowMessage(const IVirtualTable::Row &row) {
+  return std::get<std::string>(row.at("message").value());
+}
+} // namespace
+
+TEST_CASE("Bounded logger table", "[ZeekLoggerTablePlugin]") {
+  const auto kMessageTime = std::chrono::system_clock::time_point(
+      std::chrono::seconds(1600000000));
+
+  SECTION("The row limit") {
+    IVirtualTable::Ref table;
+    auto status = ZeekLoggerTablePlugin::create(table, 10U, 1024U * 1024U);
+    REQUIRE(status.succeeded());
+
+    auto &table_impl = *static_cast<ZeekLoggerTablePlugin *>(table.get());
+
+    for (std::size_t i = 0U; i < 25U; ++i) {
+      status = table_impl.appendMessage(IZeekLogger::Severity::Information,
+                                        "message " + std::to_string(i),
+                                        kMessageTime);
+
+      REQUIRE(status.succeeded());
+    }
+
+    auto stats = table_impl.stats();
+    REQUIRE(stats.queued_row_count == 10U);
+    REQUIRE(stats.dropped_row_count == 15U);
+    REQUIRE(stats.dropped_byte_count > 0U);
+
+    // The oldest messages have been dropped, and the gap is reported
+    IVirtualTable::RowList row_list;
+    status = table->generateRowList(row_list);
+    REQUIRE(status.succeeded());
+    REQUIRE(row_list.size() == 11U);
+
+    REQUIRE(std::get<std::string>(row_list.at(0U).at("severity").value()) ==
+            "Warning");
+
+    REQUIRE(rowMessage(row_list.at(0U)).find("15 older messages") == 0U);
+
+    for (std::size_t i = 1U; i < row_list.size(); ++i) {
+      REQUIRE(rowMessage(row_list.at(i)) ==
+              "message " + std::to_string(i + 14U));
+
+      REQUIRE(std::get<std::int64_t>(row_list.at(i).at("time").value()) ==
+              1600000000);
+    }
+
+    stats = table_impl.stats();
+    REQUIRE(stats.queued_row_count == 0U);
+    REQUIRE(stats.queued_byte_count == 0U);
+    REQUIRE(stats.dropped_row_count == 15U);
+
+    // The gap is only reported once
+    status = table_impl.appendMessage(IZeekLogger::Severity::Error, "last",
+                                      kMessageTime);
+    REQUIRE(status.succeeded());
+
+    status = table->generateRowList(row_list);
+    REQUIRE(status.succeeded());
+    REQUIRE(row_list.size() == 1U);
+    REQUIRE(rowMessage(row_list.at(0U)) == "last");
+  }
+
+  SECTION("The byte limit") {
+    const std::string kLargeMessage(4096U, 'A');
+
+    IVirtualTable::Ref table;
+    auto status = ZeekLoggerTablePlugin::create(table, 1000U, 16384U);
+    REQUIRE(status.succeeded());
+
+    auto &table_impl = *static_cast<ZeekLoggerTablePlugin *>(table.get());
+
+    for (std::size_t i = 0U; i < 10U; ++i) {
+      status = table_impl.appendMessage(IZeekLogger::Severity::Information,
+                                        kLargeMessage, kMessageTime);
+
+      REQUIRE(status.succeeded());
+    }
+
+    auto stats = table_impl.stats();
+    REQUIRE(stats.queued_byte_count <= 16384U);
+    REQUIRE(stats.queued_row_count < 4U);
+    REQUIRE(stats.queued_row_count + stats.dropped_row_count == 10U);
+  }
+
+  SECTION("Invalid limits") {
+    IVirtualTable::Ref table;
+    auto status = ZeekLoggerTablePlugin::create(table, 0U, 16384U);
+    REQUIRE(!status.succeeded());
+  }
+}
+} // namespace zeek
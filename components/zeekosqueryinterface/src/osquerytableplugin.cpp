@@ -4,6 +4,8 @@
 #include <osquery/sdk/sdk.h>
 #include <osquery/system.h>
 
+#include <zeek/logratelimiter.h>
+
 namespace zeek {
 struct OsqueryTablePlugin::PrivateData final {
   PrivateData(IZeekLogger &logger_) : logger(logger_) {}
@@ -11,6 +13,9 @@ struct OsqueryTablePlugin::PrivateData final {
   std::string table_name;
   Schema table_schema;
   IZeekLogger &logger;
+
+  /// \brief Limits the unknown column errors of this table
+  LogRateLimiter unknown_column_log_rate_limiter;
 };
 
 Status OsqueryTablePlugin::create(Ref &ref,
@@ -61,9 +66,10 @@ Status OsqueryTablePlugin::generateRowList(RowList &row_list) {
 
       auto column_info_it = d->table_schema.find(column_name);
       if (column_info_it == d->table_schema.end()) {
-        d->logger.logMessage(IZeekLogger::Severity::Error,
-                             "Unknown column returned from table " +
-                                 d->table_name + ": " + column_name);
+        ZEEK_LOG_RATE_LIMITED_BY(d->unknown_column_log_rate_limiter,
+                                 d->logger, IZeekLogger::Severity::Error,
+                                 "Unknown column returned from table " +
+                                     d->table_name + ": " + column_name);
 
         continue;
       }
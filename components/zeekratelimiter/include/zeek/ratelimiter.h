@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zeek/ivirtualtable.h>
+#include <zeek/izeekconfiguration.h>
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief How many (exe, uid) pairs each event table tracks by default
+const std::size_t kDefaultRateLimiterKeyCount{4096U};
+
+/// \brief The names of the row columns holding the executable path, the
+///        user id and the process id
+struct RateLimiterKeyColumns final {
+  /// \brief The executable path column (string)
+  std::string exe{"exe"};
+
+  /// \brief The user id column (integer)
+  std::string uid{"uid"};
+
+  /// \brief The process id column (integer)
+  std::string pid{"pid"};
+};
+
+/// \brief Thins event rows using a token bucket for each (exe, uid) pair
+///
+/// Once a bucket is empty, events are suppressed until it is refilled. If
+/// sampling is enabled, a fixed subset of the processes (selected by
+/// hashing the pid) keeps reporting events while the bucket is empty, so
+/// that the surviving events can still be correlated with each other.
+/// The number of tracked keys is bounded; when the limit is reached, the
+/// least recently used key is evicted
+class RateLimiter final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to a rate limiter object
+  using Ref = std::unique_ptr<RateLimiter>;
+
+  /// \brief Event counters for a single (exe, uid) pair
+  struct KeyStats final {
+    /// \brief The executable path
+    std::string exe;
+
+    /// \brief The user id
+    std::int64_t uid{0};
+
+    /// \brief How many events have been accepted by the token bucket
+    std::uint64_t accepted_count{0U};
+
+    /// \brief How many events have been accepted by the sampling stage
+    std::uint64_t sampled_count{0U};
+
+    /// \brief How many events have been discarded
+    std::uint64_t suppressed_count{0U};
+  };
+
+  /// \brief A list of key statistics
+  using KeyStatsList = std::vector<KeyStats>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param settings The rate limiting settings
+  /// \param max_key_count How many (exe, uid) pairs can be tracked
+  /// \param key_columns The columns used to build the keys
+  /// \return A Status object
+  static Status create(Ref &obj,
+                       const IZeekConfiguration::EventRateLimit &settings,
+                       std::size_t max_key_count,
+                       const RateLimiterKeyColumns &key_columns = {});
+
+  /// \brief Destructor
+  ~RateLimiter();
+
+  /// \return True if rate limiting has been enabled
+  bool enabled() const;
+
+  /// \brief Decides whether the given row should be kept, updating the
+  ///        counters of its (exe, uid) pair
+  /// \param row The row to test, using the columns named by the key columns
+  /// \param current_time The current time, taken from a monotonic clock
+  /// \return True if the row should be kept, false otherwise
+  bool accept(const IVirtualTable::Row &row,
+              std::chrono::milliseconds current_time);
+
+  /// \return The counters for each tracked (exe, uid) pair
+  KeyStatsList keyStats() const;
+
+  /// \return The counters for all the events, including the ones whose key
+  ///         has been evicted. The exe and uid fields are not used
+  KeyStats totalStats() const;
+
+  RateLimiter(const RateLimiter &) = delete;
+  RateLimiter &operator=(const RateLimiter &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param settings The rate limiting settings
+  /// \param max_key_count How many (exe, uid) pairs can be tracked
+  /// \param key_columns The columns used to build the keys
+  RateLimiter(const IZeekConfiguration::EventRateLimit &settings,
+              std::size_t max_key_count,
+              const RateLimiterKeyColumns &key_columns);
+};
+} // namespace zeek
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <unordered_map>
+
+#include <zeek/ivirtualtable.h>
+#include <zeek/ratelimiter.h>
+
+namespace zeek {
+/// \brief A virtual table plugin that exposes the counters of the event
+///        table rate limiters
+class RateLimiterTablePlugin final : public IVirtualTable {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief Maps each event table name to its rate limiter
+  using RateLimiterMap = std::unordered_map<std::string, const RateLimiter *>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param table_name The name of the table
+  /// \param rate_limiter_map The rate limiters to export
+  /// \return A Status object
+  static Status create(Ref &obj, const std::string &table_name,
+                       const RateLimiterMap &rate_limiter_map);
+
+  /// \brief Destructor
+  virtual ~RateLimiterTablePlugin() override;
+
+  /// \return The table name
+  virtual const std::string &name() const override;
+
+  /// \return The table schema
+  virtual const Schema &schema() const override;
+
+  /// \brief Generates one row for each tracked (exe, uid) pair, plus one
+  ///        row for each table (with null exe and uid) holding its totals
+  /// \param row_list Where the generated rows are stored
+  /// \return A Status object
+  virtual Status generateRowList(RowList &row_list) override;
+
+protected:
+  /// \brief Constructor
+  /// \param table_name The name of the table
+  /// \param rate_limiter_map The rate limiters to export
+  RateLimiterTablePlugin(const std::string &table_name,
+                         const RateLimiterMap &rate_limiter_map);
+};
+} // namespace zeek
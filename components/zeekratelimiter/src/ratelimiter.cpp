@@ -0,0 +1,223 @@
+#include <zeek/ratelimiter.h>
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace zeek {
+namespace {
+using Key = std::pair<std::string, std::int64_t>;
+
+struct KeyHash final {
+  std::size_t operator()(const Key &key) const {
+    auto hash = std::hash<std::string>{}(key.first);
+    hash ^= std::hash<std::int64_t>{}(key.second) + 0x9e3779b97f4a7c15ULL +
+            (hash << 6) + (hash >> 2);
+
+    return hash;
+  }
+};
+
+struct KeyState final {
+  RateLimiter::KeyStats stats;
+
+  std::size_t key_hash{0U};
+  double token_count{0.0};
+  std::chrono::milliseconds last_refill_time{0};
+};
+
+using KeyStateList = std::list<KeyState>;
+using KeyStateMap =
+    std::unordered_map<Key, KeyStateList::iterator, KeyHash>;
+
+template <typename ValueType>
+ValueType getColumnValue(const IVirtualTable::Row &row,
+                         const std::string &column_name,
+                         const ValueType &default_value) {
+
+  auto column_it = row.find(column_name);
+  if (column_it == row.end() || !column_it->second.has_value()) {
+    return default_value;
+  }
+
+  const auto &column_value = column_it->second.value();
+  if (!std::holds_alternative<ValueType>(column_value)) {
+    return default_value;
+  }
+
+  return std::get<ValueType>(column_value);
+}
+
+std::uint64_t mixHash(std::uint64_t value) {
+  value += 0x9e3779b97f4a7c15ULL;
+  value = (value ^ (value >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27U)) * 0x94d049bb133111ebULL;
+
+  return value ^ (value >> 31U);
+}
+} // namespace
+
+struct RateLimiter::PrivateData final {
+  IZeekConfiguration::EventRateLimit settings;
+  std::size_t max_key_count{0U};
+  RateLimiterKeyColumns key_columns;
+
+  mutable std::mutex mutex;
+
+  /// \brief Tracked keys, most recently used first
+  KeyStateList key_state_list;
+  KeyStateMap key_state_map;
+
+  KeyStats total_stats;
+};
+
+Status RateLimiter::create(Ref &obj,
+                           const IZeekConfiguration::EventRateLimit &settings,
+                           std::size_t max_key_count,
+                           const RateLimiterKeyColumns &key_columns) {
+  try {
+    obj.reset();
+
+    auto ptr = new RateLimiter(settings, max_key_count, key_columns);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+RateLimiter::~RateLimiter() {}
+
+bool RateLimiter::enabled() const {
+  return d->settings.events_per_second != 0U;
+}
+
+bool RateLimiter::accept(const IVirtualTable::Row &row,
+                         std::chrono::milliseconds current_time) {
+  if (!enabled()) {
+    return true;
+  }
+
+  const auto &key_columns = d->key_columns;
+
+  Key key{getColumnValue<std::string>(row, key_columns.exe, ""),
+          getColumnValue<std::int64_t>(row, key_columns.uid, -1)};
+
+  auto pid = getColumnValue<std::int64_t>(row, key_columns.pid, -1);
+
+  std::lock_guard<std::mutex> lock(d->mutex);
+
+  KeyState *key_state{nullptr};
+
+  auto key_state_map_it = d->key_state_map.find(key);
+  if (key_state_map_it != d->key_state_map.end()) {
+    auto key_state_it = key_state_map_it->second;
+
+    d->key_state_list.splice(d->key_state_list.begin(), d->key_state_list,
+                             key_state_it);
+
+    key_state = &(*key_state_it);
+
+  } else {
+    if (d->key_state_list.size() >= d->max_key_count) {
+      const auto &evicted_stats = d->key_state_list.back().stats;
+      d->key_state_map.erase({evicted_stats.exe, evicted_stats.uid});
+      d->key_state_list.pop_back();
+    }
+
+    KeyState new_key_state;
+    new_key_state.stats.exe = key.first;
+    new_key_state.stats.uid = key.second;
+    new_key_state.key_hash = KeyHash{}(key);
+    new_key_state.token_count = static_cast<double>(d->settings.burst_size);
+    new_key_state.last_refill_time = current_time;
+
+    d->key_state_list.push_front(std::move(new_key_state));
+    d->key_state_map.insert({std::move(key), d->key_state_list.begin()});
+
+    key_state = &d->key_state_list.front();
+  }
+
+  if (current_time > key_state->last_refill_time) {
+    auto elapsed_time = current_time - key_state->last_refill_time;
+
+    key_state->token_count +=
+        static_cast<double>(elapsed_time.count()) *
+        static_cast<double>(d->settings.events_per_second) / 1000.0;
+
+    key_state->token_count =
+        std::min(key_state->token_count,
+                 static_cast<double>(d->settings.burst_size));
+
+    key_state->last_refill_time = current_time;
+  }
+
+  if (key_state->token_count >= 1.0) {
+    key_state->token_count -= 1.0;
+
+    ++key_state->stats.accepted_count;
+    ++d->total_stats.accepted_count;
+
+    return true;
+  }
+
+  if (d->settings.sampling_ratio > 1U) {
+    auto sample_hash = mixHash(static_cast<std::uint64_t>(key_state->key_hash) ^
+                               static_cast<std::uint64_t>(pid));
+
+    if (sample_hash % d->settings.sampling_ratio == 0U) {
+      ++key_state->stats.sampled_count;
+      ++d->total_stats.sampled_count;
+
+      return true;
+    }
+  }
+
+  ++key_state->stats.suppressed_count;
+  ++d->total_stats.suppressed_count;
+
+  return false;
+}
+
+RateLimiter::KeyStatsList RateLimiter::keyStats() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+
+  KeyStatsList key_stats_list;
+  key_stats_list.reserve(d->key_state_list.size());
+
+  for (const auto &key_state : d->key_state_list) {
+    key_stats_list.push_back(key_state.stats);
+  }
+
+  return key_stats_list;
+}
+
+RateLimiter::KeyStats RateLimiter::totalStats() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->total_stats;
+}
+
+RateLimiter::RateLimiter(const IZeekConfiguration::EventRateLimit &settings,
+                         std::size_t max_key_count,
+                         const RateLimiterKeyColumns &key_columns)
+    : d(new PrivateData) {
+
+  if (settings.events_per_second != 0U && max_key_count == 0U) {
+    throw Status::failure("The maximum key count must be greater than zero");
+  }
+
+  d->settings = settings;
+  d->max_key_count = max_key_count;
+  d->key_columns = key_columns;
+
+  if (d->settings.burst_size == 0U) {
+    d->settings.burst_size = d->settings.events_per_second;
+  }
+}
+} // namespace zeek
@@ -0,0 +1,104 @@
+#include <zeek/ratelimitertableplugin.h>
+
+namespace zeek {
+namespace {
+IVirtualTable::Row generateRow(const std::string &table_name,
+                               const RateLimiter::KeyStats &key_stats) {
+  IVirtualTable::Row row = {};
+
+  row["table_name"] = table_name;
+  row["exe"] = key_stats.exe;
+  row["uid"] = key_stats.uid;
+  row["accepted_count"] = static_cast<std::int64_t>(key_stats.accepted_count);
+  row["sampled_count"] = static_cast<std::int64_t>(key_stats.sampled_count);
+  row["suppressed_count"] =
+      static_cast<std::int64_t>(key_stats.suppressed_count);
+
+  return row;
+}
+} // namespace
+
+struct RateLimiterTablePlugin::PrivateData final {
+  std::string table_name;
+  RateLimiterMap rate_limiter_map;
+};
+
+Status RateLimiterTablePlugin::create(Ref &obj, const std::string &table_name,
+                                      const RateLimiterMap &rate_limiter_map) {
+  obj.reset();
+
+  try {
+    auto ptr = new RateLimiterTablePlugin(table_name, rate_limiter_map);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+RateLimiterTablePlugin::~RateLimiterTablePlugin() {}
+
+const std::string &RateLimiterTablePlugin::name() const {
+  return d->table_name;
+}
+
+const RateLimiterTablePlugin::Schema &RateLimiterTablePlugin::schema() const {
+  // clang-format off
+  static const Schema kTableSchema = {
+    { "table_name", IVirtualTable::ColumnType::String },
+    { "exe", IVirtualTable::ColumnType::String },
+    { "uid", IVirtualTable::ColumnType::Integer },
+    { "accepted_count", IVirtualTable::ColumnType::Integer },
+    { "sampled_count", IVirtualTable::ColumnType::Integer },
+    { "suppressed_count", IVirtualTable::ColumnType::Integer }
+  };
+  // clang-format on
+
+  return kTableSchema;
+}
+
+Status RateLimiterTablePlugin::generateRowList(RowList &row_list) {
+  row_list = {};
+
+  for (const auto &p : d->rate_limiter_map) {
+    const auto &table_name = p.first;
+    const auto &rate_limiter = *p.second;
+
+    if (!rate_limiter.enabled()) {
+      continue;
+    }
+
+    auto row = generateRow(table_name, rate_limiter.totalStats());
+    row["exe"] = {};
+    row["uid"] = {};
+
+    row_list.push_back(std::move(row));
+
+    for (const auto &key_stats : rate_limiter.keyStats()) {
+      row_list.push_back(generateRow(table_name, key_stats));
+    }
+  }
+
+  return Status::success();
+}
+
+RateLimiterTablePlugin::RateLimiterTablePlugin(
+    const std::string &table_name, const RateLimiterMap &rate_limiter_map)
+    : d(new PrivateData) {
+
+  for (const auto &p : rate_limiter_map) {
+    if (p.second == nullptr) {
+      throw Status::failure("Invalid rate limiter specified for table " +
+                            p.first);
+    }
+  }
+
+  d->table_name = table_name;
+  d->rate_limiter_map = rate_limiter_map;
+}
+} // namespace zeek
@@ -0,0 +1,193 @@
+#include <catch2/catch.hpp>
+
+#include <zeek/ratelimiter.h>
+
+namespace zeek {
+namespace {
+IVirtualTable::Row generateTestRow(const std::string &exe, std::int64_t uid,
+                                   std::int64_t pid) {
+  IVirtualTable::Row row;
+  row["exe"] = exe;
+  row["uid"] = uid;
+  row["pid"] = pid;
+
+  return row;
+}
+
+RateLimiter::KeyStats getKeyStats(const RateLimiter &rate_limiter,
+                                  const std::string &exe, std::int64_t uid) {
+  for (const auto &key_stats : rate_limiter.keyStats()) {
+    if (key_stats.exe == exe && key_stats.uid == uid) {
+      return key_stats;
+    }
+  }
+
+  return {};
+}
+} // namespace
+
+SCENARIO("Rate limiting for event tables", "[RateLimiter]") {
+  const std::chrono::milliseconds kStartTime{1000};
+
+  GIVEN("a disabled rate limiter") {
+    RateLimiter::Ref rate_limiter;
+    auto status = RateLimiter::create(rate_limiter, {}, 16U);
+    REQUIRE(status.succeeded());
+
+    THEN("all rows are accepted") {
+      REQUIRE(!rate_limiter->enabled());
+
+      for (std::int64_t i = 0; i < 1000; ++i) {
+        REQUIRE(rate_limiter->accept(generateTestRow("/bin/sh", 0, i),
+                                     kStartTime));
+      }
+    }
+  }
+
+  GIVEN("a rate limiter allowing 10 events per second") {
+    IZeekConfiguration::EventRateLimit settings;
+    settings.events_per_second = 10U;
+    settings.burst_size = 10U;
+
+    RateLimiter::Ref rate_limiter;
+    auto status = RateLimiter::create(rate_limiter, settings, 16U);
+    REQUIRE(status.succeeded());
+
+    WHEN("a single process floods the table") {
+      std::size_t accepted_count{0U};
+      for (std::int64_t i = 0; i < 100; ++i) {
+        if (rate_limiter->accept(generateTestRow("/bin/sh", 0, 100),
+                                 kStartTime)) {
+          ++accepted_count;
+        }
+      }
+
+      THEN("only the burst is accepted") {
+        REQUIRE(accepted_count == 10U);
+
+        auto key_stats = getKeyStats(*rate_limiter.get(), "/bin/sh", 0);
+        REQUIRE(key_stats.accepted_count == 10U);
+        REQUIRE(key_stats.suppressed_count == 90U);
+      }
+
+      THEN("other (exe, uid) pairs are not affected") {
+        REQUIRE(rate_limiter->accept(generateTestRow("/bin/sh", 1000, 101),
+                                     kStartTime));
+
+        REQUIRE(rate_limiter->accept(generateTestRow("/usr/bin/ssh", 0, 102),
+                                     kStartTime));
+      }
+
+      THEN("the bucket is refilled over time") {
+        auto current_time = kStartTime + std::chrono::milliseconds(500);
+
+        accepted_count = 0U;
+        for (std::int64_t i = 0; i < 100; ++i) {
+          if (rate_limiter->accept(generateTestRow("/bin/sh", 0, 100),
+                                   current_time)) {
+            ++accepted_count;
+          }
+        }
+
+        REQUIRE(accepted_count == 5U);
+      }
+    }
+  }
+
+  GIVEN("a rate limiter with sampling enabled") {
+    IZeekConfiguration::EventRateLimit settings;
+    settings.events_per_second = 1U;
+    settings.sampling_ratio = 4U;
+
+    RateLimiter::Ref rate_limiter;
+    auto status = RateLimiter::create(rate_limiter, settings, 16U);
+    REQUIRE(status.succeeded());
+
+    REQUIRE(rate_limiter->accept(generateTestRow("/bin/sh", 0, 1), kStartTime));
+
+    WHEN("the bucket is empty") {
+      std::vector<bool> first_pass;
+      for (std::int64_t pid = 0; pid < 1000; ++pid) {
+        first_pass.push_back(rate_limiter->accept(
+            generateTestRow("/bin/sh", 0, pid), kStartTime));
+      }
+
+      THEN("the same processes are always selected") {
+        for (std::int64_t pid = 0; pid < 1000; ++pid) {
+          auto accepted = rate_limiter->accept(
+              generateTestRow("/bin/sh", 0, pid), kStartTime);
+
+          REQUIRE(accepted == first_pass.at(static_cast<std::size_t>(pid)));
+        }
+      }
+
+      THEN("roughly one in sampling_ratio processes is selected") {
+        auto key_stats = getKeyStats(*rate_limiter.get(), "/bin/sh", 0);
+
+        REQUIRE(key_stats.sampled_count > 150U);
+        REQUIRE(key_stats.sampled_count < 350U);
+        REQUIRE(key_stats.sampled_count + key_stats.suppressed_count == 1000U);
+      }
+    }
+  }
+
+  GIVEN("a rate limiter reading the keys from other columns") {
+    IZeekConfiguration::EventRateLimit settings;
+    settings.events_per_second = 1U;
+
+    RateLimiterKeyColumns key_columns;
+    key_columns.exe = "path";
+    key_columns.uid = "user_id";
+    key_columns.pid = "process_id";
+
+    RateLimiter::Ref rate_limiter;
+    auto status = RateLimiter::create(rate_limiter, settings, 16U, key_columns);
+    REQUIRE(status.succeeded());
+
+    WHEN("a single process floods the table") {
+      IVirtualTable::Row row;
+      row["path"] = "/bin/sh";
+      row["user_id"] = std::int64_t{501};
+      row["process_id"] = std::int64_t{100};
+
+      REQUIRE(rate_limiter->accept(row, kStartTime));
+      REQUIRE(!rate_limiter->accept(row, kStartTime));
+
+      THEN("the events are counted under the (path, user_id) pair") {
+        auto key_stats = getKeyStats(*rate_limiter.get(), "/bin/sh", 501);
+        REQUIRE(key_stats.accepted_count == 1U);
+        REQUIRE(key_stats.suppressed_count == 1U);
+      }
+    }
+  }
+
+  GIVEN("a rate limiter that can only track two keys") {
+    IZeekConfiguration::EventRateLimit settings;
+    settings.events_per_second = 1U;
+
+    RateLimiter::Ref rate_limiter;
+    auto status = RateLimiter::create(rate_limiter, settings, 2U);
+    REQUIRE(status.succeeded());
+
+    WHEN("a third key is added") {
+      rate_limiter->accept(generateTestRow("/bin/a", 0, 1), kStartTime);
+      rate_limiter->accept(generateTestRow("/bin/b", 0, 2), kStartTime);
+      rate_limiter->accept(generateTestRow("/bin/a", 0, 1), kStartTime);
+      rate_limiter->accept(generateTestRow("/bin/c", 0, 3), kStartTime);
+
+      THEN("the least recently used key is evicted") {
+        auto key_stats_list = rate_limiter->keyStats();
+        REQUIRE(key_stats_list.size() == 2U);
+        REQUIRE(getKeyStats(*rate_limiter.get(), "/bin/b", 0).exe.empty());
+        REQUIRE(getKeyStats(*rate_limiter.get(), "/bin/a", 0).exe == "/bin/a");
+      }
+
+      THEN("the total counters still include the evicted key") {
+        auto total_stats = rate_limiter->totalStats();
+        REQUIRE(total_stats.accepted_count == 3U);
+        REQUIRE(total_stats.suppressed_count == 1U);
+      }
+    }
+  }
+}
+} // namespace zeek
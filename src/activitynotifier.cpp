@@ -0,0 +1,230 @@
+#include "activitynotifier.h"
+
+#include <atomic>
+#include <string>
+
+#ifdef WIN32
+#include <ws2tcpip.h>
+
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace zeek {
+struct ActivityNotifier::PrivateData final {
+#ifdef WIN32
+  ~PrivateData() {
+    if (socket != INVALID_SOCKET) {
+      closesocket(socket);
+    }
+
+    if (winsock_initialized) {
+      WSACleanup();
+    }
+  }
+
+  bool winsock_initialized{false};
+  SOCKET socket{INVALID_SOCKET};
+
+#elif defined(__linux__)
+  ~PrivateData() {
+    if (event_fd != -1) {
+      close(event_fd);
+    }
+  }
+
+  int event_fd{-1};
+
+#else
+  ~PrivateData() {
+    if (read_fd != -1) {
+      close(read_fd);
+    }
+
+    if (write_fd != -1) {
+      close(write_fd);
+    }
+  }
+
+  int read_fd{-1};
+  int write_fd{-1};
+#endif
+
+  /// \brief Set when a notification has been sent but not yet consumed, so
+  ///        that repeated notifications do not fill the buffer
+  std::atomic_bool pending{false};
+};
+
+Status ActivityNotifier::create(Ref &obj) {
+  try {
+    obj.reset();
+
+    auto ptr = new ActivityNotifier();
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+ActivityNotifier::~ActivityNotifier() {}
+
+#ifdef WIN32
+ActivityNotifier::Descriptor ActivityNotifier::descriptor() const {
+  return d->socket;
+}
+
+void ActivityNotifier::notify() {
+  if (d->pending.exchange(true)) {
+    return;
+  }
+
+  const char buffer{0};
+  send(d->socket, &buffer, 1, 0);
+}
+
+void ActivityNotifier::reset() {
+  char buffer[64];
+  while (recv(d->socket, buffer, sizeof(buffer), 0) > 0) {
+  }
+
+  d->pending = false;
+}
+
+ActivityNotifier::ActivityNotifier() : d(new PrivateData) {
+  WSADATA wsa_data{};
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    throw Status::failure("Failed to initialize Winsock");
+  }
+
+  d->winsock_initialized = true;
+
+  d->socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (d->socket == INVALID_SOCKET) {
+    throw Status::failure("Failed to create the notification socket: " +
+                          std::to_string(WSAGetLastError()));
+  }
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  auto address_ptr = reinterpret_cast<sockaddr *>(&address);
+  int address_size = sizeof(address);
+
+  if (bind(d->socket, address_ptr, address_size) != 0 ||
+      getsockname(d->socket, address_ptr, &address_size) != 0 ||
+      connect(d->socket, address_ptr, address_size) != 0) {
+
+    throw Status::failure("Failed to initialize the notification socket: " +
+                          std::to_string(WSAGetLastError()));
+  }
+
+  u_long non_blocking{1};
+  if (ioctlsocket(d->socket, FIONBIO, &non_blocking) != 0) {
+    throw Status::failure("Failed to configure the notification socket: " +
+                          std::to_string(WSAGetLastError()));
+  }
+}
+
+#elif defined(__linux__)
+ActivityNotifier::Descriptor ActivityNotifier::descriptor() const {
+  return d->event_fd;
+}
+
+void ActivityNotifier::notify() {
+  if (d->pending.exchange(true)) {
+    return;
+  }
+
+  const std::uint64_t increment{1U};
+  while (write(d->event_fd, &increment, sizeof(increment)) == -1 &&
+         errno == EINTR) {
+  }
+}
+
+void ActivityNotifier::reset() {
+  // Reading the counter also resets it
+  std::uint64_t counter{0U};
+  while (read(d->event_fd, &counter, sizeof(counter)) == -1 &&
+         errno == EINTR) {
+  }
+
+  d->pending = false;
+}
+
+ActivityNotifier::ActivityNotifier() : d(new PrivateData) {
+  d->event_fd = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (d->event_fd == -1) {
+    throw Status::failure("Failed to create the notification eventfd: " +
+                          std::to_string(errno));
+  }
+}
+
+#else
+ActivityNotifier::Descriptor ActivityNotifier::descriptor() const {
+  return d->read_fd;
+}
+
+void ActivityNotifier::notify() {
+  if (d->pending.exchange(true)) {
+    return;
+  }
+
+  const char buffer{0};
+  while (write(d->write_fd, &buffer, 1) == -1 && errno == EINTR) {
+  }
+}
+
+void ActivityNotifier::reset() {
+  char buffer[64];
+
+  for (;;) {
+    auto bytes_read = read(d->read_fd, buffer, sizeof(buffer));
+    if (bytes_read > 0 || (bytes_read == -1 && errno == EINTR)) {
+      continue;
+    }
+
+    break;
+  }
+
+  d->pending = false;
+}
+
+ActivityNotifier::ActivityNotifier() : d(new PrivateData) {
+  int fd_list[2]{};
+  if (pipe(fd_list) != 0) {
+    throw Status::failure("Failed to create the notification pipe: " +
+                          std::to_string(errno));
+  }
+
+  d->read_fd = fd_list[0];
+  d->write_fd = fd_list[1];
+
+  for (auto fd : fd_list) {
+    auto flags = fcntl(fd, F_GETFL);
+
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+        fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+
+      throw Status::failure("Failed to configure the notification pipe: " +
+                            std::to_string(errno));
+    }
+  }
+}
+#endif
+} // namespace zeek
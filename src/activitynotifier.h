@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+
+#include <zeek/status.h>
+
+#ifdef WIN32
+#include <winsock2.h>
+#endif
+
+namespace zeek {
+/// \brief A wakeup signal that can be waited on together with the broker
+///        subscriber descriptors
+///
+/// This is implemented with an eventfd on Linux, with a non-blocking pipe on
+/// the other POSIX systems, and with a loopback UDP socket on Windows (where
+/// select() only accepts sockets)
+class ActivityNotifier final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to an activity notifier object
+  using Ref = std::unique_ptr<ActivityNotifier>;
+
+#ifdef WIN32
+  /// \brief The descriptor type accepted by select()
+  using Descriptor = SOCKET;
+#else
+  /// \brief The descriptor type accepted by select()
+  using Descriptor = int;
+#endif
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \return A Status object
+  static Status create(Ref &obj);
+
+  /// \brief Destructor
+  ~ActivityNotifier();
+
+  /// \return The descriptor that becomes readable after notify() is called
+  Descriptor descriptor() const;
+
+  /// \brief Wakes up the thread that is waiting on the descriptor. This
+  ///        method can be called from any thread
+  void notify();
+
+  /// \brief Consumes all the pending notifications
+  void reset();
+
+  ActivityNotifier(const ActivityNotifier &) = delete;
+  ActivityNotifier &operator=(const ActivityNotifier &) = delete;
+
+private:
+  /// \brief Constructor
+  ActivityNotifier();
+};
+} // namespace zeek
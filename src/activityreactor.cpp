@@ -0,0 +1,174 @@
+#include "activityreactor.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#elif !defined(WIN32)
+#include <cerrno>
+#include <sys/select.h>
+#endif
+
+namespace zeek {
+namespace {
+#if defined(__linux__)
+/// \brief How many ready descriptors are returned by a single epoll_wait
+const std::size_t kMaxEventCount{16U};
+#endif
+} // namespace
+
+struct ActivityReactor::PrivateData final {
+#if defined(__linux__)
+  ~PrivateData() {
+    if (epoll_fd != -1) {
+      close(epoll_fd);
+    }
+  }
+
+  int epoll_fd{-1};
+#else
+  DescriptorList descriptor_list;
+#endif
+};
+
+Status ActivityReactor::create(Ref &obj) {
+  try {
+    obj.reset();
+
+    auto ptr = new ActivityReactor();
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+ActivityReactor::~ActivityReactor() {}
+
+#if defined(__linux__)
+Status ActivityReactor::add(Descriptor descriptor) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = descriptor;
+
+  if (epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, descriptor, &event) != 0) {
+    return Status::failure("Failed to watch descriptor " +
+                           std::to_string(descriptor) + ": error " +
+                           std::to_string(errno));
+  }
+
+  return Status::success();
+}
+
+Status ActivityReactor::wait(DescriptorList &ready_list,
+                             std::chrono::milliseconds timeout) {
+  ready_list.clear();
+
+  std::array<epoll_event, kMaxEventCount> event_list{};
+
+  auto event_count =
+      epoll_wait(d->epoll_fd, event_list.data(),
+                 static_cast<int>(event_list.size()),
+                 static_cast<int>(std::max<std::chrono::milliseconds::rep>(
+                     timeout.count(), 0)));
+
+  if (event_count == -1) {
+    if (errno == EINTR) {
+      return Status::success();
+    }
+
+    return Status::failure("epoll_wait() has failed with error " +
+                           std::to_string(errno));
+  }
+
+  for (int i = 0; i < event_count; ++i) {
+    ready_list.push_back(event_list[static_cast<std::size_t>(i)].data.fd);
+  }
+
+  return Status::success();
+}
+
+ActivityReactor::ActivityReactor() : d(new PrivateData) {
+  d->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (d->epoll_fd == -1) {
+    throw Status::failure("Failed to create the epoll descriptor: " +
+                          std::to_string(errno));
+  }
+}
+
+#else
+Status ActivityReactor::add(Descriptor descriptor) {
+#ifndef WIN32
+  if (descriptor < 0 || descriptor >= FD_SETSIZE) {
+    return Status::failure("The following descriptor can not be watched: " +
+                           std::to_string(descriptor));
+  }
+#endif
+
+  d->descriptor_list.push_back(descriptor);
+  return Status::success();
+}
+
+Status ActivityReactor::wait(DescriptorList &ready_list,
+                             std::chrono::milliseconds timeout) {
+  ready_list.clear();
+
+  fd_set fd_list;
+  FD_ZERO(&fd_list);
+
+  Descriptor highest_descriptor{0};
+
+  for (auto descriptor : d->descriptor_list) {
+    FD_SET(descriptor, &fd_list);
+    highest_descriptor = std::max(highest_descriptor, descriptor);
+  }
+
+  auto timeout_count =
+      std::max<std::chrono::milliseconds::rep>(timeout.count(), 0);
+
+  struct timeval select_timeout {};
+  select_timeout.tv_sec = static_cast<long>(timeout_count / 1000);
+  select_timeout.tv_usec = static_cast<long>((timeout_count % 1000) * 1000);
+
+  auto select_err = select(static_cast<int>(highest_descriptor) + 1, &fd_list,
+                           nullptr, nullptr, &select_timeout);
+
+  if (select_err == -1) {
+#ifdef WIN32
+    auto error_code = WSAGetLastError();
+    auto eintr_value = WSAEINTR;
+#else
+    auto error_code = errno;
+    auto eintr_value = EINTR;
+#endif
+
+    if (error_code == eintr_value) {
+      return Status::success();
+    }
+
+    return Status::failure("select() has failed with error " +
+                           std::to_string(error_code));
+  }
+
+  for (auto descriptor : d->descriptor_list) {
+    if (FD_ISSET(descriptor, &fd_list)) {
+      ready_list.push_back(descriptor);
+    }
+  }
+
+  return Status::success();
+}
+
+ActivityReactor::ActivityReactor() : d(new PrivateData) {}
+#endif
+} // namespace zeek
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "activitynotifier.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief Waits for incoming data on a fixed set of descriptors
+///
+/// The descriptors are registered once, and every wait only returns the ones
+/// that are ready. This is implemented with epoll on Linux, so the cost of a
+/// wait does not depend on how many descriptors are watched and there is no
+/// FD_SETSIZE limit; the other platforms use select()
+///
+/// Both are level-triggered: a descriptor is reported again by every wait
+/// until its data has been consumed, so the callers must always drain the
+/// descriptors that are ready
+class ActivityReactor final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to an activity reactor object
+  using Ref = std::unique_ptr<ActivityReactor>;
+
+  /// \brief The descriptor type
+  using Descriptor = ActivityNotifier::Descriptor;
+
+  /// \brief A list of descriptors
+  using DescriptorList = std::vector<Descriptor>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \return A Status object
+  static Status create(Ref &obj);
+
+  /// \brief Destructor
+  ~ActivityReactor();
+
+  /// \brief Starts watching the given descriptor
+  /// \param descriptor A descriptor that becomes readable when there is
+  ///                   incoming data
+  /// \return A Status object
+  Status add(Descriptor descriptor);
+
+  /// \brief Waits until at least one of the descriptors is readable
+  /// \param ready_list Where the readable descriptors are stored; empty if
+  ///                   the timeout has expired or the wait was interrupted
+  /// \param timeout How long to wait at most
+  /// \return A Status object
+  Status wait(DescriptorList &ready_list, std::chrono::milliseconds timeout);
+
+  ActivityReactor(const ActivityReactor &) = delete;
+  ActivityReactor &operator=(const ActivityReactor &) = delete;
+
+private:
+  /// \brief Constructor
+  ActivityReactor();
+};
+} // namespace zeek
@@ -0,0 +1,55 @@
+#include "endpointselector.h"
+
+#include <algorithm>
+
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
+namespace zeek {
+EndpointSelector::EndpointSelector(Policy policy_, std::size_t endpoint_count)
+    : policy(policy_),
+      connected_list(std::max<std::size_t>(endpoint_count, 1U), false) {}
+
+void EndpointSelector::setConnected(std::size_t endpoint_index,
+                                    bool connected) {
+  connected_list.at(endpoint_index) = connected;
+}
+
+bool EndpointSelector::isConnected(std::size_t endpoint_index) const {
+  return connected_list.at(endpoint_index);
+}
+
+bool EndpointSelector::anyConnected() const {
+  return std::find(connected_list.begin(), connected_list.end(), true) !=
+         connected_list.end();
+}
+
+std::size_t EndpointSelector::select(const std::string &query_id,
+                                     const std::string &response_topic) const {
+  auto endpoint_count = connected_list.size();
+
+  // The hash is stable across restarts and platforms, so that all the
+  // agents send the same query or topic to the same endpoint
+  std::size_t preferred_index{0U};
+
+  if (policy == Policy::ShardByQuery) {
+    preferred_index = static_cast<std::size_t>(
+        XXH3_64bits(query_id.data(), query_id.size()) % endpoint_count);
+
+  } else if (policy == Policy::ShardByTopic) {
+    preferred_index = static_cast<std::size_t>(
+        XXH3_64bits(response_topic.data(), response_topic.size()) %
+        endpoint_count);
+  }
+
+  for (std::size_t i = 0U; i < endpoint_count; ++i) {
+    auto endpoint_index = (preferred_index + i) % endpoint_count;
+
+    if (connected_list[endpoint_index]) {
+      return endpoint_index;
+    }
+  }
+
+  return preferred_index;
+}
+} // namespace zeek
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <zeek/izeekconfiguration.h>
+
+namespace zeek {
+/// \brief Assigns the query output to one of the Zeek server endpoints,
+///        according to the configured policy
+///
+/// Each output has a preferred endpoint: the first one for the failover
+/// policy, or the one picked by hashing the query ID or the response topic
+/// when sharding. If the preferred endpoint is not connected, the next
+/// connected one (in list order, wrapping around) is used instead. When no
+/// endpoint is connected, the preferred one is returned, so that the output
+/// waits in its queue
+class EndpointSelector final {
+public:
+  /// \brief The endpoint policy
+  using Policy = IZeekConfiguration::ServerEndpoints::Policy;
+
+  /// \brief Constructor
+  /// \param policy How the output is distributed across the endpoints
+  /// \param endpoint_count How many endpoints there are
+  EndpointSelector(Policy policy, std::size_t endpoint_count);
+
+  /// \brief Updates the connection state of an endpoint
+  /// \param endpoint_index The endpoint index
+  /// \param connected True if the endpoint is connected
+  void setConnected(std::size_t endpoint_index, bool connected);
+
+  /// \param endpoint_index The endpoint index
+  /// \return True if the given endpoint is connected
+  bool isConnected(std::size_t endpoint_index) const;
+
+  /// \return True if at least one endpoint is connected
+  bool anyConnected() const;
+
+  /// \brief Selects the endpoint for the given output
+  /// \param query_id The ID of the query, as returned by
+  ///                 ZeekConnection::computeQueryID
+  /// \param response_topic The response topic of the query
+  /// \return The endpoint index
+  std::size_t select(const std::string &query_id,
+                     const std::string &response_topic) const;
+
+private:
+  /// \brief How the output is distributed across the endpoints
+  Policy policy{Policy::Failover};
+
+  /// \brief The connection state of each endpoint
+  std::vector<bool> connected_list;
+};
+} // namespace zeek
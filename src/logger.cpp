@@ -9,6 +9,16 @@ IZeekLogger::Ref zeek_logger;
 Status initializeLogger(IVirtualDatabase &virtual_database) {
   IZeekLogger::Configuration logger_config;
   logger_config.log_folder = zeek::getConfig().getLogFolder();
+  logger_config.max_table_row_count = zeek::getConfig().maxQueuedRowCount();
+
+  const auto &log_rotation = zeek::getConfig().logRotation();
+
+  logger_config.max_log_file_byte_count = log_rotation.max_log_file_byte_count;
+
+  logger_config.max_log_file_age =
+      std::chrono::seconds(log_rotation.max_log_file_age);
+
+  logger_config.max_log_file_count = log_rotation.max_log_file_count;
 
   auto status =
       IZeekLogger::create(zeek_logger, logger_config, virtual_database);
@@ -0,0 +1,594 @@
+#include "outputpublisher.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace zeek {
+namespace {
+/// \brief How often the idle queries are forgotten
+const std::chrono::seconds kIdleQueryCleanupInterval{1};
+
+/// \brief A rate limit, in rows per second. Bursts of up to one second
+///        worth of rows are allowed; an output that is larger than the
+///        tokens left puts the bucket into debt
+struct TokenBucket final {
+  double token_count{0.0};
+  std::chrono::steady_clock::time_point last_refill_time;
+};
+
+/// \brief Creates a full token bucket
+TokenBucket createTokenBucket(std::size_t rows_per_second,
+                              std::chrono::steady_clock::time_point now) {
+  TokenBucket token_bucket;
+  token_bucket.token_count = static_cast<double>(rows_per_second);
+  token_bucket.last_refill_time = now;
+
+  return token_bucket;
+}
+
+/// \brief Adds the tokens earned since the last refill
+/// \return When the bucket allows publishing again
+std::chrono::steady_clock::time_point
+refillTokenBucket(TokenBucket &token_bucket, std::size_t rows_per_second,
+                  std::chrono::steady_clock::time_point now) {
+  if (rows_per_second == 0U) {
+    return now;
+  }
+
+  auto max_token_count = static_cast<double>(rows_per_second);
+
+  auto elapsed_time =
+      std::chrono::duration<double>(now - token_bucket.last_refill_time);
+
+  token_bucket.token_count =
+      std::min(token_bucket.token_count +
+                   elapsed_time.count() * max_token_count,
+               max_token_count);
+
+  token_bucket.last_refill_time = now;
+
+  if (token_bucket.token_count > 0.0) {
+    return now;
+  }
+
+  auto wait_time = std::chrono::duration<double>(-token_bucket.token_count /
+                                                 max_token_count);
+
+  return now + std::chrono::ceil<std::chrono::milliseconds>(wait_time) +
+         std::chrono::milliseconds(1);
+}
+
+/// \brief Takes the given amount of rows from the bucket
+void consumeTokens(TokenBucket &token_bucket, std::size_t rows_per_second,
+                   std::size_t row_count) {
+  if (rows_per_second != 0U) {
+    token_bucket.token_count -= static_cast<double>(row_count);
+  }
+}
+
+/// \return True if the bucket is full, or if there is no rate limit
+bool isTokenBucketFull(TokenBucket &token_bucket, std::size_t rows_per_second,
+                       std::chrono::steady_clock::time_point now) {
+  refillTokenBucket(token_bucket, rows_per_second, now);
+  return token_bucket.token_count >= static_cast<double>(rows_per_second);
+}
+
+/// \return The key that identifies the query that generated the output
+std::string queryKey(const OutputPublisher::Output &output) {
+  return output.response_topic + "\n" + output.response_event + "\n" +
+         output.cookie;
+}
+} // namespace
+
+struct OutputPublisher::QueuedOutput final {
+  Output output;
+  std::size_t byte_count{0U};
+
+  /// \brief The arrival order, across all the queries
+  std::uint64_t sequence_number{0U};
+
+  bool deferred{false};
+  bool dropped{false};
+};
+
+struct OutputPublisher::QueryQueue final {
+  std::deque<QueuedOutput> output_queue;
+  TokenBucket token_bucket;
+
+  /// \brief How many rows the query can still publish in its turn
+  std::size_t deficit{0U};
+
+  bool turn_started{false};
+  bool active{false};
+};
+
+struct OutputPublisher::PrivateData final {
+  PrivateData(const Configuration &configuration_)
+      : configuration(configuration_) {}
+
+  Configuration configuration;
+  std::thread thread;
+
+  mutable std::mutex queue_mutex;
+  std::condition_variable queue_cv;
+  std::condition_variable idle_cv;
+
+  std::unordered_map<std::string, QueryQueue> query_queue_map;
+  std::deque<QueryQueue *> active_query_list;
+  std::unordered_map<std::string, TokenBucket> topic_bucket_map;
+
+  std::uint64_t next_sequence_number{0U};
+  std::chrono::steady_clock::time_point last_cleanup_time;
+  Stats stats;
+
+  PublishCallback publish_callback;
+  CapacityCallback capacity_callback;
+
+  bool publishing{false};
+  bool full{false};
+  bool terminate{false};
+};
+
+Status OutputPublisher::create(Ref &obj, const Configuration &configuration) {
+  try {
+    obj.reset();
+
+    auto ptr = new OutputPublisher(configuration);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+OutputPublisher::~OutputPublisher() {
+  {
+    std::lock_guard<std::mutex> lock(d->queue_mutex);
+    d->terminate = true;
+  }
+
+  d->queue_cv.notify_all();
+  d->thread.join();
+}
+
+void OutputPublisher::setPublishCallback(PublishCallback callback) {
+  {
+    std::unique_lock<std::mutex> lock(d->queue_mutex);
+    d->idle_cv.wait(lock, [this]() { return !d->publishing; });
+
+    d->publish_callback = std::move(callback);
+  }
+
+  d->queue_cv.notify_all();
+}
+
+void OutputPublisher::setCapacityCallback(CapacityCallback callback) {
+  std::lock_guard<std::mutex> lock(d->queue_mutex);
+  d->capacity_callback = std::move(callback);
+}
+
+bool OutputPublisher::hasCapacity() const {
+  std::lock_guard<std::mutex> lock(d->queue_mutex);
+  return d->stats.queued_byte_count < d->configuration.max_queued_byte_count;
+}
+
+void OutputPublisher::push(Output output) {
+  auto byte_count = estimateByteCount(output);
+  auto query_key = queryKey(output);
+
+  {
+    std::lock_guard<std::mutex> lock(d->queue_mutex);
+
+    auto query_queue_it = d->query_queue_map.find(query_key);
+    if (query_queue_it == d->query_queue_map.end()) {
+      QueryQueue query_queue;
+      query_queue.token_bucket =
+          createTokenBucket(d->configuration.max_query_rows_per_second,
+                            std::chrono::steady_clock::now());
+
+      query_queue_it =
+          d->query_queue_map
+              .insert({std::move(query_key), std::move(query_queue)})
+              .first;
+    }
+
+    auto &query_queue = query_queue_it->second;
+
+    QueuedOutput queued_output;
+    queued_output.output = std::move(output);
+    queued_output.byte_count = byte_count;
+    queued_output.sequence_number = d->next_sequence_number++;
+
+    query_queue.output_queue.push_back(std::move(queued_output));
+
+    if (!query_queue.active) {
+      query_queue.active = true;
+      d->active_query_list.push_back(&query_queue);
+    }
+
+    auto &stats = d->stats;
+    ++stats.queued_output_count;
+    stats.queued_byte_count += byte_count;
+
+    stats.peak_queued_byte_count =
+        std::max(stats.peak_queued_byte_count, stats.queued_byte_count);
+
+    if (d->configuration.overflow_policy == OverflowPolicy::DropSnapshots) {
+      dropSnapshots();
+    }
+
+    auto full =
+        stats.queued_byte_count >= d->configuration.max_queued_byte_count;
+
+    if (full && !d->full) {
+      ++stats.overflow_count;
+    }
+
+    d->full = full;
+  }
+
+  d->queue_cv.notify_all();
+}
+
+OutputPublisher::OutputList OutputPublisher::takeQueuedOutput() {
+  OutputList output_list;
+  CapacityCallback capacity_callback;
+
+  {
+    std::lock_guard<std::mutex> lock(d->queue_mutex);
+
+    std::vector<QueuedOutput> queued_output_list;
+
+    for (auto query_queue : d->active_query_list) {
+      for (auto &queued_output : query_queue->output_queue) {
+        queued_output_list.push_back(std::move(queued_output));
+      }
+
+      query_queue->output_queue.clear();
+      query_queue->deficit = 0U;
+      query_queue->turn_started = false;
+      query_queue->active = false;
+    }
+
+    d->active_query_list.clear();
+
+    std::sort(queued_output_list.begin(), queued_output_list.end(),
+              [](const QueuedOutput &left, const QueuedOutput &right) {
+                return left.sequence_number < right.sequence_number;
+              });
+
+    auto &stats = d->stats;
+
+    for (auto &queued_output : queued_output_list) {
+      --stats.queued_output_count;
+      stats.queued_byte_count -= queued_output.byte_count;
+
+      output_list.push_back(std::move(queued_output.output));
+    }
+
+    if (d->full &&
+        stats.queued_byte_count < d->configuration.max_queued_byte_count) {
+      d->full = false;
+      capacity_callback = d->capacity_callback;
+    }
+  }
+
+  if (capacity_callback) {
+    capacity_callback();
+  }
+
+  return output_list;
+}
+
+OutputPublisher::Stats OutputPublisher::stats() const {
+  std::lock_guard<std::mutex> lock(d->queue_mutex);
+  return d->stats;
+}
+
+std::size_t OutputPublisher::estimateByteCount(const Output &output) {
+  auto byte_count = sizeof(Output) + output.trigger.size() +
+                    output.response_topic.size() +
+                    output.response_event.size() + output.cookie.size();
+
+  for (const auto &row : output.query_output) {
+    byte_count += sizeof(IVirtualDatabase::OutputRow) +
+                  row.size() * sizeof(IVirtualDatabase::ColumnValue);
+
+    for (const auto &column : row) {
+      byte_count += column.name.size();
+
+      if (!column.data.has_value()) {
+        continue;
+      }
+
+      if (auto string_value = std::get_if<std::string>(&column.data.value())) {
+        byte_count += string_value->size();
+      }
+    }
+  }
+
+  return byte_count;
+}
+
+OutputPublisher::OutputPublisher(const Configuration &configuration)
+    : d(new PrivateData(configuration)) {
+
+  d->thread = std::thread(&OutputPublisher::publisherThread, this);
+}
+
+void OutputPublisher::dropSnapshots() {
+  auto &stats = d->stats;
+  if (stats.queued_byte_count <= d->configuration.max_queued_byte_count) {
+    return;
+  }
+
+  // Each query has its own queue, so sort the snapshots by arrival order
+  // to drop the oldest ones first
+  std::vector<QueuedOutput *> snapshot_list;
+
+  for (auto query_queue : d->active_query_list) {
+    for (auto &queued_output : query_queue->output_queue) {
+      if (queued_output.output.snapshot) {
+        snapshot_list.push_back(&queued_output);
+      }
+    }
+  }
+
+  std::sort(snapshot_list.begin(), snapshot_list.end(),
+            [](const QueuedOutput *left, const QueuedOutput *right) {
+              return left->sequence_number < right->sequence_number;
+            });
+
+  for (auto queued_output : snapshot_list) {
+    if (stats.queued_byte_count <= d->configuration.max_queued_byte_count) {
+      break;
+    }
+
+    --stats.queued_output_count;
+    stats.queued_byte_count -= queued_output->byte_count;
+
+    ++stats.dropped_output_count;
+    stats.dropped_row_count += queued_output->output.query_output.size();
+
+    queued_output->dropped = true;
+  }
+
+  std::deque<QueryQueue *> active_query_list;
+
+  for (auto query_queue : d->active_query_list) {
+    auto &output_queue = query_queue->output_queue;
+
+    output_queue.erase(std::remove_if(output_queue.begin(), output_queue.end(),
+                                      [](const QueuedOutput &queued_output) {
+                                        return queued_output.dropped;
+                                      }),
+                       output_queue.end());
+
+    if (!output_queue.empty()) {
+      active_query_list.push_back(query_queue);
+      continue;
+    }
+
+    query_queue->deficit = 0U;
+    query_queue->turn_started = false;
+    query_queue->active = false;
+  }
+
+  d->active_query_list = std::move(active_query_list);
+}
+
+bool OutputPublisher::takeNextOutput(
+    QueuedOutput &queued_output,
+    std::chrono::steady_clock::time_point &wake_up_time) {
+
+  const auto &configuration = d->configuration;
+  auto &active_query_list = d->active_query_list;
+
+  auto now = std::chrono::steady_clock::now();
+  wake_up_time = std::chrono::steady_clock::time_point::max();
+
+  // Stop once every query has been found over its rate limit in a row
+  std::size_t deferred_query_count{0U};
+
+  while (deferred_query_count < active_query_list.size()) {
+    auto query_queue = active_query_list.front();
+    auto &next_output = query_queue->output_queue.front();
+
+    TokenBucket *topic_bucket{nullptr};
+    auto ready_time = refillTokenBucket(
+        query_queue->token_bucket, configuration.max_query_rows_per_second,
+        now);
+
+    if (configuration.max_topic_rows_per_second != 0U) {
+      const auto &response_topic = next_output.output.response_topic;
+
+      auto topic_bucket_it = d->topic_bucket_map.find(response_topic);
+      if (topic_bucket_it == d->topic_bucket_map.end()) {
+        topic_bucket_it =
+            d->topic_bucket_map
+                .insert({response_topic,
+                         createTokenBucket(
+                             configuration.max_topic_rows_per_second, now)})
+                .first;
+      }
+
+      topic_bucket = &topic_bucket_it->second;
+      ready_time = std::max(
+          ready_time,
+          refillTokenBucket(*topic_bucket,
+                            configuration.max_topic_rows_per_second, now));
+    }
+
+    active_query_list.pop_front();
+
+    if (ready_time > now) {
+      if (!next_output.deferred) {
+        next_output.deferred = true;
+        ++d->stats.deferred_output_count;
+      }
+
+      wake_up_time = std::min(wake_up_time, ready_time);
+      ++deferred_query_count;
+
+      query_queue->turn_started = false;
+      active_query_list.push_back(query_queue);
+
+      continue;
+    }
+
+    if (!query_queue->turn_started) {
+      query_queue->deficit += configuration.fair_queuing_quantum;
+      query_queue->turn_started = true;
+    }
+
+    auto row_count = next_output.output.query_output.size();
+    if (row_count > query_queue->deficit) {
+      deferred_query_count = 0U;
+
+      query_queue->turn_started = false;
+      active_query_list.push_back(query_queue);
+
+      continue;
+    }
+
+    query_queue->deficit -= row_count;
+
+    consumeTokens(query_queue->token_bucket,
+                  configuration.max_query_rows_per_second, row_count);
+
+    if (topic_bucket != nullptr) {
+      consumeTokens(*topic_bucket, configuration.max_topic_rows_per_second,
+                    row_count);
+    }
+
+    queued_output = std::move(next_output);
+    query_queue->output_queue.pop_front();
+
+    if (query_queue->output_queue.empty()) {
+      query_queue->deficit = 0U;
+      query_queue->turn_started = false;
+      query_queue->active = false;
+
+    } else if (query_queue->output_queue.front().output.query_output.size() >
+               query_queue->deficit) {
+      // The turn is over
+      query_queue->turn_started = false;
+      active_query_list.push_back(query_queue);
+
+    } else {
+      active_query_list.push_front(query_queue);
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+void OutputPublisher::removeIdleQueries() {
+  const auto &configuration = d->configuration;
+  auto now = std::chrono::steady_clock::now();
+
+  for (auto query_queue_it = d->query_queue_map.begin();
+       query_queue_it != d->query_queue_map.end();) {
+
+    auto &query_queue = query_queue_it->second;
+
+    if (query_queue.active ||
+        !isTokenBucketFull(query_queue.token_bucket,
+                           configuration.max_query_rows_per_second, now)) {
+      ++query_queue_it;
+      continue;
+    }
+
+    query_queue_it = d->query_queue_map.erase(query_queue_it);
+  }
+
+  for (auto topic_bucket_it = d->topic_bucket_map.begin();
+       topic_bucket_it != d->topic_bucket_map.end();) {
+
+    if (!isTokenBucketFull(topic_bucket_it->second,
+                           configuration.max_topic_rows_per_second, now)) {
+      ++topic_bucket_it;
+      continue;
+    }
+
+    topic_bucket_it = d->topic_bucket_map.erase(topic_bucket_it);
+  }
+}
+
+void OutputPublisher::publisherThread() {
+  std::unique_lock<std::mutex> lock(d->queue_mutex);
+
+  for (;;) {
+    d->queue_cv.wait(lock, [this]() {
+      return d->terminate ||
+             (d->publish_callback && !d->active_query_list.empty());
+    });
+
+    if (d->terminate) {
+      break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - d->last_cleanup_time >= kIdleQueryCleanupInterval) {
+      removeIdleQueries();
+      d->last_cleanup_time = now;
+    }
+
+    QueuedOutput queued_output;
+    std::chrono::steady_clock::time_point wake_up_time;
+
+    if (!takeNextOutput(queued_output, wake_up_time)) {
+      // Every query with queued output is over its rate limit; new output
+      // may still wake up the thread earlier
+      d->queue_cv.wait_until(lock, wake_up_time);
+      continue;
+    }
+
+    auto &stats = d->stats;
+    --stats.queued_output_count;
+
+    auto row_count = queued_output.output.query_output.size();
+
+    // The callback can not be replaced while it is running, so it can be
+    // invoked without holding the lock
+    d->publishing = true;
+    lock.unlock();
+
+    d->publish_callback(std::move(queued_output.output));
+
+    lock.lock();
+    d->publishing = false;
+
+    stats.queued_byte_count -= queued_output.byte_count;
+    ++stats.published_output_count;
+    stats.published_row_count += row_count;
+
+    d->idle_cv.notify_all();
+
+    if (!d->full ||
+        stats.queued_byte_count >= d->configuration.max_queued_byte_count) {
+      continue;
+    }
+
+    d->full = false;
+
+    auto capacity_callback = d->capacity_callback;
+    if (capacity_callback) {
+      lock.unlock();
+      capacity_callback();
+      lock.lock();
+    }
+  }
+}
+} // namespace zeek
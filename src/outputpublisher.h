@@ -0,0 +1,207 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zeek/ivirtualdatabase.h>
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief A dedicated thread that publishes the query outputs, fed by a
+///        bounded queue
+///
+/// The queue size is measured in (estimated) bytes. Once the limit has been
+/// reached, the caller is expected to stop feeding new outputs until the
+/// capacity callback is invoked, which in turn blocks the query scheduler
+/// once its own output list is full. Depending on the overflow policy, the
+/// queued snapshots can be dropped first to make room
+///
+/// Each query (response topic, event and cookie) has its own queue, so that
+/// a chatty query can not starve the others: the queries take turns using
+/// deficit round robin, measured in rows. The outputs of a single query are
+/// always published in order. Token buckets can also limit how many rows
+/// are published each second, for each response topic and for each query;
+/// the outputs that exceed them are deferred, not dropped
+class OutputPublisher final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to an output publisher object
+  using Ref = std::unique_ptr<OutputPublisher>;
+
+  /// \brief What happens when the queue is full
+  enum class OverflowPolicy {
+    /// \brief Nothing is dropped; the caller has to wait
+    Block,
+
+    /// \brief The oldest snapshot outputs are dropped until the queue is
+    ///        below the limit, then the caller has to wait
+    DropSnapshots
+  };
+
+  /// \brief Output publisher settings
+  struct Configuration final {
+    /// \brief The maximum (estimated) size of the queued outputs
+    std::size_t max_queued_byte_count{64U * 1024U * 1024U};
+
+    /// \brief What happens when the queue is full
+    OverflowPolicy overflow_policy{OverflowPolicy::Block};
+
+    /// \brief How many rows can be published each second on a single
+    ///        response topic; 0 means unlimited. Bursts of up to one
+    ///        second worth of rows are allowed
+    std::size_t max_topic_rows_per_second{0U};
+
+    /// \brief How many rows can be published each second for a single
+    ///        query; 0 means unlimited
+    std::size_t max_query_rows_per_second{0U};
+
+    /// \brief How many rows each query can publish in its turn
+    std::size_t fair_queuing_quantum{1000U};
+  };
+
+  /// \brief A query output waiting to be published
+  struct Output final {
+    /// \brief The reason the query was run (differential change or
+    ///        snapshot)
+    std::string trigger;
+
+    /// \brief The output topic
+    std::string response_topic;
+
+    /// \brief The event name
+    std::string response_event;
+
+    /// \brief The id that identifies the task
+    std::string cookie;
+
+    /// \brief The rows to publish
+    IVirtualDatabase::QueryOutput query_output;
+
+    /// \brief True if this is a full snapshot rather than a differential
+    ///        update. Only snapshots can be dropped
+    bool snapshot{false};
+  };
+
+  /// \brief Queue metrics
+  struct Stats final {
+    /// \brief How many outputs are waiting to be published
+    std::size_t queued_output_count{0U};
+
+    /// \brief The estimated size of the outputs waiting to be published,
+    ///        including the one being published
+    std::size_t queued_byte_count{0U};
+
+    /// \brief The highest value queued_byte_count has ever reached
+    std::size_t peak_queued_byte_count{0U};
+
+    /// \brief How many outputs have been published
+    std::uint64_t published_output_count{0U};
+
+    /// \brief How many rows have been published
+    std::uint64_t published_row_count{0U};
+
+    /// \brief How many outputs have been dropped because the queue was full
+    std::uint64_t dropped_output_count{0U};
+
+    /// \brief How many rows have been dropped because the queue was full
+    std::uint64_t dropped_row_count{0U};
+
+    /// \brief How many times the queue has become full
+    std::uint64_t overflow_count{0U};
+
+    /// \brief How many outputs have been held back by the rate limits
+    std::uint64_t deferred_output_count{0U};
+  };
+
+  /// \brief A list of outputs
+  using OutputList = std::vector<Output>;
+
+  /// \brief Publishes a single output. Invoked from the publisher thread
+  using PublishCallback = std::function<void(Output)>;
+
+  /// \brief Invoked (from the publisher thread) when a full queue has room
+  ///        again
+  using CapacityCallback = std::function<void()>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param configuration The output publisher settings
+  /// \return A Status object
+  static Status create(Ref &obj, const Configuration &configuration);
+
+  /// \brief Destructor; the outputs that are still queued are discarded
+  ~OutputPublisher();
+
+  /// \brief Sets the callback that publishes the outputs. The queue is
+  ///        paused while it is not set
+  /// \param callback The new callback; may be empty. When this method
+  ///                 returns, the previous callback is no longer running
+  void setPublishCallback(PublishCallback callback);
+
+  /// \brief Sets the callback invoked when a full queue has room again
+  /// \param callback The new callback
+  void setCapacityCallback(CapacityCallback callback);
+
+  /// \return True if the queue is below its limit
+  bool hasCapacity() const;
+
+  /// \brief Queues a new output. The output is always accepted, even if
+  ///        the queue is full
+  /// \param output The output to publish
+  void push(Output output);
+
+  /// \brief Removes all the queued outputs, so that they can be published
+  ///        somewhere else. The output that is being published is not
+  ///        included
+  /// \return The queued outputs, oldest first
+  OutputList takeQueuedOutput();
+
+  /// \return The queue metrics
+  Stats stats() const;
+
+  /// \param output An output
+  /// \return The estimated memory used by the given output
+  static std::size_t estimateByteCount(const Output &output);
+
+  OutputPublisher(const OutputPublisher &) = delete;
+  OutputPublisher &operator=(const OutputPublisher &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param configuration The output publisher settings
+  OutputPublisher(const Configuration &configuration);
+
+  /// \brief An output waiting in the queue
+  struct QueuedOutput;
+
+  /// \brief The queued outputs of a single query
+  struct QueryQueue;
+
+  /// \brief Drops the oldest snapshots until the queue is below its limit.
+  ///        The queue mutex must be held
+  void dropSnapshots();
+
+  /// \brief Picks the next output to publish, taking turns across the
+  ///        queries and honoring the rate limits. The queue mutex must be
+  ///        held
+  /// \param queued_output Where the output is stored
+  /// \param wake_up_time When the rate limits allow publishing again, if
+  ///                     no output could be taken
+  /// \return True if an output has been taken
+  bool takeNextOutput(QueuedOutput &queued_output,
+                      std::chrono::steady_clock::time_point &wake_up_time);
+
+  /// \brief Forgets the queries that have nothing queued and whose token
+  ///        bucket is full again. The queue mutex must be held
+  void removeIdleQueries();
+
+  /// \brief Publishes the queued outputs until the object is destroyed
+  void publisherThread();
+};
+} // namespace zeek
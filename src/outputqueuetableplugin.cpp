@@ -0,0 +1,102 @@
+#include "outputqueuetableplugin.h"
+#include "outputpublisher.h"
+
+namespace zeek {
+struct OutputQueueTablePlugin::PrivateData final {
+  PrivateData(const OutputQueueList &output_queue_list_)
+      : output_queue_list(output_queue_list_) {}
+
+  OutputQueueList output_queue_list;
+};
+
+Status
+OutputQueueTablePlugin::create(Ref &obj,
+                               const OutputQueueList &output_queue_list) {
+  obj.reset();
+
+  try {
+    auto ptr = new OutputQueueTablePlugin(output_queue_list);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+OutputQueueTablePlugin::~OutputQueueTablePlugin() {}
+
+const std::string &OutputQueueTablePlugin::name() const {
+  static const std::string kTableName{"output_queue_metrics"};
+
+  return kTableName;
+}
+
+const OutputQueueTablePlugin::Schema &OutputQueueTablePlugin::schema() const {
+  // clang-format off
+  static const Schema kTableSchema = {
+    { "endpoint", IVirtualTable::ColumnType::String },
+    { "queued_output_count", IVirtualTable::ColumnType::Integer },
+    { "queued_byte_count", IVirtualTable::ColumnType::Integer },
+    { "peak_queued_byte_count", IVirtualTable::ColumnType::Integer },
+    { "published_output_count", IVirtualTable::ColumnType::Integer },
+    { "published_row_count", IVirtualTable::ColumnType::Integer },
+    { "dropped_output_count", IVirtualTable::ColumnType::Integer },
+    { "dropped_row_count", IVirtualTable::ColumnType::Integer },
+    { "overflow_count", IVirtualTable::ColumnType::Integer },
+    { "deferred_output_count", IVirtualTable::ColumnType::Integer }
+  };
+  // clang-format on
+
+  return kTableSchema;
+}
+
+Status OutputQueueTablePlugin::generateRowList(RowList &row_list) {
+  row_list = {};
+
+  for (const auto &output_queue : d->output_queue_list) {
+    auto stats = output_queue.output_publisher->stats();
+
+    Row row;
+    row["endpoint"] = output_queue.endpoint;
+
+    row["queued_output_count"] =
+        static_cast<std::int64_t>(stats.queued_output_count);
+
+    row["queued_byte_count"] =
+        static_cast<std::int64_t>(stats.queued_byte_count);
+
+    row["peak_queued_byte_count"] =
+        static_cast<std::int64_t>(stats.peak_queued_byte_count);
+
+    row["published_output_count"] =
+        static_cast<std::int64_t>(stats.published_output_count);
+
+    row["published_row_count"] =
+        static_cast<std::int64_t>(stats.published_row_count);
+
+    row["dropped_output_count"] =
+        static_cast<std::int64_t>(stats.dropped_output_count);
+
+    row["dropped_row_count"] =
+        static_cast<std::int64_t>(stats.dropped_row_count);
+
+    row["overflow_count"] = static_cast<std::int64_t>(stats.overflow_count);
+
+    row["deferred_output_count"] =
+        static_cast<std::int64_t>(stats.deferred_output_count);
+
+    row_list.push_back(std::move(row));
+  }
+
+  return Status::success();
+}
+
+OutputQueueTablePlugin::OutputQueueTablePlugin(
+    const OutputQueueList &output_queue_list)
+    : d(new PrivateData(output_queue_list)) {}
+} // namespace zeek
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zeek/ivirtualtable.h>
+
+namespace zeek {
+class OutputPublisher;
+
+/// \brief A virtual table plugin that exposes the metrics of the output
+///        publisher queues, with one row for each Zeek server endpoint
+class OutputQueueTablePlugin final : public IVirtualTable {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief The output queue of a single Zeek server endpoint
+  struct OutputQueue final {
+    /// \brief The endpoint, as address:port
+    std::string endpoint;
+
+    /// \brief The output publisher to inspect
+    const OutputPublisher *output_publisher{nullptr};
+  };
+
+  /// \brief A list of output queues
+  using OutputQueueList = std::vector<OutputQueue>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param output_queue_list The output queues to inspect
+  /// \return A Status object
+  static Status create(Ref &obj, const OutputQueueList &output_queue_list);
+
+  /// \brief Destructor
+  virtual ~OutputQueueTablePlugin() override;
+
+  /// \return The table name
+  virtual const std::string &name() const override;
+
+  /// \return The table schema
+  virtual const Schema &schema() const override;
+
+  /// \brief Generates a row with the current metrics of each queue
+  /// \param row_list Where the generated rows are stored
+  /// \return A Status object
+  virtual Status generateRowList(RowList &row_list) override;
+
+protected:
+  /// \brief Constructor
+  /// \param output_queue_list The output queues to inspect
+  OutputQueueTablePlugin(const OutputQueueList &output_queue_list);
+};
+} // namespace zeek
@@ -0,0 +1,692 @@
+#include "outputspool.h"
+#include "rowcodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
+
+#if !defined(WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
+namespace zeek {
+namespace {
+const char kSegmentMagic[4] = {'Z', 'A', 'O', 'S'};
+const std::uint32_t kSegmentVersion{1U};
+const std::string kSegmentExtension{".spool"};
+
+/// \brief The magic and the version
+const std::size_t kSegmentHeaderSize{8U};
+
+/// \brief The payload size (32 bits) and its checksum (64 bits)
+const std::size_t kRecordHeaderSize{12U};
+
+/// \brief What was found at a given offset of a segment
+enum class RecordType { Valid, End, Damaged };
+
+void writeLittleEndian(char *destination, std::uint64_t value,
+                       std::size_t size) {
+  for (std::size_t i = 0U; i < size; ++i) {
+    destination[i] = static_cast<char>((value >> (i * 8U)) & 0xFFU);
+  }
+}
+
+std::uint64_t readLittleEndian(const char *source, std::size_t size) {
+  std::uint64_t value{0U};
+
+  for (std::size_t i = 0U; i < size; ++i) {
+    auto byte = static_cast<std::uint8_t>(source[i]);
+    value |= static_cast<std::uint64_t>(byte) << (i * 8U);
+  }
+
+  return value;
+}
+
+std::uint64_t computeChecksum(const char *payload, std::size_t size) {
+  // The size is used as the seed, so that a damaged size field is detected
+  // as well
+  return XXH3_64bits_withSeed(payload, size, size);
+}
+
+/// \brief Locates the next record of a segment
+/// \param offset The record offset; advanced past the record if valid
+RecordType nextRecord(const std::string &buffer, std::size_t &offset,
+                      const char *&payload, std::size_t &payload_size) {
+
+  if (buffer.size() - offset < kRecordHeaderSize) {
+    return RecordType::End;
+  }
+
+  payload_size =
+      static_cast<std::size_t>(readLittleEndian(buffer.data() + offset, 4U));
+
+  // The unused tail of a segment is zero filled
+  if (payload_size == 0U) {
+    return RecordType::End;
+  }
+
+  if (buffer.size() - offset - kRecordHeaderSize < payload_size) {
+    return RecordType::Damaged;
+  }
+
+  auto checksum = readLittleEndian(buffer.data() + offset + 4U, 8U);
+  payload = buffer.data() + offset + kRecordHeaderSize;
+
+  if (computeChecksum(payload, payload_size) != checksum) {
+    return RecordType::Damaged;
+  }
+
+  offset += kRecordHeaderSize + payload_size;
+  return RecordType::Valid;
+}
+
+bool isValidSegmentHeader(const std::string &buffer) {
+  return buffer.size() >= kSegmentHeaderSize &&
+         std::memcmp(buffer.data(), kSegmentMagic, sizeof(kSegmentMagic)) ==
+             0 &&
+         readLittleEndian(buffer.data() + 4U, 4U) == kSegmentVersion;
+}
+
+std::string segmentFileName(std::uint64_t sequence) {
+  // Zero padded, so that the names sort in the same order as the sequence
+  // numbers
+  auto sequence_string = std::to_string(sequence);
+  return std::string(20U - sequence_string.size(), '0') + sequence_string +
+         kSegmentExtension;
+}
+
+bool parseSegmentFileName(std::uint64_t &sequence, const std::string &name) {
+  if (name.size() != 20U + kSegmentExtension.size() ||
+      name.compare(20U, std::string::npos, kSegmentExtension) != 0) {
+    return false;
+  }
+
+  auto sequence_string = name.substr(0U, 20U);
+  if (sequence_string.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+
+  sequence = std::stoull(sequence_string);
+  return true;
+}
+
+Status readFile(std::string &buffer, const std::string &path) {
+  buffer.clear();
+
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream) {
+    return Status::failure("Failed to open the output spool segment: " +
+                           path);
+  }
+
+  buffer.assign(std::istreambuf_iterator<char>(stream),
+                std::istreambuf_iterator<char>());
+
+  if (stream.bad()) {
+    return Status::failure("Failed to read the output spool segment: " +
+                           path);
+  }
+
+  return Status::success();
+}
+
+bool decodeRecord(OutputPublisher::Output &output, const char *payload,
+                  std::size_t payload_size) {
+  output = {};
+
+  RowDecoder reader(payload, payload_size);
+
+  std::uint8_t flags{0U};
+  std::uint64_t column_name_count{0U};
+
+  if (!reader.readU8(flags) || !reader.readString(output.trigger) ||
+      !reader.readString(output.response_topic) ||
+      !reader.readString(output.response_event) ||
+      !reader.readString(output.cookie) ||
+      !reader.readVarint(column_name_count)) {
+    return false;
+  }
+
+  output.snapshot = (flags & 1U) != 0U;
+
+  std::vector<std::string> column_name_list;
+  for (std::uint64_t i = 0U; i < column_name_count; ++i) {
+    std::string column_name;
+    if (!reader.readString(column_name)) {
+      return false;
+    }
+
+    column_name_list.push_back(std::move(column_name));
+  }
+
+  std::uint64_t row_count{0U};
+  if (!reader.readVarint(row_count)) {
+    return false;
+  }
+
+  for (std::uint64_t i = 0U; i < row_count; ++i) {
+    std::uint64_t column_count{0U};
+    if (!reader.readVarint(column_count)) {
+      return false;
+    }
+
+    IVirtualDatabase::OutputRow row;
+
+    for (std::uint64_t j = 0U; j < column_count; ++j) {
+      std::uint64_t name_index{0U};
+      if (!reader.readVarint(name_index) ||
+          name_index >= column_name_list.size()) {
+        return false;
+      }
+
+      IVirtualDatabase::ColumnValue column;
+      column.name = column_name_list[static_cast<std::size_t>(name_index)];
+
+      if (!reader.readColumnValue(column.data)) {
+        return false;
+      }
+
+      row.push_back(std::move(column));
+    }
+
+    output.query_output.push_back(std::move(row));
+  }
+
+  return reader.empty();
+}
+} // namespace
+
+struct OutputSpool::Segment final {
+  std::uint64_t sequence{0U};
+  std::string path;
+
+  /// \brief The size on disk
+  std::size_t byte_count{0U};
+
+  /// \brief How many outputs have not been read yet
+  std::size_t record_count{0U};
+};
+
+struct OutputSpool::PrivateData final {
+  PrivateData(const Configuration &configuration_)
+      : configuration(configuration_) {}
+
+  Configuration configuration;
+
+  /// \brief The segments that are no longer written, oldest first. The
+  ///        first one is the one being read
+  std::deque<Segment> segment_list;
+  std::uint64_t next_sequence{0U};
+
+  std::optional<Segment> write_segment;
+  std::size_t write_offset{0U};
+
+#if defined(WIN32)
+  std::ofstream write_stream;
+#else
+  int write_fd{-1};
+  char *write_mapping{nullptr};
+#endif
+
+  std::string read_buffer;
+  std::size_t read_offset{0U};
+  bool read_buffer_loaded{false};
+
+  std::string record_buffer;
+  Stats stats;
+};
+
+Status OutputSpool::create(Ref &obj, const Configuration &configuration) {
+  try {
+    obj.reset();
+
+    auto ptr = new OutputSpool(configuration);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+OutputSpool::~OutputSpool() { sealWriteSegment(); }
+
+Status OutputSpool::append(const OutputPublisher::Output &output) {
+  auto &record_buffer = d->record_buffer;
+
+  // Leave room for the record header, which is only known at the end
+  record_buffer.assign(kRecordHeaderSize, '\0');
+  encodeOutput(record_buffer, output);
+
+  auto payload_size = record_buffer.size() - kRecordHeaderSize;
+  if (payload_size > std::numeric_limits<std::uint32_t>::max()) {
+    return Status::failure("The output is too large for the output spool");
+  }
+
+  writeLittleEndian(&record_buffer[0], payload_size, 4U);
+  writeLittleEndian(
+      &record_buffer[4],
+      computeChecksum(record_buffer.data() + kRecordHeaderSize, payload_size),
+      8U);
+
+  if (d->write_segment.has_value() &&
+      d->write_segment->byte_count - d->write_offset < record_buffer.size()) {
+    sealWriteSegment();
+  }
+
+  if (!d->write_segment.has_value()) {
+    auto status = openWriteSegment(
+        std::max(d->configuration.segment_byte_count,
+                 kSegmentHeaderSize + record_buffer.size()));
+
+    if (!status.succeeded()) {
+      return status;
+    }
+  }
+
+#if defined(WIN32)
+  d->write_stream.write(record_buffer.data(),
+                        static_cast<std::streamsize>(record_buffer.size()));
+  d->write_stream.flush();
+
+  if (!d->write_stream) {
+    auto path = d->write_segment->path;
+    sealWriteSegment();
+
+    return Status::failure("Failed to write the output spool segment: " +
+                           path);
+  }
+#else
+  // The payload is copied before the header, so that the record only
+  // becomes visible once complete
+  std::memcpy(d->write_mapping + d->write_offset + kRecordHeaderSize,
+              record_buffer.data() + kRecordHeaderSize, payload_size);
+
+  std::memcpy(d->write_mapping + d->write_offset, record_buffer.data(),
+              kRecordHeaderSize);
+#endif
+
+  d->write_offset += record_buffer.size();
+
+  ++d->write_segment->record_count;
+  ++d->stats.spooled_output_count;
+  ++d->stats.written_output_count;
+
+  return Status::success();
+}
+
+bool OutputSpool::empty() const { return d->stats.spooled_output_count == 0U; }
+
+Status OutputSpool::takeNext(std::optional<OutputPublisher::Output> &output) {
+  output = std::nullopt;
+
+  while (d->stats.spooled_output_count != 0U) {
+    // Catching up with the writer; the segment being written has to be
+    // closed before it can be read
+    if (d->segment_list.empty()) {
+      sealWriteSegment();
+
+      if (d->segment_list.empty()) {
+        break;
+      }
+    }
+
+    auto &segment = d->segment_list.front();
+
+    if (!d->read_buffer_loaded) {
+      auto status = readFile(d->read_buffer, segment.path);
+      if (!status.succeeded()) {
+        d->stats.dropped_output_count += segment.record_count;
+        removeOldestSegment();
+
+        return status;
+      }
+
+      d->read_buffer_loaded = true;
+      d->read_offset = kSegmentHeaderSize;
+
+      if (!isValidSegmentHeader(d->read_buffer)) {
+        d->read_offset = d->read_buffer.size();
+      }
+    }
+
+    const char *payload{nullptr};
+    std::size_t payload_size{0U};
+
+    auto record_type =
+        nextRecord(d->read_buffer, d->read_offset, payload, payload_size);
+
+    if (record_type != RecordType::Valid) {
+      // The rest of the segment can not be trusted
+      d->stats.corrupted_record_count += segment.record_count;
+      removeOldestSegment();
+
+      continue;
+    }
+
+    --segment.record_count;
+    --d->stats.spooled_output_count;
+
+    OutputPublisher::Output decoded_output;
+    if (decodeRecord(decoded_output, payload, payload_size)) {
+      ++d->stats.replayed_output_count;
+      output = std::move(decoded_output);
+
+    } else {
+      ++d->stats.corrupted_record_count;
+    }
+
+    if (segment.record_count == 0U) {
+      removeOldestSegment();
+    }
+
+    if (output.has_value()) {
+      break;
+    }
+  }
+
+  return Status::success();
+}
+
+OutputSpool::Stats OutputSpool::stats() const {
+  auto stats = d->stats;
+  stats.segment_count =
+      d->segment_list.size() + (d->write_segment.has_value() ? 1U : 0U);
+
+  return stats;
+}
+
+void OutputSpool::encodeOutput(std::string &buffer,
+                               const OutputPublisher::Output &output) {
+  RowEncoder writer(buffer);
+
+  writer.writeU8(output.snapshot ? 1U : 0U);
+  writer.writeString(output.trigger);
+  writer.writeString(output.response_topic);
+  writer.writeString(output.response_event);
+  writer.writeString(output.cookie);
+
+  // The column names are only stored once per output; the rows refer to
+  // them by index
+  std::unordered_map<std::string, std::size_t> column_name_map;
+  std::vector<const std::string *> column_name_list;
+
+  for (const auto &row : output.query_output) {
+    for (const auto &column : row) {
+      if (column_name_map.insert({column.name, column_name_list.size()})
+              .second) {
+        column_name_list.push_back(&column.name);
+      }
+    }
+  }
+
+  writer.writeVarint(column_name_list.size());
+  for (const auto &column_name : column_name_list) {
+    writer.writeString(*column_name);
+  }
+
+  writer.writeVarint(output.query_output.size());
+
+  for (const auto &row : output.query_output) {
+    writer.writeVarint(row.size());
+
+    for (const auto &column : row) {
+      writer.writeVarint(column_name_map.at(column.name));
+      writer.writeColumnValue(column.data);
+    }
+  }
+}
+
+Status OutputSpool::decodeOutput(OutputPublisher::Output &output,
+                                 const std::string &buffer) {
+  if (!decodeRecord(output, buffer.data(), buffer.size())) {
+    return Status::failure("Invalid output spool record");
+  }
+
+  return Status::success();
+}
+
+OutputSpool::OutputSpool(const Configuration &configuration)
+    : d(new PrivateData(configuration)) {
+
+  auto status = recoverSegments();
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+Status OutputSpool::recoverSegments() {
+  const auto &folder_path = d->configuration.folder_path;
+
+  std::error_code error;
+  std::filesystem::create_directories(folder_path, error);
+  if (error) {
+    return Status::failure("Failed to create the output spool folder " +
+                           folder_path + ": " + error.message());
+  }
+
+  std::vector<Segment> segment_list;
+
+  for (const auto &entry :
+       std::filesystem::directory_iterator(folder_path, error)) {
+    std::uint64_t sequence{0U};
+    if (!entry.is_regular_file(error) ||
+        !parseSegmentFileName(sequence, entry.path().filename().string())) {
+      continue;
+    }
+
+    Segment segment;
+    segment.sequence = sequence;
+    segment.path = entry.path().string();
+
+    segment_list.push_back(std::move(segment));
+  }
+
+  if (error) {
+    return Status::failure("Failed to list the output spool folder " +
+                           folder_path + ": " + error.message());
+  }
+
+  std::sort(segment_list.begin(), segment_list.end(),
+            [](const Segment &left, const Segment &right) -> bool {
+              return left.sequence < right.sequence;
+            });
+
+  // Count the valid records, so that the replay progress is known. A
+  // damaged record ends the segment
+  std::string buffer;
+
+  for (auto &segment : segment_list) {
+    d->next_sequence = std::max(d->next_sequence, segment.sequence + 1U);
+
+    auto status = readFile(buffer, segment.path);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    segment.byte_count = buffer.size();
+
+    if (isValidSegmentHeader(buffer)) {
+      std::size_t offset{kSegmentHeaderSize};
+      const char *payload{nullptr};
+      std::size_t payload_size{0U};
+
+      RecordType record_type{RecordType::Valid};
+      while ((record_type = nextRecord(buffer, offset, payload,
+                                       payload_size)) == RecordType::Valid) {
+        ++segment.record_count;
+      }
+
+      if (record_type == RecordType::Damaged) {
+        ++d->stats.corrupted_record_count;
+      }
+
+    } else {
+      ++d->stats.corrupted_record_count;
+    }
+
+    if (segment.record_count == 0U) {
+      std::filesystem::remove(segment.path, error);
+      continue;
+    }
+
+    d->stats.spooled_output_count += segment.record_count;
+    d->stats.spooled_byte_count += segment.byte_count;
+
+    d->segment_list.push_back(std::move(segment));
+  }
+
+  return Status::success();
+}
+
+Status OutputSpool::openWriteSegment(std::size_t byte_count) {
+  if (byte_count > d->configuration.max_byte_count) {
+    return Status::failure("The output is too large for the output spool");
+  }
+
+  // Make room by dropping the oldest outputs
+  while (!d->segment_list.empty() &&
+         d->stats.spooled_byte_count + byte_count >
+             d->configuration.max_byte_count) {
+
+    d->stats.dropped_output_count += d->segment_list.front().record_count;
+    removeOldestSegment();
+  }
+
+  Segment segment;
+  segment.sequence = d->next_sequence;
+  segment.path = (std::filesystem::path(d->configuration.folder_path) /
+                  segmentFileName(segment.sequence))
+                     .string();
+
+  segment.byte_count = byte_count;
+
+  char segment_header[kSegmentHeaderSize];
+  std::memcpy(segment_header, kSegmentMagic, sizeof(kSegmentMagic));
+  writeLittleEndian(segment_header + 4U, kSegmentVersion, 4U);
+
+#if defined(WIN32)
+  d->write_stream.open(segment.path, std::ios::binary | std::ios::trunc);
+  d->write_stream.write(segment_header, sizeof(segment_header));
+
+  if (!d->write_stream) {
+    d->write_stream = {};
+
+    return Status::failure("Failed to create the output spool segment: " +
+                           segment.path);
+  }
+#else
+  // The segment is allocated in full, then filled through the mapping;
+  // the unused tail is trimmed when it is sealed
+  auto fd = open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0600);
+
+  if (fd == -1) {
+    return Status::failure("Failed to create the output spool segment " +
+                           segment.path + ": error " + std::to_string(errno));
+  }
+
+  void *mapping{MAP_FAILED};
+  if (ftruncate(fd, static_cast<off_t>(byte_count)) == 0) {
+    mapping =
+        mmap(nullptr, byte_count, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+
+  if (mapping == MAP_FAILED) {
+    auto error_code = errno;
+
+    close(fd);
+    unlink(segment.path.c_str());
+
+    return Status::failure("Failed to map the output spool segment " +
+                           segment.path + ": error " +
+                           std::to_string(error_code));
+  }
+
+  d->write_fd = fd;
+  d->write_mapping = static_cast<char *>(mapping);
+
+  std::memcpy(d->write_mapping, segment_header, sizeof(segment_header));
+#endif
+
+  ++d->next_sequence;
+
+  d->write_offset = kSegmentHeaderSize;
+  d->stats.spooled_byte_count += byte_count;
+  d->write_segment = std::move(segment);
+
+  return Status::success();
+}
+
+void OutputSpool::sealWriteSegment() {
+  if (!d->write_segment.has_value()) {
+    return;
+  }
+
+  auto segment = std::move(d->write_segment.value());
+  d->write_segment.reset();
+
+#if defined(WIN32)
+  d->write_stream.close();
+  d->write_stream = {};
+#else
+  msync(d->write_mapping, d->write_offset, MS_ASYNC);
+  munmap(d->write_mapping, segment.byte_count);
+
+  if (ftruncate(d->write_fd, static_cast<off_t>(d->write_offset)) != 0) {
+    // Not an error; the zero filled tail is skipped when reading
+    d->write_offset = segment.byte_count;
+  }
+
+  close(d->write_fd);
+
+  d->write_fd = -1;
+  d->write_mapping = nullptr;
+#endif
+
+  d->stats.spooled_byte_count -= segment.byte_count;
+
+  if (segment.record_count == 0U) {
+    std::error_code error;
+    std::filesystem::remove(segment.path, error);
+
+    return;
+  }
+
+  segment.byte_count = d->write_offset;
+  d->stats.spooled_byte_count += segment.byte_count;
+
+  d->segment_list.push_back(std::move(segment));
+}
+
+void OutputSpool::removeOldestSegment() {
+  auto &segment = d->segment_list.front();
+
+  d->stats.spooled_output_count -= segment.record_count;
+  d->stats.spooled_byte_count -= segment.byte_count;
+
+  std::error_code error;
+  std::filesystem::remove(segment.path, error);
+
+  d->segment_list.pop_front();
+
+  d->read_buffer.clear();
+  d->read_offset = 0U;
+  d->read_buffer_loaded = false;
+}
+} // namespace zeek
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "outputpublisher.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief An append-only disk spool for the query outputs that can not be
+///        published, replayed in order once a Zeek server is available
+///
+/// The outputs are stored in a compact binary encoding, in segments that
+/// are memory mapped while written. Each record carries its own checksum,
+/// so that a crash only costs the records that were being written: the
+/// rest of the segment is skipped when it is read back. When the spool
+/// reaches its maximum size, the oldest segments are dropped to make room
+class OutputSpool final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to an output spool object
+  using Ref = std::unique_ptr<OutputSpool>;
+
+  /// \brief Output spool settings
+  struct Configuration final {
+    /// \brief Where the segments are stored; created if missing
+    std::string folder_path;
+
+    /// \brief The maximum size of the segments on disk
+    std::size_t max_byte_count{256U * 1024U * 1024U};
+
+    /// \brief The size of each segment. Outputs that are larger get a
+    ///        segment of their own
+    std::size_t segment_byte_count{4U * 1024U * 1024U};
+  };
+
+  /// \brief Spool metrics
+  struct Stats final {
+    /// \brief How many outputs are waiting to be replayed
+    std::size_t spooled_output_count{0U};
+
+    /// \brief The size of the segments on disk
+    std::size_t spooled_byte_count{0U};
+
+    /// \brief How many segments are on disk
+    std::size_t segment_count{0U};
+
+    /// \brief How many outputs have been written
+    std::uint64_t written_output_count{0U};
+
+    /// \brief How many outputs have been read back
+    std::uint64_t replayed_output_count{0U};
+
+    /// \brief How many outputs have been dropped because the spool was full
+    std::uint64_t dropped_output_count{0U};
+
+    /// \brief How many records have been skipped because they were
+    ///        damaged
+    std::uint64_t corrupted_record_count{0U};
+  };
+
+  /// \brief Factory method. The segments left by a previous run are
+  ///        recovered, and replayed before any new output
+  /// \param obj Where the created object is stored
+  /// \param configuration The output spool settings
+  /// \return A Status object
+  static Status create(Ref &obj, const Configuration &configuration);
+
+  /// \brief Destructor; the segments are kept on disk
+  ~OutputSpool();
+
+  /// \brief Appends an output at the end of the spool
+  /// \param output The output to store
+  /// \return A Status object. The output is not stored on failure
+  Status append(const OutputPublisher::Output &output);
+
+  /// \return True if there is no output waiting to be replayed
+  bool empty() const;
+
+  /// \brief Removes the oldest output from the spool
+  /// \param output Where the output is stored; std::nullopt if the spool
+  ///               is empty
+  /// \return A Status object
+  Status takeNext(std::optional<OutputPublisher::Output> &output);
+
+  /// \return The spool metrics
+  Stats stats() const;
+
+  /// \brief Encodes an output in the spool record format
+  /// \param buffer Where the encoded output is appended
+  /// \param output The output to encode
+  static void encodeOutput(std::string &buffer,
+                           const OutputPublisher::Output &output);
+
+  /// \brief Decodes an output from the spool record format
+  /// \param output Where the decoded output is stored
+  /// \param buffer The encoded output
+  /// \return A Status object
+  static Status decodeOutput(OutputPublisher::Output &output,
+                             const std::string &buffer);
+
+  OutputSpool(const OutputSpool &) = delete;
+  OutputSpool &operator=(const OutputSpool &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param configuration The output spool settings
+  OutputSpool(const Configuration &configuration);
+
+  /// \brief A segment on disk
+  struct Segment;
+
+  /// \brief Loads the segments left by a previous run
+  /// \return A Status object
+  Status recoverSegments();
+
+  /// \brief Opens a new segment for writing, making room for it first
+  /// \param byte_count The size of the new segment
+  /// \return A Status object
+  Status openWriteSegment(std::size_t byte_count);
+
+  /// \brief Closes the segment being written, so that it can be read
+  void sealWriteSegment();
+
+  /// \brief Deletes the oldest segment, together with the outputs it
+  ///        still contains
+  void removeOldestSegment();
+};
+} // namespace zeek
@@ -1,23 +1,135 @@
 #include "queryscheduler.h"
-#include "logger.h"
+#include "scheduleloadtableplugin.h"
+#include "scheduleplanner.h"
+#include "sharedscanquery.h"
+#include "taskschedule.h"
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <zeek/logratelimiter.h>
 
 namespace zeek {
 namespace {
+const std::chrono::milliseconds kMaxSchedulerSleepTime{1000};
+const std::size_t kMaxPendingScanRowCount{65536U};
+const std::size_t kLoadHistogramSize{60U};
+
+/// \brief How many chunks of output can be waiting in the task output list
+///        before the scheduler stops publishing more output
+const std::size_t kMaxPendingOutputChunkCount{8U};
+
+/// \brief How many scheduled queries have been started in a given second
+struct LoadHistogramEntry final {
+  std::int64_t second{0};
+  std::size_t query_count{0U};
+};
+
+/// \brief Identifies a scheduled query; the same query can be scheduled
+///        more than once with different topics or cookies
+struct ScheduledTaskKey final {
+  std::string query;
+  std::string response_topic;
+  std::string cookie;
+
+  bool operator==(const ScheduledTaskKey &other) const {
+    return query == other.query && response_topic == other.response_topic &&
+           cookie == other.cookie;
+  }
+};
+
+struct ScheduledTaskKeyHash final {
+  std::size_t operator()(const ScheduledTaskKey &key) const {
+    std::hash<std::string> hasher;
+
+    auto hash = hasher(key.query);
+    hash ^= hasher(key.response_topic) + 0x9e3779b9U + (hash << 6U) +
+            (hash >> 2U);
+
+    hash ^= hasher(key.cookie) + 0x9e3779b9U + (hash << 6U) + (hash >> 2U);
+    return hash;
+  }
+};
+
+/// \brief Identifies a query execution that can be shared by all the
+///        subscribers that have scheduled the same query with the same
+///        interval and trigger
+///
+/// The query text, the interval and the trigger must match exactly. A
+/// subscriber asking for the same query every 60 seconds does not share
+/// the executions of one asking for it every 30 seconds, even though they
+/// could be served from a common base interval
+struct SharedQueryKey final {
+  std::string query;
+  std::optional<std::chrono::milliseconds> interval;
+  std::optional<QueryScheduler::Task::Trigger> trigger;
+
+  bool operator==(const SharedQueryKey &other) const {
+    return query == other.query && interval == other.interval &&
+           trigger == other.trigger;
+  }
+};
+
+struct SharedQueryKeyHash final {
+  std::size_t operator()(const SharedQueryKey &key) const {
+    // Queries sharing the same text but not the same schedule are rare;
+    // don't bother hashing the interval and the trigger
+    return std::hash<std::string>()(key.query);
+  }
+};
+
+/// \brief A query that is executed once per interval (or trigger), and
+///        whose output is forwarded to every subscriber
+struct SharedQuery final {
+  SharedQueryKey key;
+  QueryScheduler::TaskQueue subscriber_list;
+
+  /// \brief Where the periodic executions have been placed within the
+  ///        interval, if an interval has been set
+  std::optional<SchedulePlanner::Placement> placement;
+
+  /// \brief The next periodic execution, if an interval has been set
+  std::optional<TaskSchedule::TimePoint> next_interval_deadline;
+
+  /// \brief How many rows the source table has received since the last
+  ///        execution, and when the first one has been reported
+  std::size_t triggered_row_count{0U};
+  std::optional<TaskSchedule::TimePoint> first_trigger_time;
+
+  /// \brief Set when the query is triggered, which requires a simple filter
+  ///        over an event table; the rows are then collected from a table
+  ///        scan shared with the other triggered queries reading from the
+  ///        same table
+  SharedScanQuery::Ref shared_scan_query;
+
+  /// \brief The rows collected from the table scans since the last time
+  ///        this query was due
+  IVirtualDatabase::QueryOutput pending_output;
+
+  /// \brief Limits the warnings about the rows dropped from
+  ///        pending_output. Created the first time rows are dropped
+  std::unique_ptr<LogRateLimiter> drop_log_rate_limiter;
+};
+
 Status querySchedulerThread(QueryScheduler &query_scheduler,
-                            std::atomic_bool &terminate) {
+                            IZeekLogger &logger, std::atomic_bool &terminate) {
   while (!terminate) {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    query_scheduler.waitForTasks(kMaxSchedulerSleepTime);
+    if (terminate) {
+      break;
+    }
 
     auto status = query_scheduler.processEvents();
     if (!status.succeeded()) {
-      getLogger().logMessage(IZeekLogger::Severity::Error,
-                             "The query scheduler has returned an error: " +
-                                 status.message());
+      logger.logMessage(IZeekLogger::Severity::Error,
+                        "The query scheduler has returned an error: " +
+                            status.message());
     }
   }
 
@@ -26,29 +138,72 @@ Status querySchedulerThread(QueryScheduler &query_scheduler,
 } // namespace
 
 struct QueryScheduler::PrivateData final {
-  PrivateData(IVirtualDatabase &virtual_database_)
-      : virtual_database(virtual_database_) {}
+  PrivateData(IVirtualDatabase &virtual_database_, IZeekLogger &logger_,
+              Clock clock_, const Configuration &configuration_)
+      : virtual_database(virtual_database_), logger(logger_),
+        clock(std::move(clock_)), configuration(configuration_) {}
 
   IVirtualDatabase &virtual_database;
+  IZeekLogger &logger;
+  Clock clock;
+  Configuration configuration;
+
+  TaskSchedule::TimePoint epoch;
+  std::unique_ptr<SchedulePlanner> schedule_planner;
+
+  IVirtualTable::Ref schedule_load_table;
+
+  mutable std::mutex load_histogram_mutex;
+  std::deque<LoadHistogramEntry> load_histogram;
 
   std::unique_ptr<std::thread> thread;
   std::atomic_bool terminate{false};
 
   TaskQueue task_queue;
+  std::unordered_map<std::string, std::size_t> table_update_map;
   std::mutex task_queue_mutex;
+  std::condition_variable task_queue_cv;
+
+  TaskOutputCallback task_output_callback;
+
+  TaskSchedule::TaskId next_task_id{0U};
 
-  std::map<std::string, Task> scheduled_task_list;
-  std::vector<std::pair<std::uint64_t, std::string>> schedule;
+  std::unordered_map<ScheduledTaskKey, TaskSchedule::TaskId,
+                     ScheduledTaskKeyHash>
+      task_id_map;
+
+  std::unordered_map<SharedQueryKey, TaskSchedule::TaskId, SharedQueryKeyHash>
+      shared_query_id_map;
+
+  std::unordered_map<TaskSchedule::TaskId, SharedQuery> shared_query_map;
+  std::atomic<std::size_t> shared_query_count{0U};
+
+  std::unordered_map<std::string, std::vector<TaskSchedule::TaskId>>
+      shared_scan_table_map;
+
+  mutable std::mutex schedule_mutex;
+  TaskSchedule schedule;
 
   std::mutex task_output_list_mutex;
+  std::condition_variable task_output_list_cv;
   std::vector<TaskOutput> task_output_list;
+  std::size_t task_output_row_count{0U};
 };
 
-Status QueryScheduler::create(Ref &obj, IVirtualDatabase &virtual_database) {
+Status QueryScheduler::create(Ref &obj, IVirtualDatabase &virtual_database,
+                              IZeekLogger &logger, Clock clock) {
+  return create(obj, virtual_database, logger, std::move(clock),
+                Configuration());
+}
+
+Status QueryScheduler::create(Ref &obj, IVirtualDatabase &virtual_database,
+                              IZeekLogger &logger, Clock clock,
+                              const Configuration &configuration) {
   try {
     obj.reset();
 
-    auto ptr = new QueryScheduler(virtual_database);
+    auto ptr = new QueryScheduler(virtual_database, logger, std::move(clock),
+                                  configuration);
     obj.reset(ptr);
 
     return Status::success();
@@ -64,129 +219,390 @@ Status QueryScheduler::create(Ref &obj, IVirtualDatabase &virtual_database) {
 QueryScheduler::~QueryScheduler() { stop(); }
 
 void QueryScheduler::processTaskQueue(TaskQueue task_queue) {
-  std::lock_guard<std::mutex> lock(d->task_queue_mutex);
+  if (task_queue.empty()) {
+    return;
+  }
 
-  // clang-format off
-  d->task_queue.insert(
-    d->task_queue.end(),
-    std::make_move_iterator(task_queue.begin()),
-    std::make_move_iterator(task_queue.end())
-  );
-  // clang-format on
+  {
+    std::lock_guard<std::mutex> lock(d->task_queue_mutex);
+
+    // clang-format off
+    d->task_queue.insert(
+      d->task_queue.end(),
+      std::make_move_iterator(task_queue.begin()),
+      std::make_move_iterator(task_queue.end())
+    );
+    // clang-format on
+  }
+
+  d->task_queue_cv.notify_one();
+}
+
+void QueryScheduler::notifyTableUpdate(const std::string &table_name,
+                                       std::size_t row_count) {
+  {
+    std::lock_guard<std::mutex> lock(d->task_queue_mutex);
+    d->table_update_map[table_name] += row_count;
+  }
+
+  d->task_queue_cv.notify_one();
 }
 
 Status QueryScheduler::processEvents() {
   TaskQueue task_queue;
+  std::unordered_map<std::string, std::size_t> table_update_map;
 
   {
     std::lock_guard<std::mutex> lock(d->task_queue_mutex);
 
     task_queue = std::move(d->task_queue);
     d->task_queue = {};
+
+    table_update_map = std::move(d->table_update_map);
+    d->table_update_map = {};
   }
 
-  auto current_timestamp = static_cast<std::uint64_t>(
-      std::chrono::duration_cast<std::chrono::seconds>(
-          std::chrono::system_clock::now().time_since_epoch())
-          .count());
+  auto current_time = d->clock();
 
   for (auto &task : task_queue) {
-    auto task_key = task.query + task.response_topic + task.cookie;
-
     if (task.type == Task::Type::ExecuteQuery) {
-      getLogger().logMessage(IZeekLogger::Severity::Information,
-                             "Executing one-shot query: " + task.query);
+      d->logger.logMessage(IZeekLogger::Severity::Information,
+                           "Executing one-shot query: " + task.query);
 
       auto status = executeTask(task);
       if (!status.succeeded()) {
-        getLogger().logMessage(
+        d->logger.logMessage(
             IZeekLogger::Severity::Error,
             "The query scheduler could not execute a one-shot task: " +
                 status.message());
       }
 
-    } else if (task.type == Task::Type::AddScheduledQuery) {
-      auto task_it = d->scheduled_task_list.find(task_key);
-      if (task_it != d->scheduled_task_list.end()) {
-        getLogger().logMessage(IZeekLogger::Severity::Error,
-                               "Not scheduling duplicate query: " + task.query);
+      // Publish the one-shot results right away, without waiting for the
+      // scheduled tasks
+      notifyTaskOutput();
+      continue;
+    }
+
+    ScheduledTaskKey task_key{task.query, task.response_topic, task.cookie};
+
+    if (task.type == Task::Type::AddScheduledQuery) {
+      if (d->task_id_map.count(task_key) > 0U) {
+        d->logger.logMessage(IZeekLogger::Severity::Error,
+                             "Not scheduling duplicate query: " + task.query);
+
+        continue;
+      }
+
+      auto valid_interval =
+          task.interval.has_value()
+              ? task.interval.value() > std::chrono::milliseconds(0)
+              : task.trigger.has_value();
+
+      if (!valid_interval) {
+        d->logger.logMessage(IZeekLogger::Severity::Error,
+                             "Not scheduling query with an invalid interval: " +
+                                 task.query);
+
+        continue;
+      }
+
+      if (task.trigger.has_value() &&
+          (task.trigger->batch_size == 0U ||
+           task.trigger->min_delay < std::chrono::milliseconds(0))) {
+
+        d->logger.logMessage(IZeekLogger::Severity::Error,
+                             "Not scheduling query with an invalid trigger: " +
+                                 task.query);
+
+        continue;
+      }
+
+      SharedQueryKey shared_query_key{task.query, task.interval, task.trigger};
+
+      // Subscribers asking for the same query with the same interval share
+      // a single execution. This also ensures that tables that are drained
+      // when read (such as the event tables) return the same rows to all of
+      // them
+      auto shared_query_id_it = d->shared_query_id_map.find(shared_query_key);
+      if (shared_query_id_it != d->shared_query_id_map.end()) {
+        auto shared_query_id = shared_query_id_it->second;
+
+        d->task_id_map.insert({std::move(task_key), shared_query_id});
+        d->shared_query_map.at(shared_query_id)
+            .subscriber_list.push_back(std::move(task));
+
+        continue;
+      }
+
+      // Triggers need to know the source table, so triggered queries must
+      // be simple filters over an event table. They are evaluated on a
+      // table scan shared with the other triggered queries reading from
+      // the same table. The other queries always go through SQLite
+      SharedScanQuery::Ref shared_scan_query;
+
+      if (task.trigger.has_value() &&
+          (!SharedScanQuery::create(shared_scan_query, shared_query_key.query)
+                .succeeded() ||
+           !d->virtual_database.isEventTable(
+               shared_scan_query->tableName()))) {
+
+        d->logger.logMessage(
+            IZeekLogger::Severity::Error,
+            "Not scheduling triggered query (only simple queries over event "
+            "tables can be triggered): " +
+                task.query);
 
         continue;
       }
 
-      getLogger().logMessage(
-          IZeekLogger::Severity::Information,
-          "A new query has been scheduled: " + task.query + " (every " +
-              std::to_string(task.interval.value()) + " seconds)");
+      std::string schedule_description;
+      if (task.interval.has_value()) {
+        schedule_description = "every " +
+                               std::to_string(task.interval.value().count()) +
+                               " milliseconds";
+      }
+
+      if (task.trigger.has_value()) {
+        if (!schedule_description.empty()) {
+          schedule_description += ", ";
+        }
+
+        schedule_description +=
+            "on new rows, min_delay " +
+            std::to_string(task.trigger->min_delay.count()) +
+            " milliseconds, batch_size " +
+            std::to_string(task.trigger->batch_size);
+      }
+
+      d->logger.logMessage(IZeekLogger::Severity::Information,
+                           "A new query has been scheduled: " + task.query +
+                               " (" + schedule_description + ")");
+
+      auto shared_query_id = d->next_task_id++;
+
+      SharedQuery shared_query;
+      shared_query.key = shared_query_key;
+      shared_query.subscriber_list.push_back(std::move(task));
+
+      if (shared_scan_query) {
+        d->shared_scan_table_map[shared_scan_query->tableName()].push_back(
+            shared_query_id);
+
+        shared_query.shared_scan_query = std::move(shared_scan_query);
+      }
+
+      // Spread the queries sharing the same interval, instead of running
+      // all of them one interval after they have been received
+      if (shared_query_key.interval.has_value()) {
+        shared_query.placement = d->schedule_planner->place(
+            shared_query_key.query, shared_query_key.interval.value(),
+            current_time);
 
-      auto query_timestamp = task.interval.value() + current_timestamp;
+        shared_query.next_interval_deadline = SchedulePlanner::nextDeadline(
+            shared_query.placement.value(), current_time);
+      }
+
+      auto next_interval_deadline = shared_query.next_interval_deadline;
+
+      d->task_id_map.insert({std::move(task_key), shared_query_id});
+      d->shared_query_id_map.insert(
+          {std::move(shared_query_key), shared_query_id});
 
-      d->scheduled_task_list.insert({task_key, std::move(task)});
-      d->schedule.push_back(std::make_pair(query_timestamp, task_key));
+      d->shared_query_map.insert({shared_query_id, std::move(shared_query)});
+      ++d->shared_query_count;
+
+      // Triggered queries without an interval only enter the schedule once
+      // their source table receives new rows
+      if (next_interval_deadline.has_value()) {
+        std::lock_guard<std::mutex> lock(d->schedule_mutex);
+        d->schedule.schedule(shared_query_id, next_interval_deadline.value());
+      }
 
     } else if (task.type == Task::Type::RemoveScheduledQuery) {
-      auto task_it = d->scheduled_task_list.find(task_key);
-      if (task_it == d->scheduled_task_list.end()) {
-        getLogger().logMessage(IZeekLogger::Severity::Error,
-                               "Failed to remove scheduled query (not found)");
+      auto task_id_it = d->task_id_map.find(task_key);
+      if (task_id_it == d->task_id_map.end()) {
+        d->logger.logMessage(IZeekLogger::Severity::Error,
+                             "Failed to remove scheduled query (not found)");
+
+        continue;
+      }
+
+      auto shared_query_id = task_id_it->second;
+      d->task_id_map.erase(task_id_it);
 
+      auto &shared_query = d->shared_query_map.at(shared_query_id);
+      auto &subscriber_list = shared_query.subscriber_list;
+
+      subscriber_list.erase(
+          std::remove_if(subscriber_list.begin(), subscriber_list.end(),
+                         [&task_key](const Task &subscriber) -> bool {
+                           return subscriber.response_topic ==
+                                      task_key.response_topic &&
+                                  subscriber.cookie == task_key.cookie;
+                         }),
+          subscriber_list.end());
+
+      if (!subscriber_list.empty()) {
         continue;
       }
 
-      d->scheduled_task_list.erase(task_it);
+      if (shared_query.shared_scan_query) {
+        auto table_it = d->shared_scan_table_map.find(
+            shared_query.shared_scan_query->tableName());
 
-      // clang-format off
-      auto schedule_it = std::find_if(
-        d->schedule.begin(),
-        d->schedule.end(),
+        auto &table_query_list = table_it->second;
+        table_query_list.erase(std::remove(table_query_list.begin(),
+                                           table_query_list.end(),
+                                           shared_query_id),
+                               table_query_list.end());
 
-        [task_key](std::pair<std::uint64_t, std::string> &pair) -> bool {
-          return pair.second == task_key;
+        if (table_query_list.empty()) {
+          d->shared_scan_table_map.erase(table_it);
         }
-      );
-      // clang-format on
+      }
+
+      if (shared_query.placement.has_value()) {
+        d->schedule_planner->release(shared_query.placement.value());
+      }
+
+      d->shared_query_id_map.erase(shared_query.key);
+      d->shared_query_map.erase(shared_query_id);
+      --d->shared_query_count;
+
+      std::lock_guard<std::mutex> lock(d->schedule_mutex);
+      d->schedule.remove(shared_query_id);
+    }
+  }
 
-      if (schedule_it != d->schedule.end()) {
-        d->schedule.erase(schedule_it);
+  processTableUpdates(table_update_map, current_time);
+
+  std::vector<TaskSchedule::TaskId> due_task_id_list;
+
+  {
+    std::lock_guard<std::mutex> lock(d->schedule_mutex);
+
+    while (!d->schedule.empty() &&
+           d->schedule.nextDeadline() <= current_time) {
+
+      auto task_id = d->schedule.nextTask();
+
+      auto &shared_query = d->shared_query_map.at(task_id);
+      shared_query.triggered_row_count = 0U;
+      shared_query.first_trigger_time.reset();
+
+      due_task_id_list.push_back(task_id);
+
+      if (!shared_query.next_interval_deadline.has_value()) {
+        d->schedule.remove(task_id);
+        continue;
       }
+
+      // Keep the original phase, skipping the missed executions if we have
+      // fallen behind by more than one interval. Runs caused by a trigger
+      // do not move the periodic schedule
+      auto &next_deadline = shared_query.next_interval_deadline.value();
+
+      if (next_deadline <= current_time) {
+        next_deadline = SchedulePlanner::nextDeadline(
+            shared_query.placement.value(), current_time);
+      }
+
+      d->schedule.schedule(task_id, next_deadline);
     }
   }
 
-  for (auto schedule_it = d->schedule.begin();
-       schedule_it != d->schedule.end();) {
+  if (!due_task_id_list.empty()) {
+    recordLoad(current_time, due_task_id_list.size());
+  }
 
-    auto &task_timestamp = schedule_it->first;
-    const auto &task_key = schedule_it->second;
+  // Scan each event table at most once, routing the rows to all the
+  // triggered queries that read from it (including the ones that are not
+  // due yet)
+  std::unordered_set<std::string> scanned_table_list;
 
-    auto task_it = d->scheduled_task_list.find(task_key);
-    if (task_it == d->scheduled_task_list.end()) {
-      schedule_it = d->schedule.erase(schedule_it);
+  for (const auto &task_id : due_task_id_list) {
+    const auto &shared_query = d->shared_query_map.at(task_id);
+    if (!shared_query.shared_scan_query) {
       continue;
     }
 
-    const auto &task = task_it->second;
+    const auto &table_name = shared_query.shared_scan_query->tableName();
+    if (!scanned_table_list.insert(table_name).second) {
+      continue;
+    }
+
+    auto status = scanEventTable(table_name);
+    if (!status.succeeded()) {
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "The query scheduler could not scan the " +
+                               table_name + " table: " + status.message());
+    }
+  }
+
+  for (const auto &task_id : due_task_id_list) {
+    auto &shared_query = d->shared_query_map.at(task_id);
 
-    if (task_timestamp <= current_timestamp) {
-      task_timestamp = current_timestamp + task.interval.value();
+    d->logger.logMessage(IZeekLogger::Severity::Debug,
+                         "Running scheduled query: " + shared_query.key.query +
+                             " (" +
+                             std::to_string(
+                                 shared_query.subscriber_list.size()) +
+                             " subscribers)");
 
-      getLogger().logMessage(IZeekLogger::Severity::Debug,
-                             "Running scheduled query: " + task.query);
+    if (shared_query.shared_scan_query) {
+      auto status = publishTaskOutput(shared_query.subscriber_list,
+                                      std::move(shared_query.pending_output),
+                                      0U, true, false);
+
+      shared_query.pending_output = {};
 
-      auto status = executeTask(task);
       if (!status.succeeded()) {
-        getLogger().logMessage(
-            IZeekLogger::Severity::Error,
-            "The query scheduler could not execute a scheduled task: " +
-                status.message());
+        d->logger.logMessage(IZeekLogger::Severity::Warning,
+                             "Dropping the output of a triggered query: " +
+                                 status.message());
+
+        continue;
       }
+
+      // The list may fill up before the remaining outputs are published,
+      // so the consumer is notified right away
+      notifyTaskOutput();
+      continue;
     }
 
-    ++schedule_it;
+    auto status = executeSharedTask(shared_query.key.query,
+                                    shared_query.subscriber_list);
+
+    if (!status.succeeded()) {
+      d->logger.logMessage(
+          IZeekLogger::Severity::Error,
+          "The query scheduler could not execute a scheduled task: " +
+              status.message());
+    }
+  }
+
+  if (!due_task_id_list.empty()) {
+    notifyTaskOutput();
   }
 
   return Status::success();
 }
 
+void QueryScheduler::waitForTasks(std::chrono::milliseconds max_wait_time) {
+  auto wait_time = timeUntilNextTask(max_wait_time);
+
+  std::unique_lock<std::mutex> lock(d->task_queue_mutex);
+
+  d->task_queue_cv.wait_for(lock, wait_time, [this]() -> bool {
+    return !d->task_queue.empty() || !d->table_update_map.empty() ||
+           d->terminate;
+  });
+}
+
+void QueryScheduler::setTaskOutputCallback(TaskOutputCallback callback) {
+  d->task_output_callback = std::move(callback);
+}
+
 QueryScheduler::TaskOutputList QueryScheduler::getTaskOutputList() {
   TaskOutputList task_output_list;
 
@@ -195,15 +611,94 @@ QueryScheduler::TaskOutputList QueryScheduler::getTaskOutputList() {
 
     task_output_list = std::move(d->task_output_list);
     d->task_output_list = {};
+    d->task_output_row_count = 0U;
   }
 
+  d->task_output_list_cv.notify_all();
   return task_output_list;
 }
 
+std::chrono::milliseconds QueryScheduler::timeUntilNextTask(
+    std::chrono::milliseconds max_wait_time) const {
+
+  TaskSchedule::TimePoint next_deadline;
+
+  {
+    std::lock_guard<std::mutex> lock(d->schedule_mutex);
+
+    if (d->schedule.empty()) {
+      return max_wait_time;
+    }
+
+    next_deadline = d->schedule.nextDeadline();
+  }
+
+  auto current_time = d->clock();
+  if (next_deadline <= current_time) {
+    return std::chrono::milliseconds(0);
+  }
+
+  auto wait_time = std::chrono::ceil<std::chrono::milliseconds>(
+      next_deadline - current_time);
+
+  return std::min(wait_time, max_wait_time);
+}
+
+std::size_t QueryScheduler::scheduledTaskCount() const {
+  return d->shared_query_count;
+}
+
+std::vector<std::size_t> QueryScheduler::loadHistogram() const {
+  auto current_second = std::chrono::duration_cast<std::chrono::seconds>(
+                            d->clock() - d->epoch)
+                            .count();
+
+  std::vector<std::size_t> load_histogram(kLoadHistogramSize, 0U);
+
+  std::lock_guard<std::mutex> lock(d->load_histogram_mutex);
+
+  for (const auto &entry : d->load_histogram) {
+    auto seconds_ago = current_second - entry.second;
+
+    if (seconds_ago >= 0 &&
+        seconds_ago < static_cast<std::int64_t>(kLoadHistogramSize)) {
+      load_histogram.at(static_cast<std::size_t>(seconds_ago)) =
+          entry.query_count;
+    }
+  }
+
+  return load_histogram;
+}
+
 Status QueryScheduler::start() {
+  if (d->thread) {
+    return Status::failure("The query scheduler is already running");
+  }
+
+  // The scheduler is stopped while the connection is down, and started
+  // again after reconnecting
+  d->terminate = false;
+
+  auto status = ScheduleLoadTablePlugin::create(d->schedule_load_table, *this);
+  if (!status.succeeded()) {
+    return status;
+  }
+
+  status = d->virtual_database.registerTable(d->schedule_load_table);
+  if (!status.succeeded()) {
+    d->schedule_load_table.reset();
+    return status;
+  }
+
   try {
     d->thread = std::make_unique<std::thread>(
-        querySchedulerThread, std::ref(*this), std::ref(d->terminate));
+        querySchedulerThread, std::ref(*this), std::ref(d->logger),
+        std::ref(d->terminate));
+
+    d->virtual_database.setTableUpdateCallback(
+        [this](const std::string &table_name, std::size_t row_count) {
+          notifyTableUpdate(table_name, row_count);
+        });
 
     return Status::success();
 
@@ -217,32 +712,303 @@ void QueryScheduler::stop() {
     return;
   }
 
-  d->terminate = true;
+  d->virtual_database.setTableUpdateCallback({});
+
+  {
+    std::lock_guard<std::mutex> lock(d->task_queue_mutex);
+    d->terminate = true;
+  }
+
+  d->task_queue_cv.notify_all();
+
+  // Interrupt the queries waiting to publish their next output chunk
+  {
+    std::lock_guard<std::mutex> lock(d->task_output_list_mutex);
+    d->task_output_list_cv.notify_all();
+  }
 
   d->thread->join();
   d->thread.reset();
+
+  if (d->schedule_load_table) {
+    d->virtual_database.unregisterTable(d->schedule_load_table->name());
+    d->schedule_load_table.reset();
+  }
 }
 
-QueryScheduler::QueryScheduler(IVirtualDatabase &virtual_database)
-    : d(new PrivateData(virtual_database)) {}
+QueryScheduler::QueryScheduler(IVirtualDatabase &virtual_database,
+                               IZeekLogger &logger, Clock clock,
+                               const Configuration &configuration)
+    : d(new PrivateData(virtual_database, logger, std::move(clock),
+                        configuration)) {
+
+  if (!d->clock) {
+    d->clock = []() -> std::chrono::steady_clock::time_point {
+      return std::chrono::steady_clock::now();
+    };
+  }
+
+  d->epoch = d->clock();
+  d->schedule_planner = std::make_unique<SchedulePlanner>(
+      d->configuration.host_identifier, d->epoch);
+}
 
 Status QueryScheduler::executeTask(const Task &task) {
-  TaskOutput task_output;
-  task_output.response_topic = task.response_topic;
-  task_output.response_event = task.response_event;
-  task_output.update_type = task.update_type;
-  task_output.cookie = task.cookie;
+  return executeSharedTask(task.query, {task});
+}
+
+Status QueryScheduler::executeSharedTask(const std::string &query,
+                                         const TaskQueue &subscriber_list) {
+  // Each chunk is held back until the next one arrives, so that the last
+  // chunk can be marked as such
+  IVirtualDatabase::QueryOutput previous_chunk;
+  bool has_previous_chunk{false};
+  std::size_t chunk_index{0U};
+
+  auto status = d->virtual_database.query(
+      query, d->configuration.output_chunk_size,
+      [&](IVirtualDatabase::QueryOutput chunk) -> Status {
+        if (has_previous_chunk) {
+          auto status = publishTaskOutput(subscriber_list,
+                                          std::move(previous_chunk),
+                                          chunk_index, false, false);
+
+          if (!status.succeeded()) {
+            return status;
+          }
+
+          ++chunk_index;
+          notifyTaskOutput();
+        }
+
+        previous_chunk = std::move(chunk);
+        has_previous_chunk = true;
+
+        return Status::success();
+      });
+
+  if (status.succeeded()) {
+    status = publishTaskOutput(subscriber_list, std::move(previous_chunk),
+                               chunk_index, true, false);
+
+    if (status.succeeded()) {
+      return Status::success();
+    }
+  }
+
+  // The subscribers would otherwise wait forever for the last chunk of
+  // an output they have already started to receive
+  if (chunk_index > 0U) {
+    publishTaskOutput(subscriber_list, {}, chunk_index, true, true);
+  }
+
+  return Status::failure(status.message() + ". Query: " + query);
+}
+
+void QueryScheduler::processTableUpdates(
+    const std::unordered_map<std::string, std::size_t> &table_update_map,
+    std::chrono::steady_clock::time_point current_time) {
+
+  for (const auto &p : table_update_map) {
+    const auto &table_name = p.first;
+    const auto &row_count = p.second;
+
+    auto table_it = d->shared_scan_table_map.find(table_name);
+    if (table_it == d->shared_scan_table_map.end()) {
+      continue;
+    }
+
+    for (const auto &task_id : table_it->second) {
+      auto &shared_query = d->shared_query_map.at(task_id);
+      if (!shared_query.key.trigger.has_value()) {
+        continue;
+      }
+
+      const auto &trigger = shared_query.key.trigger.value();
+
+      shared_query.triggered_row_count += row_count;
+      if (!shared_query.first_trigger_time.has_value()) {
+        shared_query.first_trigger_time = current_time;
+      }
+
+      // Wait for min_delay to collect more rows, unless the batch is full
+      auto deadline =
+          shared_query.triggered_row_count >= trigger.batch_size
+              ? current_time
+              : shared_query.first_trigger_time.value() + trigger.min_delay;
+
+      if (shared_query.next_interval_deadline.has_value()) {
+        deadline =
+            std::min(deadline, shared_query.next_interval_deadline.value());
+      }
+
+      std::lock_guard<std::mutex> lock(d->schedule_mutex);
+      d->schedule.schedule(task_id, deadline);
+    }
+  }
+}
+
+Status QueryScheduler::scanEventTable(const std::string &table_name) {
+  auto table_it = d->shared_scan_table_map.find(table_name);
+  if (table_it == d->shared_scan_table_map.end()) {
+    return Status::success();
+  }
+
+  IVirtualDatabase::QueryOutput table_scan;
+
+  auto status =
+      d->virtual_database.query(table_scan, "SELECT * FROM " + table_name);
 
-  auto status = d->virtual_database.query(task_output.query_output, task.query);
   if (!status.succeeded()) {
-    return Status::failure(status.message() + ". Query: " + task.query);
+    return status;
   }
 
-  {
-    std::lock_guard<std::mutex> lock(d->task_output_list_mutex);
-    d->task_output_list.push_back(std::move(task_output));
+  for (const auto &task_id : table_it->second) {
+    auto &shared_query = d->shared_query_map.at(task_id);
+    auto &pending_output = shared_query.pending_output;
+
+    status =
+        shared_query.shared_scan_query->execute(pending_output, table_scan);
+    if (!status.succeeded()) {
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "The query scheduler could not evaluate a query: " +
+                               status.message() +
+                               ". Query: " + shared_query.key.query);
+
+      continue;
+    }
+
+    if (pending_output.size() > kMaxPendingScanRowCount) {
+      auto dropped_row_count = pending_output.size() - kMaxPendingScanRowCount;
+
+      if (!shared_query.drop_log_rate_limiter) {
+        shared_query.drop_log_rate_limiter =
+            std::make_unique<LogRateLimiter>();
+      }
+
+      ZEEK_LOG_RATE_LIMITED_BY(*shared_query.drop_log_rate_limiter.get(),
+                               d->logger, IZeekLogger::Severity::Warning,
+                               "Dropping " +
+                                   std::to_string(dropped_row_count) +
+                                   " old rows for query: " +
+                                   shared_query.key.query);
+
+      pending_output.erase(
+          pending_output.begin(),
+          pending_output.begin() +
+              static_cast<std::ptrdiff_t>(dropped_row_count));
+    }
+  }
+
+  return Status::success();
+}
+
+Status QueryScheduler::waitForTaskOutputCapacity() {
+  auto max_row_count =
+      d->configuration.output_chunk_size * kMaxPendingOutputChunkCount;
+
+  std::unique_lock<std::mutex> lock(d->task_output_list_mutex);
+
+  // An empty list always accepts the next output, even when it is larger
+  // than the limit (or when chunking is disabled)
+  d->task_output_list_cv.wait(lock, [this, max_row_count]() -> bool {
+    return d->task_output_row_count < max_row_count ||
+           d->task_output_list.empty() || d->terminate;
+  });
+
+  if (d->terminate) {
+    return Status::failure("The query scheduler is stopping");
+  }
+
+  return Status::success();
+}
+
+Status QueryScheduler::publishTaskOutput(const TaskQueue &subscriber_list,
+                                         IVirtualDatabase::QueryOutput output,
+                                         std::size_t chunk_index,
+                                         bool last_chunk, bool aborted) {
+  // The aborted marker carries no rows, and must reach the subscribers
+  // even when the scheduler is stopping
+  if (!aborted) {
+    auto status = waitForTaskOutputCapacity();
+    if (!status.succeeded()) {
+      return status;
+    }
+  }
+
+  // Empty outputs are counted as one row, so that they can not pile up
+  // either while the list is not being drained
+  auto row_count =
+      std::max<std::size_t>(output.size(), 1U) * subscriber_list.size();
+
+  TaskOutputList task_output_list;
+  task_output_list.reserve(subscriber_list.size());
+
+  for (std::size_t i = 0U; i < subscriber_list.size(); ++i) {
+    const auto &subscriber = subscriber_list.at(i);
+
+    TaskOutput task_output;
+    task_output.response_topic = subscriber.response_topic;
+    task_output.response_event = subscriber.response_event;
+    task_output.update_type = subscriber.update_type;
+    task_output.cookie = subscriber.cookie;
+    task_output.chunk_index = chunk_index;
+    task_output.last_chunk = last_chunk;
+    task_output.aborted = aborted;
+
+    // Only copy the rows when there are more subscribers left
+    if (i + 1U < subscriber_list.size()) {
+      task_output.query_output = output;
+    } else {
+      task_output.query_output = std::move(output);
+    }
+
+    task_output_list.push_back(std::move(task_output));
   }
 
+  std::lock_guard<std::mutex> lock(d->task_output_list_mutex);
+
+  // clang-format off
+  d->task_output_list.insert(
+    d->task_output_list.end(),
+    std::make_move_iterator(task_output_list.begin()),
+    std::make_move_iterator(task_output_list.end())
+  );
+  // clang-format on
+
+  d->task_output_row_count += row_count;
   return Status::success();
 }
+
+void QueryScheduler::recordLoad(
+    std::chrono::steady_clock::time_point current_time,
+    std::size_t query_count) {
+
+  auto current_second = std::chrono::duration_cast<std::chrono::seconds>(
+                            current_time - d->epoch)
+                            .count();
+
+  std::lock_guard<std::mutex> lock(d->load_histogram_mutex);
+  auto &load_histogram = d->load_histogram;
+
+  if (load_histogram.empty() ||
+      load_histogram.back().second != current_second) {
+    load_histogram.push_back({current_second, 0U});
+  }
+
+  load_histogram.back().query_count += query_count;
+
+  auto oldest_second =
+      current_second - static_cast<std::int64_t>(kLoadHistogramSize) + 1;
+
+  while (load_histogram.front().second < oldest_second) {
+    load_histogram.pop_front();
+  }
+}
+
+void QueryScheduler::notifyTaskOutput() {
+  if (d->task_output_callback) {
+    d->task_output_callback();
+  }
+}
 } // namespace zeek
@@ -1,13 +1,23 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 
 #include <zeek/ivirtualdatabase.h>
+#include <zeek/izeeklogger.h>
 #include <zeek/status.h>
 
 namespace zeek {
 /// \brief Schedules queries against the virtual database
+///
+/// Subscribers that schedule the same query text with exactly the same
+/// interval and trigger share a single execution, whose output is sent to
+/// each of them. Different intervals are never merged, even when one is a
+/// multiple of the other
 class QueryScheduler final {
   struct PrivateData;
   std::unique_ptr<PrivateData> d;
@@ -16,11 +26,46 @@ public:
   /// \brief A reference to a query scheduler object
   using Ref = std::unique_ptr<QueryScheduler>;
 
+  /// \brief A monotonic clock, used to compute the task deadlines
+  using Clock = std::function<std::chrono::steady_clock::time_point()>;
+
+  /// \brief A callback invoked (from the scheduler thread) when new task
+  ///        output is available
+  using TaskOutputCallback = std::function<void()>;
+
+  /// \brief Query scheduler settings
+  struct Configuration final {
+    /// \brief Used to choose the phase of the scheduled queries, so that
+    ///        different hosts do not run the same query at the same time
+    std::string host_identifier;
+
+    /// \brief The maximum amount of rows in each task output. Larger query
+    ///        outputs are published in chunks while the query is still
+    ///        running. Zero disables chunking
+    std::size_t output_chunk_size{1024U};
+  };
+
+  /// \brief Factory method, using the default settings
+  /// \param obj Where the created object is stored
+  /// \param virtual_database The reference to a valid virtual database
+  /// \param logger The reference to a valid logger object
+  /// \param clock The clock used to schedule the tasks. When not set, the
+  ///              system steady clock is used
+  /// \return A Status object
+  static Status create(Ref &obj, IVirtualDatabase &virtual_database,
+                       IZeekLogger &logger, Clock clock = {});
+
   /// \brief Factory method
   /// \param obj Where the created object is stored
   /// \param virtual_database The reference to a valid virtual database
+  /// \param logger The reference to a valid logger object
+  /// \param clock The clock used to schedule the tasks. When not set, the
+  ///              system steady clock is used
+  /// \param configuration The query scheduler settings
   /// \return A Status object
-  static Status create(Ref &obj, IVirtualDatabase &virtual_database);
+  static Status create(Ref &obj, IVirtualDatabase &virtual_database,
+                       IZeekLogger &logger, Clock clock,
+                       const Configuration &configuration);
 
   /// \brief Destructor
   ~QueryScheduler();
@@ -33,6 +78,21 @@ public:
     /// \brief Available update types
     enum class UpdateType { Added, Removed, Both };
 
+    /// \brief Runs the query when its source table receives new rows
+    struct Trigger final {
+      /// \brief How long to wait after the first new row, so that more
+      ///        rows can be collected by the same execution
+      std::chrono::milliseconds min_delay{0};
+
+      /// \brief How many new rows cause the query to run right away,
+      ///        without waiting for min_delay
+      std::size_t batch_size{1U};
+
+      bool operator==(const Trigger &other) const {
+        return min_delay == other.min_delay && batch_size == other.batch_size;
+      }
+    };
+
     /// \brief The task type
     Type type;
 
@@ -48,8 +108,12 @@ public:
     /// \brief The task id
     std::string cookie;
 
-    /// \brief Schedule interval
-    std::optional<std::uint64_t> interval;
+    /// \brief Schedule interval; optional when a trigger is set
+    std::optional<std::chrono::milliseconds> interval;
+
+    /// \brief Push triggering options; only supported by the simple
+    ///        filter queries over event tables (see SharedScanQuery)
+    std::optional<Trigger> trigger;
 
     /// \brief Requested update type (differential)
     std::optional<UpdateType> update_type;
@@ -72,8 +136,20 @@ public:
     /// \brief The update types this task is interested in
     std::optional<Task::UpdateType> update_type;
 
-    /// \brief The query output for this task
+    /// \brief The query output for this task; a single chunk when the
+    ///        output is large
     IVirtualDatabase::QueryOutput query_output;
+
+    /// \brief The position of this chunk within the query output
+    std::size_t chunk_index{0U};
+
+    /// \brief True if this is the last chunk of the query output
+    bool last_chunk{true};
+
+    /// \brief True if the query has failed after some of its chunks had
+    ///        been published. The output is then an empty last chunk, and
+    ///        the rows received from the previous chunks are incomplete
+    bool aborted{false};
   };
 
   /// \brief A list of task outputs
@@ -87,14 +163,48 @@ public:
   /// \return A Status object
   Status processEvents();
 
+  /// \brief Signals that the given event table has received new rows. This
+  ///        method can be called from any thread
+  /// \param table_name The name of the event table
+  /// \param row_count How many rows have been added
+  void notifyTableUpdate(const std::string &table_name, std::size_t row_count);
+
+  /// \brief Blocks until new tasks are submitted, the next scheduled task is
+  ///        due or the scheduler is stopped
+  /// \param max_wait_time The maximum amount of time to wait for
+  void waitForTasks(std::chrono::milliseconds max_wait_time);
+
+  /// \brief Sets the callback used to signal that new task output is
+  ///        available. Must be called before start()
+  /// \param callback The callback to invoke
+  void setTaskOutputCallback(TaskOutputCallback callback);
+
   /// \return The output for the running tasks
   TaskOutputList getTaskOutputList();
 
-  /// \brief Starts the internal query scheduler services
+  /// \brief Returns how long until the next scheduled task is due
+  /// \param max_wait_time The maximum value that can be returned
+  /// \return The wait time, between zero and max_wait_time
+  std::chrono::milliseconds
+  timeUntilNextTask(std::chrono::milliseconds max_wait_time) const;
+
+  /// \return How many scheduled queries are currently active. Subscribers
+  ///         sharing the same query, interval and trigger are only counted
+  ///         once
+  std::size_t scheduledTaskCount() const;
+
+  /// \return How many scheduled query executions have started in each of
+  ///         the last 60 seconds; the first element is the current second
+  std::vector<std::size_t> loadHistogram() const;
+
+  /// \brief Starts the internal query scheduler services, subscribes to
+  ///        the event table updates of the virtual database and registers
+  ///        the query_schedule_load table
   /// \return A Status object
   Status start();
 
-  /// \brief Stops the internal query scheduler services
+  /// \brief Stops the internal query scheduler services. The scheduled
+  ///        queries are kept, and start() can be called again
   void stop();
 
   QueryScheduler(const QueryScheduler &) = delete;
@@ -102,12 +212,69 @@ public:
 
 protected:
   /// \brief Constructor
-  QueryScheduler(IVirtualDatabase &virtual_database);
+  /// \param virtual_database The reference to a valid virtual database
+  /// \param logger The reference to a valid logger object
+  /// \param clock The clock used to schedule the tasks
+  /// \param configuration The query scheduler settings
+  QueryScheduler(IVirtualDatabase &virtual_database, IZeekLogger &logger,
+                 Clock clock, const Configuration &configuration);
 
 private:
   /// \brief Executes a single task, updating the internal state
   /// \param task The task to execute
   /// \return A Status object
   Status executeTask(const Task &task);
+
+  /// \brief Executes a query once, forwarding its output to all the given
+  ///        subscribers
+  /// \param query The query to execute
+  /// \param subscriber_list The tasks that will receive the query output
+  /// \return A Status object
+  Status executeSharedTask(const std::string &query,
+                           const TaskQueue &subscriber_list);
+
+  /// \brief Updates the trigger state of the queries reading from the
+  ///        tables that have received new rows
+  /// \param table_update_map How many rows each table has received
+  /// \param current_time The current time
+  void processTableUpdates(
+      const std::unordered_map<std::string, std::size_t> &table_update_map,
+      std::chrono::steady_clock::time_point current_time);
+
+  /// \brief Scans the given event table once, appending the matching rows
+  ///        to the pending output of every query that reads from it
+  /// \param table_name The name of the event table to scan
+  /// \return A Status object
+  Status scanEventTable(const std::string &table_name);
+
+  /// \brief Waits until the task output list has been drained enough to
+  ///        accept more output
+  /// \return A Status object; a failure means that the scheduler is
+  ///         stopping
+  Status waitForTaskOutputCapacity();
+
+  /// \brief Forwards the given query output to all the subscribers, once
+  ///        the task output list has enough capacity for it
+  /// \param subscriber_list The tasks that will receive the query output
+  /// \param output The query output, or a chunk of it
+  /// \param chunk_index The position of the chunk within the query output
+  /// \param last_chunk True if this is the last chunk of the query output
+  /// \param aborted True if the query has failed after some of its chunks
+  ///                had been published
+  /// \return A Status object; a failure means that the scheduler is
+  ///         stopping, and that the output has been dropped
+  Status publishTaskOutput(const TaskQueue &subscriber_list,
+                           IVirtualDatabase::QueryOutput output,
+                           std::size_t chunk_index, bool last_chunk,
+                           bool aborted);
+
+  /// \brief Updates the load histogram
+  /// \param current_time The current time
+  /// \param query_count How many scheduled queries are being executed
+  void recordLoad(std::chrono::steady_clock::time_point current_time,
+                  std::size_t query_count);
+
+  /// \brief Invokes the task output callback, if one has been set
+  void notifyTaskOutput();
 };
 } // namespace zeek
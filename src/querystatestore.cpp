@@ -0,0 +1,489 @@
+#include "querystatestore.h"
+#include "rowcodec.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+namespace zeek {
+namespace {
+const char kSnapshotMagic[4] = {'Z', 'A', 'Q', 'S'};
+const std::uint32_t kSnapshotVersion{3U};
+
+std::uint8_t encodeUpdateType(
+    const std::optional<QueryScheduler::Task::UpdateType> &update_type) {
+  if (!update_type.has_value()) {
+    return 0U;
+  }
+
+  switch (update_type.value()) {
+  case QueryScheduler::Task::UpdateType::Added:
+    return 1U;
+
+  case QueryScheduler::Task::UpdateType::Removed:
+    return 2U;
+
+  case QueryScheduler::Task::UpdateType::Both:
+    return 3U;
+  }
+
+  return 0U;
+}
+
+bool decodeUpdateType(
+    std::optional<QueryScheduler::Task::UpdateType> &update_type,
+    std::uint8_t value) {
+  switch (value) {
+  case 0U:
+    update_type = std::nullopt;
+    return true;
+
+  case 1U:
+    update_type = QueryScheduler::Task::UpdateType::Added;
+    return true;
+
+  case 2U:
+    update_type = QueryScheduler::Task::UpdateType::Removed;
+    return true;
+
+  case 3U:
+    update_type = QueryScheduler::Task::UpdateType::Both;
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+void writeTask(RowEncoder &writer, const QueryScheduler::Task &task) {
+  writer.writeString(task.query);
+  writer.writeString(task.response_event);
+  writer.writeString(task.response_topic);
+  writer.writeString(task.cookie);
+
+  // A negative interval means that no interval has been set
+  writer.writeSignedVarint(task.interval.has_value() ? task.interval->count()
+                                                     : -1);
+
+  writer.writeU8(task.trigger.has_value() ? 1U : 0U);
+  if (task.trigger.has_value()) {
+    writer.writeSignedVarint(task.trigger->min_delay.count());
+    writer.writeU64(static_cast<std::uint64_t>(task.trigger->batch_size));
+  }
+
+  writer.writeU8(encodeUpdateType(task.update_type));
+}
+
+bool readTask(RowDecoder &reader, QueryScheduler::Task &task) {
+  task = {};
+  task.type = QueryScheduler::Task::Type::AddScheduledQuery;
+
+  std::int64_t interval{0};
+  std::uint8_t has_trigger{0U};
+
+  if (!reader.readString(task.query) ||
+      !reader.readString(task.response_event) ||
+      !reader.readString(task.response_topic) ||
+      !reader.readString(task.cookie) || !reader.readSignedVarint(interval) ||
+      !reader.readU8(has_trigger)) {
+    return false;
+  }
+
+  if (interval >= 0) {
+    task.interval = std::chrono::milliseconds(interval);
+  }
+
+  if (has_trigger != 0U) {
+    std::int64_t min_delay{0};
+    std::uint64_t batch_size{0U};
+
+    if (!reader.readSignedVarint(min_delay) || !reader.readU64(batch_size)) {
+      return false;
+    }
+
+    task.trigger = QueryScheduler::Task::Trigger{
+        std::chrono::milliseconds(min_delay),
+        static_cast<std::size_t>(batch_size)};
+  }
+
+  std::uint8_t update_type{0U};
+  return reader.readU8(update_type) &&
+         decodeUpdateType(task.update_type, update_type);
+}
+
+void writeRow(RowEncoder &writer, const IVirtualDatabase::OutputRow &row) {
+  writer.writeU32(static_cast<std::uint32_t>(row.size()));
+
+  for (const auto &column : row) {
+    writer.writeString(column.name);
+    writer.writeColumnValue(column.data);
+  }
+}
+
+bool readRow(RowDecoder &reader, IVirtualDatabase::OutputRow &row) {
+  row = {};
+
+  std::uint32_t column_count{0U};
+  if (!reader.readU32(column_count)) {
+    return false;
+  }
+
+  for (std::uint32_t i = 0U; i < column_count; ++i) {
+    IVirtualDatabase::ColumnValue column;
+
+    if (!reader.readString(column.name) ||
+        !reader.readColumnValue(column.data)) {
+      return false;
+    }
+
+    row.push_back(std::move(column));
+  }
+
+  return true;
+}
+
+bool isSameTask(const QueryScheduler::Task &left,
+                const QueryScheduler::Task &right) {
+  return left.query == right.query &&
+         left.response_event == right.response_event &&
+         left.response_topic == right.response_topic &&
+         left.cookie == right.cookie && left.interval == right.interval &&
+         left.trigger == right.trigger && left.update_type == right.update_type;
+}
+
+std::string computeQueryID(const QueryScheduler::Task &task) {
+  return ZeekConnection::computeQueryID(task.response_topic,
+                                        task.response_event, task.cookie);
+}
+} // namespace
+
+struct QueryStateStore::PrivateData final {
+  ZeekConnection::DifferentialContext differential_context;
+
+  std::unordered_map<std::string, QueryScheduler::Task> scheduled_task_map;
+
+  std::unordered_set<std::string> unconfirmed_query_id_set;
+  std::optional<TimePoint> confirmation_deadline;
+};
+
+Status QueryStateStore::create(Ref &obj) {
+  try {
+    obj.reset();
+
+    auto ptr = new QueryStateStore();
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+QueryStateStore::~QueryStateStore() {}
+
+ZeekConnection::DifferentialContext &QueryStateStore::differentialContext() {
+  return d->differential_context;
+}
+
+QueryScheduler::TaskQueue
+QueryStateStore::processTaskQueue(QueryScheduler::TaskQueue task_queue) {
+  QueryScheduler::TaskQueue output;
+
+  for (auto &task : task_queue) {
+    if (task.type == QueryScheduler::Task::Type::ExecuteQuery) {
+      output.push_back(std::move(task));
+      continue;
+    }
+
+    auto query_id = computeQueryID(task);
+    d->unconfirmed_query_id_set.erase(query_id);
+
+    auto scheduled_task_it = d->scheduled_task_map.find(query_id);
+
+    if (task.type == QueryScheduler::Task::Type::RemoveScheduledQuery) {
+      if (scheduled_task_it != d->scheduled_task_map.end()) {
+        d->scheduled_task_map.erase(scheduled_task_it);
+      }
+
+      d->differential_context.erase(query_id);
+      output.push_back(std::move(task));
+
+      continue;
+    }
+
+    if (scheduled_task_it != d->scheduled_task_map.end()) {
+      auto &scheduled_task = scheduled_task_it->second;
+
+      // The query is already running; keep its schedule and its
+      // differential context
+      if (isSameTask(scheduled_task, task)) {
+        continue;
+      }
+
+      // The query has changed; the old differential context no longer
+      // applies
+      auto remove_task = scheduled_task;
+      remove_task.type = QueryScheduler::Task::Type::RemoveScheduledQuery;
+      output.push_back(std::move(remove_task));
+
+      d->differential_context.erase(query_id);
+      scheduled_task = task;
+
+    } else {
+      d->scheduled_task_map.insert({query_id, task});
+    }
+
+    output.push_back(std::move(task));
+  }
+
+  if (d->unconfirmed_query_id_set.empty()) {
+    d->confirmation_deadline.reset();
+  }
+
+  return output;
+}
+
+QueryScheduler::TaskQueue QueryStateStore::scheduledTaskQueue() const {
+  QueryScheduler::TaskQueue task_queue;
+  task_queue.reserve(d->scheduled_task_map.size());
+
+  for (const auto &p : d->scheduled_task_map) {
+    task_queue.push_back(p.second);
+  }
+
+  return task_queue;
+}
+
+std::size_t QueryStateStore::scheduledTaskCount() const {
+  return d->scheduled_task_map.size();
+}
+
+void QueryStateStore::requireConfirmation(TimePoint deadline) {
+  d->unconfirmed_query_id_set.clear();
+
+  for (const auto &p : d->scheduled_task_map) {
+    d->unconfirmed_query_id_set.insert(p.first);
+  }
+
+  if (d->unconfirmed_query_id_set.empty()) {
+    d->confirmation_deadline.reset();
+  } else {
+    d->confirmation_deadline = deadline;
+  }
+}
+
+QueryScheduler::TaskQueue
+QueryStateStore::expireUnconfirmedTasks(TimePoint current_time) {
+  if (!d->confirmation_deadline.has_value() ||
+      current_time < d->confirmation_deadline.value()) {
+    return {};
+  }
+
+  QueryScheduler::TaskQueue task_queue;
+
+  for (const auto &query_id : d->unconfirmed_query_id_set) {
+    auto scheduled_task_it = d->scheduled_task_map.find(query_id);
+    if (scheduled_task_it == d->scheduled_task_map.end()) {
+      continue;
+    }
+
+    auto task = std::move(scheduled_task_it->second);
+    task.type = QueryScheduler::Task::Type::RemoveScheduledQuery;
+
+    d->scheduled_task_map.erase(scheduled_task_it);
+    d->differential_context.erase(query_id);
+
+    task_queue.push_back(std::move(task));
+  }
+
+  d->unconfirmed_query_id_set.clear();
+  d->confirmation_deadline.reset();
+
+  return task_queue;
+}
+
+Status QueryStateStore::saveSnapshot(const std::string &path) const {
+  std::string buffer(kSnapshotMagic, sizeof(kSnapshotMagic));
+
+  RowEncoder writer(buffer);
+  writer.writeU32(kSnapshotVersion);
+
+  writer.writeU32(static_cast<std::uint32_t>(d->scheduled_task_map.size()));
+  for (const auto &p : d->scheduled_task_map) {
+    writeTask(writer, p.second);
+  }
+
+  // Only keep the differential context of the scheduled queries
+  std::uint32_t differential_data_count{0U};
+  for (const auto &p : d->differential_context) {
+    if (d->scheduled_task_map.count(p.first) > 0U) {
+      ++differential_data_count;
+    }
+  }
+
+  writer.writeU32(differential_data_count);
+
+  for (const auto &p : d->differential_context) {
+    const auto &query_id = p.first;
+    const auto &differential_data = p.second;
+
+    if (d->scheduled_task_map.count(query_id) == 0U) {
+      continue;
+    }
+
+    writer.writeString(query_id);
+
+    auto row_hash_list = differential_data.row_hash_set.hashList();
+    writer.writeU32(static_cast<std::uint32_t>(row_hash_list.size()));
+
+    for (auto row_hash : row_hash_list) {
+      writer.writeU64(row_hash);
+    }
+
+    const auto &row_map = differential_data.row_map;
+    writer.writeU32(static_cast<std::uint32_t>(row_map.size()));
+
+    for (const auto &row_p : row_map) {
+      writer.writeU64(row_p.first);
+      writeRow(writer, row_p.second);
+    }
+  }
+
+  // Write a temporary file first, so that a crash can not leave a
+  // truncated snapshot behind
+  auto temporary_path = path + ".tmp";
+
+  {
+    std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+      return Status::failure("Failed to open the snapshot file: " +
+                             temporary_path);
+    }
+
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+    if (!stream) {
+      return Status::failure("Failed to write the snapshot file: " +
+                             temporary_path);
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_path, path, error);
+  if (error) {
+    return Status::failure("Failed to replace the snapshot file " + path +
+                           ": " + error.message());
+  }
+
+  return Status::success();
+}
+
+Status QueryStateStore::loadSnapshot(const std::string &path) {
+  std::error_code error;
+  if (!std::filesystem::exists(path, error)) {
+    return Status::success();
+  }
+
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream) {
+    return Status::failure("Failed to open the snapshot file: " + path);
+  }
+
+  std::string buffer((std::istreambuf_iterator<char>(stream)),
+                     std::istreambuf_iterator<char>());
+
+  RowDecoder reader(buffer);
+
+  char magic[sizeof(kSnapshotMagic)] = {};
+  std::uint32_t version{0U};
+
+  if (!reader.readBytes(magic, sizeof(magic)) ||
+      std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0 ||
+      !reader.readU32(version) || version != kSnapshotVersion) {
+    return Status::failure("Invalid or unsupported snapshot file: " + path);
+  }
+
+  auto invalid_snapshot_error =
+      Status::failure("The snapshot file is corrupted: " + path);
+
+  std::unordered_map<std::string, QueryScheduler::Task> scheduled_task_map;
+
+  std::uint32_t task_count{0U};
+  if (!reader.readU32(task_count)) {
+    return invalid_snapshot_error;
+  }
+
+  for (std::uint32_t i = 0U; i < task_count; ++i) {
+    QueryScheduler::Task task;
+    if (!readTask(reader, task)) {
+      return invalid_snapshot_error;
+    }
+
+    auto query_id = computeQueryID(task);
+    scheduled_task_map.insert({std::move(query_id), std::move(task)});
+  }
+
+  ZeekConnection::DifferentialContext differential_context;
+
+  std::uint32_t differential_data_count{0U};
+  if (!reader.readU32(differential_data_count)) {
+    return invalid_snapshot_error;
+  }
+
+  for (std::uint32_t i = 0U; i < differential_data_count; ++i) {
+    std::string query_id;
+    std::uint32_t row_hash_count{0U};
+
+    if (!reader.readString(query_id) || !reader.readU32(row_hash_count)) {
+      return invalid_snapshot_error;
+    }
+
+    auto &differential_data = differential_context[query_id];
+
+    for (std::uint32_t j = 0U; j < row_hash_count; ++j) {
+      std::uint64_t row_hash{0U};
+      if (!reader.readU64(row_hash)) {
+        return invalid_snapshot_error;
+      }
+
+      differential_data.row_hash_set.insert(row_hash);
+    }
+
+    std::uint32_t row_count{0U};
+    if (!reader.readU32(row_count)) {
+      return invalid_snapshot_error;
+    }
+
+    for (std::uint32_t j = 0U; j < row_count; ++j) {
+      std::uint64_t row_hash{0U};
+      IVirtualDatabase::OutputRow row;
+
+      if (!reader.readU64(row_hash) || !readRow(reader, row) ||
+          !differential_data.row_hash_set.contains(row_hash)) {
+        return invalid_snapshot_error;
+      }
+
+      differential_data.row_map.insert({row_hash, std::move(row)});
+    }
+  }
+
+  if (!reader.empty()) {
+    return invalid_snapshot_error;
+  }
+
+  d->scheduled_task_map = std::move(scheduled_task_map);
+  d->differential_context = std::move(differential_context);
+  d->unconfirmed_query_id_set.clear();
+  d->confirmation_deadline.reset();
+
+  return Status::success();
+}
+
+QueryStateStore::QueryStateStore() : d(new PrivateData) {}
+} // namespace zeek
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "queryscheduler.h"
+#include "zeekconnection.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief Keeps the scheduled queries and their differential context across
+///        Zeek reconnects and, through snapshots, across agent restarts
+///
+/// Zeek schedules its queries again after every reconnect. The scheduled
+/// queries that are already known are only confirmed, so that they keep
+/// their schedule and their differential context. The queries that are not
+/// confirmed within the given deadline are removed
+class QueryStateStore final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to a query state store object
+  using Ref = std::unique_ptr<QueryStateStore>;
+
+  /// \brief A point in time, taken from a monotonic clock
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \return A Status object
+  static Status create(Ref &obj);
+
+  /// \brief Destructor
+  ~QueryStateStore();
+
+  /// \return The differential context, shared by all the connections
+  ZeekConnection::DifferentialContext &differentialContext();
+
+  /// \brief Tracks the scheduled queries found in the given task queue
+  /// \param task_queue The tasks received from Zeek
+  /// \return The tasks to forward to the query scheduler. Scheduled queries
+  ///         that are already known are confirmed and left out
+  QueryScheduler::TaskQueue
+  processTaskQueue(QueryScheduler::TaskQueue task_queue);
+
+  /// \return An AddScheduledQuery task for each known scheduled query
+  QueryScheduler::TaskQueue scheduledTaskQueue() const;
+
+  /// \return How many scheduled queries are known
+  std::size_t scheduledTaskCount() const;
+
+  /// \brief Requires all the known scheduled queries to be scheduled again
+  ///        before the given deadline
+  /// \param deadline When the unconfirmed queries expire
+  void requireConfirmation(TimePoint deadline);
+
+  /// \brief Removes the scheduled queries that have not been confirmed in
+  ///        time, together with their differential context
+  /// \param current_time The current time
+  /// \return A RemoveScheduledQuery task for each expired query
+  QueryScheduler::TaskQueue expireUnconfirmedTasks(TimePoint current_time);
+
+  /// \brief Writes the scheduled queries and their differential context to
+  ///        the given file
+  /// \param path The snapshot path
+  /// \return A Status object
+  Status saveSnapshot(const std::string &path) const;
+
+  /// \brief Replaces the current state with the contents of the given
+  ///        snapshot. A missing file is not an error
+  /// \param path The snapshot path
+  /// \return A Status object
+  Status loadSnapshot(const std::string &path);
+
+  QueryStateStore(const QueryStateStore &) = delete;
+  QueryStateStore &operator=(const QueryStateStore &) = delete;
+
+private:
+  /// \brief Constructor
+  QueryStateStore();
+};
+} // namespace zeek
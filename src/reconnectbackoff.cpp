@@ -0,0 +1,34 @@
+#include "reconnectbackoff.h"
+
+#include <algorithm>
+
+namespace zeek {
+ReconnectBackoff::ReconnectBackoff(std::chrono::milliseconds initial_delay_,
+                                   std::chrono::milliseconds max_delay_,
+                                   std::uint64_t seed)
+    : initial_delay(std::max(initial_delay_, std::chrono::milliseconds(1))),
+      max_delay(std::max(max_delay_, initial_delay)),
+      current_ceiling(initial_delay), random_generator(seed) {}
+
+std::chrono::milliseconds ReconnectBackoff::nextDelay() {
+  std::uniform_int_distribution<std::chrono::milliseconds::rep> distribution(
+      0, current_ceiling.count());
+
+  auto delay = std::chrono::milliseconds(distribution(random_generator));
+
+  // Double the ceiling without overflowing, even with huge maximums
+  if (current_ceiling > max_delay / 2) {
+    current_ceiling = max_delay;
+  } else {
+    current_ceiling *= 2;
+  }
+
+  return delay;
+}
+
+void ReconnectBackoff::reset() { current_ceiling = initial_delay; }
+
+std::chrono::milliseconds ReconnectBackoff::ceiling() const {
+  return current_ceiling;
+}
+} // namespace zeek
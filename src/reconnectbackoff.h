@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace zeek {
+/// \brief Picks the delays between the connection attempts, using an
+///        exponential backoff with full jitter
+///
+/// Each delay is chosen at random between zero and the current ceiling,
+/// which starts at the initial delay and doubles after every attempt, up to
+/// the maximum delay. The random part keeps the agents that have lost the
+/// same server from reconnecting in lockstep
+class ReconnectBackoff final {
+public:
+  /// \brief Constructor
+  /// \param initial_delay The ceiling used for the first attempt
+  /// \param max_delay The maximum ceiling
+  /// \param seed The seed for the random delays
+  ReconnectBackoff(std::chrono::milliseconds initial_delay,
+                   std::chrono::milliseconds max_delay, std::uint64_t seed);
+
+  /// \brief Picks the delay before the next attempt, then doubles the
+  ///        ceiling
+  /// \return A delay between zero and the current ceiling
+  std::chrono::milliseconds nextDelay();
+
+  /// \brief Restores the initial ceiling, after a successful connection
+  void reset();
+
+  /// \return The ceiling that the next delay will be picked under
+  std::chrono::milliseconds ceiling() const;
+
+private:
+  /// \brief The ceiling used for the first attempt
+  std::chrono::milliseconds initial_delay;
+
+  /// \brief The maximum ceiling
+  std::chrono::milliseconds max_delay;
+
+  /// \brief The current ceiling
+  std::chrono::milliseconds current_ceiling;
+
+  /// \brief Generates the random delays
+  std::mt19937_64 random_generator;
+};
+} // namespace zeek
@@ -0,0 +1,232 @@
+#include "rowcodec.h"
+
+#include <cstring>
+
+namespace zeek {
+namespace {
+void writeInteger(std::string &buffer, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0U; i < size; ++i) {
+    buffer.push_back(static_cast<char>((value >> (i * 8U)) & 0xFFU));
+  }
+}
+} // namespace
+
+RowEncoder::RowEncoder(std::string &buffer_) : buffer(buffer_) {}
+
+void RowEncoder::writeU8(std::uint8_t value) {
+  buffer.push_back(static_cast<char>(value));
+}
+
+void RowEncoder::writeU32(std::uint32_t value) {
+  writeInteger(buffer, value, 4U);
+}
+
+void RowEncoder::writeU64(std::uint64_t value) {
+  writeInteger(buffer, value, 8U);
+}
+
+void RowEncoder::writeVarint(std::uint64_t value) {
+  while (value >= 0x80U) {
+    buffer.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+    value >>= 7U;
+  }
+
+  buffer.push_back(static_cast<char>(value));
+}
+
+void RowEncoder::writeSignedVarint(std::int64_t value) {
+  auto unsigned_value = static_cast<std::uint64_t>(value);
+  writeVarint((unsigned_value << 1U) ^ (value < 0 ? ~0ULL : 0ULL));
+}
+
+void RowEncoder::writeDouble(double value) {
+  std::uint64_t bits{0U};
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  writeU64(bits);
+}
+
+void RowEncoder::writeString(const std::string &value) {
+  writeVarint(value.size());
+  buffer.append(value);
+}
+
+void RowEncoder::writeColumnValue(
+    const IVirtualTable::OptionalVariant &value) {
+  if (!value.has_value()) {
+    writeU8(static_cast<std::uint8_t>(RowCodecValueType::Null));
+    return;
+  }
+
+  const auto &variant = value.value();
+
+  if (std::holds_alternative<std::int64_t>(variant)) {
+    writeU8(static_cast<std::uint8_t>(RowCodecValueType::Integer));
+    writeSignedVarint(std::get<std::int64_t>(variant));
+
+  } else if (std::holds_alternative<std::string>(variant)) {
+    writeU8(static_cast<std::uint8_t>(RowCodecValueType::String));
+    writeString(std::get<std::string>(variant));
+
+  } else {
+    writeU8(static_cast<std::uint8_t>(RowCodecValueType::Double));
+    writeDouble(std::get<double>(variant));
+  }
+}
+
+RowDecoder::RowDecoder(const char *buffer_, std::size_t size_)
+    : buffer(buffer_), size(size_) {}
+
+RowDecoder::RowDecoder(const std::string &buffer_)
+    : RowDecoder(buffer_.data(), buffer_.size()) {}
+
+bool RowDecoder::readU8(std::uint8_t &value) {
+  if (offset == size) {
+    return false;
+  }
+
+  value = static_cast<std::uint8_t>(buffer[offset]);
+  ++offset;
+
+  return true;
+}
+
+bool RowDecoder::readU32(std::uint32_t &value) {
+  std::uint64_t temp{0U};
+  if (!readInteger(temp, 4U)) {
+    return false;
+  }
+
+  value = static_cast<std::uint32_t>(temp);
+  return true;
+}
+
+bool RowDecoder::readU64(std::uint64_t &value) {
+  return readInteger(value, 8U);
+}
+
+bool RowDecoder::readVarint(std::uint64_t &value) {
+  value = 0U;
+
+  for (std::uint32_t shift = 0U; shift < 64U; shift += 7U) {
+    std::uint8_t byte{0U};
+    if (!readU8(byte)) {
+      return false;
+    }
+
+    value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0U) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool RowDecoder::readSignedVarint(std::int64_t &value) {
+  std::uint64_t unsigned_value{0U};
+  if (!readVarint(unsigned_value)) {
+    return false;
+  }
+
+  value = static_cast<std::int64_t>((unsigned_value >> 1U) ^
+                                    (~(unsigned_value & 1U) + 1U));
+  return true;
+}
+
+bool RowDecoder::readDouble(double &value) {
+  std::uint64_t bits{0U};
+  if (!readU64(bits)) {
+    return false;
+  }
+
+  std::memcpy(&value, &bits, sizeof(value));
+  return true;
+}
+
+bool RowDecoder::readString(std::string &value) {
+  std::uint64_t string_size{0U};
+  if (!readVarint(string_size) || size - offset < string_size) {
+    return false;
+  }
+
+  value.assign(buffer + offset, static_cast<std::size_t>(string_size));
+  offset += static_cast<std::size_t>(string_size);
+
+  return true;
+}
+
+bool RowDecoder::readBytes(char *destination, std::size_t byte_count) {
+  if (size - offset < byte_count) {
+    return false;
+  }
+
+  std::memcpy(destination, buffer + offset, byte_count);
+  offset += byte_count;
+
+  return true;
+}
+
+bool RowDecoder::readColumnValue(IVirtualTable::OptionalVariant &value) {
+  value.reset();
+
+  std::uint8_t value_type{0U};
+  if (!readU8(value_type)) {
+    return false;
+  }
+
+  switch (static_cast<RowCodecValueType>(value_type)) {
+  case RowCodecValueType::Null:
+    return true;
+
+  case RowCodecValueType::Integer: {
+    std::int64_t integer_value{0};
+    if (!readSignedVarint(integer_value)) {
+      return false;
+    }
+
+    value = integer_value;
+    return true;
+  }
+
+  case RowCodecValueType::String: {
+    std::string string_value;
+    if (!readString(string_value)) {
+      return false;
+    }
+
+    value = std::move(string_value);
+    return true;
+  }
+
+  case RowCodecValueType::Double: {
+    double double_value{0.0};
+    if (!readDouble(double_value)) {
+      return false;
+    }
+
+    value = double_value;
+    return true;
+  }
+  }
+
+  return false;
+}
+
+bool RowDecoder::empty() const { return offset == size; }
+
+bool RowDecoder::readInteger(std::uint64_t &value, std::size_t byte_count) {
+  if (size - offset < byte_count) {
+    return false;
+  }
+
+  value = 0U;
+  for (std::size_t i = 0U; i < byte_count; ++i) {
+    auto byte = static_cast<std::uint8_t>(buffer[offset + i]);
+    value |= static_cast<std::uint64_t>(byte) << (i * 8U);
+  }
+
+  offset += byte_count;
+  return true;
+}
+} // namespace zeek
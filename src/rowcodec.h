@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <zeek/ivirtualtable.h>
+
+namespace zeek {
+/// \brief Column value types, as stored by the RowEncoder
+enum class RowCodecValueType : std::uint8_t { Null, Integer, String, Double };
+
+/// \brief Appends values to a buffer, using the binary format shared by the
+///        output spool and the query state snapshots
+///
+/// Fixed size integers and doubles are little endian. Variable size integers
+/// use 7 bits per byte, and the signed ones are zigzag encoded first so that
+/// small negative values stay small. Strings are prefixed by their variable
+/// size length
+class RowEncoder final {
+public:
+  /// \brief Constructor
+  /// \param buffer The buffer to append to
+  RowEncoder(std::string &buffer);
+
+  /// \brief Destructor
+  ~RowEncoder() = default;
+
+  void writeU8(std::uint8_t value);
+  void writeU32(std::uint32_t value);
+  void writeU64(std::uint64_t value);
+  void writeVarint(std::uint64_t value);
+  void writeSignedVarint(std::int64_t value);
+  void writeDouble(double value);
+  void writeString(const std::string &value);
+
+  /// \brief Writes the value type, followed by the value itself
+  void writeColumnValue(const IVirtualTable::OptionalVariant &value);
+
+  RowEncoder(const RowEncoder &) = delete;
+  RowEncoder &operator=(const RowEncoder &) = delete;
+
+private:
+  std::string &buffer;
+};
+
+/// \brief Reads the values written by a RowEncoder. Every method checks the
+///        bounds of the buffer, and returns false when it is too short or
+///        malformed
+class RowDecoder final {
+public:
+  /// \brief Constructor
+  /// \param buffer The start of the encoded data; must outlive the decoder
+  /// \param size The size of the encoded data
+  RowDecoder(const char *buffer, std::size_t size);
+
+  /// \brief Constructor
+  /// \param buffer The encoded data; must outlive the decoder
+  RowDecoder(const std::string &buffer);
+
+  /// \brief Destructor
+  ~RowDecoder() = default;
+
+  bool readU8(std::uint8_t &value);
+  bool readU32(std::uint32_t &value);
+  bool readU64(std::uint64_t &value);
+  bool readVarint(std::uint64_t &value);
+  bool readSignedVarint(std::int64_t &value);
+  bool readDouble(double &value);
+  bool readString(std::string &value);
+  bool readBytes(char *destination, std::size_t byte_count);
+
+  /// \brief Reads a value written by RowEncoder::writeColumnValue
+  bool readColumnValue(IVirtualTable::OptionalVariant &value);
+
+  /// \return True if the whole buffer has been read
+  bool empty() const;
+
+  RowDecoder(const RowDecoder &) = delete;
+  RowDecoder &operator=(const RowDecoder &) = delete;
+
+private:
+  /// \brief Reads a fixed size, little endian integer
+  bool readInteger(std::uint64_t &value, std::size_t byte_count);
+
+  const char *buffer{nullptr};
+  std::size_t size{0U};
+  std::size_t offset{0U};
+};
+} // namespace zeek
@@ -0,0 +1,120 @@
+#include "rowhashset.h"
+
+namespace zeek {
+namespace {
+const std::size_t kInitialSlotCount{16U};
+
+/// \brief The table grows when it is more than 3/4 full
+bool isOverloaded(std::size_t hash_count, std::size_t slot_count) {
+  return hash_count * 4U > slot_count * 3U;
+}
+} // namespace
+
+bool RowHashSet::insert(std::uint64_t hash) {
+  if (hash == 0U) {
+    auto inserted = !contains_zero_hash;
+    contains_zero_hash = true;
+
+    return inserted;
+  }
+
+  if (slot_list.empty() ||
+      isOverloaded(stored_hash_count + 1U, slot_list.size())) {
+    grow();
+  }
+
+  auto mask = slot_list.size() - 1U;
+
+  for (auto index = static_cast<std::size_t>(hash) & mask;;
+       index = (index + 1U) & mask) {
+
+    auto &slot = slot_list[index];
+
+    if (slot == hash) {
+      return false;
+    }
+
+    if (slot == 0U) {
+      slot = hash;
+      ++stored_hash_count;
+
+      return true;
+    }
+  }
+}
+
+bool RowHashSet::contains(std::uint64_t hash) const {
+  if (hash == 0U) {
+    return contains_zero_hash;
+  }
+
+  if (slot_list.empty()) {
+    return false;
+  }
+
+  auto mask = slot_list.size() - 1U;
+
+  for (auto index = static_cast<std::size_t>(hash) & mask;;
+       index = (index + 1U) & mask) {
+
+    auto slot = slot_list[index];
+
+    if (slot == hash) {
+      return true;
+    }
+
+    if (slot == 0U) {
+      return false;
+    }
+  }
+}
+
+std::size_t RowHashSet::size() const {
+  return stored_hash_count + (contains_zero_hash ? 1U : 0U);
+}
+
+bool RowHashSet::empty() const { return size() == 0U; }
+
+void RowHashSet::clear() {
+  slot_list = std::vector<std::uint64_t>();
+  contains_zero_hash = false;
+  stored_hash_count = 0U;
+}
+
+std::vector<std::uint64_t> RowHashSet::hashList() const {
+  std::vector<std::uint64_t> hash_list;
+  hash_list.reserve(size());
+
+  if (contains_zero_hash) {
+    hash_list.push_back(0U);
+  }
+
+  for (auto slot : slot_list) {
+    if (slot != 0U) {
+      hash_list.push_back(slot);
+    }
+  }
+
+  return hash_list;
+}
+
+std::size_t RowHashSet::memoryUsage() const {
+  return slot_list.capacity() * sizeof(std::uint64_t);
+}
+
+void RowHashSet::grow() {
+  auto old_slot_list = std::move(slot_list);
+
+  slot_list = std::vector<std::uint64_t>(
+      old_slot_list.empty() ? kInitialSlotCount : old_slot_list.size() * 2U,
+      0U);
+
+  stored_hash_count = 0U;
+
+  for (auto slot : old_slot_list) {
+    if (slot != 0U) {
+      insert(slot);
+    }
+  }
+}
+} // namespace zeek
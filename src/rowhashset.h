@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace zeek {
+/// \brief A set of 64-bit row hashes, stored in a single open addressing
+///        table
+///
+/// The hashes are expected to be uniformly distributed, so their low bits
+/// are used as the table index without further mixing. Collisions are
+/// resolved with linear probing; hashes are never removed one at a time
+class RowHashSet final {
+public:
+  /// \brief Inserts a new hash
+  /// \param hash The hash to insert
+  /// \return True if the hash was not already part of the set
+  bool insert(std::uint64_t hash);
+
+  /// \param hash The hash to look for
+  /// \return True if the hash is part of the set
+  bool contains(std::uint64_t hash) const;
+
+  /// \return How many hashes are part of the set
+  std::size_t size() const;
+
+  /// \return True if the set is empty
+  bool empty() const;
+
+  /// \brief Removes all the hashes, releasing the table
+  void clear();
+
+  /// \return All the hashes in the set, in no particular order
+  std::vector<std::uint64_t> hashList() const;
+
+  /// \return The memory used by the table, in bytes
+  std::size_t memoryUsage() const;
+
+private:
+  /// \brief Doubles the size of the table, inserting the hashes again
+  void grow();
+
+  /// \brief The table slots; zero marks an empty slot
+  std::vector<std::uint64_t> slot_list;
+
+  /// \brief Whether the zero hash, which can not be stored in the table, is
+  ///        part of the set
+  bool contains_zero_hash{false};
+
+  /// \brief How many hashes are stored in the table
+  std::size_t stored_hash_count{0U};
+};
+} // namespace zeek
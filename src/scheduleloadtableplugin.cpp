@@ -0,0 +1,68 @@
+#include "scheduleloadtableplugin.h"
+#include "queryscheduler.h"
+
+namespace zeek {
+struct ScheduleLoadTablePlugin::PrivateData final {
+  PrivateData(const QueryScheduler &query_scheduler_)
+      : query_scheduler(query_scheduler_) {}
+
+  const QueryScheduler &query_scheduler;
+};
+
+Status ScheduleLoadTablePlugin::create(Ref &obj,
+                                       const QueryScheduler &query_scheduler) {
+  obj.reset();
+
+  try {
+    auto ptr = new ScheduleLoadTablePlugin(query_scheduler);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+ScheduleLoadTablePlugin::~ScheduleLoadTablePlugin() {}
+
+const std::string &ScheduleLoadTablePlugin::name() const {
+  static const std::string kTableName{"query_schedule_load"};
+
+  return kTableName;
+}
+
+const ScheduleLoadTablePlugin::Schema &ScheduleLoadTablePlugin::schema() const {
+  // clang-format off
+  static const Schema kTableSchema = {
+    { "seconds_ago", IVirtualTable::ColumnType::Integer },
+    { "query_count", IVirtualTable::ColumnType::Integer }
+  };
+  // clang-format on
+
+  return kTableSchema;
+}
+
+Status ScheduleLoadTablePlugin::generateRowList(RowList &row_list) {
+  row_list = {};
+
+  auto load_histogram = d->query_scheduler.loadHistogram();
+
+  for (std::size_t i = 0U; i < load_histogram.size(); ++i) {
+    Row row;
+    row["seconds_ago"] = static_cast<std::int64_t>(i);
+    row["query_count"] = static_cast<std::int64_t>(load_histogram.at(i));
+
+    row_list.push_back(std::move(row));
+  }
+
+  return Status::success();
+}
+
+ScheduleLoadTablePlugin::ScheduleLoadTablePlugin(
+    const QueryScheduler &query_scheduler)
+    : d(new PrivateData(query_scheduler)) {}
+} // namespace zeek
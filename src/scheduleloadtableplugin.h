@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+
+#include <zeek/ivirtualtable.h>
+
+namespace zeek {
+class QueryScheduler;
+
+/// \brief A virtual table plugin that exposes how many scheduled queries
+///        the query scheduler has started in each of the last 60 seconds
+class ScheduleLoadTablePlugin final : public IVirtualTable {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param query_scheduler The query scheduler to inspect
+  /// \return A Status object
+  static Status create(Ref &obj, const QueryScheduler &query_scheduler);
+
+  /// \brief Destructor
+  virtual ~ScheduleLoadTablePlugin() override;
+
+  /// \return The table name
+  virtual const std::string &name() const override;
+
+  /// \return The table schema
+  virtual const Schema &schema() const override;
+
+  /// \brief Generates one row for each of the last 60 seconds
+  /// \param row_list Where the generated rows are stored
+  /// \return A Status object
+  virtual Status generateRowList(RowList &row_list) override;
+
+protected:
+  /// \brief Constructor
+  /// \param query_scheduler The query scheduler to inspect
+  ScheduleLoadTablePlugin(const QueryScheduler &query_scheduler);
+};
+} // namespace zeek
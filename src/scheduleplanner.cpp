@@ -0,0 +1,123 @@
+#include "scheduleplanner.h"
+
+#include <algorithm>
+
+#include <xxhash.h>
+
+namespace zeek {
+namespace {
+const std::chrono::milliseconds kSlotWidth{1000};
+const std::size_t kMaxSlotCount{60U};
+} // namespace
+
+SchedulePlanner::SchedulePlanner(const std::string &host_identifier,
+                                 TimePoint epoch_)
+    : host_seed(XXH64(host_identifier.data(), host_identifier.size(), 0U)),
+      epoch(epoch_) {}
+
+SchedulePlanner::Placement
+SchedulePlanner::place(const std::string &query,
+                       std::chrono::milliseconds interval,
+                       TimePoint current_time) {
+  Placement placement;
+  placement.interval = interval;
+
+  // Sub-second queries keep running one interval after they are added
+  if (interval < kSlotWidth) {
+    placement.phase_origin = current_time;
+    return placement;
+  }
+
+  auto slot_count = std::min(
+      static_cast<std::size_t>(interval / kSlotWidth), kMaxSlotCount);
+
+  auto &slot_load = slot_load_map[interval.count()];
+  if (slot_load.empty()) {
+    slot_load.resize(slot_count, 0U);
+  }
+
+  auto query_hash = XXH64(query.data(), query.size(), host_seed);
+
+  // Start from the preferred slot, and move to the least loaded one
+  auto preferred_slot = static_cast<std::size_t>(query_hash % slot_count);
+  auto slot = preferred_slot;
+
+  for (std::size_t i = 1U; i < slot_count; ++i) {
+    auto candidate_slot = (preferred_slot + i) % slot_count;
+
+    if (slot_load.at(candidate_slot) < slot_load.at(slot)) {
+      slot = candidate_slot;
+    }
+  }
+
+  ++slot_load.at(slot);
+
+  // Also spread the queries sharing the same slot
+  auto slot_duration = interval / static_cast<std::int64_t>(slot_count);
+  auto slot_offset = std::chrono::milliseconds(
+      static_cast<std::int64_t>((query_hash >> 32U) %
+                                static_cast<std::uint64_t>(
+                                    slot_duration.count())));
+
+  placement.phase_origin =
+      epoch + slot_duration * static_cast<std::int64_t>(slot) + slot_offset;
+
+  placement.slot = slot;
+  return placement;
+}
+
+void SchedulePlanner::release(const Placement &placement) {
+  if (!placement.slot.has_value()) {
+    return;
+  }
+
+  auto slot_load_it = slot_load_map.find(placement.interval.count());
+  if (slot_load_it == slot_load_map.end()) {
+    return;
+  }
+
+  auto &slot_load = slot_load_it->second;
+
+  auto &query_count = slot_load.at(placement.slot.value());
+  if (query_count > 0U) {
+    --query_count;
+  }
+
+  auto empty = std::all_of(slot_load.begin(), slot_load.end(),
+                           [](std::size_t count) { return count == 0U; });
+
+  if (empty) {
+    slot_load_map.erase(slot_load_it);
+  }
+}
+
+std::vector<std::size_t>
+SchedulePlanner::slotLoad(std::chrono::milliseconds interval) const {
+  auto slot_load_it = slot_load_map.find(interval.count());
+  if (slot_load_it == slot_load_map.end()) {
+    return {};
+  }
+
+  return slot_load_it->second;
+}
+
+SchedulePlanner::TimePoint
+SchedulePlanner::nextDeadline(const Placement &placement,
+                              TimePoint current_time) {
+  auto interval =
+      std::chrono::duration_cast<TimePoint::duration>(placement.interval);
+
+  auto elapsed_time = current_time - placement.phase_origin;
+
+  // Round towards negative infinity, since the phase origin can be in the
+  // future
+  auto period_count = elapsed_time / interval;
+  if (elapsed_time < TimePoint::duration::zero() &&
+      elapsed_time % interval != TimePoint::duration::zero()) {
+
+    --period_count;
+  }
+
+  return placement.phase_origin + interval * (period_count + 1);
+}
+} // namespace zeek
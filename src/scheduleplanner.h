@@ -0,0 +1,80 @@
+#pragma once
+
+#include "taskschedule.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace zeek {
+/// \brief Chooses the phase of each periodic query within its interval, so
+///        that queries sharing the same interval do not all run at once
+///
+/// Each interval is divided into one-second slots (at most 60). A query
+/// prefers the slot selected by hashing the host identifier together with
+/// the query text, so the placement is the same across restarts and
+/// different across hosts. When another slot has fewer queries, the least
+/// loaded slot is used instead. Intervals shorter than one second are not
+/// staggered
+class SchedulePlanner final {
+public:
+  /// \brief A point in time, taken from a monotonic clock
+  using TimePoint = TaskSchedule::TimePoint;
+
+  /// \brief Where a query has been placed within its interval
+  struct Placement final {
+    /// \brief The query interval
+    std::chrono::milliseconds interval{0};
+
+    /// \brief The query runs at phase_origin + k * interval
+    TimePoint phase_origin;
+
+    /// \brief The slot used by the query; not set when the query has not
+    ///        been staggered
+    std::optional<std::size_t> slot;
+  };
+
+  /// \brief Constructor
+  /// \param host_identifier Used to compute the preferred slot of each query
+  /// \param epoch The time the slots are aligned to
+  SchedulePlanner(const std::string &host_identifier, TimePoint epoch);
+
+  /// \brief Places a new periodic query
+  /// \param query The query text
+  /// \param interval The query interval
+  /// \param current_time The current time
+  /// \return The query placement; must be passed to release() when the query
+  ///         is removed
+  Placement place(const std::string &query, std::chrono::milliseconds interval,
+                  TimePoint current_time);
+
+  /// \brief Releases the slot used by a query
+  /// \param placement The placement returned by place()
+  void release(const Placement &placement);
+
+  /// \param interval A query interval
+  /// \return How many queries have been placed in each slot for the given
+  ///         interval
+  std::vector<std::size_t> slotLoad(std::chrono::milliseconds interval) const;
+
+  /// \param placement A query placement
+  /// \param current_time The current time
+  /// \return The first execution time that follows current_time
+  static TimePoint nextDeadline(const Placement &placement,
+                                TimePoint current_time);
+
+private:
+  /// \brief The seed used to compute the preferred slot of each query
+  std::uint64_t host_seed{0U};
+
+  /// \brief The time the slots are aligned to
+  TimePoint epoch;
+
+  /// \brief How many queries have been placed in each slot, by interval
+  std::unordered_map<std::chrono::milliseconds::rep, std::vector<std::size_t>>
+      slot_load_map;
+};
+} // namespace zeek
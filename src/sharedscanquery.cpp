@@ -0,0 +1,991 @@
+#include "sharedscanquery.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace zeek {
+namespace {
+const std::size_t kMaxExpressionDepth{64U};
+
+/// \brief A single token of a SQL statement
+struct Token final {
+  enum class Type { Identifier, Integer, Real, String, Symbol, End };
+
+  Type type{Type::End};
+  std::string value;
+};
+
+using TokenList = std::vector<Token>;
+
+/// \brief A literal value, along with the conversions that SQLite would
+///        apply when comparing it against a column
+struct Literal final {
+  IVirtualTable::Variant value;
+
+  /// \brief The numeric value of a string literal, if it looks like a number
+  std::optional<IVirtualTable::Variant> numeric_value;
+
+  /// \brief The literal value, as text
+  std::string text_value;
+};
+
+/// \brief A single node of the compiled WHERE clause
+struct Node final {
+  enum class Type { And, Or, Not, Comparison, Like, IsNull };
+  enum class Operator {
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+  };
+
+  Type type{Type::Comparison};
+
+  std::size_t left{0U};
+  std::size_t right{0U};
+
+  std::size_t column_id{0U};
+  Operator op{Operator::Equal};
+  Literal literal;
+
+  /// \brief Set for NOT LIKE and IS NOT NULL
+  bool negated{false};
+};
+
+/// \brief The compiled form of a shared scan query
+struct CompiledQuery final {
+  std::string table_name;
+
+  /// \brief The columns referenced by the query; nodes and projections
+  ///        refer to them by index
+  std::vector<std::string> column_name_list;
+
+  bool select_all{false};
+  std::vector<std::size_t> projection;
+
+  std::vector<Node> node_list;
+  std::optional<std::size_t> where_clause;
+};
+
+/// \brief SQL three-valued logic
+enum class Truth { False, True, Unknown };
+
+bool equalsIgnoreCase(const std::string &left, const std::string &right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0U; i < left.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(left.at(i))) !=
+        std::tolower(static_cast<unsigned char>(right.at(i)))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool isReservedWord(const std::string &word) {
+  static const char *kReservedWordList[] = {
+      "SELECT", "FROM", "WHERE", "AND", "OR", "NOT", "IS", "NULL", "LIKE"};
+
+  for (const auto &reserved_word : kReservedWordList) {
+    if (equalsIgnoreCase(word, reserved_word)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/// \brief Renders a real value the way SQLite converts it to text (the
+///        "%!.15g" format): 15 significant digits, and always a decimal
+///        point
+std::string formatReal(double value) {
+  if (std::isinf(value)) {
+    return value < 0.0 ? "-Inf" : "Inf";
+  }
+
+  // SQLite does not print the sign of a negative zero
+  if (value == 0.0) {
+    value = 0.0;
+  }
+
+  char buffer[32] = {};
+  std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+
+  std::string text(buffer);
+  if (text.find('.') != std::string::npos) {
+    return text;
+  }
+
+  auto exponent_position = text.find('e');
+  if (exponent_position == std::string::npos) {
+    return text + ".0";
+  }
+
+  return text.insert(exponent_position, ".0");
+}
+
+/// \brief Converts a value to text, the way SQLite does before applying
+///        LIKE or comparing it against a text column
+std::string toString(const IVirtualTable::Variant &value) {
+  if (std::holds_alternative<std::string>(value)) {
+    return std::get<std::string>(value);
+
+  } else if (std::holds_alternative<std::int64_t>(value)) {
+    return std::to_string(std::get<std::int64_t>(value));
+
+  } else {
+    return formatReal(std::get<double>(value));
+  }
+}
+
+Status tokenize(TokenList &token_list, const std::string &query) {
+  token_list = {};
+
+  auto isDigitAt = [&query](std::size_t index) -> bool {
+    return index < query.size() &&
+           std::isdigit(static_cast<unsigned char>(query.at(index)));
+  };
+
+  std::size_t i{0U};
+
+  while (i < query.size()) {
+    auto c = static_cast<unsigned char>(query.at(i));
+    if (std::isspace(c)) {
+      ++i;
+      continue;
+    }
+
+    Token token;
+    auto start = i;
+
+    if (std::isalpha(c) || c == '_') {
+      while (i < query.size() &&
+             (std::isalnum(static_cast<unsigned char>(query.at(i))) ||
+              query.at(i) == '_')) {
+        ++i;
+      }
+
+      token.type = Token::Type::Identifier;
+      token.value = query.substr(start, i - start);
+
+    } else if (isDigitAt(i) || (c == '.' && isDigitAt(i + 1U))) {
+      token.type = Token::Type::Integer;
+
+      while (isDigitAt(i)) {
+        ++i;
+      }
+
+      if (i < query.size() && query.at(i) == '.') {
+        token.type = Token::Type::Real;
+
+        ++i;
+        while (isDigitAt(i)) {
+          ++i;
+        }
+      }
+
+      if (i < query.size() && (query.at(i) == 'e' || query.at(i) == 'E')) {
+        token.type = Token::Type::Real;
+
+        ++i;
+        if (i < query.size() && (query.at(i) == '+' || query.at(i) == '-')) {
+          ++i;
+        }
+
+        if (!isDigitAt(i)) {
+          return Status::failure("Invalid numeric literal");
+        }
+
+        while (isDigitAt(i)) {
+          ++i;
+        }
+      }
+
+      token.value = query.substr(start, i - start);
+
+    } else if (c == '\'') {
+      token.type = Token::Type::String;
+
+      for (++i;; ++i) {
+        if (i >= query.size()) {
+          return Status::failure("Unterminated string literal");
+        }
+
+        if (query.at(i) != '\'') {
+          token.value.push_back(query.at(i));
+          continue;
+        }
+
+        // Quotes are escaped by doubling them
+        if (i + 1U < query.size() && query.at(i + 1U) == '\'') {
+          token.value.push_back('\'');
+          ++i;
+          continue;
+        }
+
+        ++i;
+        break;
+      }
+
+    } else {
+      static const char *kSymbolList[] = {"==", "!=", "<>", "<=", ">=", "=",
+                                          "<",  ">",  "(",  ")",  ",",  "*",
+                                          ";",  "-"};
+
+      for (const auto &symbol : kSymbolList) {
+        if (query.compare(i, std::char_traits<char>::length(symbol), symbol) ==
+            0) {
+
+          token.value = symbol;
+          break;
+        }
+      }
+
+      if (token.value.empty()) {
+        return Status::failure("Unsupported character: " +
+                               std::string(1, query.at(i)));
+      }
+
+      token.type = Token::Type::Symbol;
+      i += token.value.size();
+    }
+
+    token_list.push_back(std::move(token));
+  }
+
+  token_list.push_back(Token{});
+  return Status::success();
+}
+
+/// \brief A recursive descent parser for the supported SQL subset
+class Parser final {
+public:
+  Parser(CompiledQuery &compiled_query_, const TokenList &token_list_)
+      : compiled_query(compiled_query_), token_list(token_list_) {}
+
+  Status parse() {
+    if (!acceptKeyword("SELECT")) {
+      return Status::failure("Expected SELECT");
+    }
+
+    if (acceptSymbol("*")) {
+      compiled_query.select_all = true;
+
+    } else {
+      do {
+        std::size_t column_id{0U};
+
+        auto status = parseColumn(column_id);
+        if (!status.succeeded()) {
+          return status;
+        }
+
+        compiled_query.projection.push_back(column_id);
+      } while (acceptSymbol(","));
+    }
+
+    if (!acceptKeyword("FROM")) {
+      return Status::failure("Expected FROM");
+    }
+
+    const auto &table_name = peek();
+    if (table_name.type != Token::Type::Identifier ||
+        isReservedWord(table_name.value)) {
+      return Status::failure("Expected a table name");
+    }
+
+    compiled_query.table_name = next().value;
+
+    if (acceptKeyword("WHERE")) {
+      std::size_t root{0U};
+
+      auto status = parseOr(root, 0U);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      compiled_query.where_clause = root;
+    }
+
+    acceptSymbol(";");
+
+    if (peek().type != Token::Type::End) {
+      return Status::failure("Unexpected token: " + peek().value);
+    }
+
+    return Status::success();
+  }
+
+private:
+  const Token &peek() const { return token_list.at(position); }
+
+  const Token &next() {
+    const auto &token = token_list.at(position);
+    if (token.type != Token::Type::End) {
+      ++position;
+    }
+
+    return token;
+  }
+
+  bool acceptKeyword(const char *keyword) {
+    const auto &token = peek();
+    if (token.type != Token::Type::Identifier ||
+        !equalsIgnoreCase(token.value, keyword)) {
+      return false;
+    }
+
+    next();
+    return true;
+  }
+
+  bool acceptSymbol(const char *symbol) {
+    const auto &token = peek();
+    if (token.type != Token::Type::Symbol || token.value != symbol) {
+      return false;
+    }
+
+    next();
+    return true;
+  }
+
+  Status parseColumn(std::size_t &column_id) {
+    const auto &token = peek();
+    if (token.type != Token::Type::Identifier || isReservedWord(token.value)) {
+      return Status::failure("Expected a column name");
+    }
+
+    auto &column_name_list = compiled_query.column_name_list;
+
+    for (column_id = 0U; column_id < column_name_list.size(); ++column_id) {
+      if (equalsIgnoreCase(column_name_list.at(column_id), token.value)) {
+        next();
+        return Status::success();
+      }
+    }
+
+    column_name_list.push_back(next().value);
+    return Status::success();
+  }
+
+  Status parseOr(std::size_t &node_index, std::size_t depth) {
+    auto status = parseAnd(node_index, depth);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    while (acceptKeyword("OR")) {
+      Node node;
+      node.type = Node::Type::Or;
+      node.left = node_index;
+
+      status = parseAnd(node.right, depth);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      node_index = addNode(std::move(node));
+    }
+
+    return Status::success();
+  }
+
+  Status parseAnd(std::size_t &node_index, std::size_t depth) {
+    auto status = parseNot(node_index, depth);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    while (acceptKeyword("AND")) {
+      Node node;
+      node.type = Node::Type::And;
+      node.left = node_index;
+
+      status = parseNot(node.right, depth);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      node_index = addNode(std::move(node));
+    }
+
+    return Status::success();
+  }
+
+  Status parseNot(std::size_t &node_index, std::size_t depth) {
+    if (depth >= kMaxExpressionDepth) {
+      return Status::failure("The expression is too complex");
+    }
+
+    if (acceptKeyword("NOT")) {
+      Node node;
+      node.type = Node::Type::Not;
+
+      auto status = parseNot(node.left, depth + 1U);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      node_index = addNode(std::move(node));
+      return Status::success();
+    }
+
+    if (acceptSymbol("(")) {
+      auto status = parseOr(node_index, depth + 1U);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      if (!acceptSymbol(")")) {
+        return Status::failure("Expected )");
+      }
+
+      return Status::success();
+    }
+
+    return parsePredicate(node_index);
+  }
+
+  Status parsePredicate(std::size_t &node_index) {
+    Node node;
+
+    auto status = parseColumn(node.column_id);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    if (acceptKeyword("IS")) {
+      node.type = Node::Type::IsNull;
+      node.negated = acceptKeyword("NOT");
+
+      if (!acceptKeyword("NULL")) {
+        return Status::failure("Expected NULL");
+      }
+
+    } else if (acceptKeyword("NOT")) {
+      node.type = Node::Type::Like;
+      node.negated = true;
+
+      if (!acceptKeyword("LIKE")) {
+        return Status::failure("Expected LIKE");
+      }
+
+      status = parseLikePattern(node.literal);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+    } else if (acceptKeyword("LIKE")) {
+      node.type = Node::Type::Like;
+
+      status = parseLikePattern(node.literal);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+    } else {
+      static const std::pair<const char *, Node::Operator> kOperatorList[] = {
+          {"=", Node::Operator::Equal},
+          {"==", Node::Operator::Equal},
+          {"!=", Node::Operator::NotEqual},
+          {"<>", Node::Operator::NotEqual},
+          {"<", Node::Operator::Less},
+          {"<=", Node::Operator::LessEqual},
+          {">", Node::Operator::Greater},
+          {">=", Node::Operator::GreaterEqual}};
+
+      bool operator_found{false};
+
+      for (const auto &p : kOperatorList) {
+        if (acceptSymbol(p.first)) {
+          node.op = p.second;
+          operator_found = true;
+          break;
+        }
+      }
+
+      if (!operator_found) {
+        return Status::failure("Expected a comparison operator");
+      }
+
+      node.type = Node::Type::Comparison;
+
+      status = parseLiteral(node.literal);
+      if (!status.succeeded()) {
+        return status;
+      }
+    }
+
+    node_index = addNode(std::move(node));
+    return Status::success();
+  }
+
+  Status parseLikePattern(Literal &literal) {
+    if (peek().type != Token::Type::String) {
+      return Status::failure("Expected a string pattern");
+    }
+
+    literal.text_value = next().value;
+    literal.value = literal.text_value;
+
+    return Status::success();
+  }
+
+  Status parseLiteral(Literal &literal) {
+    auto negative = acceptSymbol("-");
+
+    const auto &token = next();
+
+    if (token.type == Token::Type::String && !negative) {
+      literal.value = token.value;
+      literal.text_value = token.value;
+
+      // Like SQLite, compare the text as a number when the column is
+      // numeric and the text looks like one
+      if (!token.value.empty()) {
+        char *end_ptr{nullptr};
+
+        auto integer_value = std::strtoll(token.value.c_str(), &end_ptr, 10);
+        if (*end_ptr == '\0') {
+          literal.numeric_value = static_cast<std::int64_t>(integer_value);
+
+        } else {
+          auto real_value = std::strtod(token.value.c_str(), &end_ptr);
+          if (*end_ptr == '\0') {
+            literal.numeric_value = real_value;
+          }
+        }
+      }
+
+      return Status::success();
+    }
+
+    auto text_value = (negative ? "-" : "") + token.value;
+
+    if (token.type == Token::Type::Integer) {
+      errno = 0;
+      auto integer_value = std::strtoll(text_value.c_str(), nullptr, 10);
+
+      // Like SQLite, integers that do not fit are read as reals
+      if (errno == ERANGE) {
+        literal.value = std::strtod(text_value.c_str(), nullptr);
+      } else {
+        literal.value = static_cast<std::int64_t>(integer_value);
+      }
+
+    } else if (token.type == Token::Type::Real) {
+      literal.value = std::strtod(text_value.c_str(), nullptr);
+
+    } else {
+      return Status::failure("Expected a literal value");
+    }
+
+    // Text columns are compared against the literal as SQLite renders it
+    literal.text_value = toString(literal.value);
+    return Status::success();
+  }
+
+  std::size_t addNode(Node node) {
+    compiled_query.node_list.push_back(std::move(node));
+    return compiled_query.node_list.size() - 1U;
+  }
+
+  CompiledQuery &compiled_query;
+  const TokenList &token_list;
+  std::size_t position{0U};
+};
+
+bool isNumber(const IVirtualTable::Variant &value) {
+  return !std::holds_alternative<std::string>(value);
+}
+
+double toDouble(const IVirtualTable::Variant &value) {
+  if (std::holds_alternative<std::int64_t>(value)) {
+    return static_cast<double>(std::get<std::int64_t>(value));
+  }
+
+  return std::get<double>(value);
+}
+
+template <typename Type>
+int compareValues(const Type &left, const Type &right) {
+  if (left < right) {
+    return -1;
+  }
+
+  return right < left ? 1 : 0;
+}
+
+int compareNumbers(const IVirtualTable::Variant &left,
+                   const IVirtualTable::Variant &right) {
+  if (std::holds_alternative<std::int64_t>(left) &&
+      std::holds_alternative<std::int64_t>(right)) {
+    return compareValues(std::get<std::int64_t>(left),
+                         std::get<std::int64_t>(right));
+  }
+
+  return compareValues(toDouble(left), toDouble(right));
+}
+
+int compareColumnValue(const IVirtualTable::Variant &column_value,
+                       const Literal &literal) {
+  if (!isNumber(column_value)) {
+    return compareValues(std::get<std::string>(column_value),
+                         literal.text_value);
+  }
+
+  if (isNumber(literal.value)) {
+    return compareNumbers(column_value, literal.value);
+  }
+
+  if (literal.numeric_value.has_value()) {
+    return compareNumbers(column_value, literal.numeric_value.value());
+  }
+
+  // Numbers always sort before text
+  return -1;
+}
+
+/// \return The size of the UTF-8 character at the given offset. Like
+///         SQLite, a lead byte takes all the continuation bytes that follow
+///         it, and any other byte is a character of its own
+std::size_t utf8CharacterSize(const std::string &text, std::size_t offset) {
+  std::size_t size{1U};
+
+  if (static_cast<unsigned char>(text.at(offset)) >= 0xC0U) {
+    while (offset + size < text.size() &&
+           (static_cast<unsigned char>(text.at(offset + size)) & 0xC0U) ==
+               0x80U) {
+      ++size;
+    }
+  }
+
+  return size;
+}
+
+/// \brief LIKE pattern matching, with the semantics of the SQLite built-in:
+///        case insensitive for ASCII characters only, and '_' matches a
+///        single UTF-8 character
+bool matchLikePattern(const std::string &text, const std::string &pattern) {
+  auto characterEquals = [&text, &pattern](std::size_t text_index,
+                                           std::size_t text_size,
+                                           std::size_t pattern_index,
+                                           std::size_t pattern_size) -> bool {
+    if (text_size != pattern_size) {
+      return false;
+    }
+
+    if (text_size == 1U) {
+      auto text_char = static_cast<unsigned char>(text.at(text_index));
+      auto pattern_char = static_cast<unsigned char>(pattern.at(pattern_index));
+
+      return text_char < 0x80U && pattern_char < 0x80U
+                 ? std::tolower(text_char) == std::tolower(pattern_char)
+                 : text_char == pattern_char;
+    }
+
+    return text.compare(text_index, text_size, pattern, pattern_index,
+                        pattern_size) == 0;
+  };
+
+  std::size_t text_index{0U};
+  std::size_t pattern_index{0U};
+
+  std::optional<std::size_t> wildcard_pattern_index;
+  std::size_t wildcard_text_index{0U};
+
+  while (text_index < text.size()) {
+    auto text_size = utf8CharacterSize(text, text_index);
+
+    if (pattern_index < pattern.size() && pattern.at(pattern_index) == '%') {
+      wildcard_pattern_index = pattern_index++;
+      wildcard_text_index = text_index;
+
+      continue;
+    }
+
+    if (pattern_index < pattern.size()) {
+      auto pattern_size = utf8CharacterSize(pattern, pattern_index);
+
+      if (pattern.at(pattern_index) == '_' ||
+          characterEquals(text_index, text_size, pattern_index,
+                          pattern_size)) {
+        pattern_index += pattern_size;
+        text_index += text_size;
+
+        continue;
+      }
+    }
+
+    if (!wildcard_pattern_index.has_value()) {
+      return false;
+    }
+
+    // Let the last wildcard consume one more character
+    pattern_index = wildcard_pattern_index.value() + 1U;
+
+    wildcard_text_index += utf8CharacterSize(text, wildcard_text_index);
+    text_index = wildcard_text_index;
+  }
+
+  while (pattern_index < pattern.size() && pattern.at(pattern_index) == '%') {
+    ++pattern_index;
+  }
+
+  return pattern_index == pattern.size();
+}
+
+Truth toTruth(bool value) { return value ? Truth::True : Truth::False; }
+
+Truth evaluateNode(const CompiledQuery &compiled_query,
+                   const std::vector<std::size_t> &column_index_list,
+                   const IVirtualDatabase::OutputRow &row,
+                   std::size_t node_index) {
+
+  const auto &node = compiled_query.node_list.at(node_index);
+
+  switch (node.type) {
+  case Node::Type::And: {
+    auto left =
+        evaluateNode(compiled_query, column_index_list, row, node.left);
+    if (left == Truth::False) {
+      return Truth::False;
+    }
+
+    auto right =
+        evaluateNode(compiled_query, column_index_list, row, node.right);
+    if (right == Truth::False) {
+      return Truth::False;
+    }
+
+    return left == Truth::True && right == Truth::True ? Truth::True
+                                                       : Truth::Unknown;
+  }
+
+  case Node::Type::Or: {
+    auto left =
+        evaluateNode(compiled_query, column_index_list, row, node.left);
+    if (left == Truth::True) {
+      return Truth::True;
+    }
+
+    auto right =
+        evaluateNode(compiled_query, column_index_list, row, node.right);
+    if (right == Truth::True) {
+      return Truth::True;
+    }
+
+    return left == Truth::False && right == Truth::False ? Truth::False
+                                                         : Truth::Unknown;
+  }
+
+  case Node::Type::Not: {
+    auto value =
+        evaluateNode(compiled_query, column_index_list, row, node.left);
+
+    if (value == Truth::Unknown) {
+      return Truth::Unknown;
+    }
+
+    return toTruth(value == Truth::False);
+  }
+
+  default:
+    break;
+  }
+
+  const auto &column_value =
+      row.at(column_index_list.at(node.column_id)).data;
+
+  if (node.type == Node::Type::IsNull) {
+    return toTruth(column_value.has_value() == node.negated);
+  }
+
+  if (!column_value.has_value()) {
+    return Truth::Unknown;
+  }
+
+  if (node.type == Node::Type::Like) {
+    return toTruth(matchLikePattern(toString(column_value.value()),
+                                    node.literal.text_value) != node.negated);
+  }
+
+  auto comparison = compareColumnValue(column_value.value(), node.literal);
+
+  switch (node.op) {
+  case Node::Operator::Equal:
+    return toTruth(comparison == 0);
+
+  case Node::Operator::NotEqual:
+    return toTruth(comparison != 0);
+
+  case Node::Operator::Less:
+    return toTruth(comparison < 0);
+
+  case Node::Operator::LessEqual:
+    return toTruth(comparison <= 0);
+
+  case Node::Operator::Greater:
+    return toTruth(comparison > 0);
+
+  case Node::Operator::GreaterEqual:
+    return toTruth(comparison >= 0);
+  }
+
+  return Truth::Unknown;
+}
+
+/// \brief Finds the referenced columns in the given row
+Status resolveColumns(std::vector<std::size_t> &column_index_list,
+                      const CompiledQuery &compiled_query,
+                      const IVirtualDatabase::OutputRow &row) {
+  column_index_list.clear();
+  column_index_list.reserve(compiled_query.column_name_list.size());
+
+  for (const auto &column_name : compiled_query.column_name_list) {
+    std::size_t column_index{0U};
+
+    for (; column_index < row.size(); ++column_index) {
+      if (equalsIgnoreCase(row.at(column_index).name, column_name)) {
+        break;
+      }
+    }
+
+    if (column_index == row.size()) {
+      return Status::failure("no such column: " + column_name);
+    }
+
+    column_index_list.push_back(column_index);
+  }
+
+  return Status::success();
+}
+
+/// \return True if the resolved column indexes can be used for the given
+///         row as well
+bool hasSameLayout(const IVirtualDatabase::OutputRow &row,
+                   const IVirtualDatabase::OutputRow &layout_row,
+                   const std::vector<std::size_t> &column_index_list) {
+  if (row.size() != layout_row.size()) {
+    return false;
+  }
+
+  for (auto column_index : column_index_list) {
+    if (row.at(column_index).name != layout_row.at(column_index).name) {
+      return false;
+    }
+  }
+
+  return true;
+}
+} // namespace
+
+struct SharedScanQuery::PrivateData final {
+  CompiledQuery compiled_query;
+};
+
+Status SharedScanQuery::create(Ref &obj, const std::string &query) {
+  try {
+    obj.reset();
+
+    auto ptr = new SharedScanQuery(query);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+SharedScanQuery::~SharedScanQuery() {}
+
+const std::string &SharedScanQuery::tableName() const {
+  return d->compiled_query.table_name;
+}
+
+Status SharedScanQuery::execute(
+    IVirtualDatabase::QueryOutput &output,
+    const IVirtualDatabase::QueryOutput &table_scan) const {
+
+  if (table_scan.empty()) {
+    return Status::success();
+  }
+
+  const auto &compiled_query = d->compiled_query;
+
+  // The rows of a table scan normally share the same layout; the column
+  // indexes are only resolved again when a row does not match the row
+  // they have been resolved on
+  std::vector<std::size_t> column_index_list;
+  const IVirtualDatabase::OutputRow *layout_row{nullptr};
+
+  for (const auto &row : table_scan) {
+    if (layout_row == nullptr ||
+        !hasSameLayout(row, *layout_row, column_index_list)) {
+      auto status = resolveColumns(column_index_list, compiled_query, row);
+      if (!status.succeeded()) {
+        return status;
+      }
+
+      layout_row = &row;
+    }
+
+    if (compiled_query.where_clause.has_value() &&
+        evaluateNode(compiled_query, column_index_list, row,
+                     compiled_query.where_clause.value()) != Truth::True) {
+      continue;
+    }
+
+    if (compiled_query.select_all) {
+      output.push_back(row);
+      continue;
+    }
+
+    IVirtualDatabase::OutputRow output_row;
+    output_row.reserve(compiled_query.projection.size());
+
+    // Like SQLite, use the column names declared by the table, whatever
+    // their spelling in the query
+    for (auto column_id : compiled_query.projection) {
+      output_row.push_back(row.at(column_index_list.at(column_id)));
+    }
+
+    output.push_back(std::move(output_row));
+  }
+
+  return Status::success();
+}
+
+SharedScanQuery::SharedScanQuery(const std::string &query)
+    : d(new PrivateData) {
+
+  TokenList token_list;
+  auto status = tokenize(token_list, query);
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  Parser parser(d->compiled_query, token_list);
+
+  status = parser.parse();
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+} // namespace zeek
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <zeek/ivirtualdatabase.h>
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief A single-table filter query that can be evaluated directly on the
+///        rows of a table scan, without going through SQLite
+///
+/// Only a small subset of SQL is supported:
+///
+///   SELECT <* | column[, column...]> FROM <table> [WHERE <expression>]
+///
+/// Expressions are made of column comparisons against literals (=, ==, !=,
+/// <>, <, <=, >, >=), LIKE, NOT LIKE, IS NULL, IS NOT NULL, combined with
+/// AND, OR, NOT and parentheses. The results match what SQLite returns for
+/// the same query: values are converted to text the way SQLite does, LIKE
+/// is case insensitive for ASCII characters only, with '_' matching a single
+/// UTF-8 character, and the output columns take the names declared by the
+/// table
+class SharedScanQuery final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to a shared scan query object
+  using Ref = std::unique_ptr<SharedScanQuery>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param query The SQL statement to compile
+  /// \return A Status object; fails if the query is not supported
+  static Status create(Ref &obj, const std::string &query);
+
+  /// \brief Destructor
+  ~SharedScanQuery();
+
+  /// \return The name of the table this query reads from
+  const std::string &tableName() const;
+
+  /// \brief Evaluates the query against the output of a full table scan
+  /// \param output Where the matching rows are appended
+  /// \param table_scan The output of `SELECT * FROM <table>`
+  /// \return A Status object
+  Status execute(IVirtualDatabase::QueryOutput &output,
+                 const IVirtualDatabase::QueryOutput &table_scan) const;
+
+  SharedScanQuery(const SharedScanQuery &) = delete;
+  SharedScanQuery &operator=(const SharedScanQuery &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param query The SQL statement to compile
+  SharedScanQuery(const std::string &query);
+};
+} // namespace zeek
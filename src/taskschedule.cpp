@@ -0,0 +1,116 @@
+#include "taskschedule.h"
+
+#include <cassert>
+
+namespace zeek {
+void TaskSchedule::schedule(TaskId task_id, TimePoint deadline) {
+  auto position_it = position_map.find(task_id);
+
+  if (position_it == position_map.end()) {
+    auto position = heap.size();
+
+    heap.push_back({deadline, task_id});
+    position_map.insert({task_id, position});
+
+    siftUp(position);
+    return;
+  }
+
+  auto position = position_it->second;
+  heap[position].deadline = deadline;
+
+  siftUp(position);
+  siftDown(position_map.at(task_id));
+}
+
+bool TaskSchedule::remove(TaskId task_id) {
+  auto position_it = position_map.find(task_id);
+  if (position_it == position_map.end()) {
+    return false;
+  }
+
+  auto position = position_it->second;
+  auto last_position = heap.size() - 1U;
+
+  if (position != last_position) {
+    swapEntries(position, last_position);
+  }
+
+  heap.pop_back();
+  position_map.erase(task_id);
+
+  if (position < heap.size()) {
+    siftUp(position);
+    siftDown(position_map.at(heap[position].task_id));
+  }
+
+  return true;
+}
+
+bool TaskSchedule::empty() const { return heap.empty(); }
+
+std::size_t TaskSchedule::size() const { return heap.size(); }
+
+TaskSchedule::TaskId TaskSchedule::nextTask() const {
+  assert(!heap.empty() && "The task schedule is empty");
+  return heap.front().task_id;
+}
+
+TaskSchedule::TimePoint TaskSchedule::nextDeadline() const {
+  assert(!heap.empty() && "The task schedule is empty");
+  return heap.front().deadline;
+}
+
+bool TaskSchedule::lessThan(std::size_t first, std::size_t second) const {
+  const auto &first_entry = heap[first];
+  const auto &second_entry = heap[second];
+
+  if (first_entry.deadline != second_entry.deadline) {
+    return first_entry.deadline < second_entry.deadline;
+  }
+
+  return first_entry.task_id < second_entry.task_id;
+}
+
+void TaskSchedule::swapEntries(std::size_t first, std::size_t second) {
+  std::swap(heap[first], heap[second]);
+
+  position_map[heap[first].task_id] = first;
+  position_map[heap[second].task_id] = second;
+}
+
+void TaskSchedule::siftUp(std::size_t position) {
+  while (position > 0U) {
+    auto parent = (position - 1U) / 2U;
+    if (!lessThan(position, parent)) {
+      break;
+    }
+
+    swapEntries(position, parent);
+    position = parent;
+  }
+}
+
+void TaskSchedule::siftDown(std::size_t position) {
+  for (;;) {
+    auto smallest = position;
+    auto left = (2U * position) + 1U;
+    auto right = left + 1U;
+
+    if (left < heap.size() && lessThan(left, smallest)) {
+      smallest = left;
+    }
+
+    if (right < heap.size() && lessThan(right, smallest)) {
+      smallest = right;
+    }
+
+    if (smallest == position) {
+      break;
+    }
+
+    swapEntries(position, smallest);
+    position = smallest;
+  }
+}
+} // namespace zeek
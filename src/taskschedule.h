@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zeek {
+/// \brief An indexed binary min-heap that orders scheduled tasks by their
+///        next deadline
+///
+/// Insertion, removal and rescheduling are O(log n); the task with the
+/// earliest deadline is available in O(1). Tasks sharing the same deadline
+/// are returned in task id order
+class TaskSchedule final {
+public:
+  /// \brief A unique task identifier
+  using TaskId = std::uint64_t;
+
+  /// \brief A point in time, taken from a monotonic clock
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  /// \brief Adds a new task, or updates the deadline of an existing one
+  /// \param task_id The task identifier
+  /// \param deadline When the task should be executed
+  void schedule(TaskId task_id, TimePoint deadline);
+
+  /// \brief Removes the given task
+  /// \param task_id The task identifier
+  /// \return True if the task was found, false otherwise
+  bool remove(TaskId task_id);
+
+  /// \return True if there are no scheduled tasks
+  bool empty() const;
+
+  /// \return How many tasks are scheduled
+  std::size_t size() const;
+
+  /// \return The task with the earliest deadline. The schedule must not be
+  ///         empty
+  TaskId nextTask() const;
+
+  /// \return The earliest deadline. The schedule must not be empty
+  TimePoint nextDeadline() const;
+
+private:
+  /// \brief A single heap entry
+  struct Entry final {
+    /// \brief When the task should be executed
+    TimePoint deadline;
+
+    /// \brief The task identifier
+    TaskId task_id{0U};
+  };
+
+  /// \brief Compares the entries at the given heap positions
+  /// \return True if the first entry should be executed before the second
+  bool lessThan(std::size_t first, std::size_t second) const;
+
+  /// \brief Swaps two heap entries, updating the position index
+  void swapEntries(std::size_t first, std::size_t second);
+
+  /// \brief Moves the given entry towards the root until the heap is valid
+  void siftUp(std::size_t position);
+
+  /// \brief Moves the given entry towards the leaves until the heap is valid
+  void siftDown(std::size_t position);
+
+  /// \brief The heap entries
+  std::vector<Entry> heap;
+
+  /// \brief Maps each task to its position in the heap
+  std::unordered_map<TaskId, std::size_t> position_map;
+};
+} // namespace zeek
@@ -1,10 +1,12 @@
 #include "zeekagent.h"
 #include "configuration.h"
 #include "logger.h"
+#include "outputqueuetableplugin.h"
+#include "querystatestore.h"
 #include "zeekconnection.h"
 
+#include <algorithm>
 #include <chrono>
-#include <thread>
 
 #if defined(ZEEK_AGENT_ENABLE_OSQUERY_SUPPORT)
 #include <zeek/iosqueryinterface.h>
@@ -23,8 +25,20 @@
 #include <zeek/system_identifiers.h>
 
 namespace zeek {
+namespace {
+/// \brief How long Zeek has to schedule its queries again after a
+///        reconnect, before the ones it has not confirmed are removed
+const std::chrono::seconds kScheduleConfirmationTimeout{120};
+
+/// \brief How often the query state snapshot is written
+const std::chrono::seconds kSnapshotInterval{60};
+} // namespace
+
 struct ZeekAgent::PrivateData final {
   IVirtualDatabase::Ref virtual_database;
+  ActivityNotifier::Ref activity_notifier;
+  std::vector<OutputPublisher::Ref> output_publisher_list;
+  QueryStateStore::Ref query_state_store;
   std::string host_identifier;
   std::vector<IVirtualTable::Ref> internal_table_list;
 };
@@ -71,8 +85,67 @@ Status ZeekAgent::exec(std::atomic_bool &terminate) {
     return status;
   }
 
+  // The scheduled queries and their differential context are kept across
+  // reconnects, and optionally across restarts
+  const auto &snapshot_path = getConfig().stateSnapshotPath();
+
+  if (!snapshot_path.empty()) {
+    status = d->query_state_store->loadSnapshot(snapshot_path);
+
+    if (!status.succeeded()) {
+      getLogger().logMessage(IZeekLogger::Severity::Error,
+                             "The query state snapshot could not be loaded: " +
+                                 status.message());
+
+    } else {
+      getLogger().logMessage(
+          IZeekLogger::Severity::Information,
+          "Restored " +
+              std::to_string(d->query_state_store->scheduledTaskCount()) +
+              " scheduled queries from the query state snapshot");
+    }
+  }
+
   ZeekConnection::Ref zeek_connection;
+
   QueryScheduler::Ref query_scheduler;
+  status = initializeQueryScheduler(query_scheduler);
+  if (!status.succeeded()) {
+    status = Status::failure("Failed to initialize the query scheduler");
+
+    getLogger().logMessage(IZeekLogger::Severity::Error, status.message());
+    return status;
+  }
+
+  query_scheduler->processTaskQueue(
+      d->query_state_store->scheduledTaskQueue());
+
+  // The scheduled queries keep running while disconnected; their output
+  // waits in the output queues, or in the output spool when enabled
+  status = query_scheduler->start();
+  if (!status.succeeded()) {
+    status = Status::failure("Failed to start the query scheduler: " +
+                             status.message());
+
+    getLogger().logMessage(IZeekLogger::Severity::Error, status.message());
+    return status;
+  }
+
+  // The connection is established (and retried) in the background, by
+  // processEvents
+  status = initializeConnection(zeek_connection);
+  if (!status.succeeded()) {
+    status = Status::failure("Failed to initialize the Zeek connection: " +
+                             status.message());
+
+    getLogger().logMessage(IZeekLogger::Severity::Error, status.message());
+    return status;
+  }
+
+  bool connected{false};
+  auto exit_status = Status::success();
+
+  auto last_snapshot_time = std::chrono::steady_clock::now();
 
 #if defined(ZEEK_AGENT_ENABLE_OSQUERY_SUPPORT)
   auto osquery_socket = getConfig().osqueryExtensionsSocket();
@@ -98,54 +171,80 @@ Status ZeekAgent::exec(std::atomic_bool &terminate) {
   while (!terminate) {
     service_manager->checkServices();
 
-    if (zeek_connection && query_scheduler) {
-      status = zeek_connection->processEvents();
+    status = zeek_connection->processEvents();
+    if (!status.succeeded()) {
+      exit_status = Status::failure(
+          "Failed to process the connection events: " + status.message());
 
-      if (!status.succeeded()) {
-        getLogger().logMessage(IZeekLogger::Severity::Error,
-                               "The connection has been lost: " +
-                                   status.message());
-
-        zeek_connection.reset();
+      getLogger().logMessage(IZeekLogger::Severity::Error,
+                             exit_status.message());
+      break;
+    }
 
-        query_scheduler->stop();
-        query_scheduler.reset();
+    if (zeek_connection->isConnected() != connected) {
+      connected = !connected;
 
-        continue;
+      // Zeek schedules its queries again after connecting; the ones it no
+      // longer sends are removed once the timeout expires
+      if (connected) {
+        d->query_state_store->requireConfirmation(
+            std::chrono::steady_clock::now() + kScheduleConfirmationTimeout);
       }
+    }
 
-    } else {
-      status = initializeConnection(zeek_connection);
+    auto current_time = std::chrono::steady_clock::now();
 
-      if (!status.succeeded()) {
-        getLogger().logMessage(
-            IZeekLogger::Severity::Error,
-            "Reconnecting has failed. Retrying again later...");
+    auto task_queue = d->query_state_store->processTaskQueue(
+        zeek_connection->getTaskQueue());
 
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-        continue;
-      }
+    auto expired_task_queue =
+        d->query_state_store->expireUnconfirmedTasks(current_time);
 
-      status = initializeQueryScheduler(query_scheduler);
-      if (!status.succeeded()) {
-        status = Status::failure("Failed to initialize the query scheduler");
+    if (!expired_task_queue.empty()) {
+      getLogger().logMessage(IZeekLogger::Severity::Information,
+                             "Removing " +
+                                 std::to_string(expired_task_queue.size()) +
+                                 " scheduled queries that have not been "
+                                 "confirmed after reconnecting");
 
-        getLogger().logMessage(IZeekLogger::Severity::Error, status.message());
-        return status;
-      }
+      task_queue.insert(task_queue.end(),
+                        std::make_move_iterator(expired_task_queue.begin()),
+                        std::make_move_iterator(expired_task_queue.end()));
     }
 
-    auto task_queue = zeek_connection->getTaskQueue();
     query_scheduler->processTaskQueue(std::move(task_queue));
 
-    auto task_output_list = query_scheduler->getTaskOutputList();
-    if (!task_output_list.empty()) {
-      status =
-          zeek_connection->processTaskOutputList(std::move(task_output_list));
+    // While an output queue is full, the output is left in the query
+    // scheduler. Once its own list is full, the scheduler waits before
+    // publishing any more output, which also pauses the query executions
+    auto has_capacity = std::all_of(
+        d->output_publisher_list.begin(), d->output_publisher_list.end(),
+        [](const OutputPublisher::Ref &output_publisher) -> bool {
+          return output_publisher->hasCapacity();
+        });
+
+    if (has_capacity) {
+      auto task_output_list = query_scheduler->getTaskOutputList();
+      if (!task_output_list.empty()) {
+        status =
+            zeek_connection->processTaskOutputList(std::move(task_output_list));
+
+        if (!status.succeeded()) {
+          getLogger().logMessage(IZeekLogger::Severity::Error,
+                                 "Failed to process the task output list: " +
+                                     status.message());
+        }
+      }
+    }
+
+    if (!snapshot_path.empty() &&
+        current_time - last_snapshot_time >= kSnapshotInterval) {
+      last_snapshot_time = current_time;
 
+      status = d->query_state_store->saveSnapshot(snapshot_path);
       if (!status.succeeded()) {
         getLogger().logMessage(IZeekLogger::Severity::Error,
-                               "Failed to process the task output list: " +
+                               "The query state snapshot could not be saved: " +
                                    status.message());
       }
     }
@@ -154,9 +253,7 @@ Status ZeekAgent::exec(std::atomic_bool &terminate) {
   getLogger().logMessage(IZeekLogger::Severity::Information,
                          "Stopping all services");
 
-  if (zeek_connection) {
-    zeek_connection.reset();
-  }
+  zeek_connection.reset();
 
 #if defined(ZEEK_AGENT_ENABLE_OSQUERY_SUPPORT)
   osquery_interface->stop();
@@ -168,11 +265,20 @@ Status ZeekAgent::exec(std::atomic_bool &terminate) {
     query_scheduler.reset();
   }
 
+  if (!snapshot_path.empty()) {
+    status = d->query_state_store->saveSnapshot(snapshot_path);
+    if (!status.succeeded()) {
+      getLogger().logMessage(IZeekLogger::Severity::Error,
+                             "The query state snapshot could not be saved: " +
+                                 status.message());
+    }
+  }
+
   service_manager->stopServices();
   service_manager.reset();
 
   getLogger().logMessage(IZeekLogger::Severity::Information, "Terminating");
-  return Status::success();
+  return exit_status;
 }
 
 IVirtualDatabase &ZeekAgent::virtualDatabase() {
@@ -189,12 +295,45 @@ ZeekAgent::ZeekAgent() : d(new PrivateData) {
   if (!status.succeeded()) {
     throw status;
   }
+
+  status = ActivityNotifier::create(d->activity_notifier);
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = QueryStateStore::create(d->query_state_store);
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = initializeOutputPublisher();
+  if (!status.succeeded()) {
+    throw status;
+  }
 }
 
 Status ZeekAgent::initializeConnection(ZeekConnection::Ref &zeek_connection) {
   zeek_connection.reset();
 
-  auto status = ZeekConnection::create(zeek_connection, d->host_identifier);
+  ZeekConnection::Configuration configuration;
+  configuration.host_identifier = d->host_identifier;
+  configuration.server_endpoints = getConfig().serverEndpoints();
+  configuration.group_list = getConfig().groupList();
+  configuration.certificate_authority = getConfig().certificateAuthority();
+  configuration.client_certificate = getConfig().clientCertificate();
+  configuration.client_key = getConfig().clientKey();
+  configuration.event_batching = getConfig().zeekEventBatching();
+  configuration.reconnect = getConfig().reconnect();
+  configuration.output_spool = getConfig().outputSpool();
+
+  ZeekConnection::OutputPublisherList output_publisher_list;
+  for (const auto &output_publisher : d->output_publisher_list) {
+    output_publisher_list.push_back(output_publisher.get());
+  }
+
+  auto status = ZeekConnection::create(
+      zeek_connection, getLogger(), configuration, *d->activity_notifier.get(),
+      d->query_state_store->differentialContext(), output_publisher_list);
   if (!status.succeeded()) {
     return status;
   }
@@ -209,18 +348,83 @@ ZeekAgent::initializeQueryScheduler(QueryScheduler::Ref &query_scheduler) {
     query_scheduler.reset();
   }
 
-  auto status =
-      QueryScheduler::create(query_scheduler, *d->virtual_database.get());
+  QueryScheduler::Configuration configuration;
+  configuration.host_identifier = d->host_identifier;
+  configuration.output_chunk_size = getConfig().queryOutputChunkSize();
+
+  auto status = QueryScheduler::create(
+      query_scheduler, *d->virtual_database.get(), getLogger(), {},
+      configuration);
 
   if (!status.succeeded()) {
     return status;
   }
 
-  status = query_scheduler->start();
+  // Wake up the main loop as soon as there is new output to publish
+  auto &activity_notifier = *d->activity_notifier.get();
+  query_scheduler->setTaskOutputCallback(
+      [&activity_notifier]() { activity_notifier.notify(); });
+
+  return Status::success();
+}
+
+Status ZeekAgent::initializeOutputPublisher() {
+  const auto &output_queue = getConfig().outputQueue();
+
+  OutputPublisher::Configuration configuration;
+  configuration.max_queued_byte_count = output_queue.max_queued_byte_count;
+
+  if (output_queue.overflow_policy ==
+      IZeekConfiguration::OutputQueue::OverflowPolicy::DropSnapshots) {
+    configuration.overflow_policy =
+        OutputPublisher::OverflowPolicy::DropSnapshots;
+
+  } else {
+    configuration.overflow_policy = OutputPublisher::OverflowPolicy::Block;
+  }
+
+  configuration.max_topic_rows_per_second =
+      output_queue.max_topic_rows_per_second;
+
+  configuration.max_query_rows_per_second =
+      output_queue.max_query_rows_per_second;
+
+  configuration.fair_queuing_quantum = output_queue.fair_queuing_quantum;
+
+  // Each Zeek server endpoint has its own queue
+  auto &activity_notifier = *d->activity_notifier.get();
+  OutputQueueTablePlugin::OutputQueueList output_queue_list;
+
+  for (const auto &endpoint : getConfig().serverEndpoints().endpoint_list) {
+    OutputPublisher::Ref output_publisher;
+    auto status = OutputPublisher::create(output_publisher, configuration);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    // Wake up the main loop as soon as the output queue has room again
+    output_publisher->setCapacityCallback(
+        [&activity_notifier]() { activity_notifier.notify(); });
+
+    output_queue_list.push_back(
+        {endpoint.address + ":" + std::to_string(endpoint.port),
+         output_publisher.get()});
+
+    d->output_publisher_list.push_back(std::move(output_publisher));
+  }
+
+  IVirtualTable::Ref table_ref;
+  auto status = OutputQueueTablePlugin::create(table_ref, output_queue_list);
   if (!status.succeeded()) {
     return status;
   }
 
+  status = d->virtual_database->registerTable(table_ref);
+  if (!status.succeeded()) {
+    return status;
+  }
+
+  d->internal_table_list.push_back(table_ref);
   return Status::success();
 }
 
@@ -47,11 +47,16 @@ private:
   /// \return A Status object
   Status initializeConnection(ZeekConnection::Ref &zeek_connection);
 
-  /// \brief Initializes the query scheduler
+  /// \brief Initializes the query scheduler, without starting it
   /// \param query_scheduler Where the scheduler object is stored
   /// \return A Status object
   Status initializeQueryScheduler(QueryScheduler::Ref &query_scheduler);
 
+  /// \brief Initializes the output publishers (one for each Zeek server
+  ///        endpoint) and their metrics table
+  /// \return A Status object
+  Status initializeOutputPublisher();
+
   /// \brief Initializes the service manager
   /// \param service_manager Where the service manager object is stored
   /// \return A Status object
@@ -1,14 +1,20 @@
 #include "zeekconnection.h"
-#include "configuration.h"
-#include "logger.h"
-#include "uniquexxh64state.h"
+#include "activityreactor.h"
 #include "utils.h"
+#include "zeekeventserializer.h"
 
+#include <algorithm>
+#include <random>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <broker/endpoint.hh>
 #include <broker/zeek.hh>
 
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
+#include <zeek/logratelimiter.h>
 #include <zeek/network.h>
 #include <zeek/system_identifiers.h>
 
@@ -32,6 +38,24 @@ const std::string kBrokerTopic_PRE_INDIVIDUALS{"/zeek/zeek-agent/host/"};
 const std::string kBrokerTopic_PRE_GROUPS{"/zeek/zeek-agent/group/"};
 const std::string kBrokerEvent_HOST_NEW{"ZeekAgent::host_new"};
 
+/// \brief How long to wait for new events before returning to the caller
+const std::chrono::milliseconds kMaxActivityWaitTime{1000};
+
+/// \brief How long a connection attempt can last before it is abandoned
+const std::chrono::seconds kConnectionAttemptTimeout{10};
+
+/// \brief How long a connection has to last before the backoff is reset, so
+///        that a server dropping the agents right after accepting them does
+///        not cause a reconnect storm
+const std::chrono::seconds kMinStableConnectionTime{10};
+
+/// \brief How often the spooled output is replayed, while the replay rate
+///        limit has been reached
+const std::chrono::milliseconds kSpoolReplayInterval{100};
+
+/// \brief Value types, as fed to the row hash
+enum class HashedValueType : std::uint8_t { Null, Integer, String, Double };
+
 template <typename FieldType, int field_index>
 FieldType getZeekEventField(const broker::zeek::Event &event) {
   const auto &argument_list = event.args();
@@ -52,32 +76,136 @@ auto getZeekEventQueryString = getZeekEventField<std::string, 1>;
 auto getZeekEventCookie = getZeekEventField<std::string, 2>;
 auto getZeekEventResponseTopic = getZeekEventField<std::string, 3>;
 auto getZeekEventUpdateType = getZeekEventField<std::string, 4>;
-auto getZeekEventInterval = getZeekEventField<std::uint64_t, 5>;
+
+std::chrono::milliseconds
+getZeekEventInterval(const broker::zeek::Event &event) {
+  // Zeek sends either a count (in seconds) or an interval, which allows
+  // sub-second schedules
+  const auto &argument_list = event.args();
+  if (argument_list.size() > 5U) {
+    const auto &argument = argument_list[5];
+
+    if (broker::is<broker::timespan>(argument)) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+          broker::get<broker::timespan>(argument));
+    }
+  }
+
+  return std::chrono::seconds(getZeekEventField<std::uint64_t, 5>(event));
+}
+
+std::optional<QueryScheduler::Task::Trigger>
+getZeekEventTrigger(const broker::zeek::Event &event) {
+  // Optional; Zeek can append the minimum delay (an interval) and the
+  // batch size (a count) to request push triggering
+  const auto &argument_list = event.args();
+  if (argument_list.size() <= 6U) {
+    return std::nullopt;
+  }
+
+  QueryScheduler::Task::Trigger trigger;
+  trigger.min_delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      getZeekEventField<broker::timespan, 6>(event));
+
+  if (argument_list.size() > 7U) {
+    trigger.batch_size =
+        static_cast<std::size_t>(getZeekEventField<std::uint64_t, 7>(event));
+  }
+
+  return trigger;
+}
 } // namespace
 
+struct ZeekConnection::Endpoint final {
+  Endpoint(const IZeekConfiguration::ServerEndpoint &server_endpoint_,
+           broker::configuration config, OutputPublisher &output_publisher_,
+           const Configuration &configuration, std::uint64_t seed)
+      : server_endpoint(server_endpoint_),
+        name(server_endpoint.address + ":" +
+             std::to_string(server_endpoint.port)),
+        broker_endpoint(new broker::endpoint(std::move(config))),
+        status_subscriber(broker_endpoint->make_status_subscriber(true)),
+        subscriber(broker_endpoint->make_subscriber({})),
+        output_publisher(output_publisher_),
+        reconnect_backoff(
+            std::chrono::milliseconds(
+                configuration.reconnect.initial_backoff_ms),
+            std::chrono::milliseconds(configuration.reconnect.max_backoff_ms),
+            seed),
+        event_serializer(configuration.event_batching) {}
+
+  IZeekConfiguration::ServerEndpoint server_endpoint;
+  std::size_t index{0U};
+  std::string name;
+
+  std::unique_ptr<broker::endpoint> broker_endpoint;
+  broker::status_subscriber status_subscriber;
+  broker::subscriber subscriber;
+
+  OutputPublisher &output_publisher;
+
+  ConnectionState connection_state{ConnectionState::WaitingToReconnect};
+  std::chrono::steady_clock::time_point state_deadline;
+  std::chrono::steady_clock::time_point connection_time;
+  ReconnectBackoff reconnect_backoff;
+
+  // Only used by the output publisher thread
+  ZeekEventSerializer event_serializer;
+  ZeekEventSerializer::EventList event_list;
+};
+
 struct ZeekConnection::PrivateData final {
-  PrivateData(broker::configuration config)
-      : broker_endpoint(new broker::endpoint(std::move(config))),
-        status_subscriber(broker_endpoint->make_status_subscriber(true)) {}
+  PrivateData(IZeekLogger &logger_, const Configuration &configuration_,
+              ActivityNotifier &activity_notifier_,
+              DifferentialContext &differential_context_)
+      : logger(logger_), configuration(configuration_),
+        activity_notifier(activity_notifier_),
+        differential_context(differential_context_),
+        endpoint_selector(configuration.server_endpoints.policy,
+                          configuration.server_endpoints.endpoint_list.size()) {
+  }
+
+  IZeekLogger &logger;
+  Configuration configuration;
+
+  ActivityNotifier &activity_notifier;
+  DifferentialContext &differential_context;
 
   std::string peer_name;
-  std::string host_identifier;
-  std::unique_ptr<broker::endpoint> broker_endpoint;
+  std::vector<std::unique_ptr<Endpoint>> endpoint_list;
+  EndpointSelector endpoint_selector;
 
-  broker::status_subscriber status_subscriber;
+  // The endpoint each pending request came from, by query ID; only used
+  // by the failover policy
+  std::unordered_map<std::string, std::size_t> query_origin_map;
+
+  std::unordered_set<std::string> subscribed_topic_set;
 
-  std::unordered_map<std::string, broker::subscriber> subscriber_map;
+  ActivityReactor::Ref activity_reactor;
   std::vector<std::string> joined_group_list;
 
   QueryScheduler::TaskQueue task_queue;
-  DifferentialContext differential_context;
+  PendingDifferentialContext pending_differential_context;
+
+  OutputSpool::Ref output_spool;
+  std::uint64_t reported_spool_drop_count{0U};
+
+  // Token bucket for the spool replay, refilled at replay_rows_per_second
+  double replay_row_budget{0.0};
+  std::chrono::steady_clock::time_point last_replay_time;
 };
 
-Status ZeekConnection::create(Ref &obj, const std::string &host_identifier) {
+Status
+ZeekConnection::create(Ref &obj, IZeekLogger &logger,
+                       const Configuration &configuration,
+                       ActivityNotifier &activity_notifier,
+                       DifferentialContext &differential_context,
+                       const OutputPublisherList &output_publisher_list) {
   try {
     obj.reset();
 
-    auto ptr = new ZeekConnection(host_identifier);
+    auto ptr = new ZeekConnection(logger, configuration, activity_notifier,
+                                  differential_context, output_publisher_list);
     obj.reset(ptr);
 
     return Status::success();
@@ -90,7 +218,32 @@ Status ZeekConnection::create(Ref &obj, const std::string &host_identifier) {
   }
 }
 
-ZeekConnection::~ZeekConnection() { d->broker_endpoint->shutdown(); }
+ZeekConnection::~ZeekConnection() {
+  // Wait for the output that is being published; the rest stays queued
+  // until the next connection
+  for (auto &endpoint : d->endpoint_list) {
+    endpoint->output_publisher.setPublishCallback({});
+    endpoint->broker_endpoint->shutdown();
+  }
+
+  if (!d->output_spool) {
+    return;
+  }
+
+  // Spool what is still queued, so that it is not lost if the agent is
+  // stopped before it could be published
+  for (auto &endpoint : d->endpoint_list) {
+    for (const auto &output : endpoint->output_publisher.takeQueuedOutput()) {
+      auto status = d->output_spool->append(output);
+
+      if (!status.succeeded()) {
+        d->logger.logMessage(IZeekLogger::Severity::Error,
+                             "Failed to spool the queued output: " +
+                                 status.message());
+      }
+    }
+  }
+}
 
 Status ZeekConnection::joinGroup(const std::string &name) {
   auto group_it =
@@ -103,11 +256,11 @@ Status ZeekConnection::joinGroup(const std::string &name) {
 
   auto status = createSubscription(kBrokerTopic_PRE_GROUPS + name);
   if (!status.succeeded()) {
-    throw status;
+    return status;
   }
 
-  getLogger().logMessage(IZeekLogger::Severity::Information,
-                         "A new group has been joined: " + name);
+  d->logger.logMessage(IZeekLogger::Severity::Information,
+                       "A new group has been joined: " + name);
 
   d->joined_group_list.push_back(name);
   return Status::success();
@@ -131,94 +284,117 @@ Status ZeekConnection::leaveGroup(const std::string &name) {
 }
 
 Status ZeekConnection::processEvents() {
-  StatusEventList status_event_list;
-  auto status = getStatusEvents(status_event_list);
+  // Status events also wake up the wait, so that a lost connection is
+  // noticed right away
+  auto status = waitForActivity();
   if (!status.succeeded()) {
     return status;
   }
 
-  if (!status_event_list.empty()) {
-    // Whatever happened, we are either disconnected or have just
-    // reconnected (in which case we have to reset the connection state)
-    return Status::failure("Connection hase been lost or reset");
-  }
+  for (auto &endpoint : d->endpoint_list) {
+    PeerEventList peer_event_list;
+    getPeerEvents(*endpoint.get(), peer_event_list);
 
-  bool ready{false};
-  status = waitForActivity(ready);
-  if (!status.succeeded()) {
-    return status;
-  }
+    for (auto peer_event : peer_event_list) {
+      handlePeerEvent(*endpoint.get(), peer_event);
+    }
 
-  if (!ready) {
-    return Status::success();
+    updateConnectionState(*endpoint.get());
+
+    // The subscriber descriptor stays readable until it has been drained,
+    // so it has to be polled even while disconnected. The messages that
+    // were received before the connection was lost are dropped; the server
+    // sends its requests again after the next host_new announcement
+    auto message_list = endpoint->subscriber.poll();
+
+    if (endpoint->connection_state != ConnectionState::Connected) {
+      if (!message_list.empty()) {
+        d->logger.logMessage(IZeekLogger::Severity::Warning,
+                             "Dropping " +
+                                 std::to_string(message_list.size()) +
+                                 " messages received from " + endpoint->name +
+                                 " before the connection was lost");
+      }
+
+      continue;
+    }
+
+    for (const auto &message : message_list) {
+      processZeekEvent(*endpoint.get(),
+                       broker::zeek::Event(caf::get<1>(message)));
+    }
   }
 
-  for (auto &subscriber_p : d->subscriber_map) {
-    auto &subscriber = subscriber_p.second;
+  replaySpooledOutput();
+  return Status::success();
+}
 
-    for (const auto &message : subscriber.poll()) {
-      broker::zeek::Event event(caf::get<1>(message));
+void ZeekConnection::processZeekEvent(const Endpoint &endpoint,
+                                      const broker::zeek::Event &event) {
+  Status status;
 
-      if (event.name() == kHostJoinEvent || event.name() == kHostLeaveEvent) {
-        const auto &argument_list = event.args();
+  if (event.name() == kHostJoinEvent || event.name() == kHostLeaveEvent) {
+    const auto &argument_list = event.args();
 
-        if (argument_list.size() != 1U) {
-          getLogger().logMessage(IZeekLogger::Severity::Error,
-                                 "Invalid host_join/host_leave event received "
-                                 "(wrong argument count)");
+    if (argument_list.size() != 1U) {
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "Invalid host_join/host_leave event received "
+                           "(wrong argument count)");
 
-          continue;
-        }
+      return;
+    }
 
-        auto group_name_ptr = broker::get_if<std::string>(argument_list[0]);
-        if (group_name_ptr == nullptr) {
-          getLogger().logMessage(IZeekLogger::Severity::Error,
-                                 "Invalid host_join/host_leave event received "
-                                 "(missing or invalid group name)");
+    auto group_name_ptr = broker::get_if<std::string>(argument_list[0]);
+    if (group_name_ptr == nullptr) {
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "Invalid host_join/host_leave event received "
+                           "(missing or invalid group name)");
 
-          continue;
-        }
+      return;
+    }
 
-        const auto &group_name = *group_name_ptr;
+    const auto &group_name = *group_name_ptr;
 
-        if (event.name() == kHostJoinEvent) {
-          status = joinGroup(group_name);
-        } else {
-          status = leaveGroup(group_name);
-        }
+    if (event.name() == kHostJoinEvent) {
+      status = joinGroup(group_name);
+    } else {
+      status = leaveGroup(group_name);
+    }
 
-        if (!status.succeeded()) {
-          getLogger().logMessage(
-              IZeekLogger::Severity::Error,
-              "Failed to handle host_join/host_leave event: " +
-                  status.message());
-        }
+    if (!status.succeeded()) {
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "Failed to handle host_join/host_leave event: " +
+                               status.message());
+    }
 
-      } else {
-        QueryScheduler::Task pending_task;
+  } else {
+    QueryScheduler::Task pending_task;
 
-        status = taskFromZeekEvent(pending_task, event);
-        if (!status.succeeded()) {
-          getLogger().logMessage(IZeekLogger::Severity::Error,
-                                 status.message());
+    status = taskFromZeekEvent(pending_task, event);
+    if (!status.succeeded()) {
+      d->logger.logMessage(IZeekLogger::Severity::Error, status.message());
+      return;
+    }
 
-        } else {
-          if (pending_task.type ==
-              QueryScheduler::Task::Type::RemoveScheduledQuery) {
-            auto query_id = computeQueryID(pending_task.response_topic,
-                                           pending_task.response_event,
-                                           pending_task.cookie);
+    auto query_id = computeQueryID(pending_task.response_topic,
+                                   pending_task.response_event,
+                                   pending_task.cookie);
 
-            d->differential_context.erase(query_id);
-          }
+    if (pending_task.type == QueryScheduler::Task::Type::RemoveScheduledQuery) {
+      d->differential_context.erase(query_id);
+      d->query_origin_map.erase(query_id);
 
-          d->task_queue.push_back(std::move(pending_task));
-        }
-      }
+    } else if (d->configuration.server_endpoints.policy ==
+               IZeekConfiguration::ServerEndpoints::Policy::Failover) {
+      d->query_origin_map[query_id] = endpoint.index;
     }
+
+    d->task_queue.push_back(std::move(pending_task));
   }
+}
 
-  return Status::success();
+bool ZeekConnection::isConnected() const {
+  return d->endpoint_selector.anyConnected();
 }
 
 QueryScheduler::TaskQueue ZeekConnection::getTaskQueue() {
@@ -228,96 +404,130 @@ QueryScheduler::TaskQueue ZeekConnection::getTaskQueue() {
   return output;
 }
 
-void ZeekConnection::publishTaskOutput(
-    const std::string &trigger, const std::string &response_topic,
-    const std::string &response_event, const std::string &cookie,
-    const IVirtualDatabase::QueryOutput &query_output) {
+void ZeekConnection::publishTaskOutput(Endpoint &endpoint,
+                                       OutputPublisher::Output output) {
+  std::size_t null_column_count{0U};
 
-  // clang-format off
-  broker::vector message_header(
-    {
-      broker::data(d->host_identifier),
-      broker::data(broker::data(broker::enum_value{trigger})),
-      broker::data(cookie)
-    }
-  );
-  // clang-format on
+  endpoint.event_serializer.serialize(
+      endpoint.event_list, null_column_count, d->configuration.host_identifier,
+      output.trigger, output.response_event, output.cookie,
+      std::move(output.query_output));
+
+  if (null_column_count != 0U) {
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "Returning " + std::to_string(null_column_count) +
+                              " NULL columns. This may not be correctly "
+                              "supported by Zeek");
+  }
+
+  for (auto &event : endpoint.event_list) {
+    endpoint.broker_endpoint->publish(output.response_topic, std::move(event));
+  }
+
+  endpoint.event_list.clear();
+}
 
-  for (const auto &row : query_output) {
-    broker::vector message_data = {broker::data(message_header)};
+void ZeekConnection::routeOutput(OutputPublisher::Output output) {
+  auto query_id = computeQueryID(output.response_topic, output.response_event,
+                                 output.cookie);
 
-    bool skip_row = false;
+  auto endpoint_index =
+      d->endpoint_selector.select(query_id, output.response_topic);
 
-    for (const auto &column : row) {
-      broker::data column_value = {};
+  // With the failover policy, the output goes back to the server that sent
+  // the request for as long as it stays connected
+  auto query_origin_it = d->query_origin_map.find(query_id);
 
-      if (column.data.has_value()) {
-        const auto &column_variant = column.data.value();
+  if (query_origin_it != d->query_origin_map.end() &&
+      d->endpoint_selector.isConnected(query_origin_it->second)) {
+    endpoint_index = query_origin_it->second;
+  }
 
-        if (std::holds_alternative<std::string>(column_variant)) {
-          const auto &string_value = std::get<std::string>(column_variant);
-          column_value = broker::data(string_value);
+  d->endpoint_list.at(endpoint_index)->output_publisher.push(std::move(output));
+}
 
-        } else if (std::holds_alternative<std::int64_t>(column_variant)) {
-          auto integer_value = std::get<std::int64_t>(column_variant);
-          column_value = broker::data(integer_value);
+void ZeekConnection::storeOutput(OutputPublisher::Output output) {
+  // Once something has been spooled, the new output has to follow it, so
+  // that the order is preserved
+  if (d->output_spool && (!d->endpoint_selector.anyConnected() ||
+                          !d->output_spool->empty())) {
 
-        } else if (std::holds_alternative<double>(column_variant)) {
-          auto double_value = std::get<double>(column_variant);
-          column_value = broker::data(double_value);
+    auto status = d->output_spool->append(output);
 
-        } else {
-          getLogger().logMessage(IZeekLogger::Severity::Error,
-                                 "Invalid type received");
-          skip_row = true;
-          break;
-        }
+    if (status.succeeded()) {
+      auto dropped_output_count =
+          d->output_spool->stats().dropped_output_count;
 
-      } else {
-        getLogger().logMessage(IZeekLogger::Severity::Warning,
-                               "Returning a NULL column. This may not be "
-                               "correctly supported by Zeek");
+      if (dropped_output_count != d->reported_spool_drop_count) {
+        d->logger.logMessage(
+            IZeekLogger::Severity::Warning,
+            "The output spool is full; " +
+                std::to_string(dropped_output_count -
+                               d->reported_spool_drop_count) +
+                " of the oldest outputs have been dropped");
 
-        column_value = broker::data();
+        d->reported_spool_drop_count = dropped_output_count;
       }
 
-      message_data.push_back(std::move(column_value));
+      return;
     }
 
-    if (!skip_row) {
-      // clang-format off
-      d->broker_endpoint->publish(
-        response_topic,
-        broker::zeek::Event(response_event, message_data)
-      );
-      // clang-format on
-    }
+    // Keep the output in memory instead
+    d->logger.logMessage(IZeekLogger::Severity::Error,
+                         "Failed to spool the query output: " +
+                             status.message());
   }
+
+  routeOutput(std::move(output));
+}
+
+void ZeekConnection::queueTaskOutput(
+    const std::string &trigger, const QueryScheduler::TaskOutput &task_output,
+    IVirtualDatabase::QueryOutput query_output, bool snapshot) {
+
+  if (query_output.empty()) {
+    return;
+  }
+
+  OutputPublisher::Output output;
+  output.trigger = trigger;
+  output.response_topic = task_output.response_topic;
+  output.response_event = task_output.response_event;
+  output.cookie = task_output.cookie;
+  output.query_output = std::move(query_output);
+  output.snapshot = snapshot;
+
+  storeOutput(std::move(output));
 }
 
 Status ZeekConnection::processTaskOutput(
-    const QueryScheduler::TaskOutput &task_output) {
+    QueryScheduler::TaskOutput task_output) {
 
   if (task_output.update_type.has_value()) {
     DifferentialOutput differential_output;
-    auto status = computeDifferentials(d->differential_context,
-                                       differential_output, task_output);
+    auto status = computeDifferentials(
+        d->differential_context, d->pending_differential_context,
+        differential_output, task_output);
     if (!status.succeeded()) {
       return status;
     }
 
-    publishTaskOutput("ZeekAgent::ADD", task_output.response_topic,
-                      task_output.response_event, task_output.cookie,
-                      differential_output.added_row_list);
+    queueTaskOutput("ZeekAgent::ADD", task_output,
+                    std::move(differential_output.added_row_list), false);
 
-    publishTaskOutput("ZeekAgent::REMOVE", task_output.response_topic,
-                      task_output.response_event, task_output.cookie,
-                      differential_output.removed_row_list);
+    queueTaskOutput("ZeekAgent::REMOVE", task_output,
+                    std::move(differential_output.removed_row_list), false);
 
   } else {
-    publishTaskOutput("ZeekAgent::SNAPSHOT", task_output.response_topic,
-                      task_output.response_event, task_output.cookie,
-                      task_output.query_output);
+    queueTaskOutput("ZeekAgent::SNAPSHOT", task_output,
+                    std::move(task_output.query_output), true);
+
+    // One-shot queries are done after their last chunk
+    if (task_output.last_chunk) {
+      d->query_origin_map.erase(computeQueryID(task_output.response_topic,
+                                               task_output.response_event,
+                                               task_output.cookie));
+    }
   }
 
   return Status::success();
@@ -326,8 +536,8 @@ Status ZeekConnection::processTaskOutput(
 Status ZeekConnection::processTaskOutputList(
     QueryScheduler::TaskOutputList task_output_list) {
 
-  for (const auto &task_output : task_output_list) {
-    auto status = processTaskOutput(task_output);
+  for (auto &task_output : task_output_list) {
+    auto status = processTaskOutput(std::move(task_output));
     if (!status.succeeded()) {
       return status;
     }
@@ -336,124 +546,244 @@ Status ZeekConnection::processTaskOutputList(
   return Status::success();
 }
 
-Status ZeekConnection::waitForActivity(bool &ready) {
-  ready = false;
+Status ZeekConnection::waitForActivity() {
+  auto timeout = kMaxActivityWaitTime;
 
-  fd_set fd_list;
-  FD_ZERO(&fd_list);
+  auto current_time = std::chrono::steady_clock::now();
 
-  int highest_socket_fd = -1;
-
-  for (const auto &subscriber_p : d->subscriber_map) {
-    const auto &subscriber = subscriber_p.second;
+  for (const auto &endpoint : d->endpoint_list) {
+    if (endpoint->connection_state == ConnectionState::Connected) {
+      continue;
+    }
 
-    auto socket = subscriber.fd();
-    FD_SET(socket, &fd_list);
+    auto time_left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        endpoint->state_deadline - current_time);
 
-    highest_socket_fd = std::max(highest_socket_fd, socket);
+    timeout = std::clamp(time_left, std::chrono::milliseconds(0), timeout);
   }
 
-  struct timeval timeout {};
-  timeout.tv_sec = 1;
+  if (d->output_spool && !d->output_spool->empty() &&
+      d->endpoint_selector.anyConnected()) {
+    timeout = std::min(timeout, kSpoolReplayInterval);
+  }
 
-  auto select_err =
-      select(highest_socket_fd + 1, &fd_list, nullptr, nullptr, &timeout);
-  if (select_err == 0) {
-    return Status::success();
+  ActivityReactor::DescriptorList ready_list;
 
-  } else if (select_err == -1) {
-#ifdef WIN32
-    auto error_code = WSAGetLastError();
-    auto eintr_value = WSAEINTR;
-#else
-    auto error_code = errno;
-    auto eintr_value = EINTR;
-#endif
+  auto status = d->activity_reactor->wait(ready_list, timeout);
+  if (!status.succeeded()) {
+    return status;
+  }
 
-    if (error_code == eintr_value) {
-      return Status::success();
-    }
+  auto notifier_descriptor = d->activity_notifier.descriptor();
 
-    return Status::failure("poll() has failed with error " +
-                           std::to_string(error_code));
+  if (std::find(ready_list.begin(), ready_list.end(), notifier_descriptor) !=
+      ready_list.end()) {
+    d->activity_notifier.reset();
   }
 
-  ready = true;
   return Status::success();
 }
 
-ZeekConnection::ZeekConnection(const std::string &host_identifier)
-    : d(new PrivateData(getBrokerConfiguration())) {
+ZeekConnection::ZeekConnection(IZeekLogger &logger,
+                               const Configuration &configuration,
+                               ActivityNotifier &activity_notifier,
+                               DifferentialContext &differential_context,
+                               const OutputPublisherList &output_publisher_list)
+    : d(new PrivateData(logger, configuration, activity_notifier,
+                        differential_context)) {
 
   d->peer_name = getSystemHostname();
-  d->host_identifier = host_identifier;
 
-  const auto &server_address = getConfig().serverAddress();
-  auto server_port = getConfig().serverPort();
+  const auto &server_endpoint_list =
+      d->configuration.server_endpoints.endpoint_list;
 
-  d->broker_endpoint->peer_nosync(server_address, server_port,
-                                  broker::timeout::seconds(3));
+  if (server_endpoint_list.empty()) {
+    throw Status::failure("No Zeek server endpoint has been configured");
+  }
 
-  bool connected{false};
+  if (output_publisher_list.size() != server_endpoint_list.size()) {
+    throw Status::failure(
+        "The output publishers do not match the Zeek server endpoints");
+  }
 
-  for (std::size_t retry = 0U; retry < 5U; ++retry) {
-    std::this_thread::sleep_for(std::chrono::seconds(1U));
+  // Without the spool, the output waits in memory while no endpoint is
+  // connected
+  const auto &output_spool = d->configuration.output_spool;
+
+  if (!output_spool.folder_path.empty()) {
+    OutputSpool::Configuration spool_configuration;
+    spool_configuration.folder_path = output_spool.folder_path;
+    spool_configuration.max_byte_count = output_spool.max_byte_count;
+    spool_configuration.segment_byte_count = output_spool.segment_byte_count;
+
+    auto status = OutputSpool::create(d->output_spool, spool_configuration);
 
-    StatusEventList status_event_list;
-    auto status = getStatusEvents(status_event_list);
     if (!status.succeeded()) {
-      throw status;
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "The output spool could not be opened: " +
+                               status.message());
+
+    } else if (!d->output_spool->empty()) {
+      d->logger.logMessage(
+          IZeekLogger::Severity::Information,
+          std::to_string(d->output_spool->stats().spooled_output_count) +
+              " spooled outputs are waiting to be replayed");
     }
+  }
 
-    for (const auto &status_code : status_event_list) {
-      switch (status_code) {
-      case broker::sc::peer_added:
-        connected = true;
-        break;
+  d->last_replay_time = std::chrono::steady_clock::now();
 
-      case broker::sc::peer_lost:
-      case broker::sc::peer_removed:
-        connected = false;
-        break;
+  // Each endpoint uses a different seed, so that its attempts are not
+  // aligned with the ones of the other endpoints (or agents)
+  std::random_device random_device;
+  auto host_identifier_hash =
+      std::hash<std::string>()(d->configuration.host_identifier);
 
-      case broker::sc::unspecified:
-      default:
-        break;
-      }
-    }
+  for (std::size_t i = 0U; i < server_endpoint_list.size(); ++i) {
+    auto endpoint = std::make_unique<Endpoint>(
+        server_endpoint_list.at(i), getBrokerConfiguration(configuration),
+        *output_publisher_list.at(i), d->configuration,
+        random_device() ^ host_identifier_hash);
 
-    if (connected) {
-      break;
-    }
+    endpoint->index = i;
+    d->endpoint_list.push_back(std::move(endpoint));
   }
 
-  if (!connected) {
-    throw Status::failure("The connection to the Zeek server timed out");
+  // All the topics of an endpoint share the same subscriber, so there are
+  // only two descriptors to watch for each endpoint
+  auto status = ActivityReactor::create(d->activity_reactor);
+  if (!status.succeeded()) {
+    throw status;
   }
 
-  getLogger().logMessage(IZeekLogger::Severity::Information,
-                         "Successfully connected to " + server_address + ":" +
-                             std::to_string(server_port));
+  ActivityReactor::DescriptorList descriptor_list = {
+      d->activity_notifier.descriptor()};
+
+  for (const auto &endpoint : d->endpoint_list) {
+    descriptor_list.push_back(static_cast<ActivityReactor::Descriptor>(
+        endpoint->status_subscriber.fd()));
+
+    descriptor_list.push_back(
+        static_cast<ActivityReactor::Descriptor>(endpoint->subscriber.fd()));
+  }
+
+  for (auto descriptor : descriptor_list) {
+    status = d->activity_reactor->add(descriptor);
+    if (!status.succeeded()) {
+      throw status;
+    }
+  }
 
-  auto status = createSubscription(kBrokerTopic_ALL);
+  // The subscriptions are kept by the endpoints, and sent to the servers
+  // every time a connection is established
+  status = createSubscription(kBrokerTopic_ALL);
   if (!status.succeeded()) {
     throw status;
   }
 
   status =
-      createSubscription(kBrokerTopic_PRE_INDIVIDUALS + d->host_identifier);
+      createSubscription(kBrokerTopic_PRE_INDIVIDUALS +
+                         d->configuration.host_identifier);
 
   if (!status.succeeded()) {
     throw status;
   }
 
-  for (const auto &group_name : getConfig().groupList()) {
+  for (const auto &group_name : d->configuration.group_list) {
     status = joinGroup(group_name);
     if (!status.succeeded()) {
       throw status;
     }
   }
 
+  for (auto &endpoint : d->endpoint_list) {
+    connect(*endpoint.get());
+  }
+}
+
+void ZeekConnection::handlePeerEvent(Endpoint &endpoint, PeerEvent peer_event) {
+  switch (peer_event) {
+  case PeerEvent::Added:
+    if (endpoint.connection_state != ConnectionState::Connected) {
+      onConnected(endpoint);
+    }
+
+    break;
+
+  case PeerEvent::Lost:
+  case PeerEvent::Failed:
+    if (endpoint.connection_state == ConnectionState::Connected) {
+      d->logger.logMessage(IZeekLogger::Severity::Warning,
+                           "The connection to " + endpoint.name +
+                               " has been lost");
+
+      onDisconnected(endpoint);
+
+      if (std::chrono::steady_clock::now() - endpoint.connection_time >=
+          kMinStableConnectionTime) {
+        endpoint.reconnect_backoff.reset();
+      }
+
+      scheduleReconnect(endpoint);
+
+    } else if (endpoint.connection_state == ConnectionState::Connecting) {
+      scheduleReconnect(endpoint);
+    }
+
+    break;
+  }
+}
+
+void ZeekConnection::updateConnectionState(Endpoint &endpoint) {
+  if (endpoint.connection_state == ConnectionState::Connected ||
+      std::chrono::steady_clock::now() < endpoint.state_deadline) {
+    return;
+  }
+
+  if (endpoint.connection_state == ConnectionState::WaitingToReconnect) {
+    connect(endpoint);
+    return;
+  }
+
+  d->logger.logMessage(IZeekLogger::Severity::Warning,
+                       "The connection attempt to " + endpoint.name +
+                           " has timed out");
+
+  endpoint.broker_endpoint->unpeer_nosync(endpoint.server_endpoint.address,
+                                          endpoint.server_endpoint.port);
+
+  scheduleReconnect(endpoint);
+}
+
+void ZeekConnection::connect(Endpoint &endpoint) {
+  endpoint.connection_state = ConnectionState::Connecting;
+  endpoint.state_deadline =
+      std::chrono::steady_clock::now() + kConnectionAttemptTimeout;
+
+  // Retries are handled by the connection state machine, so that they can
+  // use a random backoff
+  endpoint.broker_endpoint->peer_nosync(endpoint.server_endpoint.address,
+                                        endpoint.server_endpoint.port,
+                                        broker::timeout::seconds(0));
+}
+
+void ZeekConnection::onConnected(Endpoint &endpoint) {
+  endpoint.connection_state = ConnectionState::Connected;
+  endpoint.connection_time = std::chrono::steady_clock::now();
+
+  d->endpoint_selector.setConnected(endpoint.index, true);
+
+  d->logger.logMessage(IZeekLogger::Severity::Information,
+                       "Successfully connected to " + endpoint.name);
+
+  // The output waiting on the endpoints that are still disconnected can
+  // now be published through this one
+  for (auto &other_endpoint : d->endpoint_list) {
+    if (other_endpoint->connection_state != ConnectionState::Connected) {
+      moveQueuedOutput(*other_endpoint.get());
+    }
+  }
+
   broker::vector joined_group_list;
 
   for (const auto &group : d->joined_group_list) {
@@ -471,9 +801,9 @@ ZeekConnection::ZeekConnection(const std::string &host_identifier)
     kBrokerEvent_HOST_NEW,
 
     {
-      broker::data(caf::to_string(d->broker_endpoint->node_id())),
+      broker::data(caf::to_string(endpoint.broker_endpoint->node_id())),
       broker::data(d->peer_name),
-      broker::data(d->host_identifier),
+      broker::data(d->configuration.host_identifier),
       joined_group_list,
       broker::data(ZEEK_AGENT_VERSION),
       broker::data(kZeekAgentEdition),
@@ -482,13 +812,126 @@ ZeekConnection::ZeekConnection(const std::string &host_identifier)
   );
   // clang-format on
 
-  d->broker_endpoint->publish(kBrokerTopic_ANNOUNCE, message);
+  endpoint.broker_endpoint->publish(kBrokerTopic_ANNOUNCE, message);
+
+  // Start publishing the output, including what has been queued while we
+  // were disconnected
+  auto endpoint_ptr = &endpoint;
+
+  endpoint.output_publisher.setPublishCallback(
+      [this, endpoint_ptr](OutputPublisher::Output output) {
+        publishTaskOutput(*endpoint_ptr, std::move(output));
+      });
 }
 
-broker::configuration ZeekConnection::getBrokerConfiguration() {
-  auto ca_file_path = getConfig().certificateAuthority();
-  auto cert_file_path = getConfig().clientCertificate();
-  auto key_file_path = getConfig().clientKey();
+void ZeekConnection::onDisconnected(Endpoint &endpoint) {
+  endpoint.output_publisher.setPublishCallback({});
+  d->endpoint_selector.setConnected(endpoint.index, false);
+
+  moveQueuedOutput(endpoint);
+}
+
+void ZeekConnection::moveQueuedOutput(Endpoint &endpoint) {
+  // Without a connected endpoint the output waits where it is, unless it
+  // can be spooled
+  if (!d->endpoint_selector.anyConnected() && !d->output_spool) {
+    return;
+  }
+
+  auto output_list = endpoint.output_publisher.takeQueuedOutput();
+
+  if (!output_list.empty()) {
+    d->logger.logMessage(IZeekLogger::Severity::Information,
+                         "Moving " + std::to_string(output_list.size()) +
+                             " queued outputs away from " + endpoint.name);
+  }
+
+  for (auto &output : output_list) {
+    storeOutput(std::move(output));
+  }
+}
+
+void ZeekConnection::replaySpooledOutput() {
+  if (!d->output_spool || d->output_spool->empty() ||
+      !d->endpoint_selector.anyConnected()) {
+    return;
+  }
+
+  auto current_time = std::chrono::steady_clock::now();
+  auto rows_per_second = d->configuration.output_spool.replay_rows_per_second;
+
+  // Allow bursts of up to one second worth of rows
+  if (rows_per_second != 0U) {
+    auto elapsed_time =
+        std::chrono::duration<double>(current_time - d->last_replay_time);
+
+    d->replay_row_budget =
+        std::min(d->replay_row_budget + elapsed_time.count() * rows_per_second,
+                 static_cast<double>(rows_per_second));
+  }
+
+  d->last_replay_time = current_time;
+
+  while (!d->output_spool->empty()) {
+    if (rows_per_second != 0U && d->replay_row_budget <= 0.0) {
+      return;
+    }
+
+    // Stop while a queue is full; its capacity callback wakes up the
+    // caller once there is room again
+    for (const auto &endpoint : d->endpoint_list) {
+      if (endpoint->connection_state == ConnectionState::Connected &&
+          !endpoint->output_publisher.hasCapacity()) {
+        return;
+      }
+    }
+
+    std::optional<OutputPublisher::Output> output;
+    auto status = d->output_spool->takeNext(output);
+
+    if (!status.succeeded()) {
+      d->logger.logMessage(IZeekLogger::Severity::Error,
+                           "Failed to read the output spool: " +
+                               status.message());
+      return;
+    }
+
+    if (!output.has_value()) {
+      break;
+    }
+
+    d->replay_row_budget -= static_cast<double>(
+        std::max<std::size_t>(output->query_output.size(), 1U));
+
+    routeOutput(std::move(output.value()));
+  }
+
+  auto stats = d->output_spool->stats();
+
+  d->logger.logMessage(IZeekLogger::Severity::Information,
+                       "The output spool has been replayed; " +
+                           std::to_string(stats.replayed_output_count) +
+                           " outputs replayed so far, " +
+                           std::to_string(stats.corrupted_record_count) +
+                           " damaged records skipped");
+}
+
+void ZeekConnection::scheduleReconnect(Endpoint &endpoint) {
+  auto delay = endpoint.reconnect_backoff.nextDelay();
+
+  endpoint.connection_state = ConnectionState::WaitingToReconnect;
+  endpoint.state_deadline = std::chrono::steady_clock::now() + delay;
+
+  d->logger.logMessage(IZeekLogger::Severity::Information,
+                       "Reconnecting to " + endpoint.name + " in " +
+                           std::to_string(delay.count()) + " ms");
+}
+
+broker::configuration
+ZeekConnection::getBrokerConfiguration(const Configuration &configuration) {
+  const auto &ca_file_path = configuration.certificate_authority;
+  const auto &cert_file_path = configuration.client_certificate;
+  const auto &key_file_path = configuration.client_key;
 
   broker::configuration config;
 
@@ -503,54 +946,68 @@ broker::configuration ZeekConnection::getBrokerConfiguration() {
 }
 
 Status ZeekConnection::createSubscription(const std::string &topic) {
-  if (d->subscriber_map.count(topic) != 0U) {
+  if (d->subscribed_topic_set.count(topic) != 0U) {
     return Status::failure(
         "A subscription already exists for the following topic: " + topic);
   }
 
-  auto subscriber = d->broker_endpoint->make_subscriber({topic});
-  d->subscriber_map.insert({topic, std::move(subscriber)});
+  for (auto &endpoint : d->endpoint_list) {
+    endpoint->subscriber.add_topic(topic);
+  }
+
+  d->subscribed_topic_set.insert(topic);
 
-  getLogger().logMessage(IZeekLogger::Severity::Information,
-                         "Subscribed to: " + topic);
+  d->logger.logMessage(IZeekLogger::Severity::Information,
+                       "Subscribed to: " + topic);
 
   return Status::success();
 }
 
 Status ZeekConnection::destroySubscription(const std::string &topic) {
-  auto subscriber_it = d->subscriber_map.find(topic);
-  if (subscriber_it == d->subscriber_map.end()) {
+  auto topic_it = d->subscribed_topic_set.find(topic);
+  if (topic_it == d->subscribed_topic_set.end()) {
     return Status::failure("The following topic has not been subscribed to: " +
                            topic);
   }
 
-  auto &subscriber = subscriber_it->second;
-  subscriber.remove_topic(topic);
+  for (auto &endpoint : d->endpoint_list) {
+    endpoint->subscriber.remove_topic(topic);
+  }
 
-  d->subscriber_map.erase(subscriber_it);
+  d->subscribed_topic_set.erase(topic_it);
   return Status::success();
 }
 
-Status ZeekConnection::getStatusEvents(StatusEventList &status_event_list) {
-  status_event_list = {};
-
-  auto status_message_list = d->status_subscriber.poll();
-  if (status_message_list.empty()) {
-    return Status::success();
-  }
+void ZeekConnection::getPeerEvents(Endpoint &endpoint,
+                                   PeerEventList &peer_event_list) {
+  peer_event_list = {};
 
-  for (const auto &status_message : status_message_list) {
+  for (const auto &status_message : endpoint.status_subscriber.poll()) {
     if (const auto &status = caf::get_if<broker::status>(&status_message)) {
-      status_event_list.push_back(status->code());
+      switch (status->code()) {
+      case broker::sc::peer_added:
+        peer_event_list.push_back(PeerEvent::Added);
+        break;
+
+      case broker::sc::peer_lost:
+      case broker::sc::peer_removed:
+        peer_event_list.push_back(PeerEvent::Lost);
+        break;
+
+      case broker::sc::unspecified:
+      default:
+        break;
+      }
     }
 
     if (const auto &error = caf::get_if<broker::error>(&status_message)) {
-      std::string message = caf::to_string(error->context()).c_str();
-      return Status::failure(message);
+      d->logger.logMessage(IZeekLogger::Severity::Warning,
+                           "Connection error (" + endpoint.name + "): " +
+                               std::string(caf::to_string(error->context())));
+
+      peer_event_list.push_back(PeerEvent::Failed);
     }
   }
-
-  return Status::success();
 }
 
 Status
@@ -559,51 +1016,66 @@ ZeekConnection::computeQueryOutputHash(std::uint64_t &hash,
 
   hash = 0U;
 
-  auto xxh64_state = createXXH64State();
-  if (!xxh64_state) {
-    return Status::failure("Failed to create the XXH64 state");
+  XXH3_state_t xxh3_state;
+  if (XXH3_64bits_reset(&xxh3_state) == XXH_ERROR) {
+    return Status::failure("Failed to initialize the XXH3 state");
   }
 
-  for (const auto &column_value : row) {
-    auto error = XXH64_update(xxh64_state.get(), column_value.name.c_str(),
-                              column_value.name.size());
+  auto updateHash = [&xxh3_state](const void *buffer,
+                                  std::size_t size) -> bool {
+    return XXH3_64bits_update(&xxh3_state, buffer, size) != XXH_ERROR;
+  };
+
+  // Strings are prefixed by their size and values by their type, so that
+  // different rows can not produce the same byte sequence
+  auto updateHashWithString = [&updateHash](const std::string &value) -> bool {
+    auto size = static_cast<std::uint64_t>(value.size());
+
+    return updateHash(&size, sizeof(size)) &&
+           updateHash(value.data(), value.size());
+  };
 
-    if (error == XXH_ERROR) {
+  auto updateHashWithType = [&updateHash](HashedValueType type) -> bool {
+    return updateHash(&type, sizeof(type));
+  };
+
+  for (const auto &column_value : row) {
+    if (!updateHashWithString(column_value.name)) {
       return Status::failure("Failed to compute the row hash");
     }
 
-    if (!column_value.data.has_value()) {
-      static const std::string kNullColumnValue{"<NULL>"};
+    bool succeeded{false};
 
-      error = XXH64_update(xxh64_state.get(), column_value.name.c_str(),
-                           column_value.name.size());
+    if (!column_value.data.has_value()) {
+      succeeded = updateHashWithType(HashedValueType::Null);
 
     } else {
       const auto &var = column_value.data.value();
 
       if (std::holds_alternative<std::string>(var)) {
-        const auto &string_value = std::get<std::string>(var);
-
-        error = XXH64_update(xxh64_state.get(), string_value.c_str(),
-                             string_value.size());
+        succeeded = updateHashWithType(HashedValueType::String) &&
+                    updateHashWithString(std::get<std::string>(var));
 
       } else if (std::holds_alternative<std::int64_t>(var)) {
         auto integer_value = std::get<std::int64_t>(var);
 
-        error = XXH64_update(xxh64_state.get(), &integer_value,
-                             sizeof(integer_value));
+        succeeded = updateHashWithType(HashedValueType::Integer) &&
+                    updateHash(&integer_value, sizeof(integer_value));
 
       } else {
-        return Status::failure("Invalid column type");
+        auto double_value = std::get<double>(var);
+
+        succeeded = updateHashWithType(HashedValueType::Double) &&
+                    updateHash(&double_value, sizeof(double_value));
       }
     }
 
-    if (error == XXH_ERROR) {
+    if (!succeeded) {
       return Status::failure("Failed to compute the row hash");
     }
   }
 
-  hash = XXH64_digest(xxh64_state.get());
+  hash = XXH3_64bits_digest(&xxh3_state);
   return Status::success();
 }
 
@@ -614,38 +1086,11 @@ std::string ZeekConnection::computeQueryID(const std::string &response_topic,
 }
 
 Status ZeekConnection::computeDifferentials(
-    DifferentialContext &context, DifferentialOutput &output,
-    const QueryScheduler::TaskOutput &task_output) {
+    DifferentialContext &context, PendingDifferentialContext &pending_context,
+    DifferentialOutput &output, const QueryScheduler::TaskOutput &task_output) {
 
   output = {};
 
-  // Generate new differential data for this query output
-  DifferentialData differential_data;
-  for (const auto &row : task_output.query_output) {
-    std::uint64_t row_hash = 0U;
-    auto status = computeQueryOutputHash(row_hash, row);
-    if (!status.succeeded()) {
-      return status;
-    }
-
-    differential_data.insert({row_hash, row});
-  }
-
-  // Look for the old differential data
-  auto query_id =
-      computeQueryID(task_output.response_topic, task_output.response_event,
-                     task_output.cookie);
-
-  auto old_differential_data_it = context.find(query_id);
-  if (old_differential_data_it == context.end()) {
-    context.insert({query_id, std::move(differential_data)});
-    output.added_row_list = task_output.query_output;
-
-    return Status::success();
-  }
-
-  auto &old_differential_data = old_differential_data_it->second;
-
   // Determine what kind of updates we are required to process
   bool process_rows_added{false};
   bool process_rows_removed{false};
@@ -668,26 +1113,95 @@ Status ZeekConnection::computeDifferentials(
     }
   }
 
-  // Put new rows in the added row list
-  if (process_rows_added) {
-    for (const auto &new_diff_p : differential_data) {
-      const auto &new_row_hash = new_diff_p.first;
-      const auto &new_row_output = new_diff_p.second;
+  auto query_id =
+      computeQueryID(task_output.response_topic, task_output.response_event,
+                     task_output.cookie);
+
+  // The first chunk starts a new execution; discard what is left of the
+  // previous one, if it has been interrupted
+  if (task_output.chunk_index == 0U) {
+    pending_context.erase(query_id);
+  }
+
+  auto pending_data_it = pending_context.find(query_id);
+  if (pending_data_it == pending_context.end()) {
+    PendingDifferentialData pending_data;
+    pending_data.complete = task_output.chunk_index == 0U;
 
-      if (old_differential_data.find(new_row_hash) ==
-          old_differential_data.end()) {
-        output.added_row_list.push_back(new_row_output);
+    pending_data_it =
+        pending_context.insert({query_id, std::move(pending_data)}).first;
+  }
+
+  auto &pending_data = pending_data_it->second;
+
+  // Look for the old differential data
+  auto old_differential_data_it = context.find(query_id);
+  auto first_execution = old_differential_data_it == context.end();
+
+  auto &differential_data = pending_data.differential_data;
+
+  // Report the new rows right away
+  for (const auto &row : task_output.query_output) {
+    std::uint64_t row_hash = 0U;
+    auto status = computeQueryOutputHash(row_hash, row);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    // The rows are only needed to report them once they are removed; the
+    // other queries only keep their hashes
+    auto inserted = differential_data.row_hash_set.insert(row_hash);
+    if (inserted && process_rows_removed) {
+      differential_data.row_map.insert({row_hash, row});
+    }
+
+    if (first_execution) {
+      output.added_row_list.push_back(row);
+
+    } else if (inserted && process_rows_added) {
+      const auto &old_differential_data = old_differential_data_it->second;
+
+      if (!old_differential_data.row_hash_set.contains(row_hash)) {
+        output.added_row_list.push_back(row);
       }
     }
   }
 
+  if (!task_output.last_chunk) {
+    return Status::success();
+  }
+
+  if (first_execution) {
+    context.insert({query_id, std::move(differential_data)});
+    pending_context.erase(pending_data_it);
+
+    return Status::success();
+  }
+
+  auto &old_differential_data = old_differential_data_it->second;
+
+  if (!pending_data.complete || task_output.aborted) {
+    // Part of the output is missing, so the rows we lost can not be
+    // determined; keep the old rows until the next execution
+    for (auto row_hash : differential_data.row_hash_set.hashList()) {
+      old_differential_data.row_hash_set.insert(row_hash);
+    }
+
+    for (auto &new_row_p : differential_data.row_map) {
+      old_differential_data.row_map.insert(std::move(new_row_p));
+    }
+
+    pending_context.erase(pending_data_it);
+    return Status::success();
+  }
+
   // Put the rows we lost in the removed row list
   if (process_rows_removed) {
-    for (const auto &old_diff_p : old_differential_data) {
-      const auto &old_row_hash = old_diff_p.first;
-      const auto &old_row_output = old_diff_p.second;
+    for (const auto &old_row_p : old_differential_data.row_map) {
+      const auto &old_row_hash = old_row_p.first;
+      const auto &old_row_output = old_row_p.second;
 
-      if (differential_data.find(old_row_hash) == differential_data.end()) {
+      if (!differential_data.row_hash_set.contains(old_row_hash)) {
         output.removed_row_list.push_back(old_row_output);
       }
     }
@@ -695,6 +1209,7 @@ Status ZeekConnection::computeDifferentials(
 
   // Update the differential data inside the context structure
   std::swap(old_differential_data, differential_data);
+  pending_context.erase(pending_data_it);
 
   return Status::success();
 }
@@ -722,6 +1237,13 @@ ZeekConnection::scheduledTaskFromZeekEvent(QueryScheduler::Task &task,
     task.cookie = getZeekEventCookie(event);
     task.response_topic = getZeekEventResponseTopic(event);
     task.interval = getZeekEventInterval(event);
+    task.trigger = getZeekEventTrigger(event);
+
+    // Triggered queries can opt out of the periodic execution
+    if (task.trigger.has_value() &&
+        task.interval.value() == std::chrono::milliseconds(0)) {
+      task.interval = std::nullopt;
+    }
 
     auto update_type = getZeekEventUpdateType(event);
     if (update_type == "ADDED") {
@@ -781,10 +1303,13 @@ Status ZeekConnection::taskFromZeekEvent(QueryScheduler::Task &task,
   const auto &event_name = event.name();
 
   if (event_name == kHostSubscribeEvent ||
-      event_name == kHostUnsubscribeEvent || event_name == kHostExecuteEvent) {
+      event_name == kHostUnsubscribeEvent) {
 
     return scheduledTaskFromZeekEvent(task, event);
 
+  } else if (event_name == kHostExecuteEvent) {
+    return oneShotTaskFromZeekEvent(task, event);
+
   } else {
     task = {};
     return Status::failure("Invalid event name: " + event_name);
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "activitynotifier.h"
+#include "endpointselector.h"
+#include "outputpublisher.h"
+#include "outputspool.h"
 #include "queryscheduler.h"
+#include "reconnectbackoff.h"
+#include "rowhashset.h"
 
 #include <memory>
 #include <optional>
@@ -17,10 +23,14 @@
 #pragma warning(pop)
 #endif
 
+#include <zeek/izeekconfiguration.h>
+#include <zeek/izeeklogger.h>
 #include <zeek/status.h>
 
 namespace zeek {
-/// \brief A handler for the connection to the Zeek server
+/// \brief A handler for the connections to the Zeek servers. Each server
+///        endpoint has its own broker endpoint, connection state and
+///        output queue
 class ZeekConnection final {
   struct PrivateData;
   std::unique_ptr<PrivateData> d;
@@ -29,12 +39,92 @@ public:
   /// \brief A reference to a connection object
   using Ref = std::unique_ptr<ZeekConnection>;
 
+  /// \brief Connection settings
+  struct Configuration final {
+    /// \brief The UUID of the system, or the hostname if it was not possible
+    ///        to acquire it
+    std::string host_identifier;
+
+    /// \brief The Zeek server endpoints, and how the output is distributed
+    ///        across them
+    IZeekConfiguration::ServerEndpoints server_endpoints;
+
+    /// \brief The Zeek groups to join after connecting
+    std::vector<std::string> group_list;
+
+    /// \brief Path to the certificate authority. TLS is only enabled when
+    ///        all three paths are set
+    std::string certificate_authority;
+
+    /// \brief Path to the client certificate
+    std::string client_certificate;
+
+    /// \brief Path to the client key
+    std::string client_key;
+
+    /// \brief Settings for the batched wire mode
+    IZeekConfiguration::ZeekEventBatching event_batching;
+
+    /// \brief Settings for the reconnection to the Zeek servers
+    IZeekConfiguration::Reconnect reconnect;
+
+    /// \brief Settings for the disk spool that keeps the output while no
+    ///        server is connected
+    IZeekConfiguration::OutputSpool output_spool;
+  };
+
+  /// \brief The output publishers, one for each server endpoint
+  using OutputPublisherList = std::vector<OutputPublisher *>;
+
+  /// \brief The differential context for a single table, used to calculate
+  ///        differential output
+  struct DifferentialData final {
+    /// \brief The hashes of the rows returned by the last execution
+    RowHashSet row_hash_set;
+
+    /// \brief The rows returned by the last execution. They are only kept
+    ///        for the queries that report removed rows
+    std::unordered_map<std::uint64_t, IVirtualDatabase::OutputRow> row_map;
+  };
+
+  /// \brief The global differentinal context for all tables, used to calculate
+  ///        differential output
+  using DifferentialContext = std::unordered_map<std::string, DifferentialData>;
+
+  /// \brief The differential data collected from the output chunks of a
+  ///        query execution that has not been fully received yet
+  struct PendingDifferentialData final {
+    /// \brief The rows received so far
+    DifferentialData differential_data;
+
+    /// \brief False when the first chunks have been lost (i.e. they have been
+    ///        received by a previous connection)
+    bool complete{true};
+  };
+
+  /// \brief The pending differential data for all tables
+  using PendingDifferentialContext =
+      std::unordered_map<std::string, PendingDifferentialData>;
+
   /// \brief Factory method
   /// \param obj Where the created object is stored
-  /// \param host_identifier The UUID of the system, or the hostname
-  ///                        if it was not possible to acquire it
-  /// \return A Status object
-  static Status create(Ref &obj, const std::string &host_identifier);
+  /// \param logger The reference to a valid logger object
+  /// \param configuration The connection settings
+  /// \param activity_notifier Interrupts the wait for new events when
+  ///                          signaled
+  /// \param differential_context The differential context; it is owned by
+  ///                             the caller, so that it can be reused
+  ///                             after a reconnect
+  /// \param output_publisher_list Publish the task output, one for each
+  ///                              server endpoint (in the same order); they
+  ///                              are owned by the caller
+  /// \return A Status object. The connections are established in the
+  ///         background, by processEvents
+  static Status create(Ref &obj, IZeekLogger &logger,
+                       const Configuration &configuration,
+                       ActivityNotifier &activity_notifier,
+                       DifferentialContext &differential_context,
+                       const OutputPublisherList &output_publisher_list);
 
   /// \brief Destructor
   ~ZeekConnection();
@@ -49,15 +139,21 @@ public:
   /// \return A Status object
   Status leaveGroup(const std::string &name);
 
-  /// \brief Updates the connection state
-  /// \return A Status object
+  /// \brief Waits for new events, then updates the connection states:
+  ///        lost connections are retried after a random backoff, without
+  ///        blocking the caller. The spooled output is replayed once an
+  ///        endpoint is connected
+  /// \return A Status object; connection failures are not errors
   Status processEvents();
 
+  /// \return True if at least one server endpoint is connected
+  bool isConnected() const;
+
   /// \return Returns the list of queued tasks
   QueryScheduler::TaskQueue getTaskQueue();
 
-  /// \brief Processes the given list of task outputs, dispatching the
-  ///        results to the Zeek instance
+  /// \brief Processes the given list of task outputs, queueing the
+  ///        results for the output publisher
   /// \param task_output_list A list of task outputs
   /// \return A Status object
   Status processTaskOutputList(QueryScheduler::TaskOutputList task_output_list);
@@ -67,12 +163,26 @@ public:
 
 private:
   /// \brief Constructor
-  /// \param host_identifier The UUID of the system, or the hostname
-  ///                        if it was not possible to acquire it
-  ZeekConnection(const std::string &host_identifier);
-
+  /// \param logger The reference to a valid logger object
+  /// \param configuration The connection settings
+  /// \param activity_notifier Interrupts the wait for new events when
+  ///                          signaled
+  /// \param differential_context The differential context
+  /// \param output_publisher_list Publish the task output, one for each
+  ///                              server endpoint
+  ZeekConnection(IZeekLogger &logger, const Configuration &configuration,
+                 ActivityNotifier &activity_notifier,
+                 DifferentialContext &differential_context,
+                 const OutputPublisherList &output_publisher_list);
+
+  /// \brief The broker endpoint and the connection state of a single
+  ///        server endpoint
+  struct Endpoint;
+
+  /// \param configuration The connection settings
   /// \return The broker configuration
-  broker::configuration getBrokerConfiguration();
+  static broker::configuration
+  getBrokerConfiguration(const Configuration &configuration);
 
   /// \brief Subscribes to a new broker topic
   /// \param topic The topic name
@@ -84,49 +194,114 @@ private:
   /// \return A Status object
   Status destroySubscription(const std::string &topic);
 
-  /// \brief A list of broker status events
-  using StatusEventList = std::vector<broker::sc>;
+  /// \brief The states of the connection to the Zeek server
+  enum class ConnectionState {
+    /// \brief Waiting for the backoff delay to expire
+    WaitingToReconnect,
 
-  /// \brief Updates the connection status
-  /// \param status_event_list Where the new status list is stored
-  /// \return A Status object
-  Status getStatusEvents(StatusEventList &status_event_list);
+    /// \brief A connection attempt is in progress
+    Connecting,
+
+    /// \brief The connection is established
+    Connected
+  };
 
-  /// \brief Waits for new events, timing out after 1 second
-  /// \param ready This boolean is set to true if there is incoming data
-  ///              that can be read
+  /// \brief Peering changes, as reported by the broker status subscriber
+  enum class PeerEvent { Added, Lost, Failed };
+
+  /// \brief A list of peering changes
+  using PeerEventList = std::vector<PeerEvent>;
+
+  /// \brief Collects the pending peering changes
+  /// \param endpoint The server endpoint
+  /// \param peer_event_list Where the peering changes are stored
+  void getPeerEvents(Endpoint &endpoint, PeerEventList &peer_event_list);
+
+  /// \brief Advances the connection state machine
+  /// \param endpoint The server endpoint
+  /// \param peer_event The peering change to handle
+  void handlePeerEvent(Endpoint &endpoint, PeerEvent peer_event);
+
+  /// \brief Starts a new connection attempt, or gives up on the current
+  ///        one, once the deadline of the current state has expired
+  /// \param endpoint The server endpoint
+  void updateConnectionState(Endpoint &endpoint);
+
+  /// \brief Starts a new connection attempt
+  /// \param endpoint The server endpoint
+  void connect(Endpoint &endpoint);
+
+  /// \brief Announces the agent to the Zeek server and starts publishing
+  ///        the queued output
+  /// \param endpoint The server endpoint
+  void onConnected(Endpoint &endpoint);
+
+  /// \brief Pauses the output of a lost endpoint, moving its queue to the
+  ///        other endpoints when possible
+  /// \param endpoint The server endpoint
+  void onDisconnected(Endpoint &endpoint);
+
+  /// \brief Moves the output queued on a disconnected endpoint to the
+  ///        connected ones, or to the output spool
+  /// \param endpoint The server endpoint
+  void moveQueuedOutput(Endpoint &endpoint);
+
+  /// \brief Moves the spooled output to the endpoint queues, within the
+  ///        replay rate limit and while the queues have room
+  void replaySpooledOutput();
+
+  /// \brief Schedules the next connection attempt after a random backoff
+  /// \param endpoint The server endpoint
+  void scheduleReconnect(Endpoint &endpoint);
+
+  /// \brief Handles a request received from a Zeek server
+  /// \param endpoint The server endpoint the request came from
+  /// \param event The Zeek event
+  void processZeekEvent(const Endpoint &endpoint,
+                        const broker::zeek::Event &event);
+
+  /// \brief Waits for new events, status events or a signal from the
+  ///        activity notifier, timing out after 1 second, when the
+  ///        deadline of a connection state expires or when the spooled
+  ///        output can be replayed
   /// \return A Status object
-  Status waitForActivity(bool &ready);
+  Status waitForActivity();
 
-  /// \brief Processes the output for a single task, dispatching results to
-  ///        the Zeek instance
+  /// \brief Processes the output for a single task, queueing the results
+  ///        for the output publisher
   /// \param task_output The task output that needs to be processed
   /// \return A Status object
-  Status processTaskOutput(const QueryScheduler::TaskOutput &task_output);
+  Status processTaskOutput(QueryScheduler::TaskOutput task_output);
+
+  /// \brief Queues the given output on the endpoint selected for it. With
+  ///        the failover policy, this is the endpoint that sent the request
+  ///        while it is connected
+  /// \param output The output to queue
+  void routeOutput(OutputPublisher::Output output);
+
+  /// \brief Spools the given output while no endpoint is connected, or
+  ///        while older output is still spooled; routes it otherwise
+  /// \param output The output to store
+  void storeOutput(OutputPublisher::Output output);
 
-  /// \brief Publishes the given task output message to Zeek
+  /// \brief Queues the given rows for the output publisher, unless empty
   /// \param trigger The reason this task was run (differential change or
   ///                snapshot)
-  /// \param response_topic The output topic
-  /// \param response_event The event name
-  /// \param cookie The id that identifies this task
-  /// \param query_output The query results associated with this task
-  void publishTaskOutput(const std::string &trigger,
-                         const std::string &response_topic,
-                         const std::string &response_event,
-                         const std::string &cookie,
-                         const IVirtualDatabase::QueryOutput &query_output);
+  /// \param task_output The task output the rows come from
+  /// \param query_output The rows to publish
+  /// \param snapshot True if the rows are a full snapshot
+  void queueTaskOutput(const std::string &trigger,
+                       const QueryScheduler::TaskOutput &task_output,
+                       IVirtualDatabase::QueryOutput query_output,
+                       bool snapshot);
+
+  /// \brief Publishes the given task output message to Zeek. Invoked from
+  ///        the output publisher thread of the endpoint
+  /// \param endpoint The server endpoint
+  /// \param output The output to publish
+  void publishTaskOutput(Endpoint &endpoint, OutputPublisher::Output output);
 
 public:
-  /// \brief The differential context for a single table, used to calculate
-  ///        differential output
-  using DifferentialData =
-      std::unordered_map<std::uint64_t, IVirtualDatabase::OutputRow>;
-
-  /// \brief The global differentinal context for all tables, used to calculate
-  ///        differential output
-  using DifferentialContext = std::unordered_map<std::string, DifferentialData>;
-
   /// \brief Differential output
   struct DifferentialOutput final {
     /// \brief List of added rows
@@ -153,14 +328,21 @@ public:
                                     const std::string &response_event,
                                     const std::string &cookie);
 
-  /// \brief Computes differentials for the given query output, updating the
-  ///        differential context
+  /// \brief Computes differentials for the given query output chunk. New
+  ///        rows are reported right away, while the removed rows are only
+  ///        reported (and the differential context updated) once the last
+  ///        chunk has been received. Nothing is removed when the execution
+  ///        has been aborted
   /// \param context The differential context, updated on return
+  /// \param pending_context The rows received from the chunks of the
+  ///                        executions that are still in progress
   /// \param output The differential output
-  /// \param task_output The full task output
+  /// \param task_output The task output chunk
   /// \return A Status object
   static Status
-  computeDifferentials(DifferentialContext &context, DifferentialOutput &output,
+  computeDifferentials(DifferentialContext &context,
+                       PendingDifferentialContext &pending_context,
+                       DifferentialOutput &output,
                        const QueryScheduler::TaskOutput &task_output);
 
   /// \brief Creates a new scheduled task from the given broker event
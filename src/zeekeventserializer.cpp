@@ -0,0 +1,230 @@
+#include "zeekeventserializer.h"
+
+#include <algorithm>
+
+namespace zeek {
+namespace {
+/// \brief Appended to the response event name of the batched events
+const std::string kBatchEventSuffix{"_batch"};
+
+ZeekEventSerializer::ColumnEncoder
+getColumnEncoder(const IVirtualTable::Variant &column_variant) {
+  if (std::holds_alternative<std::string>(column_variant)) {
+    return ZeekEventSerializer::ColumnEncoder::String;
+
+  } else if (std::holds_alternative<std::int64_t>(column_variant)) {
+    return ZeekEventSerializer::ColumnEncoder::Integer;
+
+  } else {
+    return ZeekEventSerializer::ColumnEncoder::Double;
+  }
+}
+} // namespace
+
+ZeekEventSerializer::ZeekEventSerializer(
+    const IZeekConfiguration::ZeekEventBatching &batching_)
+    : batching(batching_) {}
+
+void ZeekEventSerializer::serialize(
+    EventList &event_list, std::size_t &null_column_count,
+    const std::string &host_identifier, const std::string &trigger,
+    const std::string &response_event, const std::string &cookie,
+    IVirtualDatabase::QueryOutput query_output) const {
+
+  event_list.clear();
+  null_column_count = 0U;
+
+  if (query_output.empty()) {
+    return;
+  }
+
+  // clang-format off
+  broker::vector message_header(
+    {
+      broker::data(host_identifier),
+      broker::data(broker::data(broker::enum_value{trigger})),
+      broker::data(cookie)
+    }
+  );
+  // clang-format on
+
+  auto column_encoder_plan = createColumnEncoderPlan(query_output);
+
+  auto encodeRow = [&column_encoder_plan, &null_column_count](
+                       broker::vector &destination,
+                       IVirtualDatabase::OutputRow &row) -> std::size_t {
+    std::size_t byte_count{0U};
+
+    for (std::size_t i = 0U; i < row.size(); ++i) {
+      auto encoder = i < column_encoder_plan.size() ? column_encoder_plan[i]
+                                                    : ColumnEncoder::Unknown;
+
+      destination.push_back(encodeColumn(encoder, row[i].data, byte_count,
+                                         null_column_count));
+    }
+
+    return byte_count;
+  };
+
+  if (batching.max_row_count == 0U) {
+    event_list.reserve(query_output.size());
+
+    for (auto &row : query_output) {
+      broker::vector message_data;
+      message_data.reserve(row.size() + 1U);
+      message_data.push_back(broker::data(message_header));
+
+      encodeRow(message_data, row);
+
+      event_list.emplace_back(response_event, std::move(message_data));
+    }
+
+    return;
+  }
+
+  std::size_t max_row_count{batching.max_row_count};
+
+  event_list.reserve((query_output.size() + max_row_count - 1U) /
+                     max_row_count);
+
+  auto batch_event_name = response_event + kBatchEventSuffix;
+
+  broker::vector row_batch;
+  std::size_t row_batch_byte_count{0U};
+
+  auto flushRowBatch = [&]() {
+    if (row_batch.empty()) {
+      return;
+    }
+
+    broker::vector message_data;
+    message_data.reserve(2U);
+    message_data.push_back(broker::data(message_header));
+    message_data.push_back(broker::data(std::move(row_batch)));
+
+    event_list.emplace_back(batch_event_name, std::move(message_data));
+
+    row_batch = {};
+    row_batch_byte_count = 0U;
+  };
+
+  for (std::size_t row_index = 0U; row_index < query_output.size();
+       ++row_index) {
+
+    auto &row = query_output[row_index];
+
+    broker::vector column_list;
+    column_list.reserve(row.size());
+
+    auto row_byte_count = encodeRow(column_list, row);
+
+    if (!row_batch.empty() &&
+        row_batch_byte_count + row_byte_count > batching.max_byte_count) {
+      flushRowBatch();
+    }
+
+    if (row_batch.empty()) {
+      row_batch.reserve(
+          std::min(max_row_count, query_output.size() - row_index));
+    }
+
+    row_batch.push_back(broker::data(std::move(column_list)));
+    row_batch_byte_count += row_byte_count;
+
+    if (row_batch.size() >= max_row_count) {
+      flushRowBatch();
+    }
+  }
+
+  flushRowBatch();
+}
+
+ZeekEventSerializer::ColumnEncoderPlan
+ZeekEventSerializer::createColumnEncoderPlan(
+    const IVirtualDatabase::QueryOutput &query_output) {
+
+  ColumnEncoderPlan column_encoder_plan;
+  if (query_output.empty()) {
+    return column_encoder_plan;
+  }
+
+  column_encoder_plan.resize(query_output.front().size(),
+                             ColumnEncoder::Unknown);
+
+  auto unknown_column_count = column_encoder_plan.size();
+
+  for (const auto &row : query_output) {
+    if (unknown_column_count == 0U) {
+      break;
+    }
+
+    auto column_count = std::min(row.size(), column_encoder_plan.size());
+
+    for (std::size_t i = 0U; i < column_count; ++i) {
+      auto &encoder = column_encoder_plan[i];
+      if (encoder != ColumnEncoder::Unknown || !row[i].data.has_value()) {
+        continue;
+      }
+
+      encoder = getColumnEncoder(row[i].data.value());
+      --unknown_column_count;
+    }
+  }
+
+  return column_encoder_plan;
+}
+
+broker::data
+ZeekEventSerializer::encodeColumn(ColumnEncoder encoder,
+                                  IVirtualTable::OptionalVariant &column_data,
+                                  std::size_t &byte_count,
+                                  std::size_t &null_column_count) {
+
+  if (!column_data.has_value()) {
+    ++null_column_count;
+    ++byte_count;
+
+    return broker::data();
+  }
+
+  auto &column_variant = column_data.value();
+
+  // A column whose values do not all share the same type is encoded with
+  // the type of each value
+  if (encoder == ColumnEncoder::Unknown) {
+    encoder = getColumnEncoder(column_variant);
+  }
+
+  switch (encoder) {
+  case ColumnEncoder::String:
+    if (auto string_value = std::get_if<std::string>(&column_variant)) {
+      byte_count += string_value->size();
+      return broker::data(std::move(*string_value));
+    }
+
+    break;
+
+  case ColumnEncoder::Integer:
+    if (auto integer_value = std::get_if<std::int64_t>(&column_variant)) {
+      byte_count += sizeof(std::int64_t);
+      return broker::data(*integer_value);
+    }
+
+    break;
+
+  case ColumnEncoder::Double:
+    if (auto double_value = std::get_if<double>(&column_variant)) {
+      byte_count += sizeof(double);
+      return broker::data(*double_value);
+    }
+
+    break;
+
+  case ColumnEncoder::Unknown:
+    break;
+  }
+
+  return encodeColumn(getColumnEncoder(column_variant), column_data,
+                      byte_count, null_column_count);
+}
+} // namespace zeek
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267)
+#endif
+
+#include <broker/broker.hh>
+
+#ifdef WIN32
+#pragma warning(pop)
+#endif
+
+#include <zeek/ivirtualdatabase.h>
+#include <zeek/izeekconfiguration.h>
+
+namespace zeek {
+/// \brief Converts query output to the Zeek events that carry it
+///
+/// Each row is sent as its own event, unless batching is enabled; each event
+/// is then named response_event + "_batch", and carries the message header
+/// followed by a vector of rows.
+///
+/// The column types are resolved once per query output, so that each cell
+/// is encoded without going through the whole list of types. The event
+/// arguments are allocated with their final size, and strings are moved out
+/// of the query output instead of being copied
+class ZeekEventSerializer final {
+public:
+  /// \brief A list of Zeek events
+  using EventList = std::vector<broker::zeek::Event>;
+
+  /// \brief How the values of a column are encoded
+  enum class ColumnEncoder { Unknown, String, Integer, Double };
+
+  /// \brief The encoder used for each column of a query output
+  using ColumnEncoderPlan = std::vector<ColumnEncoder>;
+
+  /// \brief Constructor
+  /// \param batching The batching settings
+  ZeekEventSerializer(const IZeekConfiguration::ZeekEventBatching &batching);
+
+  /// \brief Converts the given query output to Zeek events
+  /// \param event_list Where the events are stored. The list is cleared
+  ///                   first, so that its storage can be reused across calls
+  /// \param null_column_count How many NULL columns are being sent; they
+  ///                          may not be correctly supported by Zeek
+  /// \param host_identifier The identifier of this host
+  /// \param trigger The reason this task was run (differential change or
+  ///                snapshot)
+  /// \param response_event The event name
+  /// \param cookie The id that identifies this task
+  /// \param query_output The query results associated with this task; the
+  ///                     string values are moved out
+  void serialize(EventList &event_list, std::size_t &null_column_count,
+                 const std::string &host_identifier,
+                 const std::string &trigger, const std::string &response_event,
+                 const std::string &cookie,
+                 IVirtualDatabase::QueryOutput query_output) const;
+
+  /// \param query_output A query output
+  /// \return The encoder of each column, taken from the first row that has
+  ///         a value for it
+  static ColumnEncoderPlan
+  createColumnEncoderPlan(const IVirtualDatabase::QueryOutput &query_output);
+
+private:
+  /// \brief Encodes a single cell
+  /// \param encoder The encoder planned for this column
+  /// \param column_data The cell value; strings are moved out
+  /// \param byte_count Incremented with the estimated size of the value
+  /// \param null_column_count Incremented when the cell is NULL
+  /// \return The encoded value
+  static broker::data encodeColumn(ColumnEncoder encoder,
+                                   IVirtualTable::OptionalVariant &column_data,
+                                   std::size_t &byte_count,
+                                   std::size_t &null_column_count);
+
+  /// \brief The batching settings
+  IZeekConfiguration::ZeekEventBatching batching;
+};
+} // namespace zeek
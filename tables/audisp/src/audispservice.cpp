@@ -1,5 +1,6 @@
 #include "audispservice.h"
 #include "fileeventstableplugin.h"
+#include "pathfiltertableplugin.h"
 #include "processeventstableplugin.h"
 #include "socketeventstableplugin.h"
 
@@ -8,6 +9,7 @@
 
 #include <zeek/audispservicefactory.h>
 #include <zeek/iaudispconsumer.h>
+#include <zeek/ratelimitertableplugin.h>
 
 namespace zeek {
 namespace {
@@ -30,11 +32,23 @@ struct AudispService::PrivateData final {
   IVirtualTable::Ref process_events_table;
   IVirtualTable::Ref socket_events_table;
   IVirtualTable::Ref file_events_table;
+  IVirtualTable::Ref path_filters_table;
+  IVirtualTable::Ref rate_limits_table;
 };
 
 AudispService::~AudispService() {
   auto status =
-      d->virtual_database.unregisterTable(d->process_events_table->name());
+      d->virtual_database.unregisterTable(d->rate_limits_table->name());
+
+  assert(status.succeeded() &&
+         "Failed to unregister the event_rate_limits table");
+
+  status = d->virtual_database.unregisterTable(d->path_filters_table->name());
+
+  assert(status.succeeded() &&
+         "Failed to unregister the file_events_path_filters table");
+
+  status = d->virtual_database.unregisterTable(d->process_events_table->name());
 
   assert(status.succeeded() && "Failed to unregister the process_events table");
 
@@ -66,10 +80,8 @@ Status AudispService::exec(std::atomic_bool &terminate) {
     IAudispConsumer::AuditEventList event_list;
     d->audisp_consumer->getEvents(event_list);
 
-    if (event_list.empty()) {
-      continue;
-    }
-
+    // The tables are updated even when there are no new events, so that
+    // they can release the rows whose coalescing window has expired
     status = process_events_table_impl.processEvents(event_list);
     if (!status.succeeded()) {
       d->logger.logMessage(
@@ -142,6 +154,46 @@ AudispService::AudispService(IVirtualDatabase &virtual_database,
   if (!status.succeeded()) {
     throw status;
   }
+
+  auto &file_events_table_impl =
+      *static_cast<FileEventsTablePlugin *>(d->file_events_table.get());
+
+  status = PathFilterTablePlugin::create(d->path_filters_table,
+                                         file_events_table_impl.pathFilter());
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = d->virtual_database.registerTable(d->path_filters_table);
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  auto &process_events_table_impl =
+      *static_cast<ProcessEventsTablePlugin *>(d->process_events_table.get());
+
+  auto &socket_events_table_impl =
+      *static_cast<SocketEventsTablePlugin *>(d->socket_events_table.get());
+
+  RateLimiterTablePlugin::RateLimiterMap rate_limiter_map = {
+      {d->process_events_table->name(),
+       &process_events_table_impl.rateLimiter()},
+
+      {d->socket_events_table->name(),
+       &socket_events_table_impl.rateLimiter()},
+
+      {d->file_events_table->name(), &file_events_table_impl.rateLimiter()}};
+
+  status = RateLimiterTablePlugin::create(
+      d->rate_limits_table, "event_rate_limits", rate_limiter_map);
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = d->virtual_database.registerTable(d->rate_limits_table);
+  if (!status.succeeded()) {
+    throw status;
+  }
 }
 
 struct AudispServiceFactory::PrivateData final {
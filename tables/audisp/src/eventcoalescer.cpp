@@ -0,0 +1,163 @@
+#include "eventcoalescer.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace zeek {
+namespace {
+const std::string kTimeColumnName{"time"};
+
+struct PendingRow final {
+  std::int64_t count{0};
+  std::int64_t first_time{0};
+  std::int64_t last_time{0};
+};
+
+using PendingRowMap = std::map<IVirtualTable::Row, PendingRow>;
+
+std::int64_t getRowTime(const IVirtualTable::Row &row) {
+  auto time_it = row.find(kTimeColumnName);
+  if (time_it == row.end() || !time_it->second.has_value()) {
+    return 0;
+  }
+
+  const auto &time_value = time_it->second.value();
+  if (!std::holds_alternative<std::int64_t>(time_value)) {
+    return 0;
+  }
+
+  return std::get<std::int64_t>(time_value);
+}
+
+void setCoalescingColumns(IVirtualTable::Row &row,
+                          const PendingRow &pending_row) {
+  row[kTimeColumnName] = pending_row.first_time;
+  row["count"] = pending_row.count;
+  row["first_time"] = pending_row.first_time;
+  row["last_time"] = pending_row.last_time;
+}
+} // namespace
+
+struct EventCoalescer::PrivateData final {
+  std::int64_t window{0};
+  std::size_t max_pending_row_count{0U};
+
+  PendingRowMap pending_row_map;
+
+  /// \brief Pending rows, in the order they have been created. Since the
+  ///        window is fixed, this is also the order in which they expire
+  std::deque<PendingRowMap::iterator> pending_row_queue;
+};
+
+Status EventCoalescer::create(Ref &obj, std::uint32_t window,
+                              std::size_t max_pending_row_count) {
+  try {
+    obj.reset();
+
+    auto ptr = new EventCoalescer(window, max_pending_row_count);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+EventCoalescer::~EventCoalescer() {}
+
+std::size_t EventCoalescer::addRow(IVirtualTable::RowList &row_list,
+                                   IVirtualTable::Row row) {
+  auto initial_row_count = row_list.size();
+  auto event_time = getRowTime(row);
+
+  if (d->window == 0) {
+    PendingRow pending_row;
+    pending_row.count = 1;
+    pending_row.first_time = pending_row.last_time = event_time;
+
+    setCoalescingColumns(row, pending_row);
+    row_list.push_back(std::move(row));
+
+    return 1U;
+  }
+
+  flush(row_list, event_time);
+
+  row.erase(kTimeColumnName);
+
+  auto pending_row_it = d->pending_row_map.find(row);
+  if (pending_row_it != d->pending_row_map.end()) {
+    auto &pending_row = pending_row_it->second;
+
+    pending_row.count++;
+    pending_row.last_time = std::max(pending_row.last_time, event_time);
+
+    return row_list.size() - initial_row_count;
+  }
+
+  if (d->pending_row_map.size() >= d->max_pending_row_count) {
+    releaseOldestRow(row_list);
+  }
+
+  PendingRow pending_row;
+  pending_row.count = 1;
+  pending_row.first_time = pending_row.last_time = event_time;
+
+  auto insert_status =
+      d->pending_row_map.insert({std::move(row), std::move(pending_row)});
+
+  d->pending_row_queue.push_back(insert_status.first);
+  return row_list.size() - initial_row_count;
+}
+
+std::size_t EventCoalescer::flush(IVirtualTable::RowList &row_list,
+                                  std::int64_t current_time) {
+  auto initial_row_count = row_list.size();
+
+  while (!d->pending_row_queue.empty()) {
+    const auto &pending_row = d->pending_row_queue.front()->second;
+    if (pending_row.first_time + d->window > current_time) {
+      break;
+    }
+
+    releaseOldestRow(row_list);
+  }
+
+  return row_list.size() - initial_row_count;
+}
+
+std::size_t EventCoalescer::pendingRowCount() const {
+  return d->pending_row_map.size();
+}
+
+EventCoalescer::EventCoalescer(std::uint32_t window,
+                               std::size_t max_pending_row_count)
+    : d(new PrivateData) {
+
+  if (window != 0U && max_pending_row_count == 0U) {
+    throw Status::failure("The pending row count must be greater than zero");
+  }
+
+  d->window = static_cast<std::int64_t>(window);
+  d->max_pending_row_count = max_pending_row_count;
+}
+
+void EventCoalescer::releaseOldestRow(IVirtualTable::RowList &row_list) {
+  if (d->pending_row_queue.empty()) {
+    return;
+  }
+
+  auto pending_row_it = d->pending_row_queue.front();
+  d->pending_row_queue.pop_front();
+
+  auto row = pending_row_it->first;
+  setCoalescingColumns(row, pending_row_it->second);
+
+  d->pending_row_map.erase(pending_row_it);
+  row_list.push_back(std::move(row));
+}
+} // namespace zeek
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+
+#include <zeek/ivirtualtable.h>
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief Merges identical event rows received within a time window into a
+///        single row, adding the `count`, `first_time` and `last_time` columns
+///
+/// Two rows are considered identical when all their columns except `time`
+/// match. This class is not thread safe; callers are expected to protect it
+/// with the same lock used for their own row list
+class EventCoalescer final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to an event coalescer object
+  using Ref = std::unique_ptr<EventCoalescer>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param window How many seconds identical rows are merged for. Setting
+  ///               this to zero disables coalescing
+  /// \param max_pending_row_count How many distinct rows can be held back
+  ///                              before the oldest ones are released early
+  /// \return A Status object
+  static Status create(Ref &obj, std::uint32_t window,
+                       std::size_t max_pending_row_count);
+
+  /// \brief Destructor
+  ~EventCoalescer();
+
+  /// \brief Adds a new row. Rows that are ready are appended to row_list
+  /// \param row_list Where the rows that are ready are stored
+  /// \param row The new row. It must contain a `time` column
+  /// \return How many rows have been appended to row_list; rows merged into
+  ///         a pending row are not counted
+  std::size_t addRow(IVirtualTable::RowList &row_list, IVirtualTable::Row row);
+
+  /// \brief Releases the rows whose window has elapsed
+  /// \param row_list Where the rows that are ready are stored
+  /// \param current_time The current time, in seconds
+  /// \return How many rows have been appended to row_list
+  std::size_t flush(IVirtualTable::RowList &row_list,
+                    std::int64_t current_time);
+
+  /// \return How many distinct rows are currently held back
+  std::size_t pendingRowCount() const;
+
+  EventCoalescer(const EventCoalescer &) = delete;
+  EventCoalescer &operator=(const EventCoalescer &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param window How many seconds identical rows are merged for
+  /// \param max_pending_row_count How many distinct rows can be held back
+  EventCoalescer(std::uint32_t window, std::size_t max_pending_row_count);
+
+  /// \brief Releases the oldest pending row
+  /// \param row_list Where the released row is stored
+  void releaseOldestRow(IVirtualTable::RowList &row_list);
+};
+} // namespace zeek
@@ -1,9 +1,13 @@
 #include "fileeventstableplugin.h"
+#include "eventcoalescer.h"
 
 #include <chrono>
 #include <filesystem>
 #include <mutex>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace zeek {
 struct FileEventsTablePlugin::PrivateData final {
   PrivateData(IZeekConfiguration &configuration_, IZeekLogger &logger_)
@@ -15,6 +19,13 @@ struct FileEventsTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  EventCoalescer::Ref event_coalescer;
+  RateLimiter::Ref rate_limiter;
+
+  TableUpdateNotifier update_notifier;
+
+  PathFilter::Ref path_filter;
 };
 
 Status FileEventsTablePlugin::create(Ref &obj,
@@ -55,36 +66,68 @@ const FileEventsTablePlugin::Schema &FileEventsTablePlugin::schema() const {
       {"exe", IVirtualTable::ColumnType::String},
       {"path", IVirtualTable::ColumnType::String},
       {"inode", IVirtualTable::ColumnType::Integer},
-      {"time", IVirtualTable::ColumnType::Integer}};
+      {"time", IVirtualTable::ColumnType::Integer},
+      {"count", IVirtualTable::ColumnType::Integer},
+      {"first_time", IVirtualTable::ColumnType::Integer},
+      {"last_time", IVirtualTable::ColumnType::Integer}};
 
   return kTableSchema;
 }
 
 Status FileEventsTablePlugin::generateRowList(RowList &row_list) {
+  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+
   std::lock_guard<std::mutex> lock(d->row_list_mutex);
 
+  d->event_coalescer->flush(
+      d->row_list, static_cast<std::int64_t>(current_timestamp.count()));
+
   row_list = std::move(d->row_list);
   d->row_list = {};
 
   return Status::success();
 }
 
+bool FileEventsTablePlugin::isEventTable() const { return true; }
+
+void FileEventsTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status FileEventsTablePlugin::processEvents(
     const IAudispConsumer::AuditEventList &event_list) {
   RowList generated_row_list;
 
+  auto current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+
+  // Rows held back by the coalescer are released once their window has
+  // expired, even when no new event is received
+  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+
+  std::size_t new_row_count{0U};
+
+  {
+    std::lock_guard<std::mutex> lock(d->row_list_mutex);
+    new_row_count += d->event_coalescer->flush(
+        d->row_list, static_cast<std::int64_t>(current_timestamp.count()));
+  }
+
   for (const auto &audit_event : event_list) {
     Row row;
 
-    auto status = generateRow(row, audit_event);
+    auto status = generateRow(row, audit_event, d->path_filter.get());
     if (!status.succeeded()) {
       return status;
     }
 
-    if (!row.empty()) {
+    if (!row.empty() && d->rate_limiter->accept(row, current_time)) {
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
-        d->row_list.push_back(row);
+        new_row_count +=
+            d->event_coalescer->addRow(d->row_list, std::move(row));
       }
     }
   }
@@ -96,17 +139,19 @@ Status FileEventsTablePlugin::processEvents(
     if (d->row_list.size() > d->max_queued_row_count) {
       auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-      d->logger.logMessage(IZeekLogger::Severity::Warning,
-                           "file_events: Dropping " +
-                               std::to_string(rows_to_remove) +
-                               " rows (max row count is set to " +
-                               std::to_string(d->max_queued_row_count) + ")");
+      ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                            "file_events: Dropping " +
+                                std::to_string(rows_to_remove) +
+                                " rows (max row count is set to " +
+                                std::to_string(d->max_queued_row_count) + ")");
 
       d->row_list.erase(d->row_list.begin(),
                         std::next(d->row_list.begin(), rows_to_remove));
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -115,6 +160,34 @@ FileEventsTablePlugin::FileEventsTablePlugin(IZeekConfiguration &configuration,
     : d(new PrivateData(configuration, logger)) {
 
   d->max_queued_row_count = d->configuration.maxQueuedRowCount();
+
+  auto status = EventCoalescer::create(
+      d->event_coalescer, d->configuration.eventCoalescingWindow(),
+      d->max_queued_row_count);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = RateLimiter::create(d->rate_limiter,
+                               d->configuration.eventRateLimit(),
+                               kDefaultRateLimiterKeyCount);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = PathFilter::create(d->path_filter,
+                              d->configuration.fileEventsIncludeList(),
+                              d->configuration.fileEventsExcludeList());
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+const PathFilter &FileEventsTablePlugin::pathFilter() const {
+  return *d->path_filter.get();
 }
 
 std::string FileEventsTablePlugin::CombinePaths(const std::string &cwd,
@@ -143,8 +216,13 @@ std::string FileEventsTablePlugin::CombinePaths(const std::string &cwd,
   return full_path;
 }
 
+const RateLimiter &FileEventsTablePlugin::rateLimiter() const {
+  return *d->rate_limiter.get();
+}
+
 Status FileEventsTablePlugin::generateRow(
-    Row &row, const IAudispConsumer::AuditEvent &audit_event) {
+    Row &row, const IAudispConsumer::AuditEvent &audit_event,
+    PathFilter *path_filter) {
   row = {};
 
   std::string syscall_name;
@@ -218,6 +296,11 @@ Status FileEventsTablePlugin::generateRow(
     return Status::success();
   }
 
+  // Discard unwanted paths before spending any time building the row
+  if (path_filter != nullptr && !path_filter->accept(full_path)) {
+    return Status::success();
+  }
+
   const auto &syscall_data = audit_event.syscall_data;
 
   row["syscall"] = std::move(syscall_name);
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "pathfilter.h"
+
 #include <memory>
 #include <string>
 #include <zeek/iaudispconsumer.h>
 #include <zeek/ivirtualtable.h>
 #include <zeek/izeekconfiguration.h>
 #include <zeek/izeeklogger.h>
+#include <zeek/ratelimiter.h>
 #include <zeek/status.h>
 
 namespace zeek {
@@ -38,17 +41,33 @@ public:
   /// \return A Status object
   virtual Status generateRowList(RowList &row_list) override;
 
+  /// \return True, since rows are discarded once they have been read
+  virtual bool isEventTable() const override;
+
+  /// \brief Sets the callback invoked when new rows are generated
+  /// \param callback The callback to invoke
+  virtual void setUpdateCallback(UpdateCallback callback) override;
+
   /// \brief Processes the specified event list, generating new rows
   /// \param event_list A list of Audit events
   /// \return A Status object
   Status processEvents(const IAudispConsumer::AuditEventList &event_list);
 
+  /// \return The path filter applied to the incoming events
+  const PathFilter &pathFilter() const;
+
+  /// \return The rate limiter applied to the generated rows
+  const RateLimiter &rateLimiter() const;
+
   /// \brief Generates a single row from the given Audit event
   /// \param row Where the generated row is stored
   /// \param audit_event a single Audit event
+  /// \param path_filter If not null, events whose path is rejected by this
+  ///                    filter will not generate a row
   /// \return A Status object
   static Status generateRow(Row &row,
-                            const IAudispConsumer::AuditEvent &audit_event);
+                            const IAudispConsumer::AuditEvent &audit_event,
+                            PathFilter *path_filter = nullptr);
 
 protected:
   /// \brief Constructor
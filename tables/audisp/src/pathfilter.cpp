@@ -0,0 +1,230 @@
+#include "pathfilter.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace zeek {
+namespace {
+const std::size_t kInvalidRuleIndex{std::numeric_limits<std::size_t>::max()};
+
+struct TrieNode final {
+  /// \brief Child nodes, sorted by character. The root node (index 0) is
+  ///        never a child, so 0 can be used to signal a missing child
+  std::vector<std::pair<char, std::size_t>> child_list;
+
+  /// \brief The rule that terminates at this node, if any
+  std::size_t rule_index{kInvalidRuleIndex};
+};
+
+using Trie = std::vector<TrieNode>;
+
+std::size_t findChildNode(const TrieNode &node, char c) {
+  // clang-format off
+  auto child_it = std::lower_bound(
+    node.child_list.begin(),
+    node.child_list.end(),
+    c,
+
+    [](const std::pair<char, std::size_t> &child, char value) -> bool {
+      return child.first < value;
+    }
+  );
+  // clang-format on
+
+  if (child_it == node.child_list.end() || child_it->first != c) {
+    return 0U;
+  }
+
+  return child_it->second;
+}
+
+std::size_t insertIntoTrie(Trie &trie, const std::string &rule) {
+  if (trie.empty()) {
+    trie.push_back({});
+  }
+
+  std::size_t node_index{0U};
+
+  for (auto c : rule) {
+    auto child_index = findChildNode(trie.at(node_index), c);
+
+    if (child_index == 0U) {
+      child_index = trie.size();
+      trie.push_back({});
+
+      auto &child_list = trie.at(node_index).child_list;
+
+      // clang-format off
+      auto insert_it = std::lower_bound(
+        child_list.begin(),
+        child_list.end(),
+        c,
+
+        [](const std::pair<char, std::size_t> &child, char value) -> bool {
+          return child.first < value;
+        }
+      );
+      // clang-format on
+
+      child_list.insert(insert_it, std::make_pair(c, child_index));
+    }
+
+    node_index = child_index;
+  }
+
+  return node_index;
+}
+
+void matchTrie(const Trie &trie, const std::string &path, std::size_t offset,
+               std::size_t &rule_index, std::size_t &rule_length) {
+
+  if (trie.empty()) {
+    return;
+  }
+
+  std::size_t node_index{0U};
+
+  for (auto i = offset; i < path.size(); ++i) {
+    node_index = findChildNode(trie[node_index], path[i]);
+    if (node_index == 0U) {
+      break;
+    }
+
+    const auto &node = trie[node_index];
+    auto match_length = i - offset + 1U;
+
+    if (node.rule_index != kInvalidRuleIndex && match_length > rule_length) {
+      rule_index = node.rule_index;
+      rule_length = match_length;
+    }
+  }
+}
+} // namespace
+
+struct PathFilter::PrivateData final {
+  Trie anchored_trie;
+  Trie component_trie;
+
+  std::vector<std::string> rule_list;
+  std::vector<Action> action_list;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> hit_count_list;
+
+  bool has_include_rules{false};
+};
+
+Status PathFilter::create(Ref &obj, const std::vector<std::string> &include_list,
+                          const std::vector<std::string> &exclude_list) {
+  try {
+    obj.reset();
+
+    auto ptr = new PathFilter(include_list, exclude_list);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+PathFilter::~PathFilter() {}
+
+bool PathFilter::empty() const { return d->rule_list.empty(); }
+
+bool PathFilter::accept(const std::string &path) {
+  if (d->rule_list.empty()) {
+    return true;
+  }
+
+  std::size_t rule_index{kInvalidRuleIndex};
+  std::size_t rule_length{0U};
+
+  matchTrie(d->anchored_trie, path, 0U, rule_index, rule_length);
+
+  if (!d->component_trie.empty()) {
+    for (std::size_t i = 0U; i < path.size(); ++i) {
+      if (i == 0U || path[i - 1U] == '/') {
+        matchTrie(d->component_trie, path, i, rule_index, rule_length);
+      }
+    }
+  }
+
+  if (rule_index == kInvalidRuleIndex) {
+    return !d->has_include_rules;
+  }
+
+  d->hit_count_list[rule_index].fetch_add(1U, std::memory_order_relaxed);
+  return d->action_list[rule_index] == Action::Include;
+}
+
+PathFilter::RuleStatsList PathFilter::ruleStats() const {
+  RuleStatsList rule_stats_list;
+
+  for (std::size_t i = 0U; i < d->rule_list.size(); ++i) {
+    RuleStats rule_stats;
+    rule_stats.rule = d->rule_list[i];
+    rule_stats.action = d->action_list[i];
+    rule_stats.hit_count =
+        d->hit_count_list[i].load(std::memory_order_relaxed);
+
+    rule_stats_list.push_back(std::move(rule_stats));
+  }
+
+  return rule_stats_list;
+}
+
+PathFilter::PathFilter(const std::vector<std::string> &include_list,
+                       const std::vector<std::string> &exclude_list)
+    : d(new PrivateData) {
+
+  for (const auto &rule : include_list) {
+    auto status = addRule(rule, Action::Include);
+    if (!status.succeeded()) {
+      throw status;
+    }
+  }
+
+  for (const auto &rule : exclude_list) {
+    auto status = addRule(rule, Action::Exclude);
+    if (!status.succeeded()) {
+      throw status;
+    }
+  }
+
+  d->hit_count_list.reset(
+      new std::atomic<std::uint64_t>[d->rule_list.size()]());
+}
+
+Status PathFilter::addRule(const std::string &rule, Action action) {
+  if (rule.empty()) {
+    return Status::failure("Empty path filter rules are not allowed");
+  }
+
+  auto &trie = (rule.front() == '/') ? d->anchored_trie : d->component_trie;
+  auto node_index = insertIntoTrie(trie, rule);
+
+  auto &node = trie.at(node_index);
+  if (node.rule_index != kInvalidRuleIndex) {
+    if (d->action_list.at(node.rule_index) != action) {
+      return Status::failure(
+          "The following path rule is both included and excluded: " + rule);
+    }
+
+    return Status::success();
+  }
+
+  node.rule_index = d->rule_list.size();
+
+  d->rule_list.push_back(rule);
+  d->action_list.push_back(action);
+
+  if (action == Action::Include) {
+    d->has_include_rules = true;
+  }
+
+  return Status::success();
+}
+} // namespace zeek
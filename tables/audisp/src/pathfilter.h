@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief Decides which file paths should be reported, using a set of
+///        include/exclude rules compiled into prefix tries
+///
+/// Rules starting with a '/' are anchored to the start of the path, while
+/// all other rules (i.e.: "node_modules/") can match at the start of any
+/// path component. When more than one rule matches, the longest one wins.
+/// Paths that do not match any rule are only accepted if there are no
+/// include rules
+class PathFilter final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief A reference to a path filter object
+  using Ref = std::unique_ptr<PathFilter>;
+
+  /// \brief Rule actions
+  enum class Action { Include, Exclude };
+
+  /// \brief Hit counters for a single rule
+  struct RuleStats final {
+    /// \brief The rule, as it appears in the configuration
+    std::string rule;
+
+    /// \brief What happens to the paths matched by this rule
+    Action action;
+
+    /// \brief How many paths have been matched by this rule
+    std::uint64_t hit_count{0U};
+  };
+
+  /// \brief A list of rule statistics
+  using RuleStatsList = std::vector<RuleStats>;
+
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param include_list Rules for paths that must be reported
+  /// \param exclude_list Rules for paths that must be discarded
+  /// \return A Status object
+  static Status create(Ref &obj, const std::vector<std::string> &include_list,
+                       const std::vector<std::string> &exclude_list);
+
+  /// \brief Destructor
+  ~PathFilter();
+
+  /// \return True if no rule has been configured
+  bool empty() const;
+
+  /// \brief Matches the given path against the configured rules, updating
+  ///        the hit counter of the rule that has been selected
+  /// \param path The path to test
+  /// \return True if the path should be reported, false otherwise
+  bool accept(const std::string &path);
+
+  /// \return The hit counters for each rule
+  RuleStatsList ruleStats() const;
+
+  PathFilter(const PathFilter &) = delete;
+  PathFilter &operator=(const PathFilter &) = delete;
+
+private:
+  /// \brief Constructor
+  /// \param include_list Rules for paths that must be reported
+  /// \param exclude_list Rules for paths that must be discarded
+  PathFilter(const std::vector<std::string> &include_list,
+             const std::vector<std::string> &exclude_list);
+
+  /// \brief Adds a new rule to the tries
+  /// \param rule The rule string
+  /// \param action The rule action
+  /// \return A Status object
+  Status addRule(const std::string &rule, Action action);
+};
+} // namespace zeek
@@ -0,0 +1,68 @@
+#include "pathfiltertableplugin.h"
+
+namespace zeek {
+struct PathFilterTablePlugin::PrivateData final {
+  PrivateData(const PathFilter &path_filter_) : path_filter(path_filter_) {}
+
+  const PathFilter &path_filter;
+};
+
+Status PathFilterTablePlugin::create(Ref &obj, const PathFilter &path_filter) {
+  obj.reset();
+
+  try {
+    auto ptr = new PathFilterTablePlugin(path_filter);
+    obj.reset(ptr);
+
+    return Status::success();
+
+  } catch (const std::bad_alloc &) {
+    return Status::failure("Memory allocation failure");
+
+  } catch (const Status &status) {
+    return status;
+  }
+}
+
+PathFilterTablePlugin::~PathFilterTablePlugin() {}
+
+const std::string &PathFilterTablePlugin::name() const {
+  static const std::string kTableName{"file_events_path_filters"};
+
+  return kTableName;
+}
+
+const PathFilterTablePlugin::Schema &PathFilterTablePlugin::schema() const {
+  // clang-format off
+  static const Schema kTableSchema = {
+    { "rule", IVirtualTable::ColumnType::String },
+    { "action", IVirtualTable::ColumnType::String },
+    { "hit_count", IVirtualTable::ColumnType::Integer }
+  };
+  // clang-format on
+
+  return kTableSchema;
+}
+
+Status PathFilterTablePlugin::generateRowList(RowList &row_list) {
+  row_list = {};
+
+  for (const auto &rule_stats : d->path_filter.ruleStats()) {
+    Row row = {};
+
+    row["rule"] = rule_stats.rule;
+    row["action"] = (rule_stats.action == PathFilter::Action::Include)
+                        ? "include"
+                        : "exclude";
+
+    row["hit_count"] = static_cast<std::int64_t>(rule_stats.hit_count);
+
+    row_list.push_back(std::move(row));
+  }
+
+  return Status::success();
+}
+
+PathFilterTablePlugin::PathFilterTablePlugin(const PathFilter &path_filter)
+    : d(new PrivateData(path_filter)) {}
+} // namespace zeek
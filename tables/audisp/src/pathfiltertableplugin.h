@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pathfilter.h"
+
+#include <zeek/ivirtualtable.h>
+
+namespace zeek {
+/// \brief A virtual table plugin that exposes the hit counters of the
+///        file_events path filter
+class PathFilterTablePlugin final : public IVirtualTable {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief Factory method
+  /// \param obj Where the created object is stored
+  /// \param path_filter A reference to an initialized path filter
+  /// \return A Status object
+  static Status create(Ref &obj, const PathFilter &path_filter);
+
+  /// \brief Destructor
+  virtual ~PathFilterTablePlugin() override;
+
+  /// \return The table name
+  virtual const std::string &name() const override;
+
+  /// \return The table schema
+  virtual const Schema &schema() const override;
+
+  /// \brief Generates one row for each configured path rule
+  /// \param row_list Where the generated rows are stored
+  /// \return A Status object
+  virtual Status generateRowList(RowList &row_list) override;
+
+protected:
+  /// \brief Constructor
+  /// \param path_filter A reference to an initialized path filter
+  PathFilterTablePlugin(const PathFilter &path_filter);
+};
+} // namespace zeek
@@ -1,8 +1,12 @@
 #include "processeventstableplugin.h"
+#include "eventcoalescer.h"
 
 #include <chrono>
 #include <mutex>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace zeek {
 struct ProcessEventsTablePlugin::PrivateData final {
   PrivateData(IZeekConfiguration &configuration_, IZeekLogger &logger_)
@@ -14,6 +18,11 @@ struct ProcessEventsTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  EventCoalescer::Ref event_coalescer;
+  RateLimiter::Ref rate_limiter;
+
+  TableUpdateNotifier update_notifier;
 };
 
 Status ProcessEventsTablePlugin::create(Ref &obj,
@@ -71,24 +80,57 @@ ProcessEventsTablePlugin::schema() const {
       {"cwd", IVirtualTable::ColumnType::String},
 
       // Custom
-      {"time", IVirtualTable::ColumnType::Integer}};
+      {"time", IVirtualTable::ColumnType::Integer},
+
+      // Event coalescing
+      {"count", IVirtualTable::ColumnType::Integer},
+      {"first_time", IVirtualTable::ColumnType::Integer},
+      {"last_time", IVirtualTable::ColumnType::Integer}};
 
   return kTableSchema;
 }
 
 Status ProcessEventsTablePlugin::generateRowList(RowList &row_list) {
+  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+
   std::lock_guard<std::mutex> lock(d->row_list_mutex);
 
+  d->event_coalescer->flush(
+      d->row_list, static_cast<std::int64_t>(current_timestamp.count()));
+
   row_list = std::move(d->row_list);
   d->row_list = {};
 
   return Status::success();
 }
 
+bool ProcessEventsTablePlugin::isEventTable() const { return true; }
+
+void ProcessEventsTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status ProcessEventsTablePlugin::processEvents(
     const IAudispConsumer::AuditEventList &event_list) {
   RowList generated_row_list;
 
+  auto current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+
+  // Rows held back by the coalescer are released once their window has
+  // expired, even when no new event is received
+  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+
+  std::size_t new_row_count{0U};
+
+  {
+    std::lock_guard<std::mutex> lock(d->row_list_mutex);
+    new_row_count += d->event_coalescer->flush(
+        d->row_list, static_cast<std::int64_t>(current_timestamp.count()));
+  }
+
   for (const auto &audit_event : event_list) {
     Row row;
 
@@ -97,10 +139,11 @@ Status ProcessEventsTablePlugin::processEvents(
       return status;
     }
 
-    if (!row.empty()) {
+    if (!row.empty() && d->rate_limiter->accept(row, current_time)) {
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
-        d->row_list.push_back(row);
+        new_row_count +=
+            d->event_coalescer->addRow(d->row_list, std::move(row));
       }
     }
   }
@@ -112,17 +155,19 @@ Status ProcessEventsTablePlugin::processEvents(
     if (d->row_list.size() > d->max_queued_row_count) {
       auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-      d->logger.logMessage(IZeekLogger::Severity::Warning,
-                           "process_events: Dropping " +
-                               std::to_string(rows_to_remove) +
-                               " rows (max row count is set to " +
-                               std::to_string(d->max_queued_row_count) + ")");
+      ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                            "process_events: Dropping " +
+                                std::to_string(rows_to_remove) +
+                                " rows (max row count is set to " +
+                                std::to_string(d->max_queued_row_count) + ")");
 
       d->row_list.erase(d->row_list.begin(),
                         std::next(d->row_list.begin(), rows_to_remove));
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -131,6 +176,26 @@ ProcessEventsTablePlugin::ProcessEventsTablePlugin(
     : d(new PrivateData(configuration, logger)) {
 
   d->max_queued_row_count = d->configuration.maxQueuedRowCount();
+
+  auto status = EventCoalescer::create(
+      d->event_coalescer, d->configuration.eventCoalescingWindow(),
+      d->max_queued_row_count);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = RateLimiter::create(d->rate_limiter,
+                               d->configuration.eventRateLimit(),
+                               kDefaultRateLimiterKeyCount);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+const RateLimiter &ProcessEventsTablePlugin::rateLimiter() const {
+  return *d->rate_limiter.get();
 }
 
 Status ProcessEventsTablePlugin::generateRow(
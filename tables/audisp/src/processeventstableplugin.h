@@ -1,9 +1,10 @@
 #pragma once
 
-#include <zeek/iwineventconsumer.h>
+#include <zeek/iaudispconsumer.h>
 #include <zeek/ivirtualtable.h>
 #include <zeek/izeekconfiguration.h>
 #include <zeek/izeeklogger.h>
+#include <zeek/ratelimiter.h>
 
 namespace zeek {
 /// \brief Provides the process_events table
@@ -35,10 +36,20 @@ public:
   /// \return A Status object
   virtual Status generateRowList(RowList &row_list) override;
 
+  /// \return True, since rows are discarded once they have been read
+  virtual bool isEventTable() const override;
+
+  /// \brief Sets the callback invoked when new rows are generated
+  /// \param callback The callback to invoke
+  virtual void setUpdateCallback(UpdateCallback callback) override;
+
   /// \brief Processes the specified event list, generating new rows
-  /// \param event_list A list of Windows events
+  /// \param event_list A list of audit events
   /// \return A Status object
-  Status processEvents(const IWineventConsumer::EventList &event_list);
+  Status processEvents(const IAudispConsumer::AuditEventList &event_list);
+
+  /// \return The rate limiter applied to the generated rows
+  const RateLimiter &rateLimiter() const;
 
 protected:
   /// \brief Constructor
@@ -48,10 +59,11 @@ protected:
                            IZeekLogger &logger);
 
 public:
-  /// \brief Generates a single row from the given Windows event
-  /// \param event a single Windows event
+  /// \brief Generates a single row from the given audit event
+  /// \param row Where the generated row is stored
+  /// \param audit_event A single audit event
   /// \return A Status object
   static Status generateRow(Row &row,
-                            const IWineventConsumer::Event &event);
+                            const IAudispConsumer::AuditEvent &audit_event);
 };
 } // namespace zeek
\ No newline at end of file
@@ -1,8 +1,12 @@
 #include "socketeventstableplugin.h"
+#include "eventcoalescer.h"
 
 #include <chrono>
 #include <mutex>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace zeek {
 struct SocketEventsTablePlugin::PrivateData final {
   PrivateData(IZeekConfiguration &configuration_, IZeekLogger &logger_)
@@ -14,6 +18,11 @@ struct SocketEventsTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  EventCoalescer::Ref event_coalescer;
+  RateLimiter::Ref rate_limiter;
+
+  TableUpdateNotifier update_notifier;
 };
 
 Status SocketEventsTablePlugin::create(Ref &obj,
@@ -60,24 +69,55 @@ const SocketEventsTablePlugin::Schema &SocketEventsTablePlugin::schema() const {
       {"remote_address", IVirtualTable::ColumnType::String},
       {"local_port", IVirtualTable::ColumnType::Integer},
       {"remote_port", IVirtualTable::ColumnType::Integer},
-      {"time", IVirtualTable::ColumnType::Integer}};
+      {"time", IVirtualTable::ColumnType::Integer},
+      {"count", IVirtualTable::ColumnType::Integer},
+      {"first_time", IVirtualTable::ColumnType::Integer},
+      {"last_time", IVirtualTable::ColumnType::Integer}};
 
   return kTableSchema;
 }
 
 Status SocketEventsTablePlugin::generateRowList(RowList &row_list) {
+  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+
   std::lock_guard<std::mutex> lock(d->row_list_mutex);
 
+  d->event_coalescer->flush(
+      d->row_list, static_cast<std::int64_t>(current_timestamp.count()));
+
   row_list = std::move(d->row_list);
   d->row_list = {};
 
   return Status::success();
 }
 
+bool SocketEventsTablePlugin::isEventTable() const { return true; }
+
+void SocketEventsTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status SocketEventsTablePlugin::processEvents(
     const IAudispConsumer::AuditEventList &event_list) {
   RowList generated_row_list;
 
+  auto current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+
+  // Rows held back by the coalescer are released once their window has
+  // expired, even when no new event is received
+  auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+
+  std::size_t new_row_count{0U};
+
+  {
+    std::lock_guard<std::mutex> lock(d->row_list_mutex);
+    new_row_count += d->event_coalescer->flush(
+        d->row_list, static_cast<std::int64_t>(current_timestamp.count()));
+  }
+
   for (const auto &audit_event : event_list) {
     Row row;
 
@@ -86,10 +126,11 @@ Status SocketEventsTablePlugin::processEvents(
       return status;
     }
 
-    if (!row.empty()) {
+    if (!row.empty() && d->rate_limiter->accept(row, current_time)) {
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
-        d->row_list.push_back(row);
+        new_row_count +=
+            d->event_coalescer->addRow(d->row_list, std::move(row));
       }
     }
   }
@@ -98,11 +139,11 @@ Status SocketEventsTablePlugin::processEvents(
 
     auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-    d->logger.logMessage(IZeekLogger::Severity::Warning,
-                         "socket_events: Dropping " +
-                             std::to_string(rows_to_remove) +
-                             " rows (max row count is set to " +
-                             std::to_string(d->max_queued_row_count) + ")");
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "socket_events: Dropping " +
+                              std::to_string(rows_to_remove) +
+                              " rows (max row count is set to " +
+                              std::to_string(d->max_queued_row_count) + ")");
 
     {
       std::lock_guard<std::mutex> lock(d->row_list_mutex);
@@ -111,6 +152,8 @@ Status SocketEventsTablePlugin::processEvents(
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -119,6 +162,26 @@ SocketEventsTablePlugin::SocketEventsTablePlugin(
     : d(new PrivateData(configuration, logger)) {
 
   d->max_queued_row_count = d->configuration.maxQueuedRowCount();
+
+  auto status = EventCoalescer::create(
+      d->event_coalescer, d->configuration.eventCoalescingWindow(),
+      d->max_queued_row_count);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = RateLimiter::create(d->rate_limiter,
+                               d->configuration.eventRateLimit(),
+                               kDefaultRateLimiterKeyCount);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+const RateLimiter &SocketEventsTablePlugin::rateLimiter() const {
+  return *d->rate_limiter.get();
 }
 
 Status SocketEventsTablePlugin::generateRow(
@@ -4,6 +4,7 @@
 #include <zeek/ivirtualtable.h>
 #include <zeek/izeekconfiguration.h>
 #include <zeek/izeeklogger.h>
+#include <zeek/ratelimiter.h>
 
 namespace zeek {
 /// \brief A virtual table plugin that presents socket events
@@ -35,11 +36,21 @@ public:
   /// \return A Status object
   virtual Status generateRowList(RowList &row_list) override;
 
+  /// \return True, since rows are discarded once they have been read
+  virtual bool isEventTable() const override;
+
+  /// \brief Sets the callback invoked when new rows are generated
+  /// \param callback The callback to invoke
+  virtual void setUpdateCallback(UpdateCallback callback) override;
+
   /// \brief Processes the given Audit events, generating new rows
   /// \param event_list The list of Audit events
   /// \return A Status object
   Status processEvents(const IAudispConsumer::AuditEventList &event_list);
 
+  /// \return The rate limiter applied to the generated rows
+  const RateLimiter &rateLimiter() const;
+
   /// \brief Generates a new row from the given Audit event
   /// \param row Where the generated row is stored
   /// \param audit_event The source Audit event
@@ -0,0 +1,118 @@
+#include "eventcoalescer.h"
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+IVirtualTable::Row generateTestRow(std::int64_t pid, std::int64_t time) {
+  IVirtualTable::Row row;
+  row["syscall"] = "open";
+  row["pid"] = pid;
+  row["path"] = "/etc/ld.so.cache";
+  row["time"] = time;
+
+  return row;
+}
+
+std::int64_t getIntegerColumn(const IVirtualTable::Row &row,
+                              const std::string &column_name) {
+  return std::get<std::int64_t>(row.at(column_name).value());
+}
+} // namespace
+
+SCENARIO("Event coalescing", "[EventCoalescer]") {
+  GIVEN("an event coalescer with coalescing disabled") {
+    EventCoalescer::Ref event_coalescer;
+    auto status = EventCoalescer::create(event_coalescer, 0U, 100U);
+    REQUIRE(status.succeeded());
+
+    WHEN("identical rows are added") {
+      IVirtualTable::RowList row_list;
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 10)) == 1U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 10)) == 1U);
+
+      THEN("they are passed through with the coalescing columns set") {
+        REQUIRE(row_list.size() == 2U);
+        REQUIRE(event_coalescer->pendingRowCount() == 0U);
+
+        for (const auto &row : row_list) {
+          REQUIRE(row.size() == 7U);
+          REQUIRE(getIntegerColumn(row, "count") == 1);
+          REQUIRE(getIntegerColumn(row, "first_time") == 10);
+          REQUIRE(getIntegerColumn(row, "last_time") == 10);
+        }
+      }
+    }
+  }
+
+  GIVEN("an event coalescer with a 5 seconds window") {
+    EventCoalescer::Ref event_coalescer;
+    auto status = EventCoalescer::create(event_coalescer, 5U, 100U);
+    REQUIRE(status.succeeded());
+
+    WHEN("identical rows are added within the window") {
+      // Merged rows are not reported as new rows
+      IVirtualTable::RowList row_list;
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 10)) == 0U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 11)) == 0U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(2, 12)) == 0U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 13)) == 0U);
+
+      THEN("they are held back until the window elapses") {
+        REQUIRE(row_list.empty());
+        REQUIRE(event_coalescer->pendingRowCount() == 2U);
+
+        REQUIRE(event_coalescer->flush(row_list, 14) == 0U);
+        REQUIRE(row_list.empty());
+
+        REQUIRE(event_coalescer->flush(row_list, 15) == 1U);
+        REQUIRE(row_list.size() == 1U);
+
+        const auto &row = row_list.at(0U);
+        REQUIRE(getIntegerColumn(row, "pid") == 1);
+        REQUIRE(getIntegerColumn(row, "time") == 10);
+        REQUIRE(getIntegerColumn(row, "count") == 3);
+        REQUIRE(getIntegerColumn(row, "first_time") == 10);
+        REQUIRE(getIntegerColumn(row, "last_time") == 13);
+
+        REQUIRE(event_coalescer->flush(row_list, 17) == 1U);
+        REQUIRE(row_list.size() == 2U);
+        REQUIRE(getIntegerColumn(row_list.at(1U), "pid") == 2);
+        REQUIRE(getIntegerColumn(row_list.at(1U), "count") == 1);
+        REQUIRE(event_coalescer->pendingRowCount() == 0U);
+      }
+    }
+
+    WHEN("an identical row is added after the window has elapsed") {
+      IVirtualTable::RowList row_list;
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 10)) == 0U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 20)) == 1U);
+
+      THEN("the previous row is released and a new one is started") {
+        REQUIRE(row_list.size() == 1U);
+        REQUIRE(getIntegerColumn(row_list.at(0U), "count") == 1);
+        REQUIRE(event_coalescer->pendingRowCount() == 1U);
+      }
+    }
+  }
+
+  GIVEN("an event coalescer that can only hold back two rows") {
+    EventCoalescer::Ref event_coalescer;
+    auto status = EventCoalescer::create(event_coalescer, 60U, 2U);
+    REQUIRE(status.succeeded());
+
+    WHEN("three distinct rows are added") {
+      IVirtualTable::RowList row_list;
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(1, 10)) == 0U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(2, 10)) == 0U);
+      REQUIRE(event_coalescer->addRow(row_list, generateTestRow(3, 10)) == 1U);
+
+      THEN("the oldest row is released early") {
+        REQUIRE(row_list.size() == 1U);
+        REQUIRE(getIntegerColumn(row_list.at(0U), "pid") == 1);
+        REQUIRE(event_coalescer->pendingRowCount() == 2U);
+      }
+    }
+  }
+}
+} // namespace zeek
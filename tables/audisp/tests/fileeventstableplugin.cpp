@@ -322,4 +322,84 @@ SCENARIO("Row generation in the file_events table", "[FileEventsTablePlugin]") {
     }
   }
 }
+
+SCENARIO("Path filtering in the file_events table", "[FileEventsTablePlugin]") {
+  GIVEN("an open syscall audit event and a path filter") {
+    // clang-format off
+    static const IAudispConsumer::AuditEvent kOpenAuditEvent = {
+        // Syscall record data
+        {
+            IAudispConsumer::SyscallRecordData::Type::Open,
+            0,
+            38031,
+            38030,
+            true,
+            500,
+            500,
+            500,
+            500,
+            500,
+            "/bin/cat",
+            "7fffd19c5592"
+        },
+
+        // Execve record data
+        {
+        },
+
+        // Path record data
+        {
+            {
+                {
+                    "/proc/self/status",
+                    0100444,
+                    0,
+                    0,
+                    409242
+                }
+            }
+        },
+
+        // Cwd data
+        {
+            "/home/wajih"
+        },
+
+        // Sockaddr data
+        {}
+    };
+    // clang-format on
+
+    WHEN("the path is excluded") {
+      PathFilter::Ref path_filter;
+      auto status = PathFilter::create(path_filter, {}, {"/proc/"});
+      REQUIRE(status.succeeded());
+
+      IVirtualTable::Row row;
+      status = FileEventsTablePlugin::generateRow(row, kOpenAuditEvent,
+                                                  path_filter.get());
+
+      REQUIRE(status.succeeded());
+
+      THEN("no row is generated") { REQUIRE(row.empty()); }
+    }
+
+    WHEN("the path is not excluded") {
+      PathFilter::Ref path_filter;
+      auto status = PathFilter::create(path_filter, {}, {"/sys/"});
+      REQUIRE(status.succeeded());
+
+      IVirtualTable::Row row;
+      status = FileEventsTablePlugin::generateRow(row, kOpenAuditEvent,
+                                                  path_filter.get());
+
+      REQUIRE(status.succeeded());
+
+      THEN("the row is generated") {
+        REQUIRE(!row.empty());
+        validateRow(row, {{"path", "/proc/self/status"}});
+      }
+    }
+  }
+}
 } // namespace zeek
@@ -0,0 +1,94 @@
+#include "pathfilter.h"
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+std::uint64_t getHitCount(const PathFilter &path_filter,
+                          const std::string &rule) {
+  for (const auto &rule_stats : path_filter.ruleStats()) {
+    if (rule_stats.rule == rule) {
+      return rule_stats.hit_count;
+    }
+  }
+
+  return 0U;
+}
+} // namespace
+
+SCENARIO("Path filtering for file events", "[PathFilter]") {
+  GIVEN("a path filter with no rules") {
+    PathFilter::Ref path_filter;
+    auto status = PathFilter::create(path_filter, {}, {});
+    REQUIRE(status.succeeded());
+
+    THEN("all paths are accepted") {
+      REQUIRE(path_filter->empty());
+      REQUIRE(path_filter->accept("/proc/1/status"));
+      REQUIRE(path_filter->accept("/etc/passwd"));
+    }
+  }
+
+  GIVEN("a path filter with exclude rules only") {
+    PathFilter::Ref path_filter;
+    auto status = PathFilter::create(path_filter, {},
+                                     {"/proc/", "/sys/", "node_modules/"});
+    REQUIRE(status.succeeded());
+
+    THEN("anchored rules only match at the start of the path") {
+      REQUIRE(!path_filter->accept("/proc/1/status"));
+      REQUIRE(!path_filter->accept("/sys/kernel/mm"));
+      REQUIRE(path_filter->accept("/home/user/proc/file"));
+      REQUIRE(path_filter->accept("/etc/passwd"));
+    }
+
+    THEN("component rules match at the start of any path component") {
+      REQUIRE(!path_filter->accept("/home/user/app/node_modules/a/index.js"));
+      REQUIRE(path_filter->accept("/home/user/app/my_node_modules/index.js"));
+    }
+
+    THEN("hit counters are updated") {
+      REQUIRE(!path_filter->accept("/proc/1/status"));
+      REQUIRE(!path_filter->accept("/proc/2/status"));
+      REQUIRE(!path_filter->accept("/srv/node_modules/index.js"));
+      REQUIRE(path_filter->accept("/etc/passwd"));
+
+      REQUIRE(getHitCount(*path_filter.get(), "/proc/") == 2U);
+      REQUIRE(getHitCount(*path_filter.get(), "/sys/") == 0U);
+      REQUIRE(getHitCount(*path_filter.get(), "node_modules/") == 1U);
+    }
+  }
+
+  GIVEN("a path filter with both include and exclude rules") {
+    PathFilter::Ref path_filter;
+    auto status = PathFilter::create(path_filter, {"/proc/self/", "/etc/"},
+                                     {"/proc/", "/etc/ld.so.cache"});
+    REQUIRE(status.succeeded());
+
+    THEN("the longest matching rule wins") {
+      REQUIRE(path_filter->accept("/proc/self/maps"));
+      REQUIRE(!path_filter->accept("/proc/1/maps"));
+      REQUIRE(path_filter->accept("/etc/passwd"));
+      REQUIRE(!path_filter->accept("/etc/ld.so.cache"));
+    }
+
+    THEN("paths that do not match any rule are discarded") {
+      REQUIRE(!path_filter->accept("/home/user/file.txt"));
+    }
+  }
+
+  GIVEN("invalid rule lists") {
+    PathFilter::Ref path_filter;
+
+    THEN("empty rules are rejected") {
+      auto status = PathFilter::create(path_filter, {""}, {});
+      REQUIRE(!status.succeeded());
+    }
+
+    THEN("rules that are both included and excluded are rejected") {
+      auto status = PathFilter::create(path_filter, {"/tmp/"}, {"/tmp/"});
+      REQUIRE(!status.succeeded());
+    }
+  }
+}
+} // namespace zeek
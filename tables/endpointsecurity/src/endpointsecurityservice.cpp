@@ -9,6 +9,7 @@
 
 #include <zeek/endpointsecurityservicefactory.h>
 #include <zeek/iendpointsecurityconsumer.h>
+#include <zeek/ratelimitertableplugin.h>
 
 namespace zeek {
 namespace {
@@ -29,9 +30,17 @@ struct EndpointSecurityService::PrivateData final {
 
   IVirtualTable::Ref process_events_table;
   IVirtualTable::Ref file_events_table;
+  IVirtualTable::Ref rate_limits_table;
 };
 
 EndpointSecurityService::~EndpointSecurityService() {
+  if (d->rate_limits_table) {
+    auto status =
+        d->virtual_database.unregisterTable(d->rate_limits_table->name());
+    assert(status.succeeded() &&
+           "Failed to unregister the endpointsecurity_event_rate_limits table");
+  }
+
   if (d->process_events_table) {
     auto status =
         d->virtual_database.unregisterTable(d->process_events_table->name());
@@ -131,6 +140,31 @@ EndpointSecurityService::EndpointSecurityService(
   if (!status.succeeded()) {
     throw status;
   }
+
+  auto &process_events_table_impl =
+      *static_cast<ProcessEventsTablePlugin *>(d->process_events_table.get());
+
+  auto &file_events_table_impl =
+      *static_cast<FileEventsTablePlugin *>(d->file_events_table.get());
+
+  RateLimiterTablePlugin::RateLimiterMap rate_limiter_map = {
+      {d->process_events_table->name(),
+       &process_events_table_impl.rateLimiter()},
+
+      {d->file_events_table->name(), &file_events_table_impl.rateLimiter()}};
+
+  status = RateLimiterTablePlugin::create(d->rate_limits_table,
+                                          "endpointsecurity_event_rate_limits",
+                                          rate_limiter_map);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = d->virtual_database.registerTable(d->rate_limits_table);
+  if (!status.succeeded()) {
+    throw status;
+  }
 }
 
 struct EndpointSecurityServiceFactory::PrivateData final {
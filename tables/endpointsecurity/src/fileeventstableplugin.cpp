@@ -4,6 +4,9 @@
 #include <limits>
 #include <mutex>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace zeek {
 struct FileEventsTablePlugin::PrivateData final {
   PrivateData(IZeekConfiguration &configuration_, IZeekLogger &logger_)
@@ -15,6 +18,9 @@ struct FileEventsTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
+  RateLimiter::Ref rate_limiter;
 };
 
 Status FileEventsTablePlugin::create(Ref &obj,
@@ -71,9 +77,20 @@ Status FileEventsTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool FileEventsTablePlugin::isEventTable() const { return true; }
+
+void FileEventsTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status FileEventsTablePlugin::processEvents(
     const IEndpointSecurityConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
+  auto current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -82,10 +99,11 @@ Status FileEventsTablePlugin::processEvents(
       return status;
     }
 
-    if (!row.empty()) {
+    if (!row.empty() && d->rate_limiter->accept(row, current_time)) {
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -97,11 +115,11 @@ Status FileEventsTablePlugin::processEvents(
     if (d->row_list.size() > d->max_queued_row_count) {
       auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-      d->logger.logMessage(IZeekLogger::Severity::Warning,
-                           "file_events: Dropping " +
-                               std::to_string(rows_to_remove) +
-                               " rows (max row count is set to " +
-                               std::to_string(d->max_queued_row_count) + ")");
+      ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                            "file_events: Dropping " +
+                                std::to_string(rows_to_remove) +
+                                " rows (max row count is set to " +
+                                std::to_string(d->max_queued_row_count) + ")");
 
       d->row_list.erase(d->row_list.begin(),
                         std::next(d->row_list.begin(), rows_to_remove));
@@ -109,6 +127,8 @@ Status FileEventsTablePlugin::processEvents(
 
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -116,6 +136,23 @@ FileEventsTablePlugin::FileEventsTablePlugin(IZeekConfiguration &configuration,
                                              IZeekLogger &logger)
     : d(new PrivateData(configuration, logger)) {
   d->max_queued_row_count = d->configuration.maxQueuedRowCount();
+
+  RateLimiterKeyColumns key_columns;
+  key_columns.exe = "path";
+  key_columns.uid = "user_id";
+  key_columns.pid = "process_id";
+
+  auto status = RateLimiter::create(d->rate_limiter,
+                                    d->configuration.eventRateLimit(),
+                                    kDefaultRateLimiterKeyCount, key_columns);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+const RateLimiter &FileEventsTablePlugin::rateLimiter() const {
+  return *d->rate_limiter.get();
 }
 
 Status FileEventsTablePlugin::generateRow(
@@ -4,6 +4,9 @@
 #include <limits>
 #include <mutex>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace zeek {
 struct ProcessEventsTablePlugin::PrivateData final {
   PrivateData(IZeekConfiguration &configuration_, IZeekLogger &logger_)
@@ -15,6 +18,9 @@ struct ProcessEventsTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
+  RateLimiter::Ref rate_limiter;
 };
 
 Status ProcessEventsTablePlugin::create(Ref &obj,
@@ -73,9 +79,20 @@ Status ProcessEventsTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool ProcessEventsTablePlugin::isEventTable() const { return true; }
+
+void ProcessEventsTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status ProcessEventsTablePlugin::processEvents(
     const IEndpointSecurityConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
+  auto current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -84,10 +101,11 @@ Status ProcessEventsTablePlugin::processEvents(
       return status;
     }
 
-    if (!row.empty()) {
+    if (!row.empty() && d->rate_limiter->accept(row, current_time)) {
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -99,17 +117,19 @@ Status ProcessEventsTablePlugin::processEvents(
     if (d->row_list.size() > d->max_queued_row_count) {
       auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-      d->logger.logMessage(IZeekLogger::Severity::Warning,
-                           "process_events: Dropping " +
-                               std::to_string(rows_to_remove) +
-                               " rows (max row count is set to " +
-                               std::to_string(d->max_queued_row_count) + ")");
+      ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                            "process_events: Dropping " +
+                                std::to_string(rows_to_remove) +
+                                " rows (max row count is set to " +
+                                std::to_string(d->max_queued_row_count) + ")");
 
       d->row_list.erase(d->row_list.begin(),
                         std::next(d->row_list.begin(), rows_to_remove));
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -118,6 +138,23 @@ ProcessEventsTablePlugin::ProcessEventsTablePlugin(
     : d(new PrivateData(configuration, logger)) {
 
   d->max_queued_row_count = d->configuration.maxQueuedRowCount();
+
+  RateLimiterKeyColumns key_columns;
+  key_columns.exe = "path";
+  key_columns.uid = "user_id";
+  key_columns.pid = "process_id";
+
+  auto status = RateLimiter::create(d->rate_limiter,
+                                    d->configuration.eventRateLimit(),
+                                    kDefaultRateLimiterKeyCount, key_columns);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+const RateLimiter &ProcessEventsTablePlugin::rateLimiter() const {
+  return *d->rate_limiter.get();
 }
 
 Status ProcessEventsTablePlugin::generateRow(
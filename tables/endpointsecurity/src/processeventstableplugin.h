@@ -4,6 +4,7 @@
 #include <zeek/ivirtualtable.h>
 #include <zeek/izeekconfiguration.h>
 #include <zeek/izeeklogger.h>
+#include <zeek/ratelimiter.h>
 
 namespace zeek {
 /// \brief Provides the process_events table
@@ -35,11 +36,21 @@ public:
   /// \return A Status object
   virtual Status generateRowList(RowList &row_list) override;
 
+  /// \return True, since rows are discarded once they have been read
+  virtual bool isEventTable() const override;
+
+  /// \brief Sets the callback invoked when new rows are generated
+  /// \param callback The callback to invoke
+  virtual void setUpdateCallback(UpdateCallback callback) override;
+
   /// \brief Processes the specified event list, generating new rows
   /// \param event_list A list of EndpointSecurity events
   /// \return A Status object
   Status processEvents(const IEndpointSecurityConsumer::EventList &event_list);
 
+  /// \return The rate limiter applied to the generated rows
+  const RateLimiter &rateLimiter() const;
+
 protected:
   /// \brief Constructor
   /// \param configuration An initialized configuration object
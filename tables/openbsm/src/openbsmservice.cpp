@@ -8,6 +8,7 @@
 
 #include <zeek/iopenbsmconsumer.h>
 #include <zeek/openbsmservicefactory.h>
+#include <zeek/ratelimitertableplugin.h>
 
 namespace zeek {
 namespace {
@@ -27,9 +28,17 @@ struct OpenbsmService::PrivateData final {
   IOpenbsmConsumer::Ref openbsm_consumer;
 
   IVirtualTable::Ref socket_events_table;
+  IVirtualTable::Ref rate_limits_table;
 };
 
 OpenbsmService::~OpenbsmService() {
+  if (d->rate_limits_table) {
+    auto status =
+        d->virtual_database.unregisterTable(d->rate_limits_table->name());
+    assert(status.succeeded() &&
+           "Failed to unregister the openbsm_event_rate_limits table");
+  }
+
   if (d->socket_events_table) {
     auto status =
         d->virtual_database.unregisterTable(d->socket_events_table->name());
@@ -101,6 +110,25 @@ OpenbsmService::OpenbsmService(IVirtualDatabase &virtual_database,
   if (!status.succeeded()) {
     throw status;
   }
+
+  auto &socket_events_table_impl =
+      *static_cast<SocketEventsTablePlugin *>(d->socket_events_table.get());
+
+  RateLimiterTablePlugin::RateLimiterMap rate_limiter_map = {
+      {d->socket_events_table->name(),
+       &socket_events_table_impl.rateLimiter()}};
+
+  status = RateLimiterTablePlugin::create(
+      d->rate_limits_table, "openbsm_event_rate_limits", rate_limiter_map);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = d->virtual_database.registerTable(d->rate_limits_table);
+  if (!status.succeeded()) {
+    throw status;
+  }
 }
 
 struct OpenbsmServiceFactory::PrivateData final {
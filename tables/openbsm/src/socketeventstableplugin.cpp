@@ -4,6 +4,9 @@
 #include <limits>
 #include <mutex>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace zeek {
 struct SocketEventsTablePlugin::PrivateData final {
   PrivateData(IZeekConfiguration &configuration_, IZeekLogger &logger_)
@@ -15,6 +18,9 @@ struct SocketEventsTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
+  RateLimiter::Ref rate_limiter;
 };
 
 Status SocketEventsTablePlugin::create(Ref &obj,
@@ -70,9 +76,20 @@ Status SocketEventsTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool SocketEventsTablePlugin::isEventTable() const { return true; }
+
+void SocketEventsTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status SocketEventsTablePlugin::processEvents(
     const IOpenbsmConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
+  auto current_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -81,10 +98,11 @@ Status SocketEventsTablePlugin::processEvents(
       return status;
     }
 
-    if (!row.empty()) {
+    if (!row.empty() && d->rate_limiter->accept(row, current_time)) {
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -93,11 +111,11 @@ Status SocketEventsTablePlugin::processEvents(
 
     auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-    d->logger.logMessage(IZeekLogger::Severity::Warning,
-                         "socket_events: Dropping " +
-                             std::to_string(rows_to_remove) +
-                             " rows (max row count is set to " +
-                             std::to_string(d->max_queued_row_count) + ")");
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "socket_events: Dropping " +
+                              std::to_string(rows_to_remove) +
+                              " rows (max row count is set to " +
+                              std::to_string(d->max_queued_row_count) + ")");
 
     {
       std::lock_guard<std::mutex> lock(d->row_list_mutex);
@@ -106,6 +124,8 @@ Status SocketEventsTablePlugin::processEvents(
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -113,6 +133,23 @@ SocketEventsTablePlugin::SocketEventsTablePlugin(
     IZeekConfiguration &configuration, IZeekLogger &logger)
     : d(new PrivateData(configuration, logger)) {
   d->max_queued_row_count = d->configuration.maxQueuedRowCount();
+
+  RateLimiterKeyColumns key_columns;
+  key_columns.exe = "path";
+  key_columns.uid = "user_id";
+  key_columns.pid = "process_id";
+
+  auto status = RateLimiter::create(d->rate_limiter,
+                                    d->configuration.eventRateLimit(),
+                                    kDefaultRateLimiterKeyCount, key_columns);
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+const RateLimiter &SocketEventsTablePlugin::rateLimiter() const {
+  return *d->rate_limiter.get();
 }
 
 Status
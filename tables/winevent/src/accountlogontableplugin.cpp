@@ -7,6 +7,9 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace pt = boost::property_tree;
 
 namespace zeek {
@@ -21,6 +24,8 @@ struct AccountLogonTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
 };
 
 Status AccountLogonTablePlugin::create(Ref &obj,
@@ -109,9 +114,17 @@ Status AccountLogonTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool AccountLogonTablePlugin::isEventTable() const { return true; }
+
+void AccountLogonTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status AccountLogonTablePlugin::processEvents(
     const IWinevtlogConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -124,6 +137,7 @@ Status AccountLogonTablePlugin::processEvents(
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -132,11 +146,11 @@ Status AccountLogonTablePlugin::processEvents(
 
     auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-    d->logger.logMessage(IZeekLogger::Severity::Warning,
-                         "account_logon_events: Dropping " +
-                         std::to_string(rows_to_remove) +
-                         " rows (max row count is set to " +
-                         std::to_string(d->max_queued_row_count) + ")");
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "account_logon_events: Dropping " +
+                              std::to_string(rows_to_remove) +
+                              " rows (max row count is set to " +
+                              std::to_string(d->max_queued_row_count) + ")");
 
     {
       std::lock_guard<std::mutex> lock(d->row_list_mutex);
@@ -145,6 +159,8 @@ Status AccountLogonTablePlugin::processEvents(
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -8,6 +8,9 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace pt = boost::property_tree;
 
 namespace zeek {
@@ -22,6 +25,8 @@ struct NetworkConnTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
 };
 
 Status NetworkConnTablePlugin::create(Ref &obj,
@@ -96,9 +101,17 @@ Status NetworkConnTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool NetworkConnTablePlugin::isEventTable() const { return true; }
+
+void NetworkConnTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status NetworkConnTablePlugin::processEvents(
     const IWinevtlogConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -111,6 +124,7 @@ Status NetworkConnTablePlugin::processEvents(
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -119,11 +133,11 @@ Status NetworkConnTablePlugin::processEvents(
 
     auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-    d->logger.logMessage(IZeekLogger::Severity::Warning,
-                         "network_conn_events: Dropping " +
-                         std::to_string(rows_to_remove) +
-                         " rows (max row count is set to " +
-                         std::to_string(d->max_queued_row_count) + ")");
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "network_conn_events: Dropping " +
+                              std::to_string(rows_to_remove) +
+                              " rows (max row count is set to " +
+                              std::to_string(d->max_queued_row_count) + ")");
 
     {
       std::lock_guard<std::mutex> lock(d->row_list_mutex);
@@ -132,6 +146,8 @@ Status NetworkConnTablePlugin::processEvents(
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
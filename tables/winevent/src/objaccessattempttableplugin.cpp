@@ -7,6 +7,9 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace pt = boost::property_tree;
 
 namespace zeek {
@@ -21,6 +24,8 @@ struct ObjAccessAttemptTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
 };
 
 Status ObjAccessAttemptTablePlugin::create(Ref &obj,
@@ -95,9 +100,17 @@ Status ObjAccessAttemptTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool ObjAccessAttemptTablePlugin::isEventTable() const { return true; }
+
+void ObjAccessAttemptTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status ObjAccessAttemptTablePlugin::processEvents(
     const IWinevtlogConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -110,6 +123,7 @@ Status ObjAccessAttemptTablePlugin::processEvents(
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -118,11 +132,11 @@ Status ObjAccessAttemptTablePlugin::processEvents(
 
     auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-    d->logger.logMessage(IZeekLogger::Severity::Warning,
-                         "object_access_attempt_events: Dropping " +
-                         std::to_string(rows_to_remove) +
-                         " rows (max row count is set to " +
-                         std::to_string(d->max_queued_row_count) + ")");
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "object_access_attempt_events: Dropping " +
+                              std::to_string(rows_to_remove) +
+                              " rows (max row count is set to " +
+                              std::to_string(d->max_queued_row_count) + ")");
 
     {
       std::lock_guard<std::mutex> lock(d->row_list_mutex);
@@ -131,6 +145,8 @@ Status ObjAccessAttemptTablePlugin::processEvents(
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
@@ -7,6 +7,9 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
+#include <zeek/logratelimiter.h>
+#include <zeek/tableupdatenotifier.h>
+
 namespace pt = boost::property_tree;
 
 namespace zeek {
@@ -21,6 +24,8 @@ struct ProcessTerminationTablePlugin::PrivateData final {
   RowList row_list;
   std::mutex row_list_mutex;
   std::size_t max_queued_row_count{0U};
+
+  TableUpdateNotifier update_notifier;
 };
 
 Status ProcessTerminationTablePlugin::create(Ref &obj,
@@ -89,9 +94,17 @@ Status ProcessTerminationTablePlugin::generateRowList(RowList &row_list) {
   return Status::success();
 }
 
+bool ProcessTerminationTablePlugin::isEventTable() const { return true; }
+
+void ProcessTerminationTablePlugin::setUpdateCallback(UpdateCallback callback) {
+  d->update_notifier.setCallback(std::move(callback));
+}
+
 Status ProcessTerminationTablePlugin::processEvents(
     const IWinevtlogConsumer::EventList &event_list) {
 
+  std::size_t new_row_count{0U};
+
   for (const auto &event : event_list) {
     Row row;
 
@@ -104,6 +117,7 @@ Status ProcessTerminationTablePlugin::processEvents(
       {
         std::lock_guard<std::mutex> lock(d->row_list_mutex);
         d->row_list.push_back(row);
+        ++new_row_count;
       }
     }
   }
@@ -112,11 +126,11 @@ Status ProcessTerminationTablePlugin::processEvents(
 
     auto rows_to_remove = d->row_list.size() - d->max_queued_row_count;
 
-    d->logger.logMessage(IZeekLogger::Severity::Warning,
-                         "process_termination_events: Dropping " +
-                         std::to_string(rows_to_remove) +
-                         " rows (max row count is set to " +
-                         std::to_string(d->max_queued_row_count) + ")");
+    ZEEK_LOG_RATE_LIMITED(d->logger, IZeekLogger::Severity::Warning,
+                          "process_termination_events: Dropping " +
+                              std::to_string(rows_to_remove) +
+                              " rows (max row count is set to " +
+                              std::to_string(d->max_queued_row_count) + ")");
 
     {
       std::lock_guard<std::mutex> lock(d->row_list_mutex);
@@ -125,6 +139,8 @@ Status ProcessTerminationTablePlugin::processEvents(
     }
   }
 
+  d->update_notifier.notify(new_row_count);
+
   return Status::success();
 }
 
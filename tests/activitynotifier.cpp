@@ -0,0 +1,186 @@
+#include "activitynotifier.h"
+#include "activityreactor.h"
+#include "mocks.h"
+#include "queryscheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+bool waitForNotification(const ActivityNotifier &activity_notifier,
+                         std::chrono::milliseconds timeout) {
+  ActivityReactor::Ref activity_reactor;
+  auto status = ActivityReactor::create(activity_reactor);
+  REQUIRE(status.succeeded());
+
+  auto descriptor = activity_notifier.descriptor();
+
+  status = activity_reactor->add(descriptor);
+  REQUIRE(status.succeeded());
+
+  ActivityReactor::DescriptorList ready_list;
+  status = activity_reactor->wait(ready_list, timeout);
+  REQUIRE(status.succeeded());
+
+  return ready_list.size() == 1U && ready_list.front() == descriptor;
+}
+} // namespace
+
+SCENARIO("Activity notifications", "[ActivityNotifier]") {
+  GIVEN("an activity notifier") {
+    ActivityNotifier::Ref activity_notifier;
+    auto status = ActivityNotifier::create(activity_notifier);
+    REQUIRE(status.succeeded());
+
+    THEN("the descriptor is not readable until notify() is called") {
+      REQUIRE(!waitForNotification(*activity_notifier.get(),
+                                   std::chrono::milliseconds(0)));
+    }
+
+    WHEN("notify() is called more than once") {
+      activity_notifier->notify();
+      activity_notifier->notify();
+
+      THEN("the descriptor becomes readable until reset() is called") {
+        REQUIRE(waitForNotification(*activity_notifier.get(),
+                                    std::chrono::milliseconds(0)));
+
+        activity_notifier->reset();
+
+        REQUIRE(!waitForNotification(*activity_notifier.get(),
+                                     std::chrono::milliseconds(0)));
+      }
+    }
+
+    WHEN("notify() is called from another thread") {
+      std::thread notifier_thread([&activity_notifier]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        activity_notifier->notify();
+      });
+
+      auto notified = waitForNotification(*activity_notifier.get(),
+                                          std::chrono::seconds(5));
+      notifier_thread.join();
+
+      THEN("the waiting thread is woken up") { REQUIRE(notified); }
+    }
+  }
+}
+
+SCENARIO("Activity reactor", "[ActivityReactor]") {
+  GIVEN("a reactor watching two activity notifiers") {
+    ActivityNotifier::Ref first_notifier;
+    auto status = ActivityNotifier::create(first_notifier);
+    REQUIRE(status.succeeded());
+
+    ActivityNotifier::Ref second_notifier;
+    status = ActivityNotifier::create(second_notifier);
+    REQUIRE(status.succeeded());
+
+    ActivityReactor::Ref activity_reactor;
+    status = ActivityReactor::create(activity_reactor);
+    REQUIRE(status.succeeded());
+
+    REQUIRE(activity_reactor->add(first_notifier->descriptor()).succeeded());
+    REQUIRE(activity_reactor->add(second_notifier->descriptor()).succeeded());
+
+    ActivityReactor::DescriptorList ready_list;
+
+    THEN("the wait times out when nothing has been signaled") {
+      status =
+          activity_reactor->wait(ready_list, std::chrono::milliseconds(10));
+
+      REQUIRE(status.succeeded());
+      REQUIRE(ready_list.empty());
+    }
+
+    WHEN("one of the notifiers is signaled") {
+      second_notifier->notify();
+
+      THEN("only its descriptor is returned, until it is reset") {
+        status = activity_reactor->wait(ready_list, std::chrono::seconds(5));
+
+        REQUIRE(status.succeeded());
+        REQUIRE(ready_list.size() == 1U);
+        REQUIRE(ready_list.front() == second_notifier->descriptor());
+
+        // Descriptors stay ready until their data has been consumed
+        status = activity_reactor->wait(ready_list, std::chrono::seconds(0));
+        REQUIRE(status.succeeded());
+        REQUIRE(ready_list.size() == 1U);
+
+        second_notifier->reset();
+
+        status = activity_reactor->wait(ready_list, std::chrono::seconds(0));
+        REQUIRE(status.succeeded());
+        REQUIRE(ready_list.empty());
+      }
+    }
+  }
+}
+
+TEST_CASE("One-shot query latency", "[ActivityNotifier][QueryScheduler]") {
+  // Previously, the scheduler thread and the main loop both slept for up to
+  // one second each before a one-shot query result could be published
+  const std::size_t kIterationCount{20U};
+  const std::chrono::milliseconds kMaxLatency{250};
+
+  MockVirtualDatabase virtual_database;
+  MockLogger logger;
+
+  ActivityNotifier::Ref activity_notifier;
+  auto status = ActivityNotifier::create(activity_notifier);
+  REQUIRE(status.succeeded());
+
+  QueryScheduler::Ref query_scheduler;
+  status = QueryScheduler::create(query_scheduler, virtual_database, logger);
+  REQUIRE(status.succeeded());
+
+  auto &activity_notifier_ref = *activity_notifier.get();
+  query_scheduler->setTaskOutputCallback(
+      [&activity_notifier_ref]() { activity_notifier_ref.notify(); });
+
+  REQUIRE(query_scheduler->start().succeeded());
+
+  std::chrono::microseconds total_latency{0};
+  std::chrono::microseconds max_latency{0};
+
+  for (std::size_t i = 0U; i < kIterationCount; ++i) {
+    QueryScheduler::Task task;
+    task.type = QueryScheduler::Task::Type::ExecuteQuery;
+    task.query = "SELECT " + std::to_string(i);
+
+    auto start_time = std::chrono::steady_clock::now();
+    query_scheduler->processTaskQueue({task});
+
+    QueryScheduler::TaskOutputList task_output_list;
+
+    while (task_output_list.empty()) {
+      REQUIRE(waitForNotification(activity_notifier_ref,
+                                  std::chrono::seconds(5)));
+
+      activity_notifier_ref.reset();
+      task_output_list = query_scheduler->getTaskOutputList();
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+
+    total_latency += latency;
+    max_latency = std::max(max_latency, latency);
+
+    REQUIRE(task_output_list.size() == 1U);
+  }
+
+  query_scheduler->stop();
+
+  WARN("One-shot query latency: "
+       << (total_latency.count() / static_cast<long long>(kIterationCount))
+       << "us average, " << max_latency.count() << "us max");
+
+  REQUIRE(max_latency < kMaxLatency);
+}
+} // namespace zeek
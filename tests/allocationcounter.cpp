@@ -0,0 +1,64 @@
+#include "allocationcounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+/// \brief Each allocation is prefixed by its size; the header is as large
+///        as the default alignment, so that the returned memory stays
+///        correctly aligned
+const std::size_t kHeaderSize{alignof(std::max_align_t)};
+
+thread_local bool allocation_counter_enabled{false};
+thread_local std::size_t allocation_count{0U};
+thread_local std::int64_t live_byte_count{0};
+} // namespace
+
+void *operator new(std::size_t size) {
+  auto ptr = static_cast<char *>(std::malloc(kHeaderSize + size));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  *reinterpret_cast<std::size_t *>(ptr) = size;
+
+  if (allocation_counter_enabled) {
+    ++allocation_count;
+    live_byte_count += static_cast<std::int64_t>(size);
+  }
+
+  return ptr + kHeaderSize;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  auto header = static_cast<char *>(ptr) - kHeaderSize;
+
+  if (allocation_counter_enabled) {
+    live_byte_count -=
+        static_cast<std::int64_t>(*reinterpret_cast<std::size_t *>(header));
+  }
+
+  std::free(header);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+
+namespace zeek {
+AllocationCounter::AllocationCounter() {
+  allocation_count = 0U;
+  live_byte_count = 0;
+  allocation_counter_enabled = true;
+}
+
+AllocationCounter::~AllocationCounter() { allocation_counter_enabled = false; }
+
+std::size_t AllocationCounter::count() const { return allocation_count; }
+
+std::int64_t AllocationCounter::liveByteCount() const {
+  return live_byte_count;
+}
+} // namespace zeek
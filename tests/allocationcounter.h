@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zeek {
+/// \brief Counts the memory allocations made by the current thread, for as
+///        long as the object is alive. The global operator new is replaced
+///        by the test executable to make this possible
+class AllocationCounter final {
+public:
+  /// \brief Constructor; starts counting
+  AllocationCounter();
+
+  /// \brief Destructor; stops counting
+  ~AllocationCounter();
+
+  /// \return How many allocations have been made so far
+  std::size_t count() const;
+
+  /// \return How many bytes allocated so far have not been released yet;
+  ///         negative when more memory has been released than allocated
+  std::int64_t liveByteCount() const;
+
+  AllocationCounter(const AllocationCounter &) = delete;
+  AllocationCounter &operator=(const AllocationCounter &) = delete;
+};
+} // namespace zeek
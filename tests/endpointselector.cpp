@@ -0,0 +1,71 @@
+#include "endpointselector.h"
+
+#include <set>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+TEST_CASE("Selecting endpoints with the failover policy",
+          "[EndpointSelector]") {
+  EndpointSelector endpoint_selector(EndpointSelector::Policy::Failover, 3U);
+  REQUIRE(!endpoint_selector.anyConnected());
+
+  // Nothing is connected, the output waits for the first endpoint
+  REQUIRE(endpoint_selector.select("query", "topic") == 0U);
+
+  endpoint_selector.setConnected(2U, true);
+  REQUIRE(endpoint_selector.anyConnected());
+  REQUIRE(endpoint_selector.select("query", "topic") == 2U);
+
+  endpoint_selector.setConnected(1U, true);
+  REQUIRE(endpoint_selector.select("query", "topic") == 1U);
+
+  endpoint_selector.setConnected(0U, true);
+  REQUIRE(endpoint_selector.select("query", "topic") == 0U);
+  REQUIRE(endpoint_selector.select("other_query", "other_topic") == 0U);
+}
+
+TEST_CASE("Selecting endpoints with the sharding policies",
+          "[EndpointSelector]") {
+  const std::size_t kEndpointCount{4U};
+
+  auto policy = GENERATE(EndpointSelector::Policy::ShardByQuery,
+                         EndpointSelector::Policy::ShardByTopic);
+
+  EndpointSelector endpoint_selector(policy, kEndpointCount);
+  for (std::size_t i = 0U; i < kEndpointCount; ++i) {
+    endpoint_selector.setConnected(i, true);
+  }
+
+  auto selectEndpoint = [&endpoint_selector,
+                         policy](const std::string &name) -> std::size_t {
+    if (policy == EndpointSelector::Policy::ShardByQuery) {
+      return endpoint_selector.select(name, "topic");
+    } else {
+      return endpoint_selector.select("query", name);
+    }
+  };
+
+  // The output is spread across all the endpoints, and the same key
+  // always goes to the same one
+  std::set<std::size_t> used_endpoint_set;
+
+  for (std::size_t i = 0U; i < 64U; ++i) {
+    auto name = "name_" + std::to_string(i);
+
+    auto endpoint_index = selectEndpoint(name);
+    REQUIRE(endpoint_index < kEndpointCount);
+    REQUIRE(selectEndpoint(name) == endpoint_index);
+
+    used_endpoint_set.insert(endpoint_index);
+  }
+
+  REQUIRE(used_endpoint_set.size() == kEndpointCount);
+
+  // The output of a disconnected endpoint goes to the next connected one
+  auto endpoint_index = selectEndpoint("name_0");
+  endpoint_selector.setConnected(endpoint_index, false);
+
+  REQUIRE(selectEndpoint("name_0") == (endpoint_index + 1U) % kEndpointCount);
+}
+} // namespace zeek
@@ -0,0 +1,838 @@
+#include "activitynotifier.h"
+#include "endpointselector.h"
+#include "mocks.h"
+#include "outputpublisher.h"
+#include "queryscheduler.h"
+#include "reconnectbackoff.h"
+#include "zeekconnection.h"
+#include "zeekserverstandin.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+const std::chrono::seconds kTimeout{60};
+
+/// \brief Retry quickly, so that the tests restarting the server do not
+///        have to wait for long backoffs
+const std::chrono::milliseconds kInitialBackoff{50};
+const std::chrono::milliseconds kMaxBackoff{200};
+
+/// \brief A virtual database that returns row_count process-like rows for
+///        each query. Every execution replaces the first changed_row_count
+///        rows of the previous one with new rows
+class GeneratedRowDatabase final : public IVirtualDatabase {
+public:
+  GeneratedRowDatabase(std::size_t row_count_, std::size_t changed_row_count_)
+      : row_count(row_count_), changed_row_count(changed_row_count_) {}
+
+  virtual ~GeneratedRowDatabase() override = default;
+
+  virtual std::vector<std::string> virtualTableList() const override {
+    return {};
+  }
+
+  virtual Status registerTable(IVirtualTable::Ref) override {
+    return Status::success();
+  }
+
+  virtual Status unregisterTable(const std::string &) override {
+    return Status::success();
+  }
+
+  virtual bool isEventTable(const std::string &) const override {
+    return false;
+  }
+
+  virtual void setTableUpdateCallback(TableUpdateCallback) override {}
+
+  virtual Status query(QueryOutput &output,
+                       const std::string &) const override {
+    auto first_row_id = execution_count++ * changed_row_count;
+
+    output.clear();
+    output.reserve(row_count);
+
+    for (auto row_id = first_row_id; row_id < first_row_id + row_count;
+         ++row_id) {
+
+      // clang-format off
+      output.push_back(
+        {
+          { "pid", static_cast<std::int64_t>(row_id) },
+          { "name", "process_name_" + std::to_string(row_id) },
+          { "path", "/usr/local/bin/process_name_" + std::to_string(row_id) },
+          { "start_time", static_cast<double>(1600000000 + row_id) }
+        }
+      );
+      // clang-format on
+    }
+
+    return Status::success();
+  }
+
+  virtual Status query(const std::string &query, std::size_t chunk_size,
+                       const QueryOutputCallback &callback) const override {
+    QueryOutput output;
+    auto status = this->query(output, query);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    if (chunk_size == 0U) {
+      chunk_size = output.size();
+    }
+
+    for (std::size_t i = 0U; i < output.size(); i += chunk_size) {
+      auto chunk_end = std::min(output.size(), i + chunk_size);
+
+      status = callback(QueryOutput(
+          std::make_move_iterator(output.begin() +
+                                  static_cast<std::ptrdiff_t>(i)),
+          std::make_move_iterator(output.begin() +
+                                  static_cast<std::ptrdiff_t>(chunk_end))));
+
+      if (!status.succeeded()) {
+        return status;
+      }
+    }
+
+    return Status::success();
+  }
+
+  /// \return How many queries have been executed so far
+  std::size_t executionCount() const { return execution_count; }
+
+private:
+  std::size_t row_count{0U};
+  std::size_t changed_row_count{0U};
+  mutable std::atomic<std::size_t> execution_count{0U};
+};
+
+/// \brief Returns the endpoint settings for the given local ports
+IZeekConfiguration::ServerEndpoints localServerEndpoints(
+    const std::vector<std::uint16_t> &port_list,
+    IZeekConfiguration::ServerEndpoints::Policy policy =
+        IZeekConfiguration::ServerEndpoints::Policy::Failover) {
+
+  IZeekConfiguration::ServerEndpoints server_endpoints;
+  server_endpoints.policy = policy;
+
+  for (auto port : port_list) {
+    server_endpoints.endpoint_list.push_back({"127.0.0.1", port});
+  }
+
+  return server_endpoints;
+}
+
+/// \brief The agent side of the output path: the query scheduler, the
+///        Zeek connection and the output publishers, driven by the same
+///        loop used by ZeekAgent::exec
+class AgentUnderTest final {
+public:
+  AgentUnderTest(const IZeekConfiguration::ServerEndpoints &server_endpoints,
+                 const IZeekConfiguration::ZeekEventBatching &event_batching,
+                 IVirtualDatabase &virtual_database,
+                 const IZeekConfiguration::OutputSpool &output_spool = {}) {
+
+    auto status = ActivityNotifier::create(activity_notifier);
+    REQUIRE(status.succeeded());
+
+    auto &notifier = *activity_notifier.get();
+    ZeekConnection::OutputPublisherList output_publisher_ptr_list;
+
+    for (std::size_t i = 0U; i < server_endpoints.endpoint_list.size(); ++i) {
+      OutputPublisher::Ref output_publisher;
+      status = OutputPublisher::create(output_publisher, {});
+      REQUIRE(status.succeeded());
+
+      output_publisher->setCapacityCallback(
+          [&notifier]() { notifier.notify(); });
+
+      output_publisher_ptr_list.push_back(output_publisher.get());
+      output_publisher_list.push_back(std::move(output_publisher));
+    }
+
+    status = QueryScheduler::create(query_scheduler, virtual_database, logger);
+    REQUIRE(status.succeeded());
+
+    query_scheduler->setTaskOutputCallback(
+        [&notifier]() { notifier.notify(); });
+
+    ZeekConnection::Configuration configuration;
+    configuration.host_identifier = "stand-in-test-host";
+    configuration.server_endpoints = server_endpoints;
+    configuration.event_batching = event_batching;
+
+    configuration.reconnect.initial_backoff_ms =
+        static_cast<std::uint32_t>(kInitialBackoff.count());
+
+    configuration.reconnect.max_backoff_ms =
+        static_cast<std::uint32_t>(kMaxBackoff.count());
+
+    configuration.output_spool = output_spool;
+
+    status = ZeekConnection::create(zeek_connection, logger, configuration,
+                                    notifier, differential_context,
+                                    output_publisher_ptr_list);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+
+    status = query_scheduler->start();
+    REQUIRE(status.succeeded());
+
+    thread = std::thread(&AgentUnderTest::agentThread, this);
+  }
+
+  ~AgentUnderTest() {
+    terminate = true;
+    activity_notifier->notify();
+
+    thread.join();
+
+    zeek_connection.reset();
+    query_scheduler->stop();
+  }
+
+  /// \brief Stops processing the connection events, so that the incoming
+  ///        messages stay queued
+  void pause() {
+    pause_requested = true;
+    activity_notifier->notify();
+
+    REQUIRE(waitForPause());
+  }
+
+  /// \brief Starts processing the connection events again
+  void resume() { pause_requested = false; }
+
+  /// \brief Set when the connection has been lost
+  std::atomic_bool connection_lost{false};
+
+  /// \brief Set when processing the connection events has failed
+  std::atomic_bool connection_error{false};
+
+  /// \brief How many times the connection events have been processed
+  std::atomic<std::size_t> loop_count{0U};
+
+private:
+  bool waitForPause() const {
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+
+    while (!paused) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return true;
+  }
+
+  void agentThread() {
+    bool connected{false};
+
+    while (!terminate) {
+      if (pause_requested) {
+        paused = true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+
+      paused = false;
+      ++loop_count;
+
+      auto status = zeek_connection->processEvents();
+      if (!status.succeeded()) {
+        connection_error = true;
+        break;
+      }
+
+      if (connected && !zeek_connection->isConnected()) {
+        connection_lost = true;
+      }
+
+      connected = zeek_connection->isConnected();
+
+      query_scheduler->processTaskQueue(zeek_connection->getTaskQueue());
+
+      auto has_capacity = std::all_of(
+          output_publisher_list.begin(), output_publisher_list.end(),
+          [](const OutputPublisher::Ref &output_publisher) -> bool {
+            return output_publisher->hasCapacity();
+          });
+
+      if (has_capacity) {
+        zeek_connection->processTaskOutputList(
+            query_scheduler->getTaskOutputList());
+      }
+    }
+  }
+
+  MockLogger logger;
+  ActivityNotifier::Ref activity_notifier;
+  std::vector<OutputPublisher::Ref> output_publisher_list;
+  QueryScheduler::Ref query_scheduler;
+  ZeekConnection::DifferentialContext differential_context;
+  ZeekConnection::Ref zeek_connection;
+
+  std::atomic_bool terminate{false};
+  std::atomic_bool pause_requested{false};
+  std::atomic_bool paused{false};
+  std::thread thread;
+};
+
+/// \brief Waits for the agent to announce itself
+std::string waitForAgent(ZeekServerStandIn &zeek_server) {
+  std::string host_identifier;
+  auto status = zeek_server.waitForHostAnnounce(host_identifier, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+
+  // The subscriptions are created right before the announcement, give
+  // them time to reach the stand-in
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  return host_identifier;
+}
+
+/// \brief Waits for the given condition to become true
+/// \return False if the timeout has expired first
+bool waitForCondition(const std::function<bool()> &condition,
+                      std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  return true;
+}
+
+std::chrono::microseconds
+elapsedTime(std::chrono::steady_clock::time_point start_time,
+            std::chrono::steady_clock::time_point end_time) {
+  return std::max(
+      std::chrono::duration_cast<std::chrono::microseconds>(end_time -
+                                                            start_time),
+      std::chrono::microseconds(1));
+}
+
+long long perSecond(std::size_t count, std::chrono::microseconds time) {
+  return static_cast<long long>(count) * 1000000LL /
+         static_cast<long long>(time.count());
+}
+} // namespace
+
+TEST_CASE("Publishing query output to a Zeek server",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kRowCount{2000U};
+  const std::size_t kChangedRowCount{100U};
+
+  ZeekServerStandIn zeek_server;
+  GeneratedRowDatabase virtual_database(kRowCount, kChangedRowCount);
+
+  // One event per row, then batched events
+  IZeekConfiguration::ZeekEventBatching event_batching;
+  event_batching.max_row_count = GENERATE(as<std::uint32_t>{}, 0U, 256U);
+
+  AgentUnderTest agent(localServerEndpoints({zeek_server.port()}),
+                       event_batching, virtual_database);
+  auto host_identifier = waitForAgent(zeek_server);
+
+  SECTION("One-shot queries return a snapshot") {
+    zeek_server.sendHostExecute(host_identifier, "SELECT * FROM processes",
+                                "one_shot");
+
+    ZeekServerStandIn::ResponseStats stats;
+    auto status =
+        zeek_server.receiveResponses(stats, "one_shot", kRowCount, kTimeout);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+
+    REQUIRE(stats.snapshot_row_count == kRowCount);
+    REQUIRE(stats.added_row_count == 0U);
+    REQUIRE(stats.removed_row_count == 0U);
+  }
+
+  SECTION("Scheduled queries return differentials") {
+    zeek_server.sendHostSubscribe(host_identifier, "SELECT * FROM processes",
+                                  "scheduled", "BOTH",
+                                  std::chrono::seconds(1));
+
+    // All the rows of the first execution are new
+    ZeekServerStandIn::ResponseStats stats;
+    auto status =
+        zeek_server.receiveResponses(stats, "scheduled", kRowCount, kTimeout);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+    REQUIRE(stats.added_row_count == kRowCount);
+
+    // The next one replaces some of them
+    status = zeek_server.receiveResponses(
+        stats, "scheduled", kRowCount + kChangedRowCount * 2U, kTimeout);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+
+    REQUIRE(stats.added_row_count == kRowCount + kChangedRowCount);
+    REQUIRE(stats.removed_row_count == kChangedRowCount);
+    REQUIRE(stats.snapshot_row_count == 0U);
+  }
+
+  REQUIRE(!agent.connection_lost);
+  REQUIRE(!agent.connection_error);
+}
+
+TEST_CASE("Reconnecting to a restarted Zeek server",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kRowCount{100U};
+  const std::size_t kChangedRowCount{10U};
+
+  GeneratedRowDatabase virtual_database(kRowCount, kChangedRowCount);
+
+  auto zeek_server = std::make_unique<ZeekServerStandIn>();
+  auto server_port = zeek_server->port();
+
+  AgentUnderTest agent(localServerEndpoints({server_port}), {},
+                       virtual_database);
+  auto host_identifier = waitForAgent(*zeek_server.get());
+
+  zeek_server->sendHostSubscribe(host_identifier, "SELECT * FROM processes",
+                                 "scheduled", "ADDED",
+                                 std::chrono::milliseconds(500));
+
+  ZeekServerStandIn::ResponseStats stats;
+  auto status =
+      zeek_server->receiveResponses(stats, "scheduled", kRowCount, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+
+  // Stop the server, and keep it down for a few executions
+  zeek_server.reset();
+
+  REQUIRE(waitForCondition(
+      [&agent]() -> bool { return agent.connection_lost; }, kTimeout));
+
+  REQUIRE(!agent.connection_error);
+
+  auto execution_count = virtual_database.executionCount();
+
+  REQUIRE(waitForCondition(
+      [&virtual_database, execution_count]() -> bool {
+        return virtual_database.executionCount() >= execution_count + 2U;
+      },
+      kTimeout));
+
+  auto restart_time = std::chrono::steady_clock::now();
+
+  zeek_server = std::make_unique<ZeekServerStandIn>(server_port);
+  REQUIRE(zeek_server->port() == server_port);
+
+  // The agent announces itself again, without waiting for the old fixed
+  // delays
+  std::string reconnected_host_identifier;
+  status = zeek_server->waitForHostAnnounce(reconnected_host_identifier,
+                                            kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+  REQUIRE(reconnected_host_identifier == host_identifier);
+
+  auto reconnect_time =
+      elapsedTime(restart_time, std::chrono::steady_clock::now());
+  WARN("Reconnected after " << reconnect_time.count() << "us");
+
+  // The elapsed time depends on the random delays and on the broker
+  // handshake, so only check that the delays picked with the test settings
+  // never exceed the configured maximum
+  for (std::uint64_t seed = 0U; seed < 100U; ++seed) {
+    ReconnectBackoff reconnect_backoff(kInitialBackoff, kMaxBackoff, seed);
+
+    for (std::size_t i = 0U; i < 16U; ++i) {
+      REQUIRE(reconnect_backoff.nextDelay() <= kMaxBackoff);
+    }
+  }
+
+  // The scheduled query kept running while disconnected; the changes are
+  // delivered over the new connection
+  ZeekServerStandIn::ResponseStats reconnected_stats;
+  status = zeek_server->receiveResponses(reconnected_stats, "scheduled",
+                                         kChangedRowCount, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+  REQUIRE(reconnected_stats.added_row_count >= kChangedRowCount);
+  REQUIRE(!agent.connection_error);
+}
+
+TEST_CASE("Losing the connection with unread messages",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kMessageCount{100U};
+  const std::chrono::seconds kMeasuredTime{1};
+
+  // Each reconnection attempt only takes a few passes of the main loop, and
+  // the attempts are at least a few milliseconds apart; a loop that does
+  // not drain the subscriber runs many thousand times per second
+  const std::size_t kMaxLoopCount{1000U};
+
+  GeneratedRowDatabase virtual_database(10U, 0U);
+
+  auto zeek_server = std::make_unique<ZeekServerStandIn>();
+
+  AgentUnderTest agent(localServerEndpoints({zeek_server->port()}), {},
+                       virtual_database);
+  auto host_identifier = waitForAgent(*zeek_server.get());
+
+  // Queue the requests on the agent side, then stop the server before
+  // the agent had a chance to read them
+  agent.pause();
+
+  for (std::size_t i = 0U; i < kMessageCount; ++i) {
+    zeek_server->sendHostExecute(host_identifier, "SELECT * FROM processes",
+                                 "one_shot_" + std::to_string(i));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  zeek_server.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  agent.resume();
+
+  REQUIRE(waitForCondition(
+      [&agent]() -> bool { return agent.connection_lost; }, kTimeout));
+
+  // The agent keeps trying to reconnect, without spinning on the messages
+  // left in the subscriber
+  auto loop_count = agent.loop_count.load();
+  std::this_thread::sleep_for(kMeasuredTime);
+
+  auto measured_loop_count = agent.loop_count.load() - loop_count;
+  WARN("The main loop ran " << measured_loop_count << " times in "
+                            << kMeasuredTime.count() << "s");
+
+  REQUIRE(measured_loop_count < kMaxLoopCount);
+
+  // The requests received before the connection was lost are dropped
+  REQUIRE(virtual_database.executionCount() == 0U);
+  REQUIRE(!agent.connection_error);
+}
+
+TEST_CASE("Spooling the output across agent restarts",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kRowCount{100U};
+  const std::size_t kChangedRowCount{10U};
+  const std::string kSpoolFolderPath{"zeek_agent_endtoend_spool_test"};
+
+  std::filesystem::remove_all(kSpoolFolderPath);
+
+  IZeekConfiguration::OutputSpool output_spool;
+  output_spool.folder_path = kSpoolFolderPath;
+  output_spool.replay_rows_per_second = kChangedRowCount;
+
+  GeneratedRowDatabase virtual_database(kRowCount, kChangedRowCount);
+
+  auto zeek_server = std::make_unique<ZeekServerStandIn>();
+  auto server_port = zeek_server->port();
+
+  {
+    AgentUnderTest agent(localServerEndpoints({server_port}), {},
+                         virtual_database, output_spool);
+
+    auto host_identifier = waitForAgent(*zeek_server.get());
+
+    zeek_server->sendHostSubscribe(host_identifier, "SELECT * FROM processes",
+                                   "scheduled", "ADDED",
+                                   std::chrono::milliseconds(500));
+
+    ZeekServerStandIn::ResponseStats stats;
+    auto status =
+        zeek_server->receiveResponses(stats, "scheduled", kRowCount, kTimeout);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+
+    // The output produced while the server is down goes to the spool
+    zeek_server.reset();
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    REQUIRE(agent.connection_lost);
+    REQUIRE(!agent.connection_error);
+  }
+
+  REQUIRE(!std::filesystem::is_empty(kSpoolFolderPath));
+
+  // A new agent, which has no scheduled query, replays it once the server
+  // is back
+  zeek_server = std::make_unique<ZeekServerStandIn>(server_port);
+
+  {
+    AgentUnderTest agent(localServerEndpoints({server_port}), {},
+                         virtual_database, output_spool);
+
+    waitForAgent(*zeek_server.get());
+
+    ZeekServerStandIn::ResponseStats stats;
+    auto status = zeek_server->receiveResponses(stats, "scheduled",
+                                                kChangedRowCount, kTimeout);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+    REQUIRE(stats.added_row_count >= kChangedRowCount);
+    REQUIRE(!agent.connection_error);
+  }
+
+  std::filesystem::remove_all(kSpoolFolderPath);
+}
+
+TEST_CASE("Failing over to the next Zeek server",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kRowCount{100U};
+  const std::size_t kChangedRowCount{10U};
+
+  GeneratedRowDatabase virtual_database(kRowCount, kChangedRowCount);
+
+  auto primary_server = std::make_unique<ZeekServerStandIn>();
+  ZeekServerStandIn secondary_server;
+
+  AgentUnderTest agent(
+      localServerEndpoints({primary_server->port(), secondary_server.port()}),
+      {}, virtual_database);
+
+  auto host_identifier = waitForAgent(*primary_server.get());
+  REQUIRE(waitForAgent(secondary_server) == host_identifier);
+
+  primary_server->sendHostSubscribe(host_identifier, "SELECT * FROM processes",
+                                    "scheduled", "ADDED",
+                                    std::chrono::milliseconds(500));
+
+  // While the primary server is up, it receives all the output
+  ZeekServerStandIn::ResponseStats stats;
+  auto status =
+      primary_server->receiveResponses(stats, "scheduled", kRowCount, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+
+  // Once it goes away, the output moves to the secondary server without
+  // waiting for the primary one to come back
+  primary_server.reset();
+
+  ZeekServerStandIn::ResponseStats failover_stats;
+  status = secondary_server.receiveResponses(failover_stats, "scheduled",
+                                             kChangedRowCount, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+  REQUIRE(failover_stats.added_row_count >= kChangedRowCount);
+
+  REQUIRE(!agent.connection_lost);
+  REQUIRE(!agent.connection_error);
+}
+
+TEST_CASE("Sharding the output across Zeek servers",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  using Policy = IZeekConfiguration::ServerEndpoints::Policy;
+
+  const std::size_t kRowCount{100U};
+  const std::size_t kQueryCount{8U};
+
+  auto policy = GENERATE(Policy::Failover, Policy::ShardByQuery);
+
+  GeneratedRowDatabase virtual_database(kRowCount, 0U);
+
+  std::vector<std::unique_ptr<ZeekServerStandIn>> zeek_server_list;
+  std::vector<std::uint16_t> port_list;
+
+  for (std::size_t i = 0U; i < 2U; ++i) {
+    zeek_server_list.push_back(std::make_unique<ZeekServerStandIn>());
+    port_list.push_back(zeek_server_list.back()->port());
+  }
+
+  AgentUnderTest agent(localServerEndpoints(port_list, policy), {},
+                       virtual_database);
+
+  std::string host_identifier;
+  for (auto &zeek_server : zeek_server_list) {
+    host_identifier = waitForAgent(*zeek_server.get());
+  }
+
+  // Each query is expected on the endpoint picked by the selector while
+  // all the endpoints are connected
+  EndpointSelector endpoint_selector(policy, zeek_server_list.size());
+  for (std::size_t i = 0U; i < zeek_server_list.size(); ++i) {
+    endpoint_selector.setConnected(i, true);
+  }
+
+  for (std::size_t i = 0U; i < kQueryCount; ++i) {
+    auto cookie = "one_shot_" + std::to_string(i);
+
+    zeek_server_list.front()->sendHostExecute(
+        host_identifier, "SELECT * FROM processes", cookie);
+
+    auto query_id = ZeekConnection::computeQueryID(
+        ZeekServerStandIn::kResponseTopic, ZeekServerStandIn::kResponseEvent,
+        cookie);
+
+    auto endpoint_index =
+        endpoint_selector.select(query_id, ZeekServerStandIn::kResponseTopic);
+
+    ZeekServerStandIn::ResponseStats stats;
+    auto status = zeek_server_list.at(endpoint_index)
+                      ->receiveResponses(stats, cookie, kRowCount, kTimeout);
+
+    CHECK(status.message() == "");
+    REQUIRE(status.succeeded());
+    REQUIRE(stats.snapshot_row_count == kRowCount);
+  }
+
+  REQUIRE(!agent.connection_error);
+}
+
+TEST_CASE("Answering each Zeek server with the failover policy",
+          "[ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kRowCount{100U};
+
+  GeneratedRowDatabase virtual_database(kRowCount, 0U);
+
+  ZeekServerStandIn primary_server;
+  ZeekServerStandIn secondary_server;
+
+  AgentUnderTest agent(
+      localServerEndpoints({primary_server.port(), secondary_server.port()}),
+      {}, virtual_database);
+
+  auto host_identifier = waitForAgent(primary_server);
+  REQUIRE(waitForAgent(secondary_server) == host_identifier);
+
+  // While the primary server is up, the requests of the secondary one are
+  // still answered by the secondary one
+  secondary_server.sendHostExecute(host_identifier, "SELECT * FROM processes",
+                                   "secondary_one_shot");
+
+  ZeekServerStandIn::ResponseStats stats;
+  auto status = secondary_server.receiveResponses(stats, "secondary_one_shot",
+                                                  kRowCount, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+  REQUIRE(stats.snapshot_row_count == kRowCount);
+
+  primary_server.sendHostExecute(host_identifier, "SELECT * FROM processes",
+                                 "primary_one_shot");
+
+  ZeekServerStandIn::ResponseStats primary_stats;
+  status = primary_server.receiveResponses(primary_stats, "primary_one_shot",
+                                           kRowCount, kTimeout);
+
+  CHECK(status.message() == "");
+  REQUIRE(status.succeeded());
+  REQUIRE(primary_stats.snapshot_row_count == kRowCount);
+
+  REQUIRE(!agent.connection_error);
+}
+
+TEST_CASE("End-to-end output path throughput",
+          "[.benchmark][ZeekConnection][ZeekServerStandIn]") {
+  const std::size_t kRowCount{50000U};
+  const std::size_t kChangedRowCount{2500U};
+
+  auto measure = [&](std::uint32_t max_row_count,
+                     const std::string &mode_name) {
+    IZeekConfiguration::ZeekEventBatching event_batching;
+    event_batching.max_row_count = max_row_count;
+
+    ZeekServerStandIn zeek_server;
+    GeneratedRowDatabase virtual_database(kRowCount, kChangedRowCount);
+
+    AgentUnderTest agent(localServerEndpoints({zeek_server.port()}),
+                         event_batching, virtual_database);
+    auto host_identifier = waitForAgent(zeek_server);
+
+    // Snapshot: latency and throughput, as seen by the receiver
+    auto send_time = std::chrono::steady_clock::now();
+
+    zeek_server.sendHostExecute(host_identifier, "SELECT * FROM processes",
+                                "one_shot");
+
+    ZeekServerStandIn::ResponseStats snapshot_stats;
+    auto status = zeek_server.receiveResponses(snapshot_stats, "one_shot",
+                                               kRowCount, kTimeout);
+    REQUIRE(status.succeeded());
+
+    auto completion_time =
+        elapsedTime(send_time, snapshot_stats.last_event_time);
+
+    WARN(mode_name << ", snapshot: " << snapshot_stats.event_count
+                   << " events, first event after "
+                   << elapsedTime(send_time, snapshot_stats.first_event_time)
+                          .count()
+                   << "us, completed after " << completion_time.count()
+                   << "us (" << perSecond(kRowCount, completion_time)
+                   << " rows/s, "
+                   << perSecond(snapshot_stats.event_count, completion_time)
+                   << " events/s)");
+
+    // Differential: the first execution reports every row, the following
+    // ones only the rows that have changed. The executions are started by
+    // the scheduler, so only the time between the first and the last
+    // event is measured
+    zeek_server.sendHostSubscribe(host_identifier, "SELECT * FROM processes",
+                                  "scheduled", "BOTH",
+                                  std::chrono::seconds(5));
+
+    ZeekServerStandIn::ResponseStats initial_stats;
+    status = zeek_server.receiveResponses(initial_stats, "scheduled",
+                                          kRowCount, kTimeout);
+    REQUIRE(status.succeeded());
+
+    auto initial_time = elapsedTime(initial_stats.first_event_time,
+                                    initial_stats.last_event_time);
+
+    WARN(mode_name << ", first differential execution: "
+                   << initial_stats.event_count << " events received in "
+                   << initial_time.count() << "us ("
+                   << perSecond(kRowCount, initial_time) << " rows/s)");
+
+    ZeekServerStandIn::ResponseStats update_stats;
+    status = zeek_server.receiveResponses(
+        update_stats, "scheduled", kChangedRowCount * 2U, kTimeout);
+    REQUIRE(status.succeeded());
+
+    auto update_time = elapsedTime(update_stats.first_event_time,
+                                   update_stats.last_event_time);
+
+    WARN(mode_name << ", differential update: " << update_stats.event_count
+                   << " events, " << update_stats.added_row_count
+                   << " added and " << update_stats.removed_row_count
+                   << " removed rows received in " << update_time.count()
+                   << "us");
+
+    REQUIRE(!agent.connection_lost);
+    REQUIRE(!agent.connection_error);
+  };
+
+  measure(0U, "One event per row");
+  measure(256U, "Batches of 256 rows");
+}
+} // namespace zeek
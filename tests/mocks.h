@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+#include <zeek/ivirtualdatabase.h>
+#include <zeek/izeeklogger.h>
+
+namespace zeek {
+/// \brief A virtual database that returns output_row_count rows for each
+///        query, counting how many queries have been executed. Scans of the
+///        tables in event_table_map return (and discard) their rows, and
+///        the chunked queries starting with "SELECT failing" fail after
+///        their second chunk
+class MockVirtualDatabase final : public IVirtualDatabase {
+public:
+  MockVirtualDatabase() = default;
+  virtual ~MockVirtualDatabase() override = default;
+
+  virtual std::vector<std::string> virtualTableList() const override {
+    return {};
+  }
+
+  virtual Status registerTable(IVirtualTable::Ref) override {
+    return Status::success();
+  }
+
+  virtual Status unregisterTable(const std::string &) override {
+    return Status::success();
+  }
+
+  virtual bool isEventTable(const std::string &name) const override {
+    return event_table_map.count(name) > 0U;
+  }
+
+  virtual void setTableUpdateCallback(TableUpdateCallback) override {}
+
+  virtual Status query(QueryOutput &output,
+                       const std::string &query) const override {
+    ++query_count;
+
+    for (auto &p : event_table_map) {
+      const auto &table_name = p.first;
+      auto &table_rows = p.second;
+
+      if (query == "SELECT * FROM " + table_name) {
+        output = std::move(table_rows);
+        table_rows = {};
+
+        return Status::success();
+      }
+    }
+
+    output = QueryOutput(output_row_count, {{"query", query}});
+    return Status::success();
+  }
+
+  virtual Status query(const std::string &query, std::size_t chunk_size,
+                       const QueryOutputCallback &callback) const override {
+    QueryOutput output;
+    auto status = this->query(output, query);
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    if (chunk_size == 0U) {
+      chunk_size = output.size();
+    }
+
+    for (std::size_t i = 0U; i < output.size(); i += chunk_size) {
+      if (i >= chunk_size * 2U && query.rfind("SELECT failing", 0U) == 0U) {
+        return Status::failure("The query has failed");
+      }
+
+      auto chunk_end = std::min(output.size(), i + chunk_size);
+
+      status = callback(QueryOutput(
+          output.begin() + static_cast<std::ptrdiff_t>(i),
+          output.begin() + static_cast<std::ptrdiff_t>(chunk_end)));
+
+      if (!status.succeeded()) {
+        return status;
+      }
+    }
+
+    return Status::success();
+  }
+
+  mutable std::atomic<std::size_t> query_count{0U};
+  std::size_t output_row_count{1U};
+  mutable std::unordered_map<std::string, QueryOutput> event_table_map;
+};
+
+/// \brief A logger that discards all messages
+class MockLogger final : public IZeekLogger {
+public:
+  MockLogger() = default;
+  virtual ~MockLogger() override = default;
+
+  virtual void logMessage(Severity, const std::string &) override {}
+};
+} // namespace zeek
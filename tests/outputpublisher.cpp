@@ -0,0 +1,314 @@
+#include "outputpublisher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+OutputPublisher::Output generateOutput(const std::string &cookie,
+                                       bool snapshot) {
+  OutputPublisher::Output output;
+  output.trigger = snapshot ? "ZeekAgent::SNAPSHOT" : "ZeekAgent::ADD";
+  output.response_topic = "/zeek/zeek-agent/response";
+  output.response_event = "response_event";
+  output.cookie = cookie;
+  output.snapshot = snapshot;
+
+  for (std::int64_t i = 0; i < 4; ++i) {
+    IVirtualDatabase::OutputRow row;
+    row.push_back({"value", i});
+    row.push_back({"name", std::string("row")});
+
+    output.query_output.push_back(std::move(row));
+  }
+
+  return output;
+}
+
+/// \brief Waits until the given condition is true, for up to 10 seconds
+bool waitFor(const std::function<bool()> &condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (condition()) {
+      return true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  return false;
+}
+
+/// \brief Waits until the given amount of outputs has been published
+bool waitForPublishedOutputs(const OutputPublisher &output_publisher,
+                             std::uint64_t published_output_count) {
+  return waitFor([&output_publisher, published_output_count]() {
+    return output_publisher.stats().published_output_count >=
+           published_output_count;
+  });
+}
+
+/// \brief Records the cookies of the published outputs
+struct PublishedCookieList final {
+  std::mutex mutex;
+  std::vector<std::string> cookie_list;
+
+  OutputPublisher::PublishCallback callback() {
+    return [this](OutputPublisher::Output output) {
+      std::lock_guard<std::mutex> lock(mutex);
+      cookie_list.push_back(output.cookie);
+    };
+  }
+};
+} // namespace
+
+SCENARIO("Publishing the query output", "[OutputPublisher]") {
+  auto update_byte_count =
+      OutputPublisher::estimateByteCount(generateOutput("0", false));
+
+  auto snapshot_byte_count =
+      OutputPublisher::estimateByteCount(generateOutput("0", true));
+
+  GIVEN("an output publisher using the block overflow policy") {
+    OutputPublisher::Configuration configuration;
+    configuration.max_queued_byte_count = snapshot_byte_count * 2U;
+    configuration.overflow_policy = OutputPublisher::OverflowPolicy::Block;
+
+    OutputPublisher::Ref output_publisher;
+    auto status = OutputPublisher::create(output_publisher, configuration);
+    REQUIRE(status.succeeded());
+
+    std::atomic_bool capacity_available{false};
+    output_publisher->setCapacityCallback(
+        [&capacity_available]() { capacity_available = true; });
+
+    WHEN("more output is queued than the limit allows") {
+      output_publisher->push(generateOutput("0", true));
+      REQUIRE(output_publisher->hasCapacity());
+
+      output_publisher->push(generateOutput("1", true));
+      output_publisher->push(generateOutput("2", false));
+
+      THEN("nothing is dropped, and the queue reports that it is full") {
+        REQUIRE(!output_publisher->hasCapacity());
+
+        auto stats = output_publisher->stats();
+        REQUIRE(stats.queued_output_count == 3U);
+        REQUIRE(stats.queued_byte_count ==
+                snapshot_byte_count * 2U + update_byte_count);
+
+        REQUIRE(stats.peak_queued_byte_count == stats.queued_byte_count);
+        REQUIRE(stats.dropped_output_count == 0U);
+        REQUIRE(stats.overflow_count == 1U);
+      }
+
+      AND_WHEN("the publish callback is set") {
+        PublishedCookieList published_cookie_list;
+        output_publisher->setPublishCallback(published_cookie_list.callback());
+
+        THEN("the output is published in order and the capacity callback "
+             "is invoked") {
+          REQUIRE(waitForPublishedOutputs(*output_publisher.get(), 3U));
+
+          {
+            std::lock_guard<std::mutex> lock(published_cookie_list.mutex);
+
+            const std::vector<std::string> kExpectedCookieList = {"0", "1",
+                                                                  "2"};
+
+            REQUIRE(published_cookie_list.cookie_list == kExpectedCookieList);
+          }
+
+          REQUIRE(waitFor([&capacity_available]() -> bool {
+            return capacity_available;
+          }));
+
+          REQUIRE(output_publisher->hasCapacity());
+
+          auto stats = output_publisher->stats();
+          REQUIRE(stats.queued_output_count == 0U);
+          REQUIRE(stats.queued_byte_count == 0U);
+          REQUIRE(stats.published_output_count == 3U);
+          REQUIRE(stats.published_row_count == 12U);
+        }
+      }
+    }
+
+    WHEN("the queued output is taken from a full queue") {
+      output_publisher->push(generateOutput("0", true));
+      output_publisher->push(generateOutput("1", true));
+      output_publisher->push(generateOutput("2", false));
+      REQUIRE(!output_publisher->hasCapacity());
+
+      auto output_list = output_publisher->takeQueuedOutput();
+
+      THEN("the output is returned in order and the queue is emptied") {
+        REQUIRE(output_list.size() == 3U);
+        REQUIRE(output_list.at(0U).cookie == "0");
+        REQUIRE(output_list.at(1U).cookie == "1");
+        REQUIRE(output_list.at(2U).cookie == "2");
+
+        REQUIRE(capacity_available);
+        REQUIRE(output_publisher->hasCapacity());
+
+        auto stats = output_publisher->stats();
+        REQUIRE(stats.queued_output_count == 0U);
+        REQUIRE(stats.queued_byte_count == 0U);
+        REQUIRE(stats.published_output_count == 0U);
+        REQUIRE(stats.dropped_output_count == 0U);
+      }
+    }
+
+    WHEN("the publish callback is removed") {
+      PublishedCookieList published_cookie_list;
+      output_publisher->setPublishCallback(published_cookie_list.callback());
+
+      output_publisher->push(generateOutput("0", false));
+      REQUIRE(waitForPublishedOutputs(*output_publisher.get(), 1U));
+
+      output_publisher->setPublishCallback({});
+      output_publisher->push(generateOutput("1", false));
+
+      THEN("the new output stays in the queue") {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        auto stats = output_publisher->stats();
+        REQUIRE(stats.published_output_count == 1U);
+        REQUIRE(stats.queued_output_count == 1U);
+      }
+    }
+  }
+
+  GIVEN("an output publisher using the drop snapshots overflow policy") {
+    OutputPublisher::Configuration configuration;
+    configuration.max_queued_byte_count =
+        snapshot_byte_count + update_byte_count;
+
+    configuration.overflow_policy =
+        OutputPublisher::OverflowPolicy::DropSnapshots;
+
+    OutputPublisher::Ref output_publisher;
+    auto status = OutputPublisher::create(output_publisher, configuration);
+    REQUIRE(status.succeeded());
+
+    WHEN("more output is queued than the limit allows") {
+      output_publisher->push(generateOutput("0", false));
+      output_publisher->push(generateOutput("1", true));
+      output_publisher->push(generateOutput("2", true));
+      output_publisher->push(generateOutput("3", false));
+
+      THEN("the oldest snapshots are dropped first") {
+        auto stats = output_publisher->stats();
+        REQUIRE(stats.queued_output_count == 2U);
+        REQUIRE(stats.queued_byte_count == update_byte_count * 2U);
+        REQUIRE(stats.dropped_output_count == 2U);
+        REQUIRE(stats.dropped_row_count == 8U);
+        REQUIRE(stats.overflow_count == 1U);
+        REQUIRE(output_publisher->hasCapacity());
+
+        PublishedCookieList published_cookie_list;
+        output_publisher->setPublishCallback(published_cookie_list.callback());
+
+        REQUIRE(waitForPublishedOutputs(*output_publisher.get(), 2U));
+
+        std::lock_guard<std::mutex> lock(published_cookie_list.mutex);
+
+        const std::vector<std::string> kExpectedCookieList = {"0", "3"};
+        REQUIRE(published_cookie_list.cookie_list == kExpectedCookieList);
+      }
+    }
+  }
+
+  GIVEN("an output publisher shared by several queries") {
+    OutputPublisher::Configuration configuration;
+    configuration.fair_queuing_quantum = 4U;
+
+    OutputPublisher::Ref output_publisher;
+    auto status = OutputPublisher::create(output_publisher, configuration);
+    REQUIRE(status.succeeded());
+
+    WHEN("a chatty query has queued more output than a quiet one") {
+      for (std::size_t i = 0U; i < 10U; ++i) {
+        output_publisher->push(generateOutput("chatty", false));
+      }
+
+      output_publisher->push(generateOutput("quiet", false));
+
+      PublishedCookieList published_cookie_list;
+      output_publisher->setPublishCallback(published_cookie_list.callback());
+
+      THEN("the queries take turns") {
+        REQUIRE(waitForPublishedOutputs(*output_publisher.get(), 11U));
+
+        std::lock_guard<std::mutex> lock(published_cookie_list.mutex);
+        const auto &cookie_list = published_cookie_list.cookie_list;
+
+        REQUIRE(cookie_list.size() == 11U);
+        REQUIRE(cookie_list.at(0U) == "chatty");
+        REQUIRE(cookie_list.at(1U) == "quiet");
+
+        REQUIRE(std::count(cookie_list.begin(), cookie_list.end(),
+                           "chatty") == 10);
+      }
+    }
+  }
+
+  GIVEN("an output publisher with rate limits") {
+    OutputPublisher::Configuration configuration;
+    configuration.max_topic_rows_per_second = 40U;
+    configuration.max_query_rows_per_second = 40U;
+
+    OutputPublisher::Ref output_publisher;
+    auto status = OutputPublisher::create(output_publisher, configuration);
+    REQUIRE(status.succeeded());
+
+    PublishedCookieList published_cookie_list;
+    output_publisher->setPublishCallback(published_cookie_list.callback());
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    // 60 rows each time, while a single second worth of rows can be
+    // published at once
+    WHEN("a query exceeds its rate limit") {
+      for (std::size_t i = 0U; i < 15U; ++i) {
+        output_publisher->push(generateOutput("limited", false));
+      }
+    }
+
+    WHEN("a response topic exceeds its rate limit") {
+      for (std::size_t i = 0U; i < 15U; ++i) {
+        output_publisher->push(
+            generateOutput("limited" + std::to_string(i % 3U), false));
+      }
+    }
+
+    auto other_output = generateOutput("other", false);
+    other_output.response_topic = "/zeek/zeek-agent/other_response";
+    output_publisher->push(std::move(other_output));
+
+    REQUIRE(waitForPublishedOutputs(*output_publisher.get(), 16U));
+
+    auto elapsed_time = std::chrono::steady_clock::now() - start_time;
+    REQUIRE(elapsed_time >= std::chrono::milliseconds(300));
+
+    auto stats = output_publisher->stats();
+    REQUIRE(stats.deferred_output_count > 0U);
+    REQUIRE(stats.dropped_output_count == 0U);
+
+    // The other topic is not affected by the rate limits
+    std::lock_guard<std::mutex> lock(published_cookie_list.mutex);
+    const auto &cookie_list = published_cookie_list.cookie_list;
+
+    REQUIRE(cookie_list.size() == 16U);
+    REQUIRE(cookie_list.back() != "other");
+  }
+}
+} // namespace zeek
@@ -0,0 +1,310 @@
+#include "outputspool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+const std::string kSpoolFolderPath{"zeek_agent_output_spool_test"};
+
+OutputPublisher::Output generateOutput(std::size_t index,
+                                       std::size_t row_count) {
+  OutputPublisher::Output output;
+  output.trigger = "ZeekAgent::ADD";
+  output.response_topic = "/zeek/zeek-agent/response";
+  output.response_event = "response_event";
+  output.cookie = "cookie" + std::to_string(index);
+  output.snapshot = (index % 2U) == 0U;
+
+  for (std::size_t i = 0U; i < row_count; ++i) {
+    // clang-format off
+    output.query_output.push_back({
+      { "integer", static_cast<std::int64_t>(i) - 1000 },
+      { "string", std::string("value") + std::to_string(i) },
+      { "double", 1.5 },
+      { "null", std::nullopt }
+    });
+    // clang-format on
+  }
+
+  return output;
+}
+
+bool isSameOutput(const OutputPublisher::Output &left,
+                  const OutputPublisher::Output &right) {
+  if (left.trigger != right.trigger ||
+      left.response_topic != right.response_topic ||
+      left.response_event != right.response_event ||
+      left.cookie != right.cookie || left.snapshot != right.snapshot ||
+      left.query_output.size() != right.query_output.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0U; i < left.query_output.size(); ++i) {
+    const auto &left_row = left.query_output.at(i);
+    const auto &right_row = right.query_output.at(i);
+
+    if (left_row.size() != right_row.size()) {
+      return false;
+    }
+
+    for (std::size_t j = 0U; j < left_row.size(); ++j) {
+      if (left_row.at(j).name != right_row.at(j).name ||
+          left_row.at(j).data != right_row.at(j).data) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+std::vector<std::filesystem::path> segmentPathList() {
+  std::vector<std::filesystem::path> path_list;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(kSpoolFolderPath)) {
+    path_list.push_back(entry.path());
+  }
+
+  std::sort(path_list.begin(), path_list.end());
+  return path_list;
+}
+} // namespace
+
+TEST_CASE("Output spool encoding", "[OutputSpool]") {
+  auto output = generateOutput(0U, 10U);
+  output.query_output.at(0U).push_back({"extra", std::int64_t{-1}});
+
+  std::string buffer;
+  OutputSpool::encodeOutput(buffer, output);
+
+  OutputPublisher::Output decoded_output;
+  auto status = OutputSpool::decodeOutput(decoded_output, buffer);
+  REQUIRE(status.succeeded());
+  REQUIRE(isSameOutput(decoded_output, output));
+
+  // The column names are only stored once
+  REQUIRE(buffer.size() < OutputPublisher::estimateByteCount(output) / 2U);
+
+  buffer.pop_back();
+  status = OutputSpool::decodeOutput(decoded_output, buffer);
+  REQUIRE(!status.succeeded());
+}
+
+TEST_CASE("Output spool replay", "[OutputSpool]") {
+  const std::size_t kOutputCount{100U};
+
+  std::filesystem::remove_all(kSpoolFolderPath);
+
+  OutputSpool::Configuration configuration;
+  configuration.folder_path = kSpoolFolderPath;
+  configuration.max_byte_count = 1024U * 1024U;
+  configuration.segment_byte_count = 4096U;
+
+  {
+    OutputSpool::Ref output_spool;
+    auto status = OutputSpool::create(output_spool, configuration);
+    REQUIRE(status.succeeded());
+    REQUIRE(output_spool->empty());
+
+    for (std::size_t i = 0U; i < kOutputCount; ++i) {
+      status = output_spool->append(generateOutput(i, 5U));
+      REQUIRE(status.succeeded());
+    }
+
+    auto stats = output_spool->stats();
+    REQUIRE(stats.spooled_output_count == kOutputCount);
+    REQUIRE(stats.written_output_count == kOutputCount);
+    REQUIRE(stats.segment_count > 1U);
+  }
+
+  // The outputs survive a restart, and are replayed in order
+  OutputSpool::Ref output_spool;
+  auto status = OutputSpool::create(output_spool, configuration);
+  REQUIRE(status.succeeded());
+  REQUIRE(output_spool->stats().spooled_output_count == kOutputCount);
+
+  for (std::size_t i = 0U; i < kOutputCount / 2U; ++i) {
+    std::optional<OutputPublisher::Output> output;
+    status = output_spool->takeNext(output);
+
+    REQUIRE(status.succeeded());
+    REQUIRE(output.has_value());
+    REQUIRE(isSameOutput(output.value(), generateOutput(i, 5U)));
+  }
+
+  // New outputs are queued after the old ones
+  status = output_spool->append(generateOutput(kOutputCount, 5U));
+  REQUIRE(status.succeeded());
+
+  for (std::size_t i = kOutputCount / 2U; i <= kOutputCount; ++i) {
+    std::optional<OutputPublisher::Output> output;
+    status = output_spool->takeNext(output);
+
+    REQUIRE(status.succeeded());
+    REQUIRE(output.has_value());
+    REQUIRE(output->cookie == "cookie" + std::to_string(i));
+  }
+
+  REQUIRE(output_spool->empty());
+
+  std::optional<OutputPublisher::Output> output;
+  status = output_spool->takeNext(output);
+  REQUIRE(status.succeeded());
+  REQUIRE(!output.has_value());
+
+  // Replayed segments are deleted
+  auto stats = output_spool->stats();
+  REQUIRE(stats.replayed_output_count == kOutputCount + 1U);
+  REQUIRE(stats.spooled_byte_count == 0U);
+  REQUIRE(segmentPathList().empty());
+
+  output_spool.reset();
+  std::filesystem::remove_all(kSpoolFolderPath);
+}
+
+TEST_CASE("Output spool limits", "[OutputSpool]") {
+  std::filesystem::remove_all(kSpoolFolderPath);
+
+  OutputSpool::Configuration configuration;
+  configuration.folder_path = kSpoolFolderPath;
+  configuration.max_byte_count = 16384U;
+  configuration.segment_byte_count = 4096U;
+
+  OutputSpool::Ref output_spool;
+  auto status = OutputSpool::create(output_spool, configuration);
+  REQUIRE(status.succeeded());
+
+  SECTION("The oldest segments are dropped when the spool is full") {
+    const std::size_t kOutputCount{500U};
+
+    for (std::size_t i = 0U; i < kOutputCount; ++i) {
+      status = output_spool->append(generateOutput(i, 2U));
+      REQUIRE(status.succeeded());
+    }
+
+    auto stats = output_spool->stats();
+    REQUIRE(stats.dropped_output_count > 0U);
+    REQUIRE(stats.spooled_byte_count <= configuration.max_byte_count);
+    REQUIRE(stats.spooled_output_count + stats.dropped_output_count ==
+            kOutputCount);
+
+    // What is left is the newest output, still in order
+    auto first_index = kOutputCount - stats.spooled_output_count;
+
+    for (auto i = first_index; i < kOutputCount; ++i) {
+      std::optional<OutputPublisher::Output> output;
+      status = output_spool->takeNext(output);
+
+      REQUIRE(status.succeeded());
+      REQUIRE(output.has_value());
+      REQUIRE(output->cookie == "cookie" + std::to_string(i));
+    }
+
+    REQUIRE(output_spool->empty());
+  }
+
+  SECTION("Outputs larger than a segment get their own segment") {
+    status = output_spool->append(generateOutput(0U, 2U));
+    REQUIRE(status.succeeded());
+
+    status = output_spool->append(generateOutput(1U, 300U));
+    REQUIRE(status.succeeded());
+    REQUIRE(output_spool->stats().segment_count == 2U);
+
+    // Outputs larger than the whole spool are rejected
+    status = output_spool->append(generateOutput(2U, 1000U));
+    REQUIRE(!status.succeeded());
+
+    const std::vector<std::size_t> kRowCountList = {2U, 300U};
+
+    for (std::size_t i = 0U; i < kRowCountList.size(); ++i) {
+      std::optional<OutputPublisher::Output> output;
+      status = output_spool->takeNext(output);
+
+      REQUIRE(status.succeeded());
+      REQUIRE(output.has_value());
+      REQUIRE(isSameOutput(output.value(),
+                           generateOutput(i, kRowCountList.at(i))));
+    }
+
+    REQUIRE(output_spool->empty());
+  }
+
+  output_spool.reset();
+  std::filesystem::remove_all(kSpoolFolderPath);
+}
+
+TEST_CASE("Damaged output spool segments", "[OutputSpool]") {
+  const std::size_t kOutputCount{40U};
+
+  std::filesystem::remove_all(kSpoolFolderPath);
+
+  OutputSpool::Configuration configuration;
+  configuration.folder_path = kSpoolFolderPath;
+  configuration.max_byte_count = 1024U * 1024U;
+  configuration.segment_byte_count = 4096U;
+
+  {
+    OutputSpool::Ref output_spool;
+    auto status = OutputSpool::create(output_spool, configuration);
+    REQUIRE(status.succeeded());
+
+    for (std::size_t i = 0U; i < kOutputCount; ++i) {
+      status = output_spool->append(generateOutput(i, 5U));
+      REQUIRE(status.succeeded());
+    }
+  }
+
+  auto path_list = segmentPathList();
+  REQUIRE(path_list.size() > 1U);
+
+  // Damage the middle of the first segment; the records that follow it in
+  // the same segment are lost, the other segments are not affected
+  {
+    std::fstream stream(path_list.front(),
+                        std::ios::binary | std::ios::in | std::ios::out);
+
+    auto middle_offset =
+        static_cast<std::streamoff>(std::filesystem::file_size(path_list[0]) /
+                                    2U);
+
+    stream.seekg(middle_offset);
+    auto byte = static_cast<char>(stream.get());
+
+    stream.seekp(middle_offset);
+    stream.put(static_cast<char>(~byte));
+  }
+
+  OutputSpool::Ref output_spool;
+  auto status = OutputSpool::create(output_spool, configuration);
+  REQUIRE(status.succeeded());
+
+  auto stats = output_spool->stats();
+  REQUIRE(stats.corrupted_record_count == 1U);
+  REQUIRE(stats.spooled_output_count < kOutputCount);
+
+  std::vector<std::string> cookie_list;
+
+  while (!output_spool->empty()) {
+    std::optional<OutputPublisher::Output> output;
+    status = output_spool->takeNext(output);
+
+    REQUIRE(status.succeeded());
+    REQUIRE(output.has_value());
+
+    cookie_list.push_back(output->cookie);
+  }
+
+  REQUIRE(!cookie_list.empty());
+  REQUIRE(cookie_list.front() == "cookie0");
+  REQUIRE(cookie_list.back() ==
+          "cookie" + std::to_string(kOutputCount - 1U));
+
+  output_spool.reset();
+  std::filesystem::remove_all(kSpoolFolderPath);
+}
+} // namespace zeek
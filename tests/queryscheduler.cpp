@@ -0,0 +1,725 @@
+#include "mocks.h"
+#include "queryscheduler.h"
+#include "scheduleplanner.h"
+#include "taskschedule.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+/// \brief A clock that only moves forward when told to
+struct VirtualClock final {
+  std::chrono::steady_clock::time_point current_time;
+
+  QueryScheduler::Clock clock() {
+    return [this]() -> std::chrono::steady_clock::time_point {
+      return current_time;
+    };
+  }
+};
+
+QueryScheduler::Task generateScheduledTask(const std::string &query,
+                                           std::chrono::milliseconds interval) {
+  QueryScheduler::Task task;
+  task.type = QueryScheduler::Task::Type::AddScheduledQuery;
+  task.query = query;
+  task.response_event = "response_event";
+  task.response_topic = "response_topic";
+  task.cookie = "cookie";
+  task.interval = interval;
+  task.update_type = QueryScheduler::Task::UpdateType::Added;
+
+  return task;
+}
+
+void addProcessEvent(MockVirtualDatabase &virtual_database, std::int64_t pid) {
+  IVirtualDatabase::ColumnValue column;
+  column.name = "pid";
+  column.data = pid;
+
+  virtual_database.event_table_map["process_events"].push_back({column});
+}
+} // namespace
+
+TEST_CASE("Task schedule ordering", "[TaskSchedule]") {
+  const std::chrono::steady_clock::time_point kBaseTime;
+
+  TaskSchedule task_schedule;
+  REQUIRE(task_schedule.empty());
+
+  task_schedule.schedule(1U, kBaseTime + std::chrono::milliseconds(300));
+  task_schedule.schedule(2U, kBaseTime + std::chrono::milliseconds(100));
+  task_schedule.schedule(3U, kBaseTime + std::chrono::milliseconds(200));
+  task_schedule.schedule(4U, kBaseTime + std::chrono::milliseconds(100));
+  REQUIRE(task_schedule.size() == 4U);
+
+  // Tasks sharing the same deadline are ordered by id
+  REQUIRE(task_schedule.nextTask() == 2U);
+
+  // Rescheduling an existing task must not create a new entry
+  task_schedule.schedule(2U, kBaseTime + std::chrono::milliseconds(400));
+  REQUIRE(task_schedule.size() == 4U);
+  REQUIRE(task_schedule.nextTask() == 4U);
+
+  REQUIRE(task_schedule.remove(4U));
+  REQUIRE(!task_schedule.remove(4U));
+  REQUIRE(task_schedule.nextTask() == 3U);
+
+  REQUIRE(task_schedule.remove(3U));
+  REQUIRE(task_schedule.nextTask() == 1U);
+  REQUIRE(task_schedule.nextDeadline() ==
+          kBaseTime + std::chrono::milliseconds(300));
+
+  REQUIRE(task_schedule.remove(1U));
+  REQUIRE(task_schedule.nextTask() == 2U);
+
+  REQUIRE(task_schedule.remove(2U));
+  REQUIRE(task_schedule.empty());
+}
+
+SCENARIO("Query scheduling", "[QueryScheduler]") {
+  GIVEN("a query scheduler driven by a virtual clock") {
+    MockVirtualDatabase virtual_database;
+    MockLogger logger;
+    VirtualClock virtual_clock;
+
+    QueryScheduler::Ref query_scheduler;
+    auto status = QueryScheduler::create(query_scheduler, virtual_database,
+                                         logger, virtual_clock.clock());
+
+    REQUIRE(status.succeeded());
+
+    WHEN("a query is scheduled with a sub-second interval") {
+      query_scheduler->processTaskQueue(
+          {generateScheduledTask("SELECT 1", std::chrono::milliseconds(250))});
+
+      REQUIRE(query_scheduler->processEvents().succeeded());
+      REQUIRE(query_scheduler->scheduledTaskCount() == 1U);
+
+      THEN("it is executed once for each elapsed interval") {
+        REQUIRE(query_scheduler->timeUntilNextTask(
+                    std::chrono::milliseconds(1000)) ==
+                std::chrono::milliseconds(250));
+
+        for (auto i = 0U; i < 4U; ++i) {
+          virtual_clock.current_time += std::chrono::milliseconds(250);
+          REQUIRE(query_scheduler->processEvents().succeeded());
+        }
+
+        REQUIRE(virtual_database.query_count == 4U);
+        REQUIRE(query_scheduler->getTaskOutputList().size() == 4U);
+      }
+
+      THEN("missed executions are not replayed") {
+        virtual_clock.current_time += std::chrono::seconds(10);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+
+        REQUIRE(virtual_database.query_count == 1U);
+        REQUIRE(query_scheduler->timeUntilNextTask(
+                    std::chrono::milliseconds(1000)) ==
+                std::chrono::milliseconds(250));
+      }
+
+      THEN("duplicated queries are rejected") {
+        query_scheduler->processTaskQueue({generateScheduledTask(
+            "SELECT 1", std::chrono::milliseconds(250))});
+
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(query_scheduler->scheduledTaskCount() == 1U);
+      }
+
+      THEN("the query can be removed") {
+        auto task =
+            generateScheduledTask("SELECT 1", std::chrono::milliseconds(250));
+
+        task.type = QueryScheduler::Task::Type::RemoveScheduledQuery;
+        query_scheduler->processTaskQueue({task});
+
+        virtual_clock.current_time += std::chrono::seconds(1);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+
+        REQUIRE(query_scheduler->scheduledTaskCount() == 0U);
+        REQUIRE(virtual_database.query_count == 0U);
+      }
+    }
+
+    WHEN("the same query is scheduled by more than one subscriber") {
+      auto first_task =
+          generateScheduledTask("SELECT 1", std::chrono::milliseconds(250));
+
+      auto second_task = first_task;
+      second_task.response_topic = "other_response_topic";
+      second_task.cookie = "other_cookie";
+
+      auto third_task = first_task;
+      third_task.cookie = "third_cookie";
+      third_task.interval = std::chrono::milliseconds(500);
+
+      query_scheduler->processTaskQueue({first_task, second_task, third_task});
+      REQUIRE(query_scheduler->processEvents().succeeded());
+
+      THEN("identical query and interval pairs are executed only once") {
+        REQUIRE(query_scheduler->scheduledTaskCount() == 2U);
+
+        virtual_clock.current_time += std::chrono::milliseconds(250);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(virtual_database.query_count == 1U);
+
+        auto task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 2U);
+
+        REQUIRE(task_output_list.at(0).response_topic == "response_topic");
+        REQUIRE(task_output_list.at(1).response_topic ==
+                "other_response_topic");
+
+        REQUIRE(task_output_list.at(0).query_output.size() == 1U);
+        REQUIRE(task_output_list.at(1).query_output.size() == 1U);
+
+        virtual_clock.current_time += std::chrono::milliseconds(250);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(virtual_database.query_count == 3U);
+        REQUIRE(query_scheduler->getTaskOutputList().size() == 3U);
+      }
+
+      THEN("removing a subscriber does not affect the others") {
+        first_task.type = QueryScheduler::Task::Type::RemoveScheduledQuery;
+        query_scheduler->processTaskQueue({first_task});
+
+        virtual_clock.current_time += std::chrono::milliseconds(250);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(query_scheduler->scheduledTaskCount() == 2U);
+
+        auto task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 1U);
+        REQUIRE(task_output_list.at(0).cookie == "other_cookie");
+
+        second_task.type = QueryScheduler::Task::Type::RemoveScheduledQuery;
+        query_scheduler->processTaskQueue({second_task});
+
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(query_scheduler->scheduledTaskCount() == 1U);
+      }
+    }
+
+    WHEN("triggered filter queries over the same event table are "
+         "scheduled") {
+      virtual_database.event_table_map["process_events"] = {};
+
+      // Only the periodic schedule runs the queries in this test
+      const QueryScheduler::Task::Trigger kTrigger{std::chrono::seconds(60),
+                                                   1000U};
+
+      auto first_task = generateScheduledTask(
+          "SELECT * FROM process_events WHERE pid < 2",
+          std::chrono::milliseconds(250));
+
+      first_task.trigger = kTrigger;
+
+      auto second_task = generateScheduledTask(
+          "SELECT pid FROM process_events WHERE pid > 0",
+          std::chrono::milliseconds(500));
+
+      second_task.trigger = kTrigger;
+
+      query_scheduler->processTaskQueue({first_task, second_task});
+      REQUIRE(query_scheduler->processEvents().succeeded());
+
+      THEN("the table is scanned once and each query gets all its rows") {
+        for (std::int64_t pid = 0; pid < 3; ++pid) {
+          addProcessEvent(virtual_database, pid);
+        }
+
+        virtual_clock.current_time += std::chrono::milliseconds(250);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(virtual_database.query_count == 1U);
+
+        auto task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 1U);
+        REQUIRE(task_output_list.at(0).query_output.size() == 2U);
+
+        addProcessEvent(virtual_database, 3);
+
+        virtual_clock.current_time += std::chrono::milliseconds(250);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(virtual_database.query_count == 2U);
+
+        // The second query also receives the rows read by the first scan
+        task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 2U);
+        REQUIRE(task_output_list.at(0).query_output.empty());
+        REQUIRE(task_output_list.at(1).query_output.size() == 3U);
+      }
+    }
+
+    WHEN("a filter query over an event table is not triggered") {
+      virtual_database.event_table_map["process_events"] = {};
+
+      auto task = generateScheduledTask(
+          "SELECT * FROM process_events WHERE pid < 2",
+          std::chrono::milliseconds(250));
+
+      query_scheduler->processTaskQueue({task});
+      REQUIRE(query_scheduler->processEvents().succeeded());
+
+      THEN("it is executed by the database instead of a shared scan") {
+        virtual_clock.current_time += std::chrono::milliseconds(250);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(virtual_database.query_count == 1U);
+
+        auto task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 1U);
+
+        const auto &query_output = task_output_list.at(0).query_output;
+        REQUIRE(query_output.size() == virtual_database.output_row_count);
+
+        const auto &column = query_output.at(0).at(0);
+        REQUIRE(column.name == "query");
+        REQUIRE(column.data == IVirtualTable::OptionalVariant{task.query});
+      }
+    }
+
+    WHEN("a query is triggered by its source table") {
+      virtual_database.event_table_map["process_events"] = {};
+
+      auto task = generateScheduledTask(
+          "SELECT * FROM process_events", std::chrono::milliseconds(0));
+
+      task.interval = std::nullopt;
+      task.trigger = QueryScheduler::Task::Trigger{
+          std::chrono::milliseconds(100), 3U};
+
+      query_scheduler->processTaskQueue({task});
+      REQUIRE(query_scheduler->processEvents().succeeded());
+      REQUIRE(query_scheduler->scheduledTaskCount() == 1U);
+
+      THEN("it does not run when the table is not updated") {
+        virtual_clock.current_time += std::chrono::seconds(10);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+
+        REQUIRE(virtual_database.query_count == 0U);
+        REQUIRE(query_scheduler->timeUntilNextTask(
+                    std::chrono::milliseconds(1000)) ==
+                std::chrono::milliseconds(1000));
+      }
+
+      THEN("it runs after min_delay, or as soon as the batch is full") {
+        addProcessEvent(virtual_database, 1);
+        query_scheduler->notifyTableUpdate("process_events", 1U);
+
+        REQUIRE(query_scheduler->processEvents().succeeded());
+        REQUIRE(virtual_database.query_count == 0U);
+        REQUIRE(query_scheduler->timeUntilNextTask(
+                    std::chrono::milliseconds(1000)) ==
+                std::chrono::milliseconds(100));
+
+        virtual_clock.current_time += std::chrono::milliseconds(100);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+
+        auto task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 1U);
+        REQUIRE(task_output_list.at(0).query_output.size() == 1U);
+
+        for (std::int64_t pid = 2; pid < 5; ++pid) {
+          addProcessEvent(virtual_database, pid);
+        }
+
+        query_scheduler->notifyTableUpdate("process_events", 3U);
+        REQUIRE(query_scheduler->processEvents().succeeded());
+
+        task_output_list = query_scheduler->getTaskOutputList();
+        REQUIRE(task_output_list.size() == 1U);
+        REQUIRE(task_output_list.at(0).query_output.size() == 3U);
+      }
+    }
+
+    WHEN("a complex query is triggered") {
+      auto task = generateScheduledTask(
+          "SELECT count(*) FROM process_events", std::chrono::seconds(1));
+
+      task.trigger = QueryScheduler::Task::Trigger{};
+
+      query_scheduler->processTaskQueue({task});
+      REQUIRE(query_scheduler->processEvents().succeeded());
+
+      THEN("it is discarded") {
+        REQUIRE(query_scheduler->scheduledTaskCount() == 0U);
+      }
+    }
+
+    WHEN("a query is scheduled with an invalid interval") {
+      query_scheduler->processTaskQueue(
+          {generateScheduledTask("SELECT 1", std::chrono::milliseconds(0))});
+
+      REQUIRE(query_scheduler->processEvents().succeeded());
+
+      THEN("it is discarded") {
+        REQUIRE(query_scheduler->scheduledTaskCount() == 0U);
+      }
+    }
+  }
+}
+
+TEST_CASE("Schedule placement", "[SchedulePlanner]") {
+  const std::size_t kQueryCount{200U};
+  const std::chrono::seconds kInterval{60};
+
+  SchedulePlanner::TimePoint epoch;
+  auto current_time = epoch + std::chrono::milliseconds(12345);
+
+  SchedulePlanner schedule_planner("host_identifier", epoch);
+  SchedulePlanner other_schedule_planner("host_identifier", epoch);
+  SchedulePlanner other_host_schedule_planner("other_host_identifier", epoch);
+
+  std::vector<SchedulePlanner::Placement> placement_list;
+  std::size_t other_host_difference_count{0U};
+
+  for (std::size_t i = 0U; i < kQueryCount; ++i) {
+    auto query = "SELECT " + std::to_string(i);
+
+    auto placement = schedule_planner.place(query, kInterval, current_time);
+    REQUIRE(placement.slot.has_value());
+
+    auto deadline = SchedulePlanner::nextDeadline(placement, current_time);
+    REQUIRE(deadline > current_time);
+    REQUIRE(deadline <= current_time + kInterval);
+
+    // The placement only depends on the host, the query and the placement
+    // order
+    auto other_placement =
+        other_schedule_planner.place(query, kInterval, current_time);
+
+    REQUIRE(other_placement.slot == placement.slot);
+    REQUIRE(other_placement.phase_origin == placement.phase_origin);
+
+    auto other_host_placement =
+        other_host_schedule_planner.place(query, kInterval, current_time);
+
+    if (other_host_placement.phase_origin != placement.phase_origin) {
+      ++other_host_difference_count;
+    }
+
+    placement_list.push_back(std::move(placement));
+  }
+
+  REQUIRE(other_host_difference_count > kQueryCount / 2U);
+
+  auto slot_load = schedule_planner.slotLoad(kInterval);
+  REQUIRE(slot_load.size() == 60U);
+
+  auto minmax_load = std::minmax_element(slot_load.begin(), slot_load.end());
+  REQUIRE(*minmax_load.second - *minmax_load.first <= 1U);
+
+  for (const auto &placement : placement_list) {
+    schedule_planner.release(placement);
+  }
+
+  REQUIRE(schedule_planner.slotLoad(kInterval).empty());
+
+  // Sub-second intervals are not staggered
+  auto placement = schedule_planner.place(
+      "SELECT 1", std::chrono::milliseconds(250), current_time);
+
+  REQUIRE(!placement.slot.has_value());
+  REQUIRE(SchedulePlanner::nextDeadline(placement, current_time) ==
+          current_time + std::chrono::milliseconds(250));
+}
+
+TEST_CASE("Staggered query execution", "[QueryScheduler]") {
+  const std::size_t kQueryCount{200U};
+  const std::chrono::seconds kInterval{60};
+
+  MockVirtualDatabase virtual_database;
+  MockLogger logger;
+  VirtualClock virtual_clock;
+
+  QueryScheduler::Configuration configuration;
+  configuration.host_identifier = "host_identifier";
+
+  QueryScheduler::Ref query_scheduler;
+  auto status =
+      QueryScheduler::create(query_scheduler, virtual_database, logger,
+                             virtual_clock.clock(), configuration);
+
+  REQUIRE(status.succeeded());
+
+  // All the queries are received at the same time
+  QueryScheduler::TaskQueue task_queue;
+  for (std::size_t i = 0U; i < kQueryCount; ++i) {
+    task_queue.push_back(
+        generateScheduledTask("SELECT " + std::to_string(i), kInterval));
+  }
+
+  query_scheduler->processTaskQueue(std::move(task_queue));
+  REQUIRE(query_scheduler->processEvents().succeeded());
+
+  std::size_t max_executions_per_second{0U};
+
+  for (std::size_t second = 0U; second < 120U; ++second) {
+    virtual_clock.current_time += std::chrono::seconds(1);
+
+    auto previous_query_count = virtual_database.query_count.load();
+    REQUIRE(query_scheduler->processEvents().succeeded());
+
+    max_executions_per_second =
+        std::max(max_executions_per_second,
+                 virtual_database.query_count - previous_query_count);
+  }
+
+  REQUIRE(virtual_database.query_count == kQueryCount * 2U);
+  REQUIRE(max_executions_per_second <= (kQueryCount / 60U) + 1U);
+
+  auto load_histogram = query_scheduler->loadHistogram();
+  REQUIRE(load_histogram.size() == 60U);
+  REQUIRE(std::accumulate(load_histogram.begin(), load_histogram.end(),
+                          std::size_t{0U}) == kQueryCount);
+
+  REQUIRE(*std::max_element(load_histogram.begin(), load_histogram.end()) ==
+          max_executions_per_second);
+}
+
+TEST_CASE("Chunked query output", "[QueryScheduler]") {
+  const std::size_t kOutputRowCount{1000U};
+  const std::size_t kChunkSize{10U};
+
+  MockVirtualDatabase virtual_database;
+  virtual_database.output_row_count = kOutputRowCount;
+
+  MockLogger logger;
+
+  QueryScheduler::Configuration configuration;
+  configuration.output_chunk_size = kChunkSize;
+
+  QueryScheduler::Ref query_scheduler;
+  auto status = QueryScheduler::create(query_scheduler, virtual_database,
+                                       logger, {}, configuration);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(query_scheduler->start().succeeded());
+
+  QueryScheduler::Task task;
+  task.type = QueryScheduler::Task::Type::ExecuteQuery;
+  task.query = "SELECT 1";
+  task.cookie = "one-shot";
+
+  query_scheduler->processTaskQueue({task});
+
+  // The query is paused while the output is not being consumed, so the
+  // pending output never grows past a few chunks
+  std::size_t received_row_count{0U};
+  std::size_t max_pending_row_count{0U};
+  std::size_t expected_chunk_index{0U};
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  for (bool last_chunk_received{false}; !last_chunk_received;) {
+    REQUIRE(std::chrono::steady_clock::now() - start_time <
+            std::chrono::seconds(5));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::size_t pending_row_count{0U};
+
+    for (const auto &task_output : query_scheduler->getTaskOutputList()) {
+      REQUIRE(!last_chunk_received);
+      REQUIRE(task_output.chunk_index == expected_chunk_index);
+      REQUIRE(task_output.query_output.size() <= kChunkSize);
+
+      pending_row_count += task_output.query_output.size();
+
+      last_chunk_received = task_output.last_chunk;
+      ++expected_chunk_index;
+    }
+
+    received_row_count += pending_row_count;
+    max_pending_row_count = std::max(max_pending_row_count, pending_row_count);
+  }
+
+  query_scheduler->stop();
+
+  REQUIRE(received_row_count == kOutputRowCount);
+  REQUIRE(max_pending_row_count <= kChunkSize * 8U);
+}
+
+TEST_CASE("Failing chunked query output", "[QueryScheduler]") {
+  const std::size_t kChunkSize{10U};
+
+  MockVirtualDatabase virtual_database;
+  virtual_database.output_row_count = kChunkSize * 3U;
+
+  MockLogger logger;
+  VirtualClock virtual_clock;
+
+  QueryScheduler::Configuration configuration;
+  configuration.output_chunk_size = kChunkSize;
+
+  QueryScheduler::Ref query_scheduler;
+  auto status =
+      QueryScheduler::create(query_scheduler, virtual_database, logger,
+                             virtual_clock.clock(), configuration);
+
+  REQUIRE(status.succeeded());
+
+  query_scheduler->processTaskQueue({generateScheduledTask(
+      "SELECT failing", std::chrono::milliseconds(100))});
+
+  REQUIRE(query_scheduler->processEvents().succeeded());
+
+  virtual_clock.current_time += std::chrono::milliseconds(100);
+  REQUIRE(query_scheduler->processEvents().succeeded());
+  REQUIRE(virtual_database.query_count == 1U);
+
+  // The chunks published before the failure are followed by an empty last
+  // chunk, marking the execution as aborted
+  auto task_output_list = query_scheduler->getTaskOutputList();
+  REQUIRE(task_output_list.size() == 2U);
+
+  REQUIRE(task_output_list.at(0).chunk_index == 0U);
+  REQUIRE(!task_output_list.at(0).last_chunk);
+  REQUIRE(!task_output_list.at(0).aborted);
+  REQUIRE(task_output_list.at(0).query_output.size() == kChunkSize);
+
+  REQUIRE(task_output_list.at(1).chunk_index == 1U);
+  REQUIRE(task_output_list.at(1).last_chunk);
+  REQUIRE(task_output_list.at(1).aborted);
+  REQUIRE(task_output_list.at(1).query_output.empty());
+}
+
+TEST_CASE("Task output capacity", "[QueryScheduler]") {
+  const std::size_t kChunkSize{10U};
+  const std::size_t kOutputRowCount{4U};
+
+  MockVirtualDatabase virtual_database;
+  virtual_database.output_row_count = kOutputRowCount;
+
+  MockLogger logger;
+
+  QueryScheduler::Configuration configuration;
+  configuration.output_chunk_size = kChunkSize;
+
+  QueryScheduler::Ref query_scheduler;
+  auto status = QueryScheduler::create(query_scheduler, virtual_database,
+                                       logger, {}, configuration);
+
+  REQUIRE(status.succeeded());
+
+  QueryScheduler::TaskQueue task_queue;
+  for (std::size_t i = 0U; i < 100U; ++i) {
+    task_queue.push_back(generateScheduledTask(
+        "SELECT " + std::to_string(i), std::chrono::milliseconds(10)));
+  }
+
+  query_scheduler->processTaskQueue(std::move(task_queue));
+  REQUIRE(query_scheduler->start().succeeded());
+
+  // Outputs that fit in a single chunk also wait for the list to be
+  // drained, instead of growing it forever
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  auto executed_query_count = virtual_database.query_count.load();
+
+  std::size_t pending_row_count{0U};
+  for (const auto &task_output : query_scheduler->getTaskOutputList()) {
+    pending_row_count += task_output.query_output.size();
+  }
+
+  REQUIRE(pending_row_count <= kChunkSize * 8U + kOutputRowCount);
+  REQUIRE(executed_query_count <= pending_row_count / kOutputRowCount + 1U);
+
+  // Stopping interrupts the wait
+  query_scheduler->stop();
+}
+
+TEST_CASE("Restarting the query scheduler", "[QueryScheduler]") {
+  MockVirtualDatabase virtual_database;
+  MockLogger logger;
+
+  QueryScheduler::Ref query_scheduler;
+  auto status =
+      QueryScheduler::create(query_scheduler, virtual_database, logger);
+
+  REQUIRE(status.succeeded());
+
+  query_scheduler->processTaskQueue({generateScheduledTask(
+      "SELECT 1", std::chrono::milliseconds(10))});
+
+  auto waitForQueries = [&virtual_database](std::size_t query_count) {
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (virtual_database.query_count < query_count) {
+      REQUIRE(std::chrono::steady_clock::now() - start_time <
+              std::chrono::seconds(5));
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
+  // The scheduled queries are kept while the scheduler is stopped, as it
+  // happens while the connection is down
+  for (std::size_t i = 0U; i < 3U; ++i) {
+    REQUIRE(query_scheduler->start().succeeded());
+    REQUIRE(!query_scheduler->start().succeeded());
+
+    waitForQueries(virtual_database.query_count + 2U);
+
+    query_scheduler->stop();
+  }
+
+  REQUIRE(!query_scheduler->getTaskOutputList().empty());
+}
+
+TEST_CASE("Query scheduler with 10k tasks", "[.benchmark][QueryScheduler]") {
+  const std::size_t kTaskCount{10000U};
+  const std::chrono::milliseconds kTickInterval{10};
+  const std::chrono::seconds kSimulatedTime{60};
+
+  MockVirtualDatabase virtual_database;
+  MockLogger logger;
+  VirtualClock virtual_clock;
+
+  QueryScheduler::Ref query_scheduler;
+  auto status = QueryScheduler::create(query_scheduler, virtual_database,
+                                       logger, virtual_clock.clock());
+
+  REQUIRE(status.succeeded());
+
+  // Intervals between 100ms and 10s
+  QueryScheduler::TaskQueue task_queue;
+  for (std::size_t i = 0U; i < kTaskCount; ++i) {
+    auto interval = std::chrono::milliseconds(100 + ((i * 7919U) % 9901U));
+    task_queue.push_back(
+        generateScheduledTask("SELECT " + std::to_string(i), interval));
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  query_scheduler->processTaskQueue(std::move(task_queue));
+  REQUIRE(query_scheduler->processEvents().succeeded());
+  REQUIRE(query_scheduler->scheduledTaskCount() == kTaskCount);
+
+  std::size_t tick_count{0U};
+  std::size_t output_count{0U};
+
+  for (auto elapsed_time = std::chrono::milliseconds(0);
+       elapsed_time < kSimulatedTime; elapsed_time += kTickInterval) {
+
+    virtual_clock.current_time += kTickInterval;
+    REQUIRE(query_scheduler->processEvents().succeeded());
+
+    output_count += query_scheduler->getTaskOutputList().size();
+    ++tick_count;
+  }
+
+  auto wall_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time);
+
+  REQUIRE(output_count == virtual_database.query_count);
+
+  WARN("Ticks: " << tick_count << ", executions: " << output_count
+                 << ", wall time: " << wall_time.count() << "us ("
+                 << (wall_time.count() / static_cast<long long>(tick_count))
+                 << "us per tick)");
+}
+} // namespace zeek
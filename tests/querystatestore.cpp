@@ -0,0 +1,209 @@
+#include "querystatestore.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+QueryScheduler::Task generateScheduledTask(const std::string &query,
+                                           const std::string &cookie) {
+  QueryScheduler::Task task;
+  task.type = QueryScheduler::Task::Type::AddScheduledQuery;
+  task.query = query;
+  task.response_event = "response_event";
+  task.response_topic = "response_topic";
+  task.cookie = cookie;
+  task.interval = std::chrono::seconds(10);
+  task.update_type = QueryScheduler::Task::UpdateType::Both;
+
+  return task;
+}
+
+std::string queryID(const QueryScheduler::Task &task) {
+  return ZeekConnection::computeQueryID(task.response_topic,
+                                        task.response_event, task.cookie);
+}
+
+IVirtualDatabase::OutputRow generateRow(std::int64_t integer_value) {
+  // clang-format off
+  return {
+    { "integer", integer_value },
+    { "string", std::string("value") },
+    { "double", 1.5 },
+    { "null", std::nullopt }
+  };
+  // clang-format on
+}
+
+bool isSameRow(const IVirtualDatabase::OutputRow &left,
+               const IVirtualDatabase::OutputRow &right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0U; i < left.size(); ++i) {
+    if (left.at(i).name != right.at(i).name ||
+        left.at(i).data != right.at(i).data) {
+      return false;
+    }
+  }
+
+  return true;
+}
+} // namespace
+
+TEST_CASE("Query state across reconnects", "[QueryStateStore]") {
+  QueryStateStore::Ref query_state_store;
+  auto status = QueryStateStore::create(query_state_store);
+  REQUIRE(status.succeeded());
+
+  auto task1 = generateScheduledTask("SELECT 1", "cookie1");
+  auto task2 = generateScheduledTask("SELECT 2", "cookie2");
+
+  auto task_queue = query_state_store->processTaskQueue({task1, task2});
+  REQUIRE(task_queue.size() == 2U);
+  REQUIRE(query_state_store->scheduledTaskCount() == 2U);
+
+  auto &differential_context = query_state_store->differentialContext();
+  differential_context[queryID(task1)].row_hash_set.insert(1U);
+  differential_context[queryID(task2)].row_hash_set.insert(2U);
+
+  auto current_time = std::chrono::steady_clock::now();
+  query_state_store->requireConfirmation(current_time +
+                                         std::chrono::seconds(10));
+
+  // After a reconnect, Zeek sends the same query again and a modified
+  // version of the second one
+  auto modified_task2 = task2;
+  modified_task2.query = "SELECT 3";
+
+  task_queue = query_state_store->processTaskQueue({task1, modified_task2});
+
+  REQUIRE(task_queue.size() == 2U);
+  REQUIRE(task_queue.at(0U).type ==
+          QueryScheduler::Task::Type::RemoveScheduledQuery);
+  REQUIRE(task_queue.at(0U).query == "SELECT 2");
+  REQUIRE(task_queue.at(1U).type ==
+          QueryScheduler::Task::Type::AddScheduledQuery);
+  REQUIRE(task_queue.at(1U).query == "SELECT 3");
+
+  REQUIRE(differential_context.count(queryID(task1)) == 1U);
+  REQUIRE(differential_context.count(queryID(task2)) == 0U);
+
+  // Everything has been confirmed; nothing expires
+  current_time += std::chrono::seconds(20);
+  REQUIRE(query_state_store->expireUnconfirmedTasks(current_time).empty());
+
+  // Queries that are not sent again are removed after the deadline
+  query_state_store->requireConfirmation(current_time +
+                                         std::chrono::seconds(10));
+
+  task_queue = query_state_store->processTaskQueue({task1});
+  REQUIRE(task_queue.empty());
+
+  REQUIRE(query_state_store->expireUnconfirmedTasks(current_time).empty());
+
+  current_time += std::chrono::seconds(10);
+  task_queue = query_state_store->expireUnconfirmedTasks(current_time);
+
+  REQUIRE(task_queue.size() == 1U);
+  REQUIRE(task_queue.at(0U).type ==
+          QueryScheduler::Task::Type::RemoveScheduledQuery);
+  REQUIRE(task_queue.at(0U).query == "SELECT 3");
+  REQUIRE(query_state_store->scheduledTaskCount() == 1U);
+
+  // Removing a query also drops its differential context
+  auto remove_task = task1;
+  remove_task.type = QueryScheduler::Task::Type::RemoveScheduledQuery;
+
+  task_queue = query_state_store->processTaskQueue({remove_task});
+  REQUIRE(task_queue.size() == 1U);
+  REQUIRE(query_state_store->scheduledTaskCount() == 0U);
+  REQUIRE(differential_context.empty());
+}
+
+TEST_CASE("Query state snapshots", "[QueryStateStore]") {
+  const std::string kSnapshotPath{"zeek_agent_query_state_test.bin"};
+  std::remove(kSnapshotPath.c_str());
+
+  QueryStateStore::Ref query_state_store;
+  auto status = QueryStateStore::create(query_state_store);
+  REQUIRE(status.succeeded());
+
+  // A missing snapshot is not an error
+  status = query_state_store->loadSnapshot(kSnapshotPath);
+  REQUIRE(status.succeeded());
+  REQUIRE(query_state_store->scheduledTaskCount() == 0U);
+
+  auto task1 = generateScheduledTask("SELECT 1", "cookie1");
+
+  auto task2 = generateScheduledTask("SELECT 2", "cookie2");
+  task2.interval = std::nullopt;
+  task2.trigger =
+      QueryScheduler::Task::Trigger{std::chrono::milliseconds(100), 50U};
+
+  query_state_store->processTaskQueue({task1, task2});
+
+  auto &differential_context = query_state_store->differentialContext();
+
+  auto &differential_data1 = differential_context[queryID(task1)];
+  differential_data1.row_hash_set.insert(1U);
+  differential_data1.row_hash_set.insert(2U);
+  differential_data1.row_map.insert({1U, generateRow(1)});
+  differential_data1.row_map.insert({2U, generateRow(-2)});
+
+  // Queries that do not report removed rows only keep the row hashes
+  auto &differential_data2 = differential_context[queryID(task2)];
+  differential_data2.row_hash_set.insert(0U);
+  differential_data2.row_hash_set.insert(3U);
+
+  // Only the context of the scheduled queries is saved
+  differential_context["unknown_query"].row_hash_set.insert(4U);
+
+  status = query_state_store->saveSnapshot(kSnapshotPath);
+  REQUIRE(status.succeeded());
+
+  QueryStateStore::Ref restored_state_store;
+  status = QueryStateStore::create(restored_state_store);
+  REQUIRE(status.succeeded());
+
+  status = restored_state_store->loadSnapshot(kSnapshotPath);
+  REQUIRE(status.succeeded());
+
+  // The restored queries are confirmed when Zeek sends them again
+  REQUIRE(restored_state_store->scheduledTaskCount() == 2U);
+  REQUIRE(restored_state_store->processTaskQueue({task1, task2}).empty());
+
+  const auto &restored_context = restored_state_store->differentialContext();
+  REQUIRE(restored_context.size() == 2U);
+
+  const auto &restored_data1 = restored_context.at(queryID(task1));
+  REQUIRE(restored_data1.row_hash_set.size() == 2U);
+  REQUIRE(restored_data1.row_map.size() == 2U);
+  REQUIRE(isSameRow(restored_data1.row_map.at(1U), generateRow(1)));
+  REQUIRE(isSameRow(restored_data1.row_map.at(2U), generateRow(-2)));
+
+  const auto &restored_data2 = restored_context.at(queryID(task2));
+  REQUIRE(restored_data2.row_hash_set.size() == 2U);
+  REQUIRE(restored_data2.row_hash_set.contains(0U));
+  REQUIRE(restored_data2.row_hash_set.contains(3U));
+  REQUIRE(restored_data2.row_map.empty());
+
+  // A corrupted snapshot is rejected, and the current state is kept
+  {
+    std::ofstream stream(kSnapshotPath,
+                         std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(-1, std::ios::end);
+    stream.put('\xFF');
+    stream.put('\xFF');
+  }
+
+  status = restored_state_store->loadSnapshot(kSnapshotPath);
+  REQUIRE(!status.succeeded());
+  REQUIRE(restored_state_store->scheduledTaskCount() == 2U);
+
+  std::remove(kSnapshotPath.c_str());
+}
+} // namespace zeek
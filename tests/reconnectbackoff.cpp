@@ -0,0 +1,44 @@
+#include "reconnectbackoff.h"
+
+#include <set>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+TEST_CASE("Reconnect backoff", "[ReconnectBackoff]") {
+  const std::chrono::milliseconds kInitialDelay{100};
+  const std::chrono::milliseconds kMaxDelay{1000};
+
+  ReconnectBackoff reconnect_backoff(kInitialDelay, kMaxDelay, 1U);
+  REQUIRE(reconnect_backoff.ceiling() == kInitialDelay);
+
+  // The ceiling doubles after every attempt, up to the maximum delay
+  const std::vector<std::chrono::milliseconds> kExpectedCeilingList = {
+      std::chrono::milliseconds(100), std::chrono::milliseconds(200),
+      std::chrono::milliseconds(400), std::chrono::milliseconds(800),
+      std::chrono::milliseconds(1000), std::chrono::milliseconds(1000)};
+
+  for (const auto &expected_ceiling : kExpectedCeilingList) {
+    REQUIRE(reconnect_backoff.ceiling() == expected_ceiling);
+
+    auto delay = reconnect_backoff.nextDelay();
+    REQUIRE(delay.count() >= 0);
+    REQUIRE(delay <= expected_ceiling);
+  }
+
+  reconnect_backoff.reset();
+  REQUIRE(reconnect_backoff.ceiling() == kInitialDelay);
+
+  // Agents using different seeds spread their attempts over the whole
+  // range instead of retrying in lockstep
+  std::set<std::chrono::milliseconds::rep> delay_set;
+
+  for (std::uint64_t seed = 0U; seed < 100U; ++seed) {
+    ReconnectBackoff agent_backoff(kInitialDelay, kMaxDelay, seed);
+    delay_set.insert(agent_backoff.nextDelay().count());
+  }
+
+  REQUIRE(delay_set.size() > 50U);
+}
+} // namespace zeek
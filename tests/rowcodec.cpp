@@ -0,0 +1,116 @@
+#include "rowcodec.h"
+
+#include <limits>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+const std::vector<IVirtualTable::OptionalVariant> kColumnValueList = {
+    std::nullopt,
+    std::int64_t{0},
+    std::int64_t{-1},
+    std::numeric_limits<std::int64_t>::min(),
+    std::numeric_limits<std::int64_t>::max(),
+    std::string(),
+    std::string(200U, 'A'),
+    -1.5,
+    std::numeric_limits<double>::max()};
+
+std::string encodeValueList() {
+  std::string buffer;
+
+  RowEncoder encoder(buffer);
+  encoder.writeU8(0xFFU);
+  encoder.writeU32(0xAABBCCDDU);
+  encoder.writeU64(std::numeric_limits<std::uint64_t>::max());
+  encoder.writeVarint(300U);
+  encoder.writeSignedVarint(-300);
+  encoder.writeDouble(0.25);
+  encoder.writeString("string");
+
+  for (const auto &column_value : kColumnValueList) {
+    encoder.writeColumnValue(column_value);
+  }
+
+  return buffer;
+}
+
+bool decodeValueList(const std::string &buffer) {
+  RowDecoder decoder(buffer);
+
+  std::uint8_t u8_value{0U};
+  std::uint32_t u32_value{0U};
+  std::uint64_t u64_value{0U};
+  std::uint64_t varint_value{0U};
+  std::int64_t signed_varint_value{0};
+  double double_value{0.0};
+  std::string string_value;
+
+  if (!decoder.readU8(u8_value) || u8_value != 0xFFU ||
+      !decoder.readU32(u32_value) || u32_value != 0xAABBCCDDU ||
+      !decoder.readU64(u64_value) ||
+      u64_value != std::numeric_limits<std::uint64_t>::max() ||
+      !decoder.readVarint(varint_value) || varint_value != 300U ||
+      !decoder.readSignedVarint(signed_varint_value) ||
+      signed_varint_value != -300 || !decoder.readDouble(double_value) ||
+      double_value != 0.25 || !decoder.readString(string_value) ||
+      string_value != "string") {
+    return false;
+  }
+
+  for (const auto &expected_column_value : kColumnValueList) {
+    IVirtualTable::OptionalVariant column_value;
+    if (!decoder.readColumnValue(column_value) ||
+        column_value != expected_column_value) {
+      return false;
+    }
+  }
+
+  return decoder.empty();
+}
+} // namespace
+
+TEST_CASE("Row codec", "[RowCodec]") {
+  auto buffer = encodeValueList();
+  REQUIRE(decodeValueList(buffer));
+
+  // Small integers only take one byte
+  std::string varint_buffer;
+  RowEncoder varint_encoder(varint_buffer);
+  varint_encoder.writeSignedVarint(-1);
+  varint_encoder.writeVarint(127U);
+  REQUIRE(varint_buffer.size() == 2U);
+
+  // Every truncated buffer is rejected instead of being read past its end
+  while (!buffer.empty()) {
+    buffer.pop_back();
+    REQUIRE(!decodeValueList(buffer));
+  }
+
+  // Unknown value types, and variable size integers that never end
+  IVirtualTable::OptionalVariant column_value;
+
+  std::string invalid_type_buffer(1U, '\x04');
+  RowDecoder invalid_type_decoder(invalid_type_buffer);
+  REQUIRE(!invalid_type_decoder.readColumnValue(column_value));
+
+  std::string invalid_varint_buffer(16U, '\xFF');
+  RowDecoder invalid_varint_decoder(invalid_varint_buffer);
+
+  std::uint64_t varint_value{0U};
+  REQUIRE(!invalid_varint_decoder.readVarint(varint_value));
+
+  // A string length larger than the rest of the buffer
+  std::string invalid_string_buffer;
+  RowEncoder invalid_string_encoder(invalid_string_buffer);
+  invalid_string_encoder.writeVarint(100U);
+  invalid_string_buffer.append("short");
+
+  RowDecoder invalid_string_decoder(invalid_string_buffer);
+
+  std::string string_value;
+  REQUIRE(!invalid_string_decoder.readString(string_value));
+}
+} // namespace zeek
@@ -0,0 +1,47 @@
+#include "rowhashset.h"
+
+#include <algorithm>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+TEST_CASE("Row hash set", "[RowHashSet]") {
+  const std::size_t kHashCount{10000U};
+
+  RowHashSet row_hash_set;
+  REQUIRE(row_hash_set.empty());
+  REQUIRE(!row_hash_set.contains(0U));
+  REQUIRE(!row_hash_set.contains(1U));
+
+  // Use hashes that share their low bits, so that they collide
+  for (std::uint64_t i = 0U; i < kHashCount; ++i) {
+    REQUIRE(row_hash_set.insert(i << 40U));
+  }
+
+  REQUIRE(row_hash_set.size() == kHashCount);
+  REQUIRE(!row_hash_set.insert(0U));
+  REQUIRE(!row_hash_set.insert(1ULL << 40U));
+
+  for (std::uint64_t i = 0U; i < kHashCount; ++i) {
+    REQUIRE(row_hash_set.contains(i << 40U));
+    REQUIRE(!row_hash_set.contains((i << 40U) + 1U));
+  }
+
+  auto hash_list = row_hash_set.hashList();
+  REQUIRE(hash_list.size() == kHashCount);
+
+  std::sort(hash_list.begin(), hash_list.end());
+  for (std::uint64_t i = 0U; i < kHashCount; ++i) {
+    REQUIRE(hash_list.at(i) == i << 40U);
+  }
+
+  // The table is kept at most 3/4 full
+  REQUIRE(row_hash_set.memoryUsage() >=
+          kHashCount * sizeof(std::uint64_t) * 4U / 3U);
+
+  row_hash_set.clear();
+  REQUIRE(row_hash_set.empty());
+  REQUIRE(row_hash_set.memoryUsage() == 0U);
+  REQUIRE(!row_hash_set.contains(0U));
+}
+} // namespace zeek
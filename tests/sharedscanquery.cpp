@@ -0,0 +1,229 @@
+#include "sharedscanquery.h"
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+class SharedScanTestTable final : public IVirtualTable {
+public:
+  SharedScanTestTable() = default;
+  virtual ~SharedScanTestTable() override = default;
+
+  virtual const std::string &name() const override {
+    static const std::string kTableName{"shared_scan_test"};
+    return kTableName;
+  }
+
+  virtual const Schema &schema() const override {
+    // clang-format off
+    static const Schema kTableSchema = {
+      { "pid", IVirtualTable::ColumnType::Integer },
+      { "uid", IVirtualTable::ColumnType::Integer },
+      { "path", IVirtualTable::ColumnType::String },
+      { "score", IVirtualTable::ColumnType::Double }
+    };
+    // clang-format on
+
+    return kTableSchema;
+  }
+
+  virtual Status generateRowList(RowList &row_list) override {
+    static const char *kPathList[] = {
+        "/usr/bin/bash", "/tmp/payload", "/TMP/Payload2", "/usr/sbin/sshd",
+        "42",            "1.5",          "/tmp/\xC3\xA9",  "/tmp/\xC3\x89X"};
+
+    static const double kScoreList[] = {1.5,   2.0,  1e20,      0.1,
+                                        -0.25, 1e-5, 1.0 / 3.0, 100.0};
+
+    row_list = {};
+
+    for (std::int64_t i = 0; i < 20; ++i) {
+      Row row;
+      row["pid"] = i;
+      row["uid"] = i % 3 == 0 ? OptionalVariant{} : (i % 2) * 1000;
+      row["path"] = i % 7 == 0 ? OptionalVariant{} : kPathList[i % 8];
+      row["score"] = kScoreList[i % 8];
+
+      row_list.push_back(std::move(row));
+    }
+
+    return Status::success();
+  }
+};
+
+bool equals(const IVirtualDatabase::QueryOutput &left,
+            const IVirtualDatabase::QueryOutput &right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0U; i < left.size(); ++i) {
+    const auto &left_row = left.at(i);
+    const auto &right_row = right.at(i);
+
+    if (left_row.size() != right_row.size()) {
+      return false;
+    }
+
+    for (std::size_t j = 0U; j < left_row.size(); ++j) {
+      if (left_row.at(j).name != right_row.at(j).name ||
+          left_row.at(j).data != right_row.at(j).data) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+} // namespace
+
+TEST_CASE("Shared scan query compilation", "[SharedScanQuery]") {
+  const std::vector<std::string> kSupportedQueryList = {
+      "SELECT * FROM process_events",
+      "select pid, path from process_events;",
+      "SELECT * FROM process_events WHERE pid = 1 AND (path LIKE '/tmp/%' "
+      "OR path IS NULL) AND NOT uid <> -1.5",
+      "SELECT path FROM file_events WHERE path NOT LIKE '%.log'"};
+
+  for (const auto &query : kSupportedQueryList) {
+    SharedScanQuery::Ref shared_scan_query;
+    auto status = SharedScanQuery::create(shared_scan_query, query);
+
+    CAPTURE(query);
+    REQUIRE(status.succeeded());
+  }
+
+  SharedScanQuery::Ref shared_scan_query;
+  REQUIRE(SharedScanQuery::create(shared_scan_query,
+                                  "SELECT pid FROM process_events")
+              .succeeded());
+
+  REQUIRE(shared_scan_query->tableName() == "process_events");
+
+  const std::vector<std::string> kUnsupportedQueryList = {
+      "SELECT count(*) FROM process_events",
+      "SELECT * FROM process_events, socket_events",
+      "SELECT * FROM process_events ORDER BY pid",
+      "SELECT * FROM process_events WHERE pid IN (1, 2)",
+      "SELECT * FROM process_events WHERE pid = uid",
+      "SELECT * FROM process_events WHERE path = 'unterminated",
+      "SELECT * FROM process_events WHERE (pid = 1",
+      "SELECT pid AS process_id FROM process_events",
+      "SELECT * FROM process_events LIMIT 1",
+      "DELETE FROM process_events"};
+
+  for (const auto &query : kUnsupportedQueryList) {
+    auto status = SharedScanQuery::create(shared_scan_query, query);
+
+    CAPTURE(query);
+    REQUIRE(!status.succeeded());
+  }
+}
+
+TEST_CASE("Shared scan query evaluation", "[SharedScanQuery]") {
+  IVirtualDatabase::Ref virtual_database;
+  REQUIRE(IVirtualDatabase::create(virtual_database).succeeded());
+
+  REQUIRE(virtual_database
+              ->registerTable(std::make_shared<SharedScanTestTable>())
+              .succeeded());
+
+  IVirtualDatabase::QueryOutput table_scan;
+  REQUIRE(virtual_database->query(table_scan, "SELECT * FROM shared_scan_test")
+              .succeeded());
+
+  REQUIRE(table_scan.size() == 20U);
+
+  // The output must match what SQLite returns for the same query
+  const std::vector<std::string> kQueryList = {
+      "SELECT * FROM shared_scan_test",
+      "SELECT path, pid FROM shared_scan_test WHERE pid > 10",
+      "SELECT * FROM shared_scan_test WHERE pid >= 5 AND pid <= 7",
+      "SELECT * FROM shared_scan_test WHERE uid = 1000 OR pid < 2",
+      "SELECT * FROM shared_scan_test WHERE uid != 0",
+      "SELECT * FROM shared_scan_test WHERE NOT uid = 0",
+      "SELECT * FROM shared_scan_test WHERE NOT (uid = 0 OR uid IS NULL)",
+      "SELECT * FROM shared_scan_test WHERE uid IS NULL",
+      "SELECT * FROM shared_scan_test WHERE path IS NOT NULL AND uid = 0",
+      "SELECT * FROM shared_scan_test WHERE path = '/tmp/payload'",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '/tmp/%'",
+      "SELECT * FROM shared_scan_test WHERE path NOT LIKE '%s_d'",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '%PAY%'",
+      "SELECT * FROM shared_scan_test WHERE pid = '12'",
+      "SELECT * FROM shared_scan_test WHERE pid < 'text'",
+      "SELECT * FROM shared_scan_test WHERE path = 42",
+      "SELECT * FROM shared_scan_test WHERE path > 'a'",
+      "SELECT * FROM shared_scan_test WHERE pid > 2.5 AND pid < 4e0",
+      "SELECT pid FROM shared_scan_test WHERE uid > -1 OR uid IS NULL",
+      "SELECT PID, pid, Path FROM shared_scan_test WHERE score > 1",
+      "SELECT * FROM shared_scan_test WHERE pid LIKE '1_'",
+      "SELECT * FROM shared_scan_test WHERE score = 2",
+      "SELECT * FROM shared_scan_test WHERE score LIKE '%.5'",
+      "SELECT * FROM shared_scan_test WHERE score LIKE '2.0'",
+      "SELECT * FROM shared_scan_test WHERE score LIKE '1.0e+20'",
+      "SELECT * FROM shared_scan_test WHERE score LIKE '1.0e-05'",
+      "SELECT * FROM shared_scan_test WHERE score LIKE '0.333333333333333'",
+      "SELECT * FROM shared_scan_test WHERE score LIKE '100._'",
+      "SELECT * FROM shared_scan_test WHERE path = 1.50",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '/tmp/_'",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '/tmp/__'",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '/tmp/_x'",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '%\xC3\xA9'",
+      "SELECT * FROM shared_scan_test WHERE path LIKE '%\xC3\x89%'"};
+
+  for (const auto &query : kQueryList) {
+    CAPTURE(query);
+
+    IVirtualDatabase::QueryOutput expected_output;
+    REQUIRE(virtual_database->query(expected_output, query).succeeded());
+
+    SharedScanQuery::Ref shared_scan_query;
+    REQUIRE(SharedScanQuery::create(shared_scan_query, query).succeeded());
+
+    IVirtualDatabase::QueryOutput output;
+    REQUIRE(shared_scan_query->execute(output, table_scan).succeeded());
+
+    REQUIRE(equals(output, expected_output));
+  }
+
+  SharedScanQuery::Ref shared_scan_query;
+  REQUIRE(SharedScanQuery::create(
+              shared_scan_query,
+              "SELECT * FROM shared_scan_test WHERE missing_column = 1")
+              .succeeded());
+
+  IVirtualDatabase::QueryOutput output;
+  REQUIRE(!shared_scan_query->execute(output, table_scan).succeeded());
+}
+
+TEST_CASE("Shared scan query with mixed row layouts", "[SharedScanQuery]") {
+  // clang-format off
+  const IVirtualDatabase::QueryOutput kTableScan = {
+    { { "pid", std::int64_t{1} }, { "path", std::string("/tmp/a") } },
+    { { "path", std::string("/tmp/b") }, { "pid", std::int64_t{2} } },
+    { { "pid", std::int64_t{3} }, { "path", std::string("/usr/c") } },
+    { { "extra", 1.5 }, { "path", std::string("/tmp/d") },
+      { "pid", std::int64_t{4} } }
+  };
+  // clang-format on
+
+  SharedScanQuery::Ref shared_scan_query;
+  REQUIRE(SharedScanQuery::create(
+              shared_scan_query,
+              "SELECT pid FROM shared_scan_test WHERE path LIKE '/tmp/%'")
+              .succeeded());
+
+  IVirtualDatabase::QueryOutput output;
+  REQUIRE(shared_scan_query->execute(output, kTableScan).succeeded());
+
+  // clang-format off
+  const IVirtualDatabase::QueryOutput kExpectedOutput = {
+    { { "pid", std::int64_t{1} } },
+    { { "pid", std::int64_t{2} } },
+    { { "pid", std::int64_t{4} } }
+  };
+  // clang-format on
+
+  REQUIRE(equals(output, kExpectedOutput));
+}
+} // namespace zeek
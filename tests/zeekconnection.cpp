@@ -1,4 +1,12 @@
+#include "allocationcounter.h"
 #include "zeekconnection.h"
+#include "zeekeventserializer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <set>
+#include <thread>
 
 #include <catch2/catch.hpp>
 
@@ -88,6 +96,7 @@ TEST_CASE("Query differentials", "[ZeekConnection]") {
   //
 
   ZeekConnection::DifferentialContext diff_context;
+  ZeekConnection::PendingDifferentialContext pending_diff_context;
 
   QueryScheduler::TaskOutput task_output;
   task_output.response_topic = "DummyResponseTopic";
@@ -99,8 +108,8 @@ TEST_CASE("Query differentials", "[ZeekConnection]") {
   ZeekConnection::DifferentialOutput diff_output;
 
   task_output.query_output = kQueryOutput01;
-  auto status = ZeekConnection::computeDifferentials(diff_context, diff_output,
-                                                     task_output);
+  auto status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
 
   REQUIRE(status.succeeded());
   REQUIRE(diff_output.added_row_list.size() == 3U);
@@ -108,8 +117,8 @@ TEST_CASE("Query differentials", "[ZeekConnection]") {
 
   // On the second run, the output has not changed
   task_output.query_output = kQueryOutput01;
-  status = ZeekConnection::computeDifferentials(diff_context, diff_output,
-                                                task_output);
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
 
   REQUIRE(status.succeeded());
   REQUIRE(diff_output.added_row_list.empty());
@@ -118,8 +127,8 @@ TEST_CASE("Query differentials", "[ZeekConnection]") {
   // On the third run, one row has been removed, while the other two
   // have been left intact
   task_output.query_output = kQueryOutput02;
-  status = ZeekConnection::computeDifferentials(diff_context, diff_output,
-                                                task_output);
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
 
   REQUIRE(status.succeeded());
   REQUIRE(diff_output.added_row_list.empty());
@@ -127,11 +136,486 @@ TEST_CASE("Query differentials", "[ZeekConnection]") {
 
   // On the fourth run, two rows have disappeared and one has been restored
   task_output.query_output = kQueryOutput03;
-  status = ZeekConnection::computeDifferentials(diff_context, diff_output,
-                                                task_output);
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.size() == 1U);
+  REQUIRE(diff_output.removed_row_list.size() == 2U);
+  REQUIRE(pending_diff_context.empty());
+
+  //
+  // Compute the same differentials from an output split in chunks
+  //
+
+  diff_context = {};
+
+  // The first execution is received one row at a time, and every row is
+  // reported as soon as it arrives
+  for (std::size_t i = 0U; i < kQueryOutput01.size(); ++i) {
+    task_output.query_output = {kQueryOutput01.at(i)};
+    task_output.chunk_index = i;
+    task_output.last_chunk = i + 1U == kQueryOutput01.size();
+
+    status = ZeekConnection::computeDifferentials(
+        diff_context, pending_diff_context, diff_output, task_output);
+
+    REQUIRE(status.succeeded());
+    REQUIRE(diff_output.added_row_list.size() == 1U);
+    REQUIRE(diff_output.removed_row_list.empty());
+    REQUIRE(diff_context.empty() == !task_output.last_chunk);
+  }
+
+  // Rows are only reported as removed once the last chunk has arrived
+  task_output.query_output = {kQueryOutput02.at(0U)};
+  task_output.chunk_index = 0U;
+  task_output.last_chunk = false;
+
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.empty());
+  REQUIRE(diff_output.removed_row_list.empty());
+
+  task_output.query_output = {kQueryOutput02.at(1U)};
+  task_output.chunk_index = 1U;
+  task_output.last_chunk = true;
+
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.empty());
+  REQUIRE(diff_output.removed_row_list.size() == 1U);
+  REQUIRE(pending_diff_context.empty());
+
+  // When the first chunks are missing, new rows are still reported but
+  // nothing is removed
+  task_output.query_output = kQueryOutput03;
+  task_output.chunk_index = 1U;
+  task_output.last_chunk = true;
+
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
 
   REQUIRE(status.succeeded());
   REQUIRE(diff_output.added_row_list.size() == 1U);
+  REQUIRE(diff_output.removed_row_list.empty());
+  REQUIRE(diff_context.begin()->second.row_hash_set.size() == 3U);
+  REQUIRE(diff_context.begin()->second.row_map.size() == 3U);
+
+  // An aborted execution does not remove anything either; the next
+  // complete execution determines which rows are gone
+  task_output.query_output = kQueryOutput03;
+  task_output.chunk_index = 0U;
+  task_output.last_chunk = false;
+
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+
+  task_output.query_output = {};
+  task_output.chunk_index = 1U;
+  task_output.last_chunk = true;
+  task_output.aborted = true;
+
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.empty());
+  REQUIRE(diff_output.removed_row_list.empty());
+  REQUIRE(pending_diff_context.empty());
+  REQUIRE(diff_context.begin()->second.row_hash_set.size() == 3U);
+
+  task_output.query_output = kQueryOutput03;
+  task_output.chunk_index = 0U;
+  task_output.aborted = false;
+
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.empty());
   REQUIRE(diff_output.removed_row_list.size() == 2U);
+
+  //
+  // Queries that only report new rows do not keep the rows around
+  //
+
+  diff_context = {};
+  task_output.update_type = QueryScheduler::Task::UpdateType::Added;
+  task_output.chunk_index = 0U;
+  task_output.last_chunk = true;
+
+  task_output.query_output = kQueryOutput01;
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.size() == 3U);
+  REQUIRE(diff_context.begin()->second.row_hash_set.size() == 3U);
+  REQUIRE(diff_context.begin()->second.row_map.empty());
+
+  task_output.query_output = kQueryOutput03;
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.empty());
+  REQUIRE(diff_output.removed_row_list.empty());
+
+  task_output.query_output = kQueryOutput01;
+  status = ZeekConnection::computeDifferentials(
+      diff_context, pending_diff_context, diff_output, task_output);
+
+  REQUIRE(status.succeeded());
+  REQUIRE(diff_output.added_row_list.size() == 2U);
+  REQUIRE(diff_output.removed_row_list.empty());
+  REQUIRE(diff_context.begin()->second.row_map.empty());
+}
+
+TEST_CASE("Query output hashing", "[ZeekConnection]") {
+  // clang-format off
+  static const IVirtualDatabase::QueryOutput kQueryOutput = {
+    {
+      { "Value", "1" }
+    },
+
+    {
+      { "Value", static_cast<std::int64_t>(1) }
+    },
+
+    {
+      { "Value", 1.0 }
+    },
+
+    {
+      { "Value", IVirtualTable::OptionalVariant() }
+    },
+
+    {
+      { "Value", "" }
+    },
+
+    {
+      { "Key", "ab" },
+      { "Value", "c" }
+    },
+
+    {
+      { "Key", "a" },
+      { "Value", "bc" }
+    }
+  };
+  // clang-format on
+
+  // Values that only differ by type, and strings that only differ by how
+  // they are split across columns, must not produce the same hash
+  std::set<std::uint64_t> row_hash_set;
+
+  for (const auto &row : kQueryOutput) {
+    std::uint64_t hash{0U};
+    auto status = ZeekConnection::computeQueryOutputHash(hash, row);
+    REQUIRE(status.succeeded());
+
+    row_hash_set.insert(hash);
+  }
+
+  REQUIRE(row_hash_set.size() == kQueryOutput.size());
+
+  // The hash is stable
+  const auto &row = kQueryOutput.at(0U);
+
+  std::uint64_t first_hash{0U};
+  auto status = ZeekConnection::computeQueryOutputHash(first_hash, row);
+  REQUIRE(status.succeeded());
+
+  std::uint64_t second_hash{0U};
+  status = ZeekConnection::computeQueryOutputHash(second_hash, row);
+  REQUIRE(status.succeeded());
+
+  REQUIRE(first_hash == second_hash);
+}
+
+TEST_CASE("Differential context memory usage",
+          "[.benchmark][ZeekConnection]") {
+  const std::size_t kRowCount{100000U};
+
+  QueryScheduler::TaskOutput task_output;
+  task_output.response_topic = "DummyResponseTopic";
+  task_output.response_event = "DummyResponseEvent";
+  task_output.cookie = "DummyCookie";
+
+  for (std::size_t i = 0U; i < kRowCount; ++i) {
+    // clang-format off
+    task_output.query_output.push_back(
+      {
+        { "pid", static_cast<std::int64_t>(i) },
+        { "ppid", static_cast<std::int64_t>(1) },
+        { "name", "process_name_" + std::to_string(i) },
+        { "path", "/usr/local/bin/process_name_" + std::to_string(i) },
+        { "start_time", static_cast<double>(1600000000 + i) }
+      }
+    );
+    // clang-format on
+  }
+
+  auto measure = [&task_output, &kRowCount](
+                     QueryScheduler::Task::UpdateType update_type,
+                     const std::string &mode_name) {
+    task_output.update_type = update_type;
+
+    ZeekConnection::DifferentialContext diff_context;
+    ZeekConnection::PendingDifferentialContext pending_diff_context;
+
+    std::int64_t live_byte_count{0};
+    std::chrono::microseconds wall_time{};
+
+    {
+      AllocationCounter allocation_counter;
+      auto start_time = std::chrono::steady_clock::now();
+
+      {
+        ZeekConnection::DifferentialOutput diff_output;
+
+        auto status = ZeekConnection::computeDifferentials(
+            diff_context, pending_diff_context, diff_output, task_output);
+
+        REQUIRE(status.succeeded());
+        REQUIRE(diff_output.added_row_list.size() == kRowCount);
+      }
+
+      wall_time = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_time);
+
+      live_byte_count = allocation_counter.liveByteCount();
+    }
+
+    WARN(mode_name << ": "
+                   << (static_cast<double>(live_byte_count) /
+                       static_cast<double>(kRowCount))
+                   << " bytes per tracked row, wall time: "
+                   << wall_time.count() << "us");
+  };
+
+  measure(QueryScheduler::Task::UpdateType::Both, "Rows kept (removed rows)");
+  measure(QueryScheduler::Task::UpdateType::Added, "Hashes only (added rows)");
+}
+
+TEST_CASE("Zeek event batching", "[ZeekConnection]") {
+  // clang-format off
+  static const IVirtualDatabase::QueryOutput kQueryOutput = {
+    {
+      { "pid", static_cast<std::int64_t>(1) },
+      { "name", "init" }
+    },
+
+    {
+      { "pid", static_cast<std::int64_t>(2) },
+      { "name", IVirtualTable::OptionalVariant() }
+    },
+
+    {
+      { "pid", static_cast<std::int64_t>(3) },
+      { "name", "kthreadd" }
+    },
+
+    // Values that do not match the type of their column are still encoded
+    {
+      { "pid", "4" },
+      { "name", 3.5 }
+    }
+  };
+  // clang-format on
+
+  ZeekEventSerializer::EventList event_list;
+  std::size_t null_column_count{0U};
+
+  // Without batching, each row is sent as its own event
+  IZeekConfiguration::ZeekEventBatching batching;
+
+  {
+    ZeekEventSerializer event_serializer(batching);
+    event_serializer.serialize(event_list, null_column_count, "host",
+                               "ZeekAgent::SNAPSHOT", "process_result",
+                               "cookie", kQueryOutput);
+  }
+
+  REQUIRE(null_column_count == 1U);
+  REQUIRE(event_list.size() == 4U);
+
+  for (const auto &event : event_list) {
+    REQUIRE(event.name() == "process_result");
+    REQUIRE(event.args().size() == 3U);
+  }
+
+  const auto &last_row = event_list.back().args();
+  REQUIRE(broker::get<std::string>(last_row.at(1U)) == "4");
+  REQUIRE(broker::get<double>(last_row.at(2U)) == 3.5);
+
+  // Batches are split by row count
+  batching.max_row_count = 3U;
+
+  {
+    ZeekEventSerializer event_serializer(batching);
+    event_serializer.serialize(event_list, null_column_count, "host",
+                               "ZeekAgent::SNAPSHOT", "process_result",
+                               "cookie", kQueryOutput);
+  }
+
+  REQUIRE(null_column_count == 1U);
+  REQUIRE(event_list.size() == 2U);
+
+  auto batchRowCount = [](const broker::zeek::Event &event) -> std::size_t {
+    REQUIRE(event.name() == "process_result_batch");
+    REQUIRE(event.args().size() == 2U);
+
+    return broker::get<broker::vector>(event.args().at(1U)).size();
+  };
+
+  REQUIRE(batchRowCount(event_list.at(0U)) == 3U);
+  REQUIRE(batchRowCount(event_list.at(1U)) == 1U);
+
+  // ...and by size, but a batch always contains at least one row
+  batching.max_row_count = 256U;
+  batching.max_byte_count = 1U;
+
+  ZeekEventSerializer event_serializer(batching);
+  event_serializer.serialize(event_list, null_column_count, "host",
+                             "ZeekAgent::SNAPSHOT", "process_result",
+                             "cookie", kQueryOutput);
+
+  REQUIRE(event_list.size() == 4U);
+
+  for (const auto &event : event_list) {
+    REQUIRE(batchRowCount(event) == 1U);
+  }
+
+  // Empty output generates no events
+  event_serializer.serialize(event_list, null_column_count, "host",
+                             "ZeekAgent::SNAPSHOT", "process_result",
+                             "cookie", {});
+
+  REQUIRE(event_list.empty());
+  REQUIRE(null_column_count == 0U);
+}
+
+TEST_CASE("Zeek event publishing throughput",
+          "[.benchmark][ZeekConnection]") {
+  const std::size_t kRowCount{50000U};
+  const std::string kTopic{"/zeek/zeek-agent/benchmark"};
+  const std::chrono::seconds kTimeout{30};
+
+  IVirtualDatabase::QueryOutput query_output;
+  for (std::size_t i = 0U; i < kRowCount; ++i) {
+    // clang-format off
+    query_output.push_back(
+      {
+        { "pid", static_cast<std::int64_t>(i) },
+        { "ppid", static_cast<std::int64_t>(1) },
+        { "name", "process_" + std::to_string(i) },
+        { "path", "/usr/bin/process_" + std::to_string(i) },
+        { "start_time", static_cast<std::int64_t>(1600000000 + i) }
+      }
+    );
+    // clang-format on
+  }
+
+  broker::endpoint receiver;
+  auto port = receiver.listen("127.0.0.1", 0);
+  REQUIRE(port != 0U);
+
+  auto subscriber = receiver.make_subscriber({kTopic});
+
+  broker::endpoint sender;
+  REQUIRE(sender.peer("127.0.0.1", port));
+
+  // Wait for the subscription to reach the sender
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+
+  for (;;) {
+    REQUIRE(std::chrono::steady_clock::now() < deadline);
+
+    sender.publish(kTopic, broker::zeek::Event("probe", broker::vector{}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    if (!subscriber.poll().empty()) {
+      break;
+    }
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  subscriber.poll();
+
+  auto receiveRows = [&subscriber, &kTimeout, &kRowCount]() -> std::size_t {
+    auto receive_deadline = std::chrono::steady_clock::now() + kTimeout;
+    std::size_t row_count{0U};
+
+    while (row_count < kRowCount &&
+           std::chrono::steady_clock::now() < receive_deadline) {
+
+      auto message_list = subscriber.poll();
+      if (message_list.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+
+      for (const auto &message : message_list) {
+        broker::zeek::Event event(caf::get<1>(message));
+
+        if (event.name() == "benchmark_result") {
+          ++row_count;
+
+        } else if (event.name() == "benchmark_result_batch") {
+          row_count += broker::get<broker::vector>(event.args().at(1U)).size();
+        }
+      }
+    }
+
+    return row_count;
+  };
+
+  auto publishRows =
+      [&](const IZeekConfiguration::ZeekEventBatching &batching,
+          const std::string &mode_name) {
+        auto start_time = std::chrono::steady_clock::now();
+
+        ZeekEventSerializer event_serializer(batching);
+
+        ZeekEventSerializer::EventList event_list;
+        std::size_t null_column_count{0U};
+
+        event_serializer.serialize(event_list, null_column_count, "host",
+                                   "ZeekAgent::SNAPSHOT", "benchmark_result",
+                                   "cookie", query_output);
+
+        auto event_count = event_list.size();
+
+        auto received_row_count = std::async(std::launch::async, receiveRows);
+
+        for (auto &event : event_list) {
+          sender.publish(kTopic, std::move(event));
+        }
+
+        REQUIRE(received_row_count.get() == kRowCount);
+
+        auto wall_time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time);
+
+        WARN(mode_name << ": " << event_count << " events, wall time: "
+                       << wall_time.count() << "us ("
+                       << (static_cast<long long>(kRowCount) * 1000000LL /
+                           std::max<long long>(wall_time.count(), 1))
+                       << " rows/s)");
+      };
+
+  IZeekConfiguration::ZeekEventBatching batching;
+  publishRows(batching, "One event per row");
+
+  batching.max_row_count = 256U;
+  publishRows(batching, "Batches of 256 rows");
 }
 } // namespace zeek
@@ -0,0 +1,111 @@
+#include "allocationcounter.h"
+#include "zeekeventserializer.h"
+
+#include <chrono>
+
+#include <catch2/catch.hpp>
+
+namespace zeek {
+namespace {
+IVirtualDatabase::QueryOutput generateProcessRows(std::size_t row_count) {
+  IVirtualDatabase::QueryOutput query_output;
+  query_output.reserve(row_count);
+
+  for (std::size_t i = 0U; i < row_count; ++i) {
+    // clang-format off
+    query_output.push_back(
+      {
+        { "pid", static_cast<std::int64_t>(i) },
+        { "ppid", static_cast<std::int64_t>(1) },
+        { "name", "process_name_" + std::to_string(i) },
+        { "path", "/usr/local/bin/process_name_" + std::to_string(i) },
+        { "start_time", static_cast<double>(1600000000 + i) }
+      }
+    );
+    // clang-format on
+  }
+
+  return query_output;
+}
+} // namespace
+
+TEST_CASE("Column encoder plan", "[ZeekEventSerializer]") {
+  // clang-format off
+  static const IVirtualDatabase::QueryOutput kQueryOutput = {
+    {
+      { "pid", static_cast<std::int64_t>(1) },
+      { "name", IVirtualTable::OptionalVariant() },
+      { "cpu", IVirtualTable::OptionalVariant() }
+    },
+
+    {
+      { "pid", static_cast<std::int64_t>(2) },
+      { "name", "kthreadd" },
+      { "cpu", IVirtualTable::OptionalVariant() }
+    }
+  };
+  // clang-format on
+
+  auto column_encoder_plan =
+      ZeekEventSerializer::createColumnEncoderPlan(kQueryOutput);
+
+  REQUIRE(column_encoder_plan.size() == 3U);
+  REQUIRE(column_encoder_plan.at(0U) ==
+          ZeekEventSerializer::ColumnEncoder::Integer);
+
+  REQUIRE(column_encoder_plan.at(1U) ==
+          ZeekEventSerializer::ColumnEncoder::String);
+
+  REQUIRE(column_encoder_plan.at(2U) ==
+          ZeekEventSerializer::ColumnEncoder::Unknown);
+
+  REQUIRE(ZeekEventSerializer::createColumnEncoderPlan({}).empty());
+}
+
+TEST_CASE("Zeek event serializer allocations",
+          "[.benchmark][ZeekEventSerializer]") {
+  const std::size_t kRowCount{10000U};
+
+  auto measure = [&kRowCount](
+                     const IZeekConfiguration::ZeekEventBatching &batching,
+                     const std::string &mode_name) {
+    ZeekEventSerializer event_serializer(batching);
+
+    ZeekEventSerializer::EventList event_list;
+    std::size_t null_column_count{0U};
+
+    // Only the serialization is measured, not the copy of the query output
+    auto query_output = generateProcessRows(kRowCount);
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::size_t allocation_count{0U};
+
+    {
+      AllocationCounter allocation_counter;
+
+      event_serializer.serialize(event_list, null_column_count, "host",
+                                 "ZeekAgent::SNAPSHOT", "process_result",
+                                 "cookie", std::move(query_output));
+
+      allocation_count = allocation_counter.count();
+    }
+
+    auto wall_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+
+    REQUIRE(null_column_count == 0U);
+
+    WARN(mode_name << ": " << event_list.size() << " events, "
+                   << (static_cast<double>(allocation_count) /
+                       static_cast<double>(kRowCount))
+                   << " allocations per row, wall time: " << wall_time.count()
+                   << "us");
+  };
+
+  IZeekConfiguration::ZeekEventBatching batching;
+  measure(batching, "One event per row");
+
+  batching.max_row_count = 256U;
+  measure(batching, "Batches of 256 rows");
+}
+} // namespace zeek
@@ -0,0 +1,231 @@
+#include "zeekserverstandin.h"
+#include "activityreactor.h"
+
+#include <broker/broker.hh>
+#include <broker/zeek.hh>
+
+namespace zeek {
+namespace {
+const std::string kHostAnnounceTopic{"/zeek/zeek-agent/host_announce"};
+const std::string kHostTopicPrefix{"/zeek/zeek-agent/host/"};
+const std::string kHostNewEvent{"ZeekAgent::host_new"};
+const std::string kBatchEventSuffix{"_batch"};
+const std::string kSnapshotUpdateType{"SNAPSHOT"};
+} // namespace
+
+const std::string ZeekServerStandIn::kResponseTopic{
+    "/zeek/zeek-agent/response/stand-in"};
+
+const std::string ZeekServerStandIn::kResponseEvent{"stand_in_response"};
+
+struct ZeekServerStandIn::PrivateData final {
+  PrivateData()
+      : subscriber(endpoint.make_subscriber(
+            {kHostAnnounceTopic, ZeekServerStandIn::kResponseTopic})) {}
+
+  broker::endpoint endpoint;
+  broker::subscriber subscriber;
+  ActivityReactor::Ref activity_reactor;
+  std::uint16_t port{0U};
+};
+
+std::size_t ZeekServerStandIn::ResponseStats::rowCount() const {
+  return added_row_count + removed_row_count + snapshot_row_count;
+}
+
+ZeekServerStandIn::ZeekServerStandIn(std::uint16_t port)
+    : d(new PrivateData) {
+  d->port = d->endpoint.listen("127.0.0.1", port);
+  if (d->port == 0U) {
+    throw Status::failure("Failed to start listening");
+  }
+
+  auto status = ActivityReactor::create(d->activity_reactor);
+  if (!status.succeeded()) {
+    throw status;
+  }
+
+  status = d->activity_reactor->add(
+      static_cast<ActivityReactor::Descriptor>(d->subscriber.fd()));
+
+  if (!status.succeeded()) {
+    throw status;
+  }
+}
+
+ZeekServerStandIn::~ZeekServerStandIn() { d->endpoint.shutdown(); }
+
+std::uint16_t ZeekServerStandIn::port() const { return d->port; }
+
+Status ZeekServerStandIn::waitForHostAnnounce(
+    std::string &host_identifier, std::chrono::milliseconds timeout) {
+
+  host_identifier = {};
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (std::chrono::steady_clock::now() < deadline) {
+    ActivityReactor::DescriptorList ready_list;
+    auto status = d->activity_reactor->wait(
+        ready_list, std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()));
+
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    for (const auto &message : d->subscriber.poll()) {
+      broker::zeek::Event event(caf::get<1>(message));
+      if (event.name() != kHostNewEvent) {
+        continue;
+      }
+
+      const auto &argument_list = event.args();
+      if (argument_list.size() < 3U ||
+          !broker::is<std::string>(argument_list[2])) {
+        return Status::failure("Invalid host_new event received");
+      }
+
+      host_identifier = broker::get<std::string>(argument_list[2]);
+      return Status::success();
+    }
+  }
+
+  return Status::failure("Timed out while waiting for the host_new event");
+}
+
+void ZeekServerStandIn::sendHostExecute(const std::string &host_identifier,
+                                        const std::string &query,
+                                        const std::string &cookie) {
+  // clang-format off
+  broker::zeek::Event event(
+    "ZeekAgent::host_execute",
+
+    {
+      broker::data(kResponseEvent),
+      broker::data(query),
+      broker::data(cookie),
+      broker::data(kResponseTopic),
+      broker::data(kSnapshotUpdateType)
+    }
+  );
+  // clang-format on
+
+  d->endpoint.publish(kHostTopicPrefix + host_identifier, std::move(event));
+}
+
+void ZeekServerStandIn::sendHostSubscribe(const std::string &host_identifier,
+                                          const std::string &query,
+                                          const std::string &cookie,
+                                          const std::string &update_type,
+                                          std::chrono::milliseconds interval) {
+  // clang-format off
+  broker::zeek::Event event(
+    "ZeekAgent::host_subscribe",
+
+    {
+      broker::data(kResponseEvent),
+      broker::data(query),
+      broker::data(cookie),
+      broker::data(kResponseTopic),
+      broker::data(update_type),
+      broker::data(broker::timespan(interval))
+    }
+  );
+  // clang-format on
+
+  d->endpoint.publish(kHostTopicPrefix + host_identifier, std::move(event));
+}
+
+Status ZeekServerStandIn::receiveResponses(ResponseStats &stats,
+                                           const std::string &cookie,
+                                           std::size_t row_count,
+                                           std::chrono::milliseconds timeout) {
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (stats.rowCount() < row_count) {
+    auto current_time = std::chrono::steady_clock::now();
+    if (current_time >= deadline) {
+      return Status::failure(
+          "Timed out while waiting for the responses; received " +
+          std::to_string(stats.rowCount()) + " rows out of " +
+          std::to_string(row_count));
+    }
+
+    ActivityReactor::DescriptorList ready_list;
+    auto status = d->activity_reactor->wait(
+        ready_list, std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - current_time));
+
+    if (!status.succeeded()) {
+      return status;
+    }
+
+    auto message_list = d->subscriber.poll();
+    auto receive_time = std::chrono::steady_clock::now();
+
+    for (const auto &message : message_list) {
+      broker::zeek::Event event(caf::get<1>(message));
+
+      auto batched = event.name() == kResponseEvent + kBatchEventSuffix;
+      if (!batched && event.name() != kResponseEvent) {
+        continue;
+      }
+
+      const auto &argument_list = event.args();
+      if (argument_list.empty() ||
+          !broker::is<broker::vector>(argument_list[0])) {
+        return Status::failure("Invalid response event received");
+      }
+
+      const auto &message_header =
+          broker::get<broker::vector>(argument_list[0]);
+      if (message_header.size() != 3U ||
+          !broker::is<broker::enum_value>(message_header[1]) ||
+          !broker::is<std::string>(message_header[2])) {
+        return Status::failure("Invalid response header received");
+      }
+
+      if (broker::get<std::string>(message_header[2]) != cookie) {
+        continue;
+      }
+
+      std::size_t event_row_count{1U};
+
+      if (batched) {
+        if (argument_list.size() != 2U ||
+            !broker::is<broker::vector>(argument_list[1])) {
+          return Status::failure("Invalid batched response event received");
+        }
+
+        event_row_count = broker::get<broker::vector>(argument_list[1]).size();
+      }
+
+      const auto &trigger = broker::get<broker::enum_value>(message_header[1]);
+
+      if (trigger.name == "ZeekAgent::ADD") {
+        stats.added_row_count += event_row_count;
+
+      } else if (trigger.name == "ZeekAgent::REMOVE") {
+        stats.removed_row_count += event_row_count;
+
+      } else if (trigger.name == "ZeekAgent::SNAPSHOT") {
+        stats.snapshot_row_count += event_row_count;
+
+      } else {
+        return Status::failure("Invalid trigger received: " + trigger.name);
+      }
+
+      if (stats.event_count == 0U) {
+        stats.first_event_time = receive_time;
+      }
+
+      stats.last_event_time = receive_time;
+      ++stats.event_count;
+    }
+  }
+
+  return Status::success();
+}
+} // namespace zeek
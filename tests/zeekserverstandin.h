@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <zeek/status.h>
+
+namespace zeek {
+/// \brief A local broker endpoint that plays the role of the Zeek server,
+///        so that the whole output path can be tested in-process
+class ZeekServerStandIn final {
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+public:
+  /// \brief The topic the agent sends its responses to
+  static const std::string kResponseTopic;
+
+  /// \brief The name of the response event
+  static const std::string kResponseEvent;
+
+  /// \brief What has been received in response to a single query
+  struct ResponseStats final {
+    /// \brief How many response events have been received
+    std::size_t event_count{0U};
+
+    /// \brief How many rows have been received, for each trigger
+    std::size_t added_row_count{0U};
+    std::size_t removed_row_count{0U};
+    std::size_t snapshot_row_count{0U};
+
+    /// \brief When the first and the last events have been received
+    std::chrono::steady_clock::time_point first_event_time;
+    std::chrono::steady_clock::time_point last_event_time;
+
+    /// \return The sum of all the row counts
+    std::size_t rowCount() const;
+  };
+
+  /// \brief Constructor; starts listening on the given local port
+  /// \param port The port to listen on; zero picks a random one
+  explicit ZeekServerStandIn(std::uint16_t port = 0U);
+
+  /// \brief Destructor
+  ~ZeekServerStandIn();
+
+  /// \return The port the endpoint is listening on
+  std::uint16_t port() const;
+
+  /// \brief Waits for the host_new event the agent sends after connecting
+  /// \param host_identifier Where the identifier of the agent is stored
+  /// \param timeout How long to wait at most
+  /// \return A Status object
+  Status waitForHostAnnounce(std::string &host_identifier,
+                             std::chrono::milliseconds timeout);
+
+  /// \brief Sends a host_execute event (a one-shot query) to the agent
+  /// \param host_identifier The agent identifier
+  /// \param query The SQL query
+  /// \param cookie The id that identifies the query
+  void sendHostExecute(const std::string &host_identifier,
+                       const std::string &query, const std::string &cookie);
+
+  /// \brief Sends a host_subscribe event (a scheduled query) to the agent
+  /// \param host_identifier The agent identifier
+  /// \param query The SQL query
+  /// \param cookie The id that identifies the query
+  /// \param update_type ADDED, REMOVED or BOTH
+  /// \param interval How often the query is executed
+  void sendHostSubscribe(const std::string &host_identifier,
+                         const std::string &query, const std::string &cookie,
+                         const std::string &update_type,
+                         std::chrono::milliseconds interval);
+
+  /// \brief Receives the responses for the given query, until the expected
+  ///        amount of rows has been received
+  /// \param stats Where the received events are accounted; it is not reset,
+  ///              so that it can accumulate many calls
+  /// \param cookie The id that identifies the query; the responses for the
+  ///               other queries are ignored
+  /// \param row_count How many rows to wait for, in total
+  /// \param timeout How long to wait at most
+  /// \return A Status object
+  Status receiveResponses(ResponseStats &stats, const std::string &cookie,
+                          std::size_t row_count,
+                          std::chrono::milliseconds timeout);
+
+  ZeekServerStandIn(const ZeekServerStandIn &) = delete;
+  ZeekServerStandIn &operator=(const ZeekServerStandIn &) = delete;
+};
+} // namespace zeek